@@ -0,0 +1,350 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "SnapshotMigratorBenchmarkCommandlet.h"
+#include "SnapshotMigratorModuleInternal.h"
+
+#include "SnapshotMigratorCommandletV2.h"
+#include "Util/SnapshotHelperLibrary.h"
+#include "Util/SnapshotMigrationAllocationCounter.h"
+
+#include "Dom/JsonValue.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+#include "SpatialGDKServicesConstants.h"
+
+namespace
+{
+	const FString SCHEMA_BUNDLE_FILENAME{ TEXT("schema.sb.json") };
+	const FString SYNTHETIC_SNAPSHOT_FILENAME{ TEXT("Synthetic.snapshot") };
+	const FString STATUS_FILENAME{ TEXT("Status.json") };
+	const float PROGRESS_INTERVAL = 60.f;
+
+	const double BYTES_PER_MEGABYTE = 1024.0 * 1024.0;
+
+	double GetMedian(TArray<double> Values)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0;
+		}
+
+		Values.Sort();
+		const int32 Middle = Values.Num() / 2;
+		return Values.Num() % 2 == 1 ? Values[Middle] : (Values[Middle - 1] + Values[Middle]) / 2.0;
+	}
+}
+
+USnapshotMigratorBenchmarkCommandlet::USnapshotMigratorBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USnapshotMigratorBenchmarkCommandlet::Main(const FString& Params)
+{
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Starting Snapshot Migrator Benchmark Commandlet"));
+
+	if (!Setup(Params))
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to initialise benchmark commandlet!"));
+		return 1;
+	}
+
+	const FString& ArtifactsDir = FPaths::Combine(BenchmarkDir, FString{ TEXT("artifacts") });
+
+	TSharedPtr<FJsonObject> GenerationJson;
+	if (!GenerateSourceArtifacts(ArtifactsDir, GenerationJson))
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to generate synthetic snapshot!"));
+		return 1;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> IterationsJson;
+	TArray<double> EntitiesPerSecond;
+	TArray<double> ReadMegabytesPerSecond;
+	TArray<double> AllocationsPerEntity;
+
+	for (int32 i = 0; i < NumIterations; i++)
+	{
+		UE_LOG(LogSnapshotMigrator, Display, TEXT("Running benchmark iteration %d of %d"), i + 1, NumIterations);
+
+		TSharedPtr<FJsonObject> IterationJson;
+		if (!RunIteration(Params, ArtifactsDir, IterationJson))
+		{
+			UE_LOG(LogSnapshotMigrator, Error, TEXT("Benchmark iteration %d failed!"), i + 1);
+			return 1;
+		}
+
+		EntitiesPerSecond.Add(IterationJson->GetNumberField(TEXT("EntitiesPerSecond")));
+		ReadMegabytesPerSecond.Add(IterationJson->GetNumberField(TEXT("ReadMegabytesPerSecond")));
+		AllocationsPerEntity.Add(IterationJson->GetNumberField(TEXT("AllocationsPerEntity")));
+
+		IterationsJson.Add(MakeShareable(new FJsonValueObject(IterationJson)));
+	}
+
+	// Medians are less sensitive than means to the odd iteration being disturbed by something else running on the machine.
+	TSharedRef<FJsonObject> SummaryJson = MakeShareable(new FJsonObject);
+	SummaryJson->SetNumberField(FString{ TEXT("EntitiesPerSecond") }, GetMedian(EntitiesPerSecond));
+	SummaryJson->SetNumberField(FString{ TEXT("ReadMegabytesPerSecond") }, GetMedian(ReadMegabytesPerSecond));
+	SummaryJson->SetNumberField(FString{ TEXT("AllocationsPerEntity") }, GetMedian(AllocationsPerEntity));
+	SummaryJson->SetNumberField(FString{ TEXT("PeakResidentMegabytes") }, FPlatformMemory::GetStats().PeakUsedPhysical / BYTES_PER_MEGABYTE);
+
+	TSharedRef<FJsonObject> RunJson = MakeShareable(new FJsonObject);
+	RunJson->SetStringField(FString{ TEXT("Label") }, Label);
+	RunJson->SetStringField(FString{ TEXT("Timestamp") }, FDateTime::UtcNow().ToIso8601());
+	RunJson->SetStringField(FString{ TEXT("Params") }, Params);
+	RunJson->SetObjectField(FString{ TEXT("Config") }, GeneratorConfig.ToJson());
+	RunJson->SetObjectField(FString{ TEXT("Generation") }, GenerationJson);
+	RunJson->SetArrayField(FString{ TEXT("Iterations") }, IterationsJson);
+	RunJson->SetObjectField(FString{ TEXT("Summary") }, SummaryJson);
+
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Benchmark '%s': %.1f entities/s, %.2f MB/s read, %.1f allocations/entity, %.1f MB peak resident memory (median of %d iterations)."),
+		*Label, SummaryJson->GetNumberField(TEXT("EntitiesPerSecond")), SummaryJson->GetNumberField(TEXT("ReadMegabytesPerSecond")),
+		SummaryJson->GetNumberField(TEXT("AllocationsPerEntity")), SummaryJson->GetNumberField(TEXT("PeakResidentMegabytes")), NumIterations);
+
+	if (!SnapshotHelperLibrary::AppendBenchmarkRunToResultsFile(ResultsFile, RunJson))
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to write benchmark results to '%s'!"), *ResultsFile);
+		return 1;
+	}
+
+	return 0;
+}
+
+bool USnapshotMigratorBenchmarkCommandlet::Setup(const FString& Params)
+{
+	const FString& DefaultSpatialRootDir = SpatialGDKServicesConstants::SpatialOSDirectory;
+
+	FString OldArtifactsDir;
+	TargetSchemaDir = FPaths::Combine(DefaultSpatialRootDir, FString{ TEXT("build/assembly/schema") });
+	BenchmarkDir = FPaths::Combine(FPaths::ProjectSavedDir(), FString{ TEXT("SnapshotMigratorBenchmark") });
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	ParseCommandLine(*Params, Tokens, Switches);
+
+	// Split won't update target strings if it fails, so we can just ignore the output. It'll be default if it fails or the CL-provided value if it succeeds.
+	for (const FString& CLSwitch : Switches)
+	{
+		FString SwitchName;
+		FString Value;
+		if (CLSwitch.StartsWith(FString{ TEXT("OldArtifactsDir") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &OldArtifactsDir);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("CompiledSchemaDir") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &TargetSchemaDir);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("BenchmarkDir") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &BenchmarkDir);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("ResultsFile") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &ResultsFile);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Label") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Label);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Iterations") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			NumIterations = FMath::Max(1, FCString::Atoi(*Value));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Entities") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			GeneratorConfig.NumEntities = FMath::Max(1, FCString::Atoi(*Value));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("MinComponents") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			GeneratorConfig.MinComponentsPerEntity = FMath::Max(0, FCString::Atoi(*Value));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("MaxComponents") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			GeneratorConfig.MaxComponentsPerEntity = FMath::Max(0, FCString::Atoi(*Value));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("ListSize") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			GeneratorConfig.ListSize = FMath::Max(0, FCString::Atoi(*Value));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("RenamedFieldShare") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			GeneratorConfig.RenamedFieldShare = FMath::Clamp(FCString::Atof(*Value), 0.f, 1.f);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("RetypedFieldShare") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			GeneratorConfig.RetypedFieldShare = FMath::Clamp(FCString::Atof(*Value), 0.f, 1.f);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Seed") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			GeneratorConfig.Seed = FCString::Atoi(*Value);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("ClassMix") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			// Comma separated classpaths, each optionally followed by a relative weight, e.g. -ClassMix=/Game/A.A_C:3,/Game/B.B_C
+			TArray<FString> Classes;
+			Value.ParseIntoArray(Classes, TEXT(","));
+			for (const FString& Class : Classes)
+			{
+				FString ClassPath = Class;
+				FString Weight;
+				const bool bHasWeight = Class.Split(FString{ TEXT(":") }, &ClassPath, &Weight, ESearchCase::CaseSensitive, ESearchDir::FromEnd);
+				GeneratorConfig.ClassMix.Add(TPair<FString, float>{ ClassPath, bHasWeight ? FCString::Atof(*Weight) : 1.f });
+			}
+		}
+	}
+
+	if (GeneratorConfig.ClassMix.Num() == 0)
+	{
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("ClassMix must be provided with at least one actor classpath which matches the classpath whitelist!"));
+		return false;
+	}
+
+	if (GeneratorConfig.MinComponentsPerEntity > GeneratorConfig.MaxComponentsPerEntity)
+	{
+		Swap(GeneratorConfig.MinComponentsPerEntity, GeneratorConfig.MaxComponentsPerEntity);
+	}
+
+	// Synthetic snapshots are derived from the target bundle unless a source bundle is given, in which case renamed and retyped fields come on top
+	// of whatever already differs between the two.
+	BaseSchemaBundlePath = FPaths::Combine(OldArtifactsDir.IsEmpty() ? TargetSchemaDir : OldArtifactsDir, SCHEMA_BUNDLE_FILENAME);
+
+	if (ResultsFile.IsEmpty())
+	{
+		ResultsFile = FPaths::Combine(BenchmarkDir, FString{ TEXT("BenchmarkResults.json") });
+	}
+
+	if (Label.IsEmpty())
+	{
+		Label = FString::Printf(TEXT("%d entities"), GeneratorConfig.NumEntities);
+	}
+
+	return true;
+}
+
+bool USnapshotMigratorBenchmarkCommandlet::GenerateSourceArtifacts(const FString& ArtifactsDir, TSharedPtr<FJsonObject>& OutGenerationJson)
+{
+	TSharedPtr<FJsonObject> BaseSchemaBundleJson;
+	if (!SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(BaseSchemaBundlePath, BaseSchemaBundleJson))
+	{
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to load schema bundle -- ensure that there is a bundle present at '%s'."), *BaseSchemaBundlePath);
+		return false;
+	}
+
+	// The migrator migrates every snapshot in the artifacts directory, so anything left over from a previous benchmark has to go.
+	IFileManager::Get().DeleteDirectory(*ArtifactsDir, false, true);
+	if (!IFileManager::Get().MakeDirectory(*ArtifactsDir, true))
+	{
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to create benchmark artifacts directory '%s'."), *ArtifactsDir);
+		return false;
+	}
+
+	const uint64 GenerationStartCycles = FPlatformTime::Cycles64();
+
+	SyntheticSnapshotGenerator Generator{ GeneratorConfig, BaseSchemaBundleJson };
+
+	TSharedPtr<FJsonObject> SourceSchemaBundleJson;
+	FString SourceSchemaBundleString;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&SourceSchemaBundleString);
+	if (!Generator.GenerateSourceSchemaBundle(SourceSchemaBundleJson) ||
+		!FJsonSerializer::Serialize(SourceSchemaBundleJson.ToSharedRef(), Writer) ||
+		!FFileHelper::SaveStringToFile(SourceSchemaBundleString, *FPaths::Combine(ArtifactsDir, SCHEMA_BUNDLE_FILENAME)))
+	{
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to generate source schema bundle."));
+		return false;
+	}
+
+	const FString& SnapshotPath = FPaths::Combine(ArtifactsDir, SYNTHETIC_SNAPSHOT_FILENAME);
+	if (!Generator.GenerateSnapshot(SnapshotPath))
+	{
+		return false;
+	}
+
+	const SyntheticSnapshotGenerator::Stats& Stats = Generator.GetStats();
+
+	OutGenerationJson = MakeShareable(new FJsonObject);
+	OutGenerationJson->SetStringField(FString{ TEXT("BaseSchemaBundle") }, BaseSchemaBundlePath);
+	OutGenerationJson->SetNumberField(FString{ TEXT("NumEntities") }, Stats.NumEntities);
+	OutGenerationJson->SetNumberField(FString{ TEXT("NumComponents") }, Stats.NumComponents);
+	OutGenerationJson->SetNumberField(FString{ TEXT("NumRenamedFields") }, Stats.NumRenamedFields);
+	OutGenerationJson->SetNumberField(FString{ TEXT("NumRetypedFields") }, Stats.NumRetypedFields);
+	OutGenerationJson->SetNumberField(FString{ TEXT("SnapshotSize") }, IFileManager::Get().FileSize(*SnapshotPath));
+	OutGenerationJson->SetNumberField(FString{ TEXT("GenerationTime") }, FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - GenerationStartCycles));
+
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Generated synthetic snapshot of %d entities and %lld components (%d renamed and %d retyped fields) at %s"),
+		Stats.NumEntities, Stats.NumComponents, Stats.NumRenamedFields, Stats.NumRetypedFields, *SnapshotPath);
+
+	return true;
+}
+
+bool USnapshotMigratorBenchmarkCommandlet::RunIteration(const FString& Params, const FString& ArtifactsDir, TSharedPtr<FJsonObject>& OutIterationJson)
+{
+	const FString& TargetSnapshotDir = FPaths::Combine(BenchmarkDir, FString{ TEXT("snapshots") });
+	const FString& StatusFile = FPaths::Combine(BenchmarkDir, STATUS_FILENAME);
+
+	// The migrator applies switches in order, so these override anything of the same name in the benchmark's own params. Progress reporting has
+	// to stay enabled, since the final progress report is where the migration's timing and byte counts come from.
+	const FString& MigratorParams = FString::Printf(TEXT("%s -OldArtifactsDir=\"%s\" -CompiledSchemaDir=\"%s\" -TargetSnapshotDir=\"%s\" -StatusFile=\"%s\" -ProgressInterval=%.1f"),
+		*Params, *ArtifactsDir, *TargetSchemaDir, *TargetSnapshotDir, *StatusFile, PROGRESS_INTERVAL);
+
+	USnapshotMigratorCommandlet* Migrator = NewObject<USnapshotMigratorCommandlet>();
+
+	// Allocations are counted across the whole run, so they include setup as well as the migration itself.
+	const SnapshotMigrationAllocationCounter& AllocationCounter = SnapshotMigrationAllocationCounter::Get();
+	const int64 StartAllocations = AllocationCounter.GetNumAllocations();
+	const int64 StartBytesAllocated = AllocationCounter.GetNumBytesAllocated();
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const int32 Result = Migrator->Main(MigratorParams);
+	const double TotalTime = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	const int64 NumAllocations = AllocationCounter.GetNumAllocations() - StartAllocations;
+	const int64 NumBytesAllocated = AllocationCounter.GetNumBytesAllocated() - StartBytesAllocated;
+
+	if (Result != 0)
+	{
+		return false;
+	}
+
+	// The final progress report has the migration's own timing and byte counts, which exclude the migrator's setup.
+	FString StatusString;
+	TSharedPtr<FJsonObject> StatusJson;
+	if (!FFileHelper::LoadFileToString(StatusString, *StatusFile) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(StatusString), StatusJson) || !StatusJson.IsValid())
+	{
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to read migrator status from '%s'."), *StatusFile);
+		return false;
+	}
+
+	const double NumProcessedEntities = StatusJson->GetNumberField(TEXT("NumProcessedEntities"));
+	const double ElapsedTime = StatusJson->GetNumberField(TEXT("ElapsedTime"));
+	const double BytesRead = StatusJson->GetNumberField(TEXT("BytesRead"));
+	const double BytesWritten = StatusJson->GetNumberField(TEXT("BytesWritten"));
+
+	OutIterationJson = MakeShareable(new FJsonObject);
+	OutIterationJson->SetNumberField(FString{ TEXT("TotalTime") }, TotalTime);
+	OutIterationJson->SetNumberField(FString{ TEXT("MigrationTime") }, ElapsedTime);
+	OutIterationJson->SetNumberField(FString{ TEXT("NumProcessedEntities") }, NumProcessedEntities);
+	OutIterationJson->SetNumberField(FString{ TEXT("NumMigratedEntities") }, StatusJson->GetNumberField(TEXT("NumMigratedEntities")));
+	OutIterationJson->SetNumberField(FString{ TEXT("BytesRead") }, BytesRead);
+	OutIterationJson->SetNumberField(FString{ TEXT("BytesWritten") }, BytesWritten);
+	OutIterationJson->SetNumberField(FString{ TEXT("EntitiesPerSecond") }, ElapsedTime > 0.0 ? NumProcessedEntities / ElapsedTime : 0.0);
+	OutIterationJson->SetNumberField(FString{ TEXT("ReadMegabytesPerSecond") }, ElapsedTime > 0.0 ? BytesRead / BYTES_PER_MEGABYTE / ElapsedTime : 0.0);
+	OutIterationJson->SetNumberField(FString{ TEXT("WriteMegabytesPerSecond") }, ElapsedTime > 0.0 ? BytesWritten / BYTES_PER_MEGABYTE / ElapsedTime : 0.0);
+	OutIterationJson->SetNumberField(FString{ TEXT("NumAllocations") }, NumAllocations);
+	OutIterationJson->SetNumberField(FString{ TEXT("NumBytesAllocated") }, NumBytesAllocated);
+	OutIterationJson->SetNumberField(FString{ TEXT("AllocationsPerEntity") }, NumProcessedEntities > 0.0 ? NumAllocations / NumProcessedEntities : 0.0);
+	// The platform only tracks the peak for the whole process, so this can only grow from one iteration to the next.
+	OutIterationJson->SetNumberField(FString{ TEXT("PeakResidentMegabytes") }, FPlatformMemory::GetStats().PeakUsedPhysical / BYTES_PER_MEGABYTE);
+
+	return true;
+}
@@ -0,0 +1,49 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+#include "Util/SyntheticSnapshotGenerator.h"
+
+#include "SnapshotMigratorBenchmarkCommandlet.generated.h"
+
+/**
+* Generates a synthetic snapshot and migrates it with USnapshotMigratorCommandlet, measuring throughput, allocations and peak memory usage. Results
+* are appended to a json file so that runs can be compared over time.
+*/
+UCLASS()
+class USnapshotMigratorBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+
+	USnapshotMigratorBenchmarkCommandlet();
+
+private:
+	SyntheticSnapshotGenerator::Config GeneratorConfig;
+	int32 NumIterations = 3;
+	FString Label;
+
+	FString BaseSchemaBundlePath;
+	FString TargetSchemaDir;
+	FString BenchmarkDir;
+	FString ResultsFile;
+
+	bool Setup(const FString& Params);
+	bool GenerateSourceArtifacts(const FString& ArtifactsDir, TSharedPtr<FJsonObject>& OutGenerationJson);
+
+	/**
+	* Migrates the generated snapshot once.
+	*	@param	Params				Params the benchmark was run with; these are passed on to the migrator so that its options can be benchmarked
+	*	@param	ArtifactsDir		Directory containing the generated snapshot and source schema bundle
+	*	@param	OutIterationJson	Measurements of the migration
+	*
+	*	@return						True if the migrator succeeded
+	*/
+	bool RunIteration(const FString& Params, const FString& ArtifactsDir, TSharedPtr<FJsonObject>& OutIterationJson);
+};
@@ -9,10 +9,14 @@
 #include "Util/SnapshotHelperLibrary.h"
 #include "Util/SnapshotMigrationJsonReporter.h"
 #include "Util/SnapshotMigrationLogReporter.h"
+#include "Util/SnapshotMigrationNDJsonReporter.h"
+#include "Util/SnapshotMigrationStatusFileReporter.h"
+#include "Util/SnapshotMigrationVerifier.h"
 
 #include "Engine.h"
 #include "FileHelpers.h"
 #include "Misc/ScopeExit.h"
+#include "Misc/SecureHash.h"
 #include "Serialization/JsonReader.h"
 #include "Serialization/JsonSerializer.h"
 
@@ -38,49 +42,129 @@ int32 USnapshotMigratorCommandlet::Main(const FString& Params)
 {
 	UE_LOG(LogSnapshotMigrator, Display, TEXT("Starting Snapshot Migrator Commandlet"));
 
-	if (!Setup())
+	const uint64 SetupStartCycles = FPlatformTime::Cycles64();
+	if (!Setup(Params))
 	{
 		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to initialise commandlet!"));
 		return 1;
 	}
 
+	// The trace writer is created during Setup, so the Setup span can only be written once it's finished.
+	if (TraceWriter.IsValid())
+	{
+		TraceWriter->WriteSpan(TEXT("Setup"), TEXT("Migrator"), SetupStartCycles, FPlatformTime::Cycles64());
+	}
+
+	// Commandlets aren't necessarily destroyed before the process exits, so make sure the trace is flushed and terminated.
+	ON_SCOPE_EXIT
+	{
+		TraceWriter.Reset();
+	};
+
 	for (const Snapshot& Snapshot : Snapshots)
 	{
-		if (!ConfigureNetDriver())
+		SnapshotMigrationTraceSpan SnapshotSpan(TraceWriter.Get(), TEXT("MigrateSnapshot"), FString::Printf(TEXT("\"Snapshot\":\"%s\""), *SnapshotMigrationTraceWriter::EscapeJsonString(Snapshot.Name)));
+
+		SnapshotMigrationManifest Manifest;
+		if (bIncrementalMigration && IsSnapshotUpToDate(Snapshot, Manifest))
+		{
+			UE_LOG(LogSnapshotMigrator, Display, TEXT("Inputs for %s are unchanged since it was last migrated; reusing previous migration."), *Snapshot.Name);
+			for (TUniquePtr<SnapshotMigrationReporterBase>& Reporter : Reporters)
+			{
+				Reporter->WriteToReport(Manifest.MigrationData);
+			}
+			continue;
+		}
+
+		// The coordinator of a sharded migration doesn't migrate any entities itself.
+		if (NumShards <= 1 && !ConfigureNetDriver())
 		{
 			UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to initialize NetDriver in order to migrate %s!"), *Snapshot.Name);
 			return 1;
 		}
 
 		MigrationData = SnapshotMigrationData{ Snapshot.Name };
-		if (!MigrateSnapshot(Snapshot.SourcePath, Snapshot.TargetPath))
+		MigrationData.SetRetainSkipDetails(bRetainSkipDetails);
+		MigrationData.SetDryRun(bDryRun);
+		MigrationData.SetCompacted(Compactor.IsValid());
+		if (Sampler.IsValid())
+		{
+			MigrationData.SetSampleFraction(Sampler->GetFraction());
+			Sampler->Reset();
+		}
+		if (Selector.IsValid())
+		{
+			MigrationData.SetPartial(Selector->GetUnselectedEntityAction() == SnapshotMigrationSelector::UnselectedEntityAction::Copy);
+		}
+		for (FanOutTarget& Target : FanOutTargets)
+		{
+			Target.MigrationData = SnapshotMigrationData{ FString::Printf(TEXT("%s (%s)"), *Snapshot.Name, *Target.CompiledSchemaDir) };
+			Target.MigrationData.SetRetainSkipDetails(bRetainSkipDetails);
+			Target.MigrationData.SetCompacted(Compactor.IsValid());
+			if (Sampler.IsValid())
+			{
+				Target.MigrationData.SetSampleFraction(Sampler->GetFraction());
+			}
+			if (Selector.IsValid())
+			{
+				Target.MigrationData.SetPartial(Selector->GetUnselectedEntityAction() == SnapshotMigrationSelector::UnselectedEntityAction::Copy);
+			}
+		}
+		if (MigrationCacheMaxEntries > 0)
+		{
+			// Cached migrations are only reused within a single snapshot to keep memory usage bounded.
+			MigrationCache = MakeUnique<SnapshotMigrationCache>(OldSchemaBundleDefinitions, NewSchemaBundleDefinitions, MigrationCacheMaxEntries);
+		}
+
+		const bool bMigratedSnapshot = NumShards > 1 ? MigrateSnapshotInShards(Snapshot) : MigrateSnapshot(Snapshot.SourcePath, Snapshot.TargetPath);
+		if (!bMigratedSnapshot)
 		{
 			UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to migrate %s!"), *Snapshot.Name);
 		}
+
+		bool bVerifiedSnapshot = true;
+		if (bVerify && bMigratedSnapshot)
+		{
+			bVerifiedSnapshot = VerifySnapshot(Snapshot.TargetPath, NewSchemaBundleDefinitions, MigrationData);
+			for (FanOutTarget& Target : FanOutTargets)
+			{
+				VerifySnapshot(FPaths::Combine(Target.TargetSnapshotDir, FPaths::GetCleanFilename(Snapshot.TargetPath)), Target.Definitions, Target.MigrationData);
+			}
+		}
 		MigrationData.FinalizeData();
 
+		if (bIncrementalMigration)
+		{
+			const FString& ManifestPath = SnapshotMigrationManifest::GetManifestPath(Snapshot.TargetPath);
+			Manifest.MigrationData = MigrationData;
+
+			// A stale manifest must never outlive a failed migration, otherwise the next run would consider the old output up to date.
+			// A snapshot which failed verification is migrated again too, rather than being reused with its failures.
+			if (!bMigratedSnapshot || !bVerifiedSnapshot || !Manifest.Save(ManifestPath))
+			{
+				IFileManager::Get().Delete(*ManifestPath, false, true);
+			}
+		}
+
 		for (TUniquePtr<SnapshotMigrationReporterBase>& Reporter : Reporters)
 		{
 			Reporter->WriteToReport(MigrationData);
 		}
-	}
-
-	return 0;
-}
 
-bool USnapshotMigratorCommandlet::LoadJsonSchemaBundleAtPath(const FString& SchemaBundlePath, TSharedPtr<FJsonObject>& OutJsonObject)
-{
-	FString SchemaBundleJson{};
-	if (!FFileHelper::LoadFileToString(SchemaBundleJson, *SchemaBundlePath))
-	{
-		return false;
+		for (FanOutTarget& Target : FanOutTargets)
+		{
+			Target.MigrationData.FinalizeData();
+			for (TUniquePtr<SnapshotMigrationReporterBase>& Reporter : Reporters)
+			{
+				Reporter->WriteToReport(Target.MigrationData);
+			}
+		}
 	}
 
-	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(SchemaBundleJson);
-	return FJsonSerializer::Deserialize(Reader, OutJsonObject) && OutJsonObject.IsValid();
+	return 0;
 }
 
-bool USnapshotMigratorCommandlet::Setup()
+bool USnapshotMigratorCommandlet::Setup(const FString& Params)
 {
 	check(GConfig);
 	FString FinalIniPath;
@@ -98,21 +182,35 @@ bool USnapshotMigratorCommandlet::Setup()
 		EntityActorClassFilters.Add(FRegexPattern{ Pattern });
 	}
 
-	World = UEditorLoadingAndSavingUtils::LoadMap(FString{ TEXT("/Game/NWX/Tests/Base/FTEST_Base") });
-	check(World);
-
 	const FString& DefaultSpatialRootDir = SpatialGDKServicesConstants::SpatialOSDirectory;
 	const FString& DefaultOldDeploymentArtifactsDir = FPaths::Combine(DefaultSpatialRootDir, FString{ TEXT("tmp/artifacts") });
 	const FString& SchemaBundleFilename = FString{ TEXT("schema.sb.json") };
 
 	const FString& DefaultCompiledSchemaDir = FPaths::Combine(DefaultSpatialRootDir, FString{ TEXT("build/assembly/schema") });
+	const FString& DefaultTargetSnapshotDir = FPaths::Combine(DefaultSpatialRootDir, FString{ TEXT("snapshots") });
 
+	// Parse the params we were given rather than the process' command line, so that the migrator can also be driven by other commandlets.
 	TArray<FString> Tokens;
 	TArray<FString> Switches;
-	FCommandLine::Parse(FCommandLine::Get(), Tokens, Switches);
+	ParseCommandLine(*Params, Tokens, Switches);
 
 	FString OldArtifactsDir = DefaultOldDeploymentArtifactsDir;
-	FString CompiledSchemaDir = DefaultCompiledSchemaDir;
+	// CompiledSchemaDir may be given more than once to migrate to several target schema bundles in one pass, optionally with a TargetSnapshotDir for each.
+	TArray<FString> CompiledSchemaDirs;
+	TArray<FString> TargetSnapshotDirs;
+	// Compiled schema directories of the versions between the old schema bundle and the new one, oldest first.
+	TArray<FString> SchemaChainDirs;
+
+	FString TraceFile;
+	int32 TraceSampleInterval = SnapshotMigrationTraceWriter::DEFAULT_ENTITY_SAMPLE_INTERVAL;
+
+	float SampleFraction = 1.f;
+	uint64 SampleSeed = 0;
+
+	bool bCompact = false;
+	TArray<SnapshotCompactionRule> CompactionRules;
+
+	SnapshotMigrationSelector Selection;
 
 	// Split won't update target strings if it fails, so we can just ignore the output. It'll be default if it fails or the CL-provided value if it succeeds.
 	for (const FString& CLSwitch : Switches)
@@ -124,7 +222,28 @@ bool USnapshotMigratorCommandlet::Setup()
 		}
 		else if (CLSwitch.StartsWith(FString{ TEXT("CompiledSchemaDir") }))
 		{
-			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &CompiledSchemaDir);
+			FString CompiledSchemaDir;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &CompiledSchemaDir))
+			{
+				CompiledSchemaDirs.Add(CompiledSchemaDir);
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("SchemaChain") }))
+		{
+			// e.g. -SchemaChain=path/to/v2/schema,path/to/v3/schema
+			FString SchemaChain;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &SchemaChain))
+			{
+				SchemaChain.ParseIntoArray(SchemaChainDirs, TEXT(","));
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("TargetSnapshotDir") }))
+		{
+			FString TargetSnapshotDir;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &TargetSnapshotDir))
+			{
+				TargetSnapshotDirs.Add(TargetSnapshotDir);
+			}
 		}
 		else if (CLSwitch.StartsWith(FString{ TEXT("LogJSON") }))
 		{
@@ -137,103 +256,615 @@ bool USnapshotMigratorCommandlet::Setup()
 
 			Reporters.Add(MakeUnique<SnapshotMigrationJsonReporter>(JsonLogFile));
 		}
-	}
+		else if (CLSwitch.StartsWith(FString{ TEXT("LogNDJSON") }))
+		{
+			FString NDJsonLogFile;
+			if (!CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &NDJsonLogFile))
+			{
+				UE_LOG(LogSnapshotMigrator, Warning, TEXT("LogNDJSON must be provided with an absolute filepath to the target log file!"));
+				return false;
+			}
 
-	Reporters.Add(MakeUnique<SnapshotMigrationLogReporter>());
+			TUniquePtr<SnapshotMigrationNDJsonReporter> NDJsonReporter = MakeUnique<SnapshotMigrationNDJsonReporter>(NDJsonLogFile);
+			if (!NDJsonReporter->IsValid())
+			{
+				return false;
+			}
 
-	const FString& OldSchemaBundlePath = FPaths::Combine(OldArtifactsDir, SchemaBundleFilename);
-	const FString& NewSchemaBundlePath = FPaths::Combine(CompiledSchemaDir, SchemaBundleFilename);
+			Reporters.Add(MoveTemp(NDJsonReporter));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("StatusFile") }))
+		{
+			FString StatusFile;
+			if (!CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &StatusFile))
+			{
+				UE_LOG(LogSnapshotMigrator, Warning, TEXT("StatusFile must be provided with an absolute filepath to the target status file!"));
+				return false;
+			}
+
+			Reporters.Add(MakeUnique<SnapshotMigrationStatusFileReporter>(StatusFile));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("ProgressInterval") }))
+		{
+			FString Interval;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Interval))
+			{
+				ProgressInterval = FCString::Atof(*Interval);
+			}
+		}
+		else if (CLSwitch.Equals(FString{ TEXT("Incremental") }))
+		{
+			bIncrementalMigration = true;
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Checkpoint") }))
+		{
+			// Optionally takes the number of seconds between checkpoints, e.g. -Checkpoint=600
+			FString Interval;
+			CheckpointInterval = CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Interval) ? FCString::Atof(*Interval) : DEFAULT_CHECKPOINT_INTERVAL;
+		}
+		else if (CLSwitch.Equals(FString{ TEXT("Resume") }))
+		{
+			bResumeFromCheckpoint = true;
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Shards") }))
+		{
+			FString Shards;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Shards))
+			{
+				NumShards = FCString::Atoi(*Shards);
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("TraceOut") }))
+		{
+			if (!CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &TraceFile))
+			{
+				UE_LOG(LogSnapshotMigrator, Warning, TEXT("TraceOut must be provided with an absolute filepath to the target trace file!"));
+				return false;
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("TraceSampleEvery") }))
+		{
+			FString SampleInterval;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &SampleInterval))
+			{
+				TraceSampleInterval = FCString::Atoi(*SampleInterval);
+			}
+		}
+		else if (CLSwitch.Equals(FString{ TEXT("ReportSkipDetails") }))
+		{
+			bRetainSkipDetails = true;
+		}
+		else if (CLSwitch.Equals(FString{ TEXT("ClassStats") }))
+		{
+			bRecordClassStats = true;
+		}
+		else if (CLSwitch.Equals(FString{ TEXT("DryRun") }))
+		{
+			bDryRun = true;
+		}
+		else if (CLSwitch.Equals(FString{ TEXT("Verify") }))
+		{
+			bVerify = true;
+		}
+		else if (CLSwitch.Equals(FString{ TEXT("ScrubDanglingReferences") }))
+		{
+			bScrubDanglingReferences = true;
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Compact") }))
+		{
+			// Optionally takes the rules to compact with, e.g. -Compact=UnknownComponents,DefaultComponentData
+			bCompact = true;
+			FString RuleNames;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &RuleNames))
+			{
+				TArray<FString> RuleNameArray;
+				RuleNames.ParseIntoArray(RuleNameArray, TEXT(","));
+				for (const FString& RuleName : RuleNameArray)
+				{
+					SnapshotCompactionRule Rule;
+					if (!GetSnapshotCompactionRuleFromName(RuleName.TrimStartAndEnd(), Rule))
+					{
+						UE_LOG(LogSnapshotMigrator, Warning, TEXT("Unknown compaction rule '%s'!"), *RuleName);
+						return false;
+					}
+					CompactionRules.AddUnique(Rule);
+				}
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("SpatialOrder") }))
+		{
+			// Optionally takes the size of the runs sorted in memory in MB, e.g. -SpatialOrder=256
+			FString RunMegabytes;
+			SpatialOrderMaxRunBytes = CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &RunMegabytes) && FCString::Atoi(*RunMegabytes) > 0
+				? FCString::Atoi(*RunMegabytes) * 1024ull * 1024ull
+				: SnapshotMigrationSpatialOrder::DEFAULT_MAX_RUN_BYTES;
+		}
+		// SampleEvery and SampleSeed need checking before Sample, which they both start with.
+		else if (CLSwitch.StartsWith(FString{ TEXT("SampleEvery") }))
+		{
+			FString SampleInterval;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &SampleInterval) && FCString::Atoi(*SampleInterval) > 0)
+			{
+				SampleFraction = 1.f / FCString::Atoi(*SampleInterval);
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("SampleSeed") }))
+		{
+			FString Seed;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Seed))
+			{
+				SampleSeed = FCString::Strtoui64(*Seed, nullptr, 10);
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Sample") }))
+		{
+			FString Fraction;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Fraction))
+			{
+				SampleFraction = FCString::Atof(*Fraction);
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("SelectEntityIds") }))
+		{
+			// Comma separated ids and inclusive ranges, e.g. -SelectEntityIds=5,100-200,1000-
+			FString Ranges;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Ranges) && !Selection.AddEntityIdRanges(Ranges))
+			{
+				UE_LOG(LogSnapshotMigrator, Warning, TEXT("Invalid entity id ranges '%s' passed to SelectEntityIds!"), *Ranges);
+				return false;
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("SelectClasses") }))
+		{
+			// Comma separated class path patterns, e.g. -SelectClasses=*/BP_Door*,*/BP_Window*
+			FString Patterns;
+			TArray<FString> PatternList;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Patterns) && Patterns.ParseIntoArray(PatternList, TEXT(",")) > 0)
+			{
+				for (const FString& Pattern : PatternList)
+				{
+					Selection.AddClassPattern(Pattern);
+				}
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("SelectComponents") }))
+		{
+			// Comma separated component ids or qualified names, e.g. -SelectComponents=unreal.generated.BP_DoorComponent,1234
+			FString Components;
+			TArray<FString> ComponentList;
+			if (CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Components) && Components.ParseIntoArray(ComponentList, TEXT(",")) > 0)
+			{
+				for (const FString& Component : ComponentList)
+				{
+					Selection.AddComponent(Component);
+				}
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Unselected") }))
+		{
+			FString ActionName;
+			SnapshotMigrationSelector::UnselectedEntityAction Action;
+			if (!CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &ActionName) || !SnapshotMigrationSelector::GetUnselectedEntityActionFromName(ActionName, Action))
+			{
+				UE_LOG(LogSnapshotMigrator, Warning, TEXT("Unselected must be given either Drop or Copy!"));
+				return false;
+			}
+			Selection.SetUnselectedEntityAction(Action);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("MigrationCache") }))
+		{
+			// Optionally takes the maximum number of cached migrations, e.g. -MigrationCache=1000
+			FString MaxEntries;
+			MigrationCacheMaxEntries = CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &MaxEntries) ? FCString::Atoi(*MaxEntries) : SnapshotMigrationCache::DEFAULT_MAX_ENTRIES;
+		}
+	}
 
-	TSharedPtr<FJsonObject> OldSchemaBundleJsonObject;
-	TSharedPtr<FJsonObject> NewSchemaBundleJsonObject;
+	Reporters.Add(MakeUnique<SnapshotMigrationLogReporter>());
 
-	if (!LoadJsonSchemaBundleAtPath(OldSchemaBundlePath, OldSchemaBundleJsonObject) || !LoadJsonSchemaBundleAtPath(NewSchemaBundlePath, NewSchemaBundleJsonObject))
+	if (SampleFraction <= 0.f || SampleFraction > 1.f)
 	{
-		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to load both schema bundles -- ensure that there are bundles present at both '%s' and '%s'."), *OldSchemaBundlePath, *NewSchemaBundlePath);
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Sample must be given a fraction of entities greater than 0 and no greater than 1!"));
 		return false;
 	}
 
-	OldSchemaBundleDefinitions = SchemaBundleDefinitions{ OldSchemaBundleJsonObject };
-	NewSchemaBundleDefinitions = SchemaBundleDefinitions{ NewSchemaBundleJsonObject };
+	if (SampleFraction < 1.f)
+	{
+		Sampler = MakeUnique<SnapshotMigrationSampler>(SampleFraction, SampleSeed);
+	}
 
-	const FString& TargetSnapshotDir = FPaths::Combine(DefaultSpatialRootDir, FString{ TEXT("snapshots") });
+	if (Selection.HasCriteria())
+	{
+		Selector = MakeUnique<SnapshotMigrationSelector>(Selection);
+	}
 
-	TArray<FString> ExistingSnapshots;
-	IFileManager::Get().FindFiles(ExistingSnapshots, *DefaultOldDeploymentArtifactsDir, TEXT("snapshot"));
-	for (const FString& ExistingSnapshot : ExistingSnapshots)
+	if (bCompact)
 	{
-		const FString& SourcePath = FPaths::Combine(DefaultOldDeploymentArtifactsDir, ExistingSnapshot);
-		const FString& TargetPath = FPaths::Combine(TargetSnapshotDir, ExistingSnapshot);
-		Snapshots.Add(Snapshot{ ExistingSnapshot, SourcePath, TargetPath });
+		Compactor = MakeUnique<SnapshotMigrationCompactor>(CompactionRules.Num() > 0 ? CompactionRules : SnapshotMigrationCompactor::GetDefaultRules());
 	}
 
-	return true;
-}
+	if (bDryRun)
+	{
+		// A dry run leaves no output to reuse, and most of its entities are never built, so there'd be nothing to fill the cache with either.
+		if (bIncrementalMigration || MigrationCacheMaxEntries > 0 || bVerify)
+		{
+			UE_LOG(LogSnapshotMigrator, Display, TEXT("Incremental migration, the migration cache and verification are disabled for dry runs."));
+		}
+		bIncrementalMigration = false;
+		MigrationCacheMaxEntries = 0;
+		bVerify = false;
+		CheckpointInterval = 0.f;
+		bResumeFromCheckpoint = false;
+	}
 
-bool USnapshotMigratorCommandlet::ConfigureNetDriver()
-{
-	// Pretty much all of this is taken wholesale from USpatialNetDriver::InitBase. However, InitBase also initiates a connection to a running Spatial
-	// deployment, which we don't have when running in this commandlet.
-	// Would it be worth standing up a local deployment when running this commandlet? Do we have the tooling in place to do so during, e.g., CI ops?
-	// Can some of the initialization logic be decoupled from actually needing to connect to a Spatial deployment so this is less cargo-culty?
+	if (CompiledSchemaDirs.Num() == 0)
+	{
+		CompiledSchemaDirs.Add(DefaultCompiledSchemaDir);
+	}
 
-	// Make absolutely sure that the actor channel that we are using is our Spatial actor channel
-	// Copied from what the Engine does with UActorChannel
-	FChannelDefinition SpatialChannelDefinition{};
-	SpatialChannelDefinition.ChannelName = NAME_Actor;
-	SpatialChannelDefinition.ClassName = FName(*USpatialActorChannel::StaticClass()->GetPathName());
-	SpatialChannelDefinition.ChannelClass = USpatialActorChannel::StaticClass();
-	SpatialChannelDefinition.bServerOpen = true;
+	if (CompiledSchemaDirs.Num() > 1)
+	{
+		// Fan-out targets have no manifests, checkpoints or projections of their own, and a shard's process would only be given the first target.
+		if (bIncrementalMigration || bDryRun || CheckpointInterval > 0.f || bResumeFromCheckpoint || NumShards > 1)
+		{
+			UE_LOG(LogSnapshotMigrator, Warning, TEXT("Several CompiledSchemaDirs can't be combined with Incremental, DryRun, Checkpoint, Resume or Shards!"));
+			return false;
+		}
 
-	NetDriver = NewObject<USpatialNetDriver>();
-	NetConnection = NewObject<USpatialNetConnection>();
-	PackageMap = NewObject<USpatialPackageMapClient>();
+		// Cached migrations are only of the first target's components.
+		if (MigrationCacheMaxEntries > 0)
+		{
+			UE_LOG(LogSnapshotMigrator, Display, TEXT("The migration cache is disabled when migrating to several target schema bundles."));
+			MigrationCacheMaxEntries = 0;
+		}
 
-	ClassInfoManager = NewObject<USpatialClassInfoManager>();
-	SpatialSender = NewObject<USpatialSender>();
-	SpatialReceiver = NewObject<USpatialReceiver>();
-	StaticComponentView = NewObject<USpatialStaticComponentView>();
-	WorkerConnection = NewObject<USpatialWorkerConnection>();
+		// Unless each target is given a directory of its own, they're written to numbered directories within the one target snapshot directory.
+		if (TargetSnapshotDirs.Num() != CompiledSchemaDirs.Num())
+		{
+			if (TargetSnapshotDirs.Num() > 1)
+			{
+				UE_LOG(LogSnapshotMigrator, Warning, TEXT("Either one TargetSnapshotDir or one for each CompiledSchemaDir must be given!"));
+				return false;
+			}
 
-	NetDriver->ChannelDefinitions[CHTYPE_Actor] = SpatialChannelDefinition;
-	NetDriver->ChannelDefinitionMap[NAME_Actor] = SpatialChannelDefinition;
-	NetDriver->GuidCache = MakeShareable(new FSpatialNetGUIDCache(NetDriver));
-	NetDriver->World = World;
-	NetDriver->Connection = WorkerConnection;
-	
-	NetConnection->Driver = NetDriver;
-	NetConnection->State = USOCK_Closed;
+			const FString BaseTargetSnapshotDir = TargetSnapshotDirs.Num() == 1 ? TargetSnapshotDirs[0] : DefaultTargetSnapshotDir;
+			TargetSnapshotDirs.Reset();
+			for (int32 i = 0; i < CompiledSchemaDirs.Num(); i++)
+			{
+				TargetSnapshotDirs.Add(FPaths::Combine(BaseTargetSnapshotDir, FString::FromInt(i)));
+			}
+		}
+	}
+	else if (TargetSnapshotDirs.Num() == 0)
+	{
+		TargetSnapshotDirs.Add(DefaultTargetSnapshotDir);
+	}
 
-	NetDriver->AddClientConnection(NetConnection);
+	const FString& CompiledSchemaDir = CompiledSchemaDirs[0];
+	// A single target keeps the last TargetSnapshotDir given, as it always has.
+	const FString& TargetSnapshotDir = CompiledSchemaDirs.Num() > 1 ? TargetSnapshotDirs[0] : TargetSnapshotDirs.Last();
 
-	NetDriver->StaticComponentView = StaticComponentView;
+	if (NumShards > 1)
+	{
+		// Dry runs don't write shards to concatenate, sampling picks the first entity of each class which depends on every entity before it,
+		// checkpoints are per process, while the shards are split again on every run, a shard's process could only index the entities in its shard, and
+		// it would write a partial migration of its shard next to the shard's target rather than to it. Only the shards' JSON reports are merged, so
+		// an NDJSON log would be missing every per-entity record.
+		const bool bLogNDJson = Switches.ContainsByPredicate([](const FString& CLSwitch) { return CLSwitch.StartsWith(FString{ TEXT("LogNDJSON") }); });
+		if (bDryRun || Sampler.IsValid() || Selector.IsValid() || CheckpointInterval > 0.f || bResumeFromCheckpoint || bScrubDanglingReferences || bLogNDJson)
+		{
+			UE_LOG(LogSnapshotMigrator, Warning, TEXT("Shards can't be combined with DryRun, Sample, Select, Checkpoint, Resume, ScrubDanglingReferences or LogNDJSON!"));
+			return false;
+		}
 
-	SpatialReceiver->Init(NetDriver, &World->GetTimerManager(), nullptr);	 //UE424_TODO - need a proper RPCService?
-	NetDriver->Receiver = SpatialReceiver;
+		// Each shard's process is given inputs, outputs and a report of its own, and incremental migration is handled by this process.
+		const TArray<FString> CoordinatorSwitches{
+			FString{ TEXT("Run") },
+			FString{ TEXT("Shards") },
+			FString{ TEXT("OldArtifactsDir") },
+			FString{ TEXT("TargetSnapshotDir") },
+			FString{ TEXT("LogJSON") },
+			FString{ TEXT("StatusFile") },
+			FString{ TEXT("TraceOut") },
+			FString{ TEXT("TraceSampleEvery") },
+			FString{ TEXT("Incremental") },
+			FString{ TEXT("SpatialOrder") },
+			FString{ TEXT("Verify") }
+		};
+		for (const FString& CLSwitch : Switches)
+		{
+			if (!CoordinatorSwitches.ContainsByPredicate([&CLSwitch](const FString& CoordinatorSwitch) { return CLSwitch.StartsWith(CoordinatorSwitch); }))
+			{
+				ShardParams += FString::Printf(TEXT(" -%s"), *CLSwitch);
+			}
+		}
+	}
 
-	PackageMap->Initialize(NetConnection, NetDriver->GuidCache);
-	PackageMap->Init(NetDriver, &World->GetTimerManager());
-	NetDriver->PackageMap = PackageMap;
-	NetConnection->PackageMap = PackageMap;
+	// Resuming needs checkpoints to be written, or a resumed migration that was interrupted again would lose everything since the first checkpoint.
+	if (bResumeFromCheckpoint && CheckpointInterval <= 0.f)
+	{
+		CheckpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+	}
 
-	NetDriver->ClassInfoManager = NewObject<USpatialClassInfoManager>();
-	if (!NetDriver->ClassInfoManager->TryInit(NetDriver))
+	if (!TraceFile.IsEmpty())
 	{
-		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to initialise the NetDriver's ClassInfoManager!"));
-		return false;
+		TraceWriter = MakeUnique<SnapshotMigrationTraceWriter>(TraceFile, TraceSampleInterval);
+		if (!TraceWriter->IsValid())
+		{
+			return false;
+		}
 	}
-	NetDriver->ClassInfoManager = ClassInfoManager;
 
-	SpatialSender->Init(NetDriver, &World->GetTimerManager(), nullptr);	   //UE424_TODO - need a proper RPCService?
-	NetDriver->Sender = SpatialSender;
+	if (bIncrementalMigration || CheckpointInterval > 0.f)
+	{
+		// Switches which only affect reporting or performance don't change the output snapshot, so they shouldn't invalidate a previous migration.
+		// The schema bundle and snapshot directories are also excluded, since the bundles and snapshots themselves are hashed.
+		const TArray<FString> NonOutputSwitches{
+			FString{ TEXT("OldArtifactsDir") },
+			FString{ TEXT("CompiledSchemaDir") },
+			FString{ TEXT("TargetSnapshotDir") },
+			FString{ TEXT("LogJSON") },
+			FString{ TEXT("LogNDJSON") },
+			FString{ TEXT("StatusFile") },
+			FString{ TEXT("ProgressInterval") },
+			FString{ TEXT("MigrationCache") },
+			FString{ TEXT("ClassStats") },
+			FString{ TEXT("ReportSkipDetails") },
+			FString{ TEXT("TraceOut") },
+			FString{ TEXT("TraceSampleEvery") },
+			FString{ TEXT("Incremental") },
+			FString{ TEXT("Checkpoint") },
+			FString{ TEXT("Resume") },
+			FString{ TEXT("Shards") },
+			FString{ TEXT("Verify") }
+		};
+		TArray<FString> OutputSwitches = Switches.FilterByPredicate([&NonOutputSwitches](const FString& CLSwitch) {
+			return !NonOutputSwitches.ContainsByPredicate([&CLSwitch](const FString& NonOutputSwitch) { return CLSwitch.StartsWith(NonOutputSwitch); });
+		});
+		OutputSwitches.Sort();
 
-	NetDriver->InterestFactory = MakeUnique<SpatialGDK::InterestFactory>(ClassInfoManager, PackageMap);
+		SharedManifestInputs.WhitelistHash = FMD5::HashAnsiString(*FString::Join(WhitelistedClasspathPatterns, TEXT("\n")));
+		SharedManifestInputs.OptionsHash = FMD5::HashAnsiString(*FString::Join(OutputSwitches, TEXT("\n")));
+	}
 
-	return true;
-}
+	OldSchemaBundlePath = FPaths::Combine(OldArtifactsDir, SchemaBundleFilename);
+	const FString& NewSchemaBundlePath = FPaths::Combine(CompiledSchemaDir, SchemaBundleFilename);
+	TArray<FString> SchemaChainBundlePaths;
+
+	{
+		SnapshotMigrationTraceSpan LoadSchemaBundlesSpan(TraceWriter.Get(), TEXT("LoadSchemaBundles"));
+
+		TSharedPtr<FJsonObject> OldSchemaBundleJsonObject;
+		TSharedPtr<FJsonObject> NewSchemaBundleJsonObject;
+
+		if (!SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(OldSchemaBundlePath, OldSchemaBundleJsonObject) || !SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(NewSchemaBundlePath, NewSchemaBundleJsonObject))
+		{
+			UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to load both schema bundles -- ensure that there are bundles present at both '%s' and '%s'."), *OldSchemaBundlePath, *NewSchemaBundlePath);
+			return false;
+		}
+
+		// Rather than migrating through each bundle along the chain in turn, the old bundle is pruned down to what would have survived the chain, so
+		// that every snapshot is migrated straight to the new bundle in a single pass.
+		if (SchemaChainDirs.Num() > 0)
+		{
+			TArray<SchemaBundleDefinitions> SchemaChainDefinitions;
+			for (const FString& SchemaChainDir : SchemaChainDirs)
+			{
+				const FString& SchemaChainBundlePath = FPaths::Combine(SchemaChainDir, SchemaBundleFilename);
+
+				TSharedPtr<FJsonObject> SchemaChainBundleJsonObject;
+				if (!SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(SchemaChainBundlePath, SchemaChainBundleJsonObject))
+				{
+					UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to load schema bundle -- ensure that there is a bundle present at '%s'."), *SchemaChainBundlePath);
+					return false;
+				}
+
+				SchemaChainDefinitions.Add(SchemaBundleDefinitions{ SchemaChainBundleJsonObject });
+				SchemaChainBundlePaths.Add(SchemaChainBundlePath);
+			}
+
+			TArray<SnapshotHelperLibrary::PrunedSchemaField> PrunedFields;
+			SnapshotHelperLibrary::ComposeSchemaBundleChain(OldSchemaBundleJsonObject, SchemaChainDefinitions, &PrunedFields);
+
+			// Migrating through the chain one bundle at a time would have reported these as type mismatches at the step where their type changed.
+			for (const SnapshotHelperLibrary::PrunedSchemaField& PrunedField : PrunedFields)
+			{
+				if (PrunedField.bTypeChanged)
+				{
+					UE_LOG(LogSnapshotMigrator, Display, TEXT("%s.%s changes type in '%s', so it isn't migrated."), *PrunedField.OwnerName, *PrunedField.FieldName, *SchemaChainBundlePaths[PrunedField.ChainStep]);
+					if (PrunedField.bIsComponentField)
+					{
+						ChainFieldTypeMismatchesByComponentName.FindOrAdd(PrunedField.OwnerName).Add(PrunedField.FieldName);
+					}
+				}
+			}
+		}
+
+		OldSchemaBundleDefinitions = SchemaBundleDefinitions{ OldSchemaBundleJsonObject };
+		NewSchemaBundleDefinitions = SchemaBundleDefinitions{ NewSchemaBundleJsonObject };
+
+		if (Selector.IsValid() && !Selector->ResolveComponents(OldSchemaBundleDefinitions))
+		{
+			return false;
+		}
+
+		for (int32 i = 1; i < CompiledSchemaDirs.Num(); i++)
+		{
+			const FString& FanOutSchemaBundlePath = FPaths::Combine(CompiledSchemaDirs[i], SchemaBundleFilename);
+
+			TSharedPtr<FJsonObject> FanOutSchemaBundleJsonObject;
+			if (!SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(FanOutSchemaBundlePath, FanOutSchemaBundleJsonObject))
+			{
+				UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to load schema bundle -- ensure that there is a bundle present at '%s'."), *FanOutSchemaBundlePath);
+				return false;
+			}
+
+			FanOutTarget& Target = FanOutTargets.AddDefaulted_GetRef();
+			Target.CompiledSchemaDir = CompiledSchemaDirs[i];
+			Target.TargetSnapshotDir = TargetSnapshotDirs[i];
+			Target.Definitions = SchemaBundleDefinitions{ FanOutSchemaBundleJsonObject };
+		}
+	}
+
+	if (bIncrementalMigration || CheckpointInterval > 0.f)
+	{
+		SharedManifestInputs.OldSchemaBundleHash = SnapshotMigrationManifest::HashFile(OldSchemaBundlePath);
+		SharedManifestInputs.NewSchemaBundleHash = SnapshotMigrationManifest::HashFile(NewSchemaBundlePath);
+
+		// The bundles along a chain change what the old bundle is migrated as, so they're folded into its hash.
+		if (SchemaChainBundlePaths.Num() > 0)
+		{
+			TArray<FString> SchemaChainHashes{ SharedManifestInputs.OldSchemaBundleHash };
+			for (const FString& SchemaChainBundlePath : SchemaChainBundlePaths)
+			{
+				SchemaChainHashes.Add(SnapshotMigrationManifest::HashFile(SchemaChainBundlePath));
+			}
+			SharedManifestInputs.OldSchemaBundleHash = FMD5::HashAnsiString(*FString::Join(SchemaChainHashes, TEXT("\n")));
+		}
+	}
+
+	TArray<FString> ExistingSnapshots;
+	IFileManager::Get().FindFiles(ExistingSnapshots, *OldArtifactsDir, TEXT("snapshot"));
+	for (const FString& ExistingSnapshot : ExistingSnapshots)
+	{
+		const FString& SourcePath = FPaths::Combine(OldArtifactsDir, ExistingSnapshot);
+		FString TargetPath = FPaths::Combine(TargetSnapshotDir, ExistingSnapshot);
+		if (Selector.IsValid())
+		{
+			TargetPath = SnapshotMigrationSelector::GetPartialSnapshotPath(TargetPath);
+		}
+		if (Sampler.IsValid())
+		{
+			TargetPath = SnapshotMigrationSampler::GetSampleSnapshotPath(TargetPath);
+		}
+		Snapshots.Add(Snapshot{ ExistingSnapshot, SourcePath, TargetPath });
+	}
+
+	return true;
+}
+
+bool USnapshotMigratorCommandlet::IsSnapshotUpToDate(const Snapshot& Snapshot, SnapshotMigrationManifest& OutManifest)
+{
+	OutManifest = SharedManifestInputs;
+	OutManifest.SetSourceSnapshotStat(Snapshot.SourcePath);
+
+	const FString& ManifestPath = SnapshotMigrationManifest::GetManifestPath(Snapshot.TargetPath);
+	SnapshotMigrationManifest PreviousManifest;
+	if (!IFileManager::Get().FileExists(*Snapshot.TargetPath) || !SnapshotMigrationManifest::Load(ManifestPath, PreviousManifest))
+	{
+		OutManifest.SourceSnapshotHash = SnapshotMigrationManifest::HashFile(Snapshot.SourcePath);
+		return false;
+	}
+
+	// Hashing a large source snapshot takes a while, so it's only done when its size or timestamp has changed since the previous migration.
+	const bool bSourceSnapshotUnchanged = OutManifest.IsSourceSnapshotUnchanged(PreviousManifest);
+	OutManifest.SourceSnapshotHash = bSourceSnapshotUnchanged ? PreviousManifest.SourceSnapshotHash : SnapshotMigrationManifest::HashFile(Snapshot.SourcePath);
+	if (!PreviousManifest.HasSameInputsAs(OutManifest))
+	{
+		return false;
+	}
+
+	OutManifest.MigrationData = PreviousManifest.MigrationData;
+
+	// A source snapshot which was touched without changing is recorded with its new timestamp, so that it isn't hashed again on the next run.
+	if (!bSourceSnapshotUnchanged)
+	{
+		OutManifest.Save(ManifestPath);
+	}
+	return true;
+}
+
+bool USnapshotMigratorCommandlet::ConfigureNetDriver()
+{
+	// Loading the map takes a while, so it's left until the first snapshot which actually needs migrating. An incremental run over snapshots which
+	// are all up to date never loads it.
+	if (World == nullptr)
+	{
+		SnapshotMigrationTraceSpan LoadMapSpan(TraceWriter.Get(), TEXT("LoadMap"));
+		World = UEditorLoadingAndSavingUtils::LoadMap(FString{ TEXT("/Game/NWX/Tests/Base/FTEST_Base") });
+		if (World == nullptr)
+		{
+			UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to load the map to spawn actors in!"));
+			return false;
+		}
+	}
+
+	// Pretty much all of this is taken wholesale from USpatialNetDriver::InitBase. However, InitBase also initiates a connection to a running Spatial
+	// deployment, which we don't have when running in this commandlet.
+	// Would it be worth standing up a local deployment when running this commandlet? Do we have the tooling in place to do so during, e.g., CI ops?
+	// Can some of the initialization logic be decoupled from actually needing to connect to a Spatial deployment so this is less cargo-culty?
+
+	// Make absolutely sure that the actor channel that we are using is our Spatial actor channel
+	// Copied from what the Engine does with UActorChannel
+	FChannelDefinition SpatialChannelDefinition{};
+	SpatialChannelDefinition.ChannelName = NAME_Actor;
+	SpatialChannelDefinition.ClassName = FName(*USpatialActorChannel::StaticClass()->GetPathName());
+	SpatialChannelDefinition.ChannelClass = USpatialActorChannel::StaticClass();
+	SpatialChannelDefinition.bServerOpen = true;
+
+	NetDriver = NewObject<USpatialNetDriver>();
+	NetConnection = NewObject<USpatialNetConnection>();
+	PackageMap = NewObject<USpatialPackageMapClient>();
+
+	ClassInfoManager = NewObject<USpatialClassInfoManager>();
+	SpatialSender = NewObject<USpatialSender>();
+	SpatialReceiver = NewObject<USpatialReceiver>();
+	StaticComponentView = NewObject<USpatialStaticComponentView>();
+	WorkerConnection = NewObject<USpatialWorkerConnection>();
+
+	NetDriver->ChannelDefinitions[CHTYPE_Actor] = SpatialChannelDefinition;
+	NetDriver->ChannelDefinitionMap[NAME_Actor] = SpatialChannelDefinition;
+	NetDriver->GuidCache = MakeShareable(new FSpatialNetGUIDCache(NetDriver));
+	NetDriver->World = World;
+	NetDriver->Connection = WorkerConnection;
+	
+	NetConnection->Driver = NetDriver;
+	NetConnection->State = USOCK_Closed;
+
+	NetDriver->AddClientConnection(NetConnection);
+
+	NetDriver->StaticComponentView = StaticComponentView;
+
+	SpatialReceiver->Init(NetDriver, &World->GetTimerManager(), nullptr);	 //UE424_TODO - need a proper RPCService?
+	NetDriver->Receiver = SpatialReceiver;
+
+	PackageMap->Initialize(NetConnection, NetDriver->GuidCache);
+	PackageMap->Init(NetDriver, &World->GetTimerManager());
+	NetDriver->PackageMap = PackageMap;
+	NetConnection->PackageMap = PackageMap;
+
+	NetDriver->ClassInfoManager = NewObject<USpatialClassInfoManager>();
+	if (!NetDriver->ClassInfoManager->TryInit(NetDriver))
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to initialise the NetDriver's ClassInfoManager!"));
+		return false;
+	}
+	NetDriver->ClassInfoManager = ClassInfoManager;
+
+	SpatialSender->Init(NetDriver, &World->GetTimerManager(), nullptr);	   //UE424_TODO - need a proper RPCService?
+	NetDriver->Sender = SpatialSender;
+
+	NetDriver->InterestFactory = MakeUnique<SpatialGDK::InterestFactory>(ClassInfoManager, PackageMap);
+
+	return true;
+}
 
 bool USnapshotMigratorCommandlet::MigrateSnapshot(const FString& Source, const FString& Target)
 {
+	// Whether a reference dangles depends on entities later in the snapshot too, so they're all indexed before the first one is migrated.
+	if (bScrubDanglingReferences)
+	{
+		SurvivingEntities = BuildSurvivingEntityIndex(Source);
+		if (!SurvivingEntities.IsValid())
+		{
+			return false;
+		}
+	}
+
+	ON_SCOPE_EXIT
+	{
+		SurvivingEntities.Reset();
+	};
+
 	const Worker_ComponentVtable DefaultInputVtable{};
 	Worker_SnapshotParameters InputParameters{};
 	InputParameters.default_component_vtable = &DefaultInputVtable;
@@ -247,68 +878,625 @@ bool USnapshotMigratorCommandlet::MigrateSnapshot(const FString& Source, const F
 	// Write to a temporary snapshot first. There may already be a file with the intended target name in existence and we don't want to mangle it if we end up failing the migration.
 	const FString& TmpSnapshotPath = FString::Printf(TEXT("%s.tmp"), *Source);
 
-	Worker_SnapshotOutputStream* OutputStream = Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*TmpSnapshotPath), &OutputParameters);
+	// With checkpoints, the output is written in segments which are only merged into the temporary snapshot once every entity has been migrated.
+	const bool bWriteCheckpoints = CheckpointInterval > 0.f;
+	const FString& CheckpointPath = SnapshotMigrationCheckpoint::GetCheckpointPath(Target);
+	SnapshotMigrationCheckpoint Checkpoint;
+
+	if (bWriteCheckpoints)
+	{
+		Checkpoint.InputsHash = GetCheckpointInputsHash(Source);
+
+		SnapshotMigrationCheckpoint PreviousCheckpoint;
+		const bool bCanResume = bResumeFromCheckpoint && SnapshotMigrationCheckpoint::Load(CheckpointPath, PreviousCheckpoint) && PreviousCheckpoint.InputsHash == Checkpoint.InputsHash &&
+			!PreviousCheckpoint.SegmentPaths.ContainsByPredicate([](const FString& SegmentPath) { return !IFileManager::Get().FileExists(*SegmentPath); });
+
+		if (bCanResume)
+		{
+			UE_LOG(LogSnapshotMigrator, Display, TEXT("Resuming migration of %s after %llu entities."), *MigrationData.GetSnapshotName(), PreviousCheckpoint.NumProcessedEntities);
+
+			Checkpoint = PreviousCheckpoint;
+			MigrationData = PreviousCheckpoint.MigrationData;
+			MigrationData.SetRetainSkipDetails(bRetainSkipDetails);
+			MigrationData.Resume();
+		}
+		else
+		{
+			SnapshotMigrationCheckpoint::Delete(CheckpointPath);
+		}
+	}
+
+	// Dry runs don't have an output stream at all; entities which would be written are projected instead.
+	const FString& OutputPath = bWriteCheckpoints ? SnapshotMigrationCheckpoint::GetSegmentPath(Target, Checkpoint.SegmentPaths.Num()) : TmpSnapshotPath;
+	Worker_SnapshotOutputStream* OutputStream = bDryRun ? nullptr : Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*OutputPath), &OutputParameters);
+
+	// Each fan-out target's snapshot is given the target snapshot's file name in the fan-out target's own directory.
+	TArray<FString> FanOutTmpSnapshotPaths;
+	for (int32 i = 0; i < FanOutTargets.Num(); i++)
+	{
+		FanOutTmpSnapshotPaths.Add(FString::Printf(TEXT("%s.%d.tmp"), *Source, i + 1));
+		FanOutTargets[i].OutputStream = Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*FanOutTmpSnapshotPaths[i]), &OutputParameters);
+	}
+
+	// In its own scope to make use of ON_SCOPE_EXIT below
+	{
+		// Clean up & release resources associated with both streams
+		ON_SCOPE_EXIT
+		{
+			Worker_SnapshotInputStream_Destroy(InputStream);
+			if (OutputStream != nullptr)
+			{
+				Worker_SnapshotOutputStream_Destroy(OutputStream);
+			}
+			for (FanOutTarget& FanOut : FanOutTargets)
+			{
+				Worker_SnapshotOutputStream_Destroy(FanOut.OutputStream);
+				FanOut.OutputStream = nullptr;
+			}
+		};
+
+		// Wrap input/output stream state validators for easier usage.
+		const auto IsInputStreamStateValid = [InputStream](const FString& OpContext) {
+			return SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, OpContext);
+		};
+
+		// The output stream is replaced at each checkpoint, so it has to be captured by reference.
+		const auto IsOutputStreamStateValid = [&OutputStream](const FString& OpContext) {
+			return OutputStream == nullptr || SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, OpContext);
+		};
+
+		// Fan-out targets' streams are only checked when they're created and once every entity has been written to them, since MigrateEntity doesn't
+		// report which of them it wrote to.
+		const auto AreFanOutStreamStatesValid = [this](const FString& OpContext) {
+			return !FanOutTargets.ContainsByPredicate([&OpContext](const FanOutTarget& FanOut) {
+				return !SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, FanOut.OutputStream, OpContext);
+			});
+		};
+
+		if (!IsInputStreamStateValid(FString{ TEXT("initialise input stream") }) || !IsOutputStreamStateValid(FString{ TEXT("initialise output stream") }) ||
+			!AreFanOutStreamStatesValid(FString{ TEXT("initialise fan-out output stream") }))
+		{
+			return false;
+		}
+
+		uint64 EntityIndex = 0;
+
+		const bool bReportProgress = ProgressInterval > 0.f;
+		Progress = SnapshotMigrationProgress{};
+		Progress.SnapshotName = MigrationData.GetSnapshotName();
+		Progress.SourceSnapshotSize = IFileManager::Get().FileSize(*Source);
+		ProgressStartCycles = LastProgressCycles = LastCheckpointCycles = FPlatformTime::Cycles64();
+
+		// The input stream can't seek, so the entities already migrated by a resumed checkpoint have to be read again. The selected ones are passed
+		// through the sampler as well, so that it goes on to pick the same entities as an uninterrupted migration would.
+		while (EntityIndex < Checkpoint.NumProcessedEntities && Worker_SnapshotInputStream_HasNext(InputStream))
+		{
+			const Worker_Entity* Entity = Worker_SnapshotInputStream_ReadEntity(InputStream);
+			if (!IsInputStreamStateValid(FString{ TEXT("read already migrated entity from snapshot") }))
+			{
+				return false;
+			}
+
+			if (Sampler.IsValid() && (!Selector.IsValid() || Selector->ShouldMigrateEntity(Entity)))
+			{
+				Sampler->ShouldMigrateEntity(Entity);
+			}
+
+			if (bReportProgress)
+			{
+				Progress.NumProcessedEntities++;
+				Progress.BytesRead += SnapshotHelperLibrary::GetSerializedComponentsSize(Entity->components, Entity->component_count);
+			}
+
+			EntityIndex++;
+		}
+
+		while (Worker_SnapshotInputStream_HasNext(InputStream))
+		{
+			if (!IsInputStreamStateValid(FString{ TEXT("check if snapshot has remaining entities") }))
+			{
+				return false;
+			}
+
+			// Counted whether or not the run is traced, since checkpoints record how many entities to skip when resuming.
+			const uint64 ReadEntityIndex = EntityIndex++;
+			EntityTraceWriter = TraceWriter.IsValid() && TraceWriter->ShouldSampleEntity(ReadEntityIndex) ? TraceWriter.Get() : nullptr;
+			if (EntityTraceWriter != nullptr)
+			{
+				EntityTraceWriter->SetEntityArgs(SpatialConstants::INVALID_ENTITY_ID);
+			}
+
+			const Worker_Entity* Entity = nullptr;
+			{
+				SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, Read);
+				Entity = Worker_SnapshotInputStream_ReadEntity(InputStream);
+			}
+
+			if (!IsInputStreamStateValid(FString{ TEXT("read entity from snapshot") }))
+			{
+				return false;
+			}
+
+			if (EntityTraceWriter != nullptr)
+			{
+				EntityTraceWriter->SetEntityArgs(Entity->entity_id);
+			}
+
+			if (bReportProgress)
+			{
+				Progress.NumProcessedEntities++;
+				Progress.BytesRead += SnapshotHelperLibrary::GetSerializedComponentsSize(Entity->components, Entity->component_count);
+			}
+
+			if (Selector.IsValid() && !Selector->ShouldMigrateEntity(Entity))
+			{
+				SkipUnselectedEntity(OutputStream, Entity);
+				if (!IsOutputStreamStateValid(FString::Printf(TEXT("copy entity with id %lld to snapshot"), Entity->entity_id)))
+				{
+					return false;
+				}
+			}
+			else if (Sampler.IsValid() && !Sampler->ShouldMigrateEntity(Entity))
+			{
+				MigrationData.RecordUnsampledEntity();
+				for (FanOutTarget& FanOut : FanOutTargets)
+				{
+					FanOut.MigrationData.RecordUnsampledEntity();
+				}
+			}
+			else if (MigrateEntity(OutputStream, Entity) && !IsOutputStreamStateValid(FString::Printf(TEXT("write entity with id %lld to snapshot"), Entity->entity_id)))
+			{
+				return false;
+			}
+
+			if (bReportProgress && FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - LastProgressCycles) >= ProgressInterval)
+			{
+				ReportProgress(false);
+			}
+
+			if (bWriteCheckpoints && FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - LastCheckpointCycles) >= CheckpointInterval &&
+				!WriteCheckpoint(Target, EntityIndex, OutputParameters, OutputStream, Checkpoint))
+			{
+				return false;
+			}
+		}
+
+		if (bReportProgress)
+		{
+			ReportProgress(true);
+		}
+
+		if (!AreFanOutStreamStatesValid(FString{ TEXT("write entities to fan-out snapshot") }))
+		{
+			return false;
+		}
+	}
+
+	if (bDryRun)
+	{
+		return true;
+	}
+
+	if (bWriteCheckpoints)
+	{
+		// The final segment was closed along with the output stream above.
+		Checkpoint.SegmentPaths.Add(SnapshotMigrationCheckpoint::GetSegmentPath(Target, Checkpoint.SegmentPaths.Num()));
+		if (!SnapshotHelperLibrary::ConcatenateSnapshots(Checkpoint.SegmentPaths, TmpSnapshotPath))
+		{
+			UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to merge the migrated segments of %s; the migration can be resumed from its last checkpoint."), *MigrationData.GetSnapshotName());
+			return false;
+		}
+	}
+
+	if (SpatialOrderMaxRunBytes > 0)
+	{
+		bool bOrdered = OrderSnapshotSpatially(TmpSnapshotPath, MigrationData);
+		for (int32 i = 0; i < FanOutTargets.Num(); i++)
+		{
+			bOrdered &= OrderSnapshotSpatially(FanOutTmpSnapshotPaths[i], FanOutTargets[i].MigrationData);
+		}
+
+		if (!bOrdered)
+		{
+			return false;
+		}
+	}
+
+	// If we reach this point, all entities have either been migrated or skipped.
+	// However, if we fail to move the file into place then the migration has technically failed, since no migrated snapshot will exist at the target path.
+	// This can be communicated by simply returning the value of the move operation.
+	bool bMoved = IFileManager::Get().Move(*Target, *TmpSnapshotPath, true, true);
+
+	for (int32 i = 0; i < FanOutTargets.Num(); i++)
+	{
+		bMoved &= IFileManager::Get().Move(*FPaths::Combine(FanOutTargets[i].TargetSnapshotDir, FPaths::GetCleanFilename(Target)), *FanOutTmpSnapshotPaths[i], true, true);
+	}
+
+	if (bMoved && bWriteCheckpoints)
+	{
+		for (const FString& SegmentPath : Checkpoint.SegmentPaths)
+		{
+			IFileManager::Get().Delete(*SegmentPath, false, true);
+		}
+		IFileManager::Get().Delete(*CheckpointPath, false, true);
+	}
+
+	return bMoved;
+}
+
+bool USnapshotMigratorCommandlet::MigrateSnapshotInShards(const Snapshot& Snapshot)
+{
+	// Each shard gets a directory laid out like the migrator's own inputs and outputs, so that it can be migrated by an ordinary migrator process.
+	const FString& ShardsDir = FPaths::ConvertRelativePathToFull(FString::Printf(TEXT("%s.shards"), *Snapshot.TargetPath));
+	IFileManager::Get().DeleteDirectory(*ShardsDir, false, true);
+
+	TArray<FString> ShardDirs;
+	TArray<FString> ShardSourcePaths;
+	TArray<FString> ShardTargetPaths;
+	for (int32 i = 0; i < NumShards; i++)
+	{
+		const FString& ShardDir = FPaths::Combine(ShardsDir, FString::FromInt(i));
+		const FString& ShardArtifactsDir = FPaths::Combine(ShardDir, FString{ TEXT("artifacts") });
+
+		if (!IFileManager::Get().MakeDirectory(*ShardArtifactsDir, true) ||
+			IFileManager::Get().Copy(*FPaths::Combine(ShardArtifactsDir, FPaths::GetCleanFilename(OldSchemaBundlePath)), *OldSchemaBundlePath) != COPY_OK)
+		{
+			UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to set up shard directory %s!"), *ShardDir);
+			return false;
+		}
+
+		ShardDirs.Add(ShardDir);
+		ShardSourcePaths.Add(FPaths::Combine(ShardArtifactsDir, Snapshot.Name));
+		ShardTargetPaths.Add(FPaths::Combine(ShardDir, FString{ TEXT("snapshots") }, Snapshot.Name));
+	}
+
+	{
+		SnapshotMigrationTraceSpan SplitSpan(TraceWriter.Get(), TEXT("SplitSnapshot"));
+		if (!SnapshotHelperLibrary::SplitSnapshot(Snapshot.SourcePath, ShardSourcePaths))
+		{
+			UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to split %s into %d shards!"), *Snapshot.Name, NumShards);
+			return false;
+		}
+	}
+
+	TArray<FProcHandle> ShardProcesses;
+	{
+		SnapshotMigrationTraceSpan MigrateShardsSpan(TraceWriter.Get(), TEXT("MigrateShards"));
+
+		const FString& ProjectFilePath = FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath());
+		for (const FString& ShardDir : ShardDirs)
+		{
+			const FString& Args = FString::Printf(TEXT("\"%s\" -Run=SnapshotMigrator%s -OldArtifactsDir=\"%s\" -TargetSnapshotDir=\"%s\" -LogJSON=\"%s\" -abslog=\"%s\" -unattended -nopause -nosplash"),
+				*ProjectFilePath,
+				*ShardParams,
+				*FPaths::Combine(ShardDir, FString{ TEXT("artifacts") }),
+				*FPaths::Combine(ShardDir, FString{ TEXT("snapshots") }),
+				*FPaths::Combine(ShardDir, FString{ TEXT("Report.json") }),
+				*FPaths::Combine(ShardDir, FString{ TEXT("Migrator.log") }));
+
+			FProcHandle ShardProcess = FPlatformProcess::CreateProc(FPlatformProcess::ExecutablePath(), *Args, false, true, true, nullptr, 0, nullptr, nullptr);
+			if (!ShardProcess.IsValid())
+			{
+				UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to start migrator process for %s!"), *ShardDir);
+				for (FProcHandle& StartedProcess : ShardProcesses)
+				{
+					FPlatformProcess::TerminateProc(StartedProcess);
+					FPlatformProcess::CloseProc(StartedProcess);
+				}
+				return false;
+			}
+
+			ShardProcesses.Add(ShardProcess);
+		}
+
+		for (FProcHandle& ShardProcess : ShardProcesses)
+		{
+			FPlatformProcess::WaitForProc(ShardProcess);
+			FPlatformProcess::CloseProc(ShardProcess);
+		}
+	}
+
+	// The migrator's exit code doesn't reflect whether its snapshots were migrated, but a migrated snapshot is only moved to its target path if it was.
+	for (int32 i = 0; i < NumShards; i++)
+	{
+		FString ReportString;
+		TSharedPtr<FJsonObject> ReportJson;
+		SnapshotMigrationData ShardMigrationData;
+
+		if (!IFileManager::Get().FileExists(*ShardTargetPaths[i]) ||
+			!FFileHelper::LoadFileToString(ReportString, *FPaths::Combine(ShardDirs[i], FString{ TEXT("Report.json") })) ||
+			!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(ReportString), ReportJson) ||
+			!SnapshotMigrationData::FromJson(ReportJson, ShardMigrationData))
+		{
+			UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to migrate shard %d of %s; see %s for details."), i, *Snapshot.Name, *FPaths::Combine(ShardDirs[i], FString{ TEXT("Migrator.log") }));
+			return false;
+		}
+
+		MigrationData.Merge(ShardMigrationData);
+	}
+
+	const FString& TmpSnapshotPath = FString::Printf(TEXT("%s.tmp"), *Snapshot.TargetPath);
+	{
+		SnapshotMigrationTraceSpan ConcatenateSpan(TraceWriter.Get(), TEXT("ConcatenateShards"));
+		if (!SnapshotHelperLibrary::ConcatenateSnapshots(ShardTargetPaths, TmpSnapshotPath))
+		{
+			UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to concatenate the migrated shards of %s!"), *Snapshot.Name);
+			return false;
+		}
+	}
+
+	// Shards are ordered as a whole once they've been concatenated, rather than each on its own.
+	if (SpatialOrderMaxRunBytes > 0 && !OrderSnapshotSpatially(TmpSnapshotPath, MigrationData))
+	{
+		return false;
+	}
+
+	if (!IFileManager::Get().Move(*Snapshot.TargetPath, *TmpSnapshotPath, true, true))
+	{
+		return false;
+	}
+
+	// Shard directories are kept when something goes wrong, so that their logs can be looked at.
+	IFileManager::Get().DeleteDirectory(*ShardsDir, false, true);
+	return true;
+}
+
+FString USnapshotMigratorCommandlet::GetCheckpointInputsHash(const FString& Source) const
+{
+	// Hashing a large source snapshot takes a while, so it's identified by its size and timestamp instead.
+	const TArray<FString> Inputs{
+		SharedManifestInputs.WhitelistHash,
+		SharedManifestInputs.OldSchemaBundleHash,
+		SharedManifestInputs.NewSchemaBundleHash,
+		SharedManifestInputs.OptionsHash,
+		LexToString(IFileManager::Get().FileSize(*Source)),
+		IFileManager::Get().GetTimeStamp(*Source).ToString()
+	};
+
+	return FMD5::HashAnsiString(*FString::Join(Inputs, TEXT("\n")));
+}
+
+bool USnapshotMigratorCommandlet::WriteCheckpoint(const FString& Target, const uint64 NumProcessedEntities, const Worker_SnapshotParameters& OutputParameters, Worker_SnapshotOutputStream*& OutputStream, SnapshotMigrationCheckpoint& Checkpoint)
+{
+	SnapshotMigrationTraceSpan CheckpointSpan(TraceWriter.Get(), TEXT("WriteCheckpoint"));
+
+	// Destroying the stream flushes the segment to disk, after which it's safe for the checkpoint to refer to it.
+	Worker_SnapshotOutputStream_Destroy(OutputStream);
+	OutputStream = nullptr;
+
+	Checkpoint.SegmentPaths.Add(SnapshotMigrationCheckpoint::GetSegmentPath(Target, Checkpoint.SegmentPaths.Num()));
+	Checkpoint.NumProcessedEntities = NumProcessedEntities;
+	Checkpoint.MigrationData = MigrationData;
+	Checkpoint.MigrationData.FinalizeData();
+
+	if (!Checkpoint.Save(SnapshotMigrationCheckpoint::GetCheckpointPath(Target)))
+	{
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to save checkpoint for %s; the migration will carry on, but can only be resumed from an earlier checkpoint."), *MigrationData.GetSnapshotName());
+	}
+
+	LastCheckpointCycles = FPlatformTime::Cycles64();
+
+	OutputStream = Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*SnapshotMigrationCheckpoint::GetSegmentPath(Target, Checkpoint.SegmentPaths.Num())), &OutputParameters);
+	return SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString{ TEXT("initialise next output segment") });
+}
+
+bool USnapshotMigratorCommandlet::OrderSnapshotSpatially(const FString& Path, SnapshotMigrationData& OutMigrationData)
+{
+	SnapshotMigrationTraceSpan OrderSpan(TraceWriter.Get(), TEXT("SpatialOrder"));
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const FString& OrderedPath = FString::Printf(TEXT("%s.ordered"), *Path);
+
+	SnapshotMigrationSpatialOrder::Result Result;
+	if (!SnapshotMigrationSpatialOrder::OrderSnapshot(Path, OrderedPath, SpatialOrderMaxRunBytes, Result) || !IFileManager::Get().Move(*Path, *OrderedPath, true, true))
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to order the entities of %s spatially!"), *OutMigrationData.GetSnapshotName());
+		IFileManager::Get().Delete(*OrderedPath, false, true);
+		return false;
+	}
+
+	OutMigrationData.SetSpatialOrderLocality(Result.MeanNeighbourDistanceBefore, Result.MeanNeighbourDistanceAfter);
+
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Ordered %llu entities of %s spatially in %.2f seconds, sorting %d run(s); %llu have no position. Mean distance between neighbouring entities: %.2f -> %.2f."),
+		Result.NumEntities, *OutMigrationData.GetSnapshotName(), FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles), Result.NumRuns, Result.NumEntitiesWithoutPosition,
+		Result.MeanNeighbourDistanceBefore, Result.MeanNeighbourDistanceAfter);
+
+	return true;
+}
+
+bool USnapshotMigratorCommandlet::VerifySnapshot(const FString& Path, const SchemaBundleDefinitions& Definitions, SnapshotMigrationData& OutMigrationData)
+{
+	SnapshotMigrationTraceSpan VerifySpan(TraceWriter.Get(), TEXT("Verify"));
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const SnapshotMigrationVerifier Verifier{ Definitions };
+	SnapshotMigrationVerifier::Result Result;
+	Verifier.VerifySnapshot(Path, [this, &OutMigrationData](const SnapshotVerificationIssue& Issue) {
+		OutMigrationData.RecordVerificationFailure(Issue.EntityId, Issue.ComponentId, Issue.FieldPath, Issue.Failure);
+		for (TUniquePtr<SnapshotMigrationReporterBase>& Reporter : Reporters)
+		{
+			Reporter->OnVerificationFailure(OutMigrationData, Issue.EntityId, Issue.ComponentId, Issue.FieldPath, Issue.Failure);
+		}
+	}, Result);
+
+	const double VerificationTime = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+	OutMigrationData.SetVerified(Result.NumEntities, VerificationTime);
+
+	if (Result.NumIssues > 0)
+	{
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Verification of %s found %llu failure(s) in %llu entities!"), *OutMigrationData.GetSnapshotName(), Result.NumIssues, Result.NumEntities);
+		return false;
+	}
+
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Verified %llu entities of %s in %.2f seconds."), Result.NumEntities, *OutMigrationData.GetSnapshotName(), VerificationTime);
+	return true;
+}
+
+TUniquePtr<SnapshotMigrationEntityIndex> USnapshotMigratorCommandlet::BuildSurvivingEntityIndex(const FString& Source)
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const Worker_ComponentVtable DefaultInputVtable{};
+	Worker_SnapshotParameters InputParameters{};
+	InputParameters.default_component_vtable = &DefaultInputVtable;
+
+	Worker_SnapshotInputStream* InputStream = Worker_SnapshotInputStream_Create(TCHAR_TO_UTF8(*Source), &InputParameters);
+	ON_SCOPE_EXIT
+	{
+		Worker_SnapshotInputStream_Destroy(InputStream);
+	};
 
-	// In its own scope to make use of ON_SCOPE_EXIT below
+	const auto IsInputStreamStateValid = [InputStream](const FString& OpContext) {
+		return SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, OpContext);
+	};
+
+	if (!IsInputStreamStateValid(FString{ TEXT("initialise input stream to index") }))
 	{
-		// Clean up & release resources associated with both streams
-		ON_SCOPE_EXIT
-		{
-			Worker_SnapshotInputStream_Destroy(InputStream);
-			Worker_SnapshotOutputStream_Destroy(OutputStream);
-		};
+		return nullptr;
+	}
 
-		// Wrap input/output stream state validators for easier usage.
-		const auto IsInputStreamStateValid = [InputStream](const FString& OpContext) {
-			return SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, OpContext);
-		};
+	// Entities which aren't sampled aren't migrated either. The sampler is copied, so that the migration goes on to pick the same entities afresh.
+	// Unselected entities survive if they're copied, but they keep their refs as they are, since they're never decoded.
+	TUniquePtr<SnapshotMigrationSampler> IndexSampler = Sampler.IsValid() ? MakeUnique<SnapshotMigrationSampler>(*Sampler) : nullptr;
 
-		const auto IsOutputStreamStateValid = [OutputStream](const FString& OpContext) {
-			return SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, OpContext);
-		};
+	// Every entity of a class is either skipped for its class or not, so each class is only filtered and loaded once.
+	TMap<FString, bool> IsClassMigratedByClassPath;
+
+	TUniquePtr<SnapshotMigrationEntityIndex> Index = MakeUnique<SnapshotMigrationEntityIndex>();
 
-		if (!IsInputStreamStateValid(FString{ TEXT("initialise input stream") }) || !IsOutputStreamStateValid(FString{ TEXT("initialise output stream") }))
+	while (Worker_SnapshotInputStream_HasNext(InputStream))
+	{
+		const Worker_Entity* Entity = Worker_SnapshotInputStream_ReadEntity(InputStream);
+		if (!IsInputStreamStateValid(FString{ TEXT("read entity from snapshot to index") }))
 		{
-			return false;
+			return nullptr;
 		}
 
-		while (Worker_SnapshotInputStream_HasNext(InputStream))
+		if (Selector.IsValid() && !Selector->ShouldMigrateEntity(Entity))
 		{
-			if (!IsInputStreamStateValid(FString{ TEXT("check if snapshot has remaining entities") }))
+			if (Selector->GetUnselectedEntityAction() == SnapshotMigrationSelector::UnselectedEntityAction::Copy)
 			{
-				return false;
+				Index->Add(Entity->entity_id);
 			}
+			continue;
+		}
 
-			const Worker_Entity* Entity = Worker_SnapshotInputStream_ReadEntity(InputStream);
-			if (!IsInputStreamStateValid(FString{ TEXT("read entity from snapshot") }))
+		if (IndexSampler.IsValid() && !IndexSampler->ShouldMigrateEntity(Entity))
+		{
+			continue;
+		}
+
+		// Matches the checks MigrateEntity makes before spawning an entity's actor.
+		const Worker_ComponentData* UnrealMetadataComponentPtr = SnapshotHelperLibrary::GetComponentFromEntityById(Entity, SpatialConstants::UNREAL_METADATA_COMPONENT_ID);
+		if (UnrealMetadataComponentPtr != nullptr)
+		{
+			const SpatialGDK::UnrealMetadata UnrealMetadata{ *UnrealMetadataComponentPtr };
+
+			const bool* bIsClassMigrated = IsClassMigratedByClassPath.Find(UnrealMetadata.ClassPath);
+			if (bIsClassMigrated == nullptr)
 			{
-				return false;
+				UClass* EntityActorClass = DoesEntityPassClassFilter(UnrealMetadata.ClassPath) ? LoadObject<UClass>(NULL, *UnrealMetadata.ClassPath) : nullptr;
+				bIsClassMigrated = &IsClassMigratedByClassPath.Add(UnrealMetadata.ClassPath, EntityActorClass != nullptr && !EntityActorClass->HasAnySpatialClassFlags(SPATIALCLASS_NotPersistent));
 			}
 
-			if (MigrateEntity(OutputStream, Entity) && !IsOutputStreamStateValid(FString::Printf(TEXT("write entity with id %lld to snapshot"), Entity->entity_id)))
+			if (!*bIsClassMigrated)
 			{
-				return false;
+				continue;
 			}
 		}
+
+		Index->Add(Entity->entity_id);
 	}
 
-	// If we reach this point, all entities have either been migrated or skipped.
-	// However, if we fail to move the file into place then the migration has technically failed, since no migrated snapshot will exist at the target path.
-	// This can be communicated by simply returning the value of the move operation.
-	return IFileManager::Get().Move(*Target, *TmpSnapshotPath, true, true);
+	Index->Build();
+
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Indexed %d entities to migrate from %s in %.2f seconds (%s, %llu bytes)."), Index->Num(), *MigrationData.GetSnapshotName(),
+		FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles), Index->IsBitmap() ? TEXT("bitmap") : TEXT("sorted ids"), static_cast<uint64>(Index->GetAllocatedSize()));
+
+	return Index;
+}
+
+void USnapshotMigratorCommandlet::SkipUnselectedEntity(Worker_SnapshotOutputStream* OutStream, const Worker_Entity* Entity)
+{
+	// Dry runs have no output stream to copy to, and copies cost next to nothing, so they aren't projected either.
+	const bool bCopy = Selector->GetUnselectedEntityAction() == SnapshotMigrationSelector::UnselectedEntityAction::Copy;
+	if (bCopy && OutStream != nullptr)
+	{
+		Worker_SnapshotOutputStream_WriteEntity(OutStream, Entity);
+	}
+	MigrationData.RecordUnselectedEntity();
+
+	for (FanOutTarget& Target : FanOutTargets)
+	{
+		if (bCopy)
+		{
+			Worker_SnapshotOutputStream_WriteEntity(Target.OutputStream, Entity);
+		}
+		Target.MigrationData.RecordUnselectedEntity();
+	}
 }
 
 bool USnapshotMigratorCommandlet::MigrateEntity(Worker_SnapshotOutputStream* OutStream, const Worker_Entity* Entity)
 {
+	SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, MigrateEntity);
+
 	const Worker_ComponentData* UnrealMetadataComponentPtr = SnapshotHelperLibrary::GetComponentFromEntityById(Entity, SpatialConstants::UNREAL_METADATA_COMPONENT_ID);
 
 	TArray<Worker_ComponentData> MigratedComponents;
+	// Copies of component data made for compaction, which clears fields in place and mustn't touch the source snapshot's entity.
+	TArray<Schema_ComponentData*> CopiedComponentData;
+	ON_SCOPE_EXIT
+	{
+		for (Schema_ComponentData* ComponentData : CopiedComponentData)
+		{
+			Schema_DestroyComponentData(ComponentData);
+		}
+	};
 
 	const uint32 EntityId = Entity->entity_id;
+	const uint64 EntityStartCycles = FPlatformTime::Cycles64();
+
+	EntitySkippedComponentFields.Reset();
 
 	if (UnrealMetadataComponentPtr == nullptr)
 	{
-		MigratedComponents = TArray<Worker_ComponentData>(Entity->components, Entity->component_count);
+		// Only clearing fields changes the data itself; dropping components just leaves them off the array.
+		const bool bCopyComponentData = Compactor.IsValid() && Compactor->HasRule(SnapshotCompactionRule::UnknownFields);
+		const auto GetEntityComponents = [Entity, bCopyComponentData, &CopiedComponentData]() {
+			TArray<Worker_ComponentData> Components(Entity->components, Entity->component_count);
+			if (bCopyComponentData)
+			{
+				for (Worker_ComponentData& Component : Components)
+				{
+					Component.schema_type = CopiedComponentData.Add_GetRef(Schema_CopyComponentData(Component.schema_type));
+				}
+			}
+			return Components;
+		};
+
+		// Entities without an actor are copied as they are, whichever schema bundle they're migrated to.
+		for (FanOutTarget& Target : FanOutTargets)
+		{
+			if (Compactor.IsValid())
+			{
+				TArray<Worker_ComponentData> TargetComponents = GetEntityComponents();
+				CompactEntity(Target.Definitions, TargetComponents, Target.MigrationData);
+
+				Worker_Entity TargetEntity;
+				TargetEntity.entity_id = Entity->entity_id;
+				TargetEntity.components = TargetComponents.GetData();
+				TargetEntity.component_count = TargetComponents.Num();
+				Worker_SnapshotOutputStream_WriteEntity(Target.OutputStream, &TargetEntity);
+			}
+			else
+			{
+				Worker_SnapshotOutputStream_WriteEntity(Target.OutputStream, Entity);
+			}
+			Target.MigrationData.RecordMigratedEntity();
+		}
+
+		MigratedComponents = GetEntityComponents();
 	}
 	else
 	{
@@ -316,16 +1504,71 @@ bool USnapshotMigratorCommandlet::MigrateEntity(Worker_SnapshotOutputStream* Out
 
 		const bool bIsStartupActor = UnrealMetadata.bNetStartup.IsSet() && UnrealMetadata.bNetStartup.GetValue();
 
-		if (!DoesEntityPassClassFilter(UnrealMetadata.ClassPath))
+		if (EntityTraceWriter != nullptr)
+		{
+			EntityTraceWriter->SetEntityArgs(Entity->entity_id, UnrealMetadata.ClassPath);
+		}
+
+		// Every path out of this scope either leaves MigratedComponents empty (the entity was skipped or projected) or filled in, ready to be written.
+		bool bProjected = false;
+		ON_SCOPE_EXIT
+		{
+			if (bRecordClassStats)
+			{
+				MigrationData.RecordClassMigration(UnrealMetadata.ClassPath, MigratedComponents.Num() > 0 || bProjected, FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - EntityStartCycles),
+					MigratedComponents.Num(), SnapshotHelperLibrary::GetSerializedComponentsSize(MigratedComponents.GetData(), MigratedComponents.Num()));
+			}
+		};
+
+		bool bPassesClassFilter = false;
+		{
+			SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, ClassFilter);
+			bPassesClassFilter = DoesEntityPassClassFilter(UnrealMetadata.ClassPath);
+		}
+
+		if (!bPassesClassFilter)
 		{
-			MigrationData.RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, FString{ TEXT("Class does not match any patterns provided in the whitelist.") });
+			RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, SnapshotMigrationSkipReason::ClassNotWhitelisted);
 			return false;
 		}
 
-		UClass* EntityActorClass = LoadObject<UClass>(NULL, *UnrealMetadata.ClassPath);
+		// A cache hit implies that an identical entity of the same class has already passed every check below, so we can skip straight to writing.
+		// Classes which never hit aren't looked up at all once the cache gives up on them, which saves building their keys.
+		SnapshotMigrationCache::Key CacheKey;
+		const bool bLookUpCache = MigrationCache.IsValid() && MigrationCache->ShouldLookUp(UnrealMetadata.ClassPath);
+		if (bLookUpCache)
+		{
+			CacheKey = MigrationCache->MakeKey(UnrealMetadata.ClassPath, Entity);
+			const SnapshotMigrationCache::Entry* CachedEntry = MigrationCache->Find(CacheKey);
+			MigrationData.RecordMigrationCacheLookup(CachedEntry != nullptr);
+
+			if (CachedEntry != nullptr)
+			{
+				for (const SkippedComponentFieldInfo& SkippedComponentField : CachedEntry->SkippedComponentFields)
+				{
+					RecordSkippedComponentFieldUpdate(EntityId, SkippedComponentField.ComponentId, MigrationData.GetInternedString(SkippedComponentField.FieldNameIndex), SkippedComponentField.SkipReason);
+				}
+
+				// The cached components already have their default data cleared, so what clearing it saved is recorded as it was for the cached entity.
+				if (CachedEntry->NumClearedFields > 0)
+				{
+					MigrationData.RecordCompaction(CachedEntry->CompactedBytes, 0, 0, CachedEntry->NumClearedFields);
+				}
+
+				MigratedComponents = MigrationCache->Instantiate(*CachedEntry, Entity->entity_id);
+				return WriteMigratedEntity(OutStream, Entity->entity_id, MigratedComponents);
+			}
+		}
+
+		UClass* EntityActorClass = nullptr;
+		{
+			SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, LoadClass);
+			EntityActorClass = LoadObject<UClass>(NULL, *UnrealMetadata.ClassPath);
+		}
+
 		if (EntityActorClass == nullptr)
 		{
-			MigrationData.RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, FString{ TEXT("Could not locate class. This is expected if the class in question has been deleted.") });
+			RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, SnapshotMigrationSkipReason::ClassNotFound);
 			return false;
 		}
 
@@ -333,14 +1576,30 @@ bool USnapshotMigratorCommandlet::MigrateEntity(Worker_SnapshotOutputStream* Out
 		// If we encounter an entity in the snapshot whose class has since been marked as not-persistent, we should skip over it.
 		if (EntityActorClass->HasAnySpatialClassFlags(SPATIALCLASS_NotPersistent))
 		{
-			MigrationData.RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, FString{ TEXT("Class is marked 'Not Persistent'.") });
+			RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, SnapshotMigrationSkipReason::ClassNotPersistent);
 			return false;
 		}
 
-		AActor* EntityActor = World->SpawnActor(EntityActorClass);
+		// Past this point, whether an entity migrates depends on its data rather than its class. A dry run builds the first entity of each class
+		// in full (or as many as it takes for one to migrate), and projects the rest of the class from it without spawning them.
+		if (bDryRun)
+		{
+			if (const DryRunClassCalibration* Calibration = DryRunCalibrations.Find(UnrealMetadata.ClassPath))
+			{
+				bProjected = true;
+				return ProjectMigratedEntity(Entity, *Calibration);
+			}
+		}
+
+		AActor* EntityActor = nullptr;
+		{
+			SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, SpawnActor);
+			EntityActor = World->SpawnActor(EntityActorClass);
+		}
+
 		if (EntityActor == nullptr)
 		{
-			MigrationData.RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, FString{ TEXT("Failed to spawn actor.") });
+			RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, SnapshotMigrationSkipReason::SpawnActorFailed);
 			return false;
 		}
 
@@ -364,11 +1623,13 @@ bool USnapshotMigratorCommandlet::MigrateEntity(Worker_SnapshotOutputStream* Out
 		// The code in the following scope is taken from USpatialActorChannel::ReplicateActor (minus the Reporter line).
 		// We do this in order to build the Actor's "skeleton", which we can then boil down to the list of components that would be sent if we were actually creating this entity.
 		{
+			SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, Replicate);
+
 			// Create an outgoing bunch (to satisfy some of the functions below)
 			FOutBunch Bunch(PackageMap);
 			if (Bunch.IsError())
 			{
-				MigrationData.RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, FString{ TEXT("Failed to create initial bunch for simulated replication.") });
+				RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, SnapshotMigrationSkipReason::CreateBunchFailed);
 				return false;
 			}
 
@@ -427,33 +1688,314 @@ bool USnapshotMigratorCommandlet::MigrateEntity(Worker_SnapshotOutputStream* Out
 		SpatialGDK::EntityFactory EntityFactory(NetDriver, PackageMap, NetDriver->ClassInfoManager, nullptr); //UE424_TODO - need a proper RPCService?
 		SpatialGDK::FRPCsOnEntityCreationMap PendingRPCs{};
 		uint32 BytesWritten;
-		EntityComponents.Append(EntityFactory.CreateEntityComponents(Channel, PendingRPCs, BytesWritten));
+		{
+			SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, CreateEntityComponents);
+			EntityComponents.Append(EntityFactory.CreateEntityComponents(Channel, PendingRPCs, BytesWritten));
+		}
+
+		// The fan-out targets start from the components as the entity factory created them, so they have to be built before those are updated below.
+		if (FanOutTargets.Num() > 0)
+		{
+			SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, FanOut);
+			MigrateEntityToFanOutTargets(Entity, UnrealMetadata.ClassPath, EntityComponents);
+		}
+
+		// Actor and subobject components whose data is left as the entity factory created it hold nothing but the class' defaults.
+		TMap<Worker_ComponentId, TArray<uint8>> CreatedComponentData;
+		if (Compactor.IsValid() && Compactor->HasRule(SnapshotCompactionRule::DefaultComponentData))
+		{
+			for (const Worker_ComponentData& EntityComponent : EntityComponents)
+			{
+				if (ActorOrSubobjectIds.Contains(EntityComponent.component_id))
+				{
+					CreatedComponentData.Add(EntityComponent.component_id, SnapshotMigrationCompactor::SerializeComponentData(EntityComponent));
+				}
+			}
+		}
+
+		{
+			SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, UpdateComponents);
+			for (Worker_ComponentData& EntityComponent : EntityComponents)
+			{
+				const auto RecordSkippedField = [this, EntityId, &EntityComponent](const FString& FieldName, const SnapshotMigrationSkipReason SkipReason) {
+					RecordSkippedComponentFieldUpdate(EntityId, EntityComponent.component_id, FieldName, SkipReason);
+				};
+
+				uint32 OldId;
+				const bool FoundOldId = SchemaBundleDefinitions::GetCorrespondingComponentId(NewSchemaBundleDefinitions, OldSchemaBundleDefinitions, EntityComponent.component_id, OldId);
+				if (FoundOldId && OldComponentsById.Contains(OldId) &&
+					!UpdateComponent(OldComponentsById.FindChecked(OldId), EntityComponent, OldSchemaBundleDefinitions, NewSchemaBundleDefinitions, RecordSkippedField))
+				{
+					RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, SnapshotMigrationSkipReason::UpdateComponentFailed);
+					UE_LOG(LogSnapshotMigrator, Display, TEXT("Failed to update component %s on entity %lld!"), *NewSchemaBundleDefinitions.FindComponentChecked(EntityComponent.component_id).GetName(SchemaBundleDefinitionWithFields::NameType::SHORT), Entity->entity_id);
+					return false;
+				}
+			}
+		}
 
+		uint64 EntityCompactedBytes = 0;
+		uint32 EntityNumClearedFields = 0;
 		for (Worker_ComponentData& EntityComponent : EntityComponents)
 		{
-			uint32 OldId;
-			const bool FoundOldId = SchemaBundleDefinitions::GetCorrespondingComponentId(NewSchemaBundleDefinitions, OldSchemaBundleDefinitions, EntityComponent.component_id, OldId);
-			if (FoundOldId && OldComponentsById.Contains(OldId) && !UpdateComponent(EntityId, OldComponentsById.FindChecked(OldId), EntityComponent))
+			if (const TArray<uint8>* CreatedData = CreatedComponentData.Find(EntityComponent.component_id))
 			{
-				MigrationData.RecordSkippedEntity(EntityId, UnrealMetadata.ClassPath, FString{ TEXT("Encountered a problem while trying to update at least one component.") });
-				UE_LOG(LogSnapshotMigrator, Display, TEXT("Failed to update component %s on entity %lld!"), *NewSchemaBundleDefinitions.FindComponentChecked(EntityComponent.component_id).GetName(SchemaBundleDefinitionWithFields::NameType::SHORT), Entity->entity_id);
-				return false;
+				// Recorded here rather than when the entity is written, since by then the cleared fields are already gone from its size.
+				const uint64 BytesBefore = SnapshotHelperLibrary::GetSerializedComponentsSize(&EntityComponent, 1);
+				const uint32 NumClearedFields = Compactor->ClearDefaultComponentData(EntityComponent, *CreatedData);
+				if (NumClearedFields > 0)
+				{
+					const uint64 CompactedBytes = BytesBefore - SnapshotHelperLibrary::GetSerializedComponentsSize(&EntityComponent, 1);
+					MigrationData.RecordCompaction(CompactedBytes, 0, 0, NumClearedFields);
+					EntityCompactedBytes += CompactedBytes;
+					EntityNumClearedFields += NumClearedFields;
+				}
+			}
+		}
+
+		if (bLookUpCache)
+		{
+			MigrationCache->Add(MoveTemp(CacheKey), Entity->entity_id, EntityComponents, EntitySkippedComponentFields, EntityCompactedBytes, EntityNumClearedFields);
+		}
+
+		if (bDryRun)
+		{
+			DryRunClassCalibration& Calibration = DryRunCalibrations.Add(UnrealMetadata.ClassPath);
+			Calibration.Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - EntityStartCycles);
+			Calibration.NumBytes = SnapshotHelperLibrary::GetSerializedComponentsSize(EntityComponents.GetData(), EntityComponents.Num());
+			for (const Worker_ComponentData& EntityComponent : EntityComponents)
+			{
+				Calibration.ComponentIds.Add(EntityComponent.component_id);
 			}
 		}
 
 		MigratedComponents = MoveTemp(EntityComponents);
 	}
 
+	return WriteMigratedEntity(OutStream, Entity->entity_id, MigratedComponents);
+}
+
+bool USnapshotMigratorCommandlet::WriteMigratedEntity(Worker_SnapshotOutputStream* OutStream, const Worker_EntityId EntityId, TArray<Worker_ComponentData>& MigratedComponents)
+{
+	if (Compactor.IsValid())
+	{
+		SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, Compact);
+		CompactEntity(NewSchemaBundleDefinitions, MigratedComponents, MigrationData);
+	}
+
 	Worker_Entity NewEntity;
-	NewEntity.entity_id = Entity->entity_id;
+	NewEntity.entity_id = EntityId;
 	NewEntity.components = MigratedComponents.GetData();
 	NewEntity.component_count = MigratedComponents.Num();
 
-	Worker_SnapshotOutputStream_WriteEntity(OutStream, &NewEntity);
+	// There's no output stream during a dry run.
+	if (OutStream != nullptr)
+	{
+		SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, EntityTraceWriter, Write);
+		Worker_SnapshotOutputStream_WriteEntity(OutStream, &NewEntity);
+	}
+
+	if (bDryRun || ProgressInterval > 0.f)
+	{
+		const uint64 NumBytes = SnapshotHelperLibrary::GetSerializedComponentsSize(MigratedComponents.GetData(), MigratedComponents.Num());
+		Progress.BytesWritten += NumBytes;
+
+		if (bDryRun)
+		{
+			// The entity was built during the dry run, so only the cost of writing it isn't accounted for.
+			MigrationData.RecordProjectedOutput(0.0, NumBytes);
+		}
+	}
+
+	MigrationData.RecordMigratedEntity();
+	return true;
+}
+
+void USnapshotMigratorCommandlet::MigrateEntityToFanOutTargets(const Worker_Entity* Entity, const FString& EntityClass, const TArray<Worker_ComponentData>& EntityComponents)
+{
+	const uint32 EntityId = Entity->entity_id;
+
+	for (FanOutTarget& Target : FanOutTargets)
+	{
+		TArray<Worker_ComponentData> TargetComponents;
+		ON_SCOPE_EXIT
+		{
+			for (Worker_ComponentData& TargetComponent : TargetComponents)
+			{
+				Schema_DestroyComponentData(TargetComponent.schema_type);
+			}
+		};
+
+		bool bUpdatedComponents = true;
+		for (const Worker_ComponentData& EntityComponent : EntityComponents)
+		{
+			// Components which the target's schema doesn't have are left off the target's entity, like components which the new schema doesn't have.
+			uint32 TargetComponentId;
+			if (!SchemaBundleDefinitions::GetCorrespondingComponentId(NewSchemaBundleDefinitions, Target.Definitions, EntityComponent.component_id, TargetComponentId))
+			{
+				continue;
+			}
+
+			Worker_ComponentData& TargetComponent = TargetComponents.AddDefaulted_GetRef();
+			TargetComponent.component_id = TargetComponentId;
+			TargetComponent.schema_type = Schema_CreateComponentData();
+
+			// Fields skipped between the two target schemas are left at their defaults rather than reported, since they don't come from the snapshot.
+			const auto IgnoreSkippedField = [](const FString& FieldName, const SnapshotMigrationSkipReason SkipReason) {};
+			const auto RecordSkippedField = [&Target, EntityId, TargetComponentId](const FString& FieldName, const SnapshotMigrationSkipReason SkipReason) {
+				Target.MigrationData.RecordSkippedComponentFieldUpdate(EntityId, TargetComponentId, FieldName, SkipReason);
+			};
+
+			uint32 OldId;
+			const Worker_ComponentData* OldComponent = SchemaBundleDefinitions::GetCorrespondingComponentId(Target.Definitions, OldSchemaBundleDefinitions, TargetComponentId, OldId)
+				? SnapshotHelperLibrary::GetComponentFromEntityById(Entity, OldId)
+				: nullptr;
+
+			if (!UpdateComponent(EntityComponent, TargetComponent, NewSchemaBundleDefinitions, Target.Definitions, IgnoreSkippedField) ||
+				(OldComponent != nullptr && !UpdateComponent(*OldComponent, TargetComponent, OldSchemaBundleDefinitions, Target.Definitions, RecordSkippedField)))
+			{
+				UE_LOG(LogSnapshotMigrator, Display, TEXT("Failed to update component %s on entity %lld for %s!"), *Target.Definitions.FindComponentChecked(TargetComponentId).GetName(SchemaBundleDefinitionWithFields::NameType::SHORT), Entity->entity_id, *Target.CompiledSchemaDir);
+				bUpdatedComponents = false;
+				break;
+			}
+		}
+
+		if (!bUpdatedComponents)
+		{
+			Target.MigrationData.RecordSkippedEntity(EntityId, EntityClass, SnapshotMigrationSkipReason::UpdateComponentFailed);
+			continue;
+		}
+
+		// Compaction may leave components off the written entity, which still have to be destroyed along with the rest.
+		TArray<Worker_ComponentData> WrittenComponents = TargetComponents;
+		if (Compactor.IsValid())
+		{
+			CompactEntity(Target.Definitions, WrittenComponents, Target.MigrationData);
+		}
+
+		Worker_Entity TargetEntity;
+		TargetEntity.entity_id = Entity->entity_id;
+		TargetEntity.components = WrittenComponents.GetData();
+		TargetEntity.component_count = WrittenComponents.Num();
+
+		Worker_SnapshotOutputStream_WriteEntity(Target.OutputStream, &TargetEntity);
+		Target.MigrationData.RecordMigratedEntity();
+	}
+}
+
+void USnapshotMigratorCommandlet::CompactEntity(const SchemaBundleDefinitions& Definitions, TArray<Worker_ComponentData>& Components, SnapshotMigrationData& OutMigrationData)
+{
+	const uint64 BytesBefore = SnapshotHelperLibrary::GetSerializedComponentsSize(Components.GetData(), Components.Num());
+	const SnapshotCompactionResult Result = Compactor->CompactEntity(Definitions, Components);
+	const uint64 BytesAfter = SnapshotHelperLibrary::GetSerializedComponentsSize(Components.GetData(), Components.Num());
+
+	OutMigrationData.RecordCompaction(BytesBefore, BytesAfter, Result.NumDroppedComponents, Result.NumClearedFields);
+}
+
+bool USnapshotMigratorCommandlet::ProjectMigratedEntity(const Worker_Entity* Entity, const DryRunClassCalibration& Calibration)
+{
+	// Field type mismatches only depend on the schema, so the fields that a full migration would skip can be found without migrating the data.
+	// Like UpdateComponent, only components which the entity's class creates and which the old entity has are considered.
+	for (uint32 i = 0; i < Entity->component_count; i++)
+	{
+		const Worker_ComponentId OldComponentId = Entity->components[i].component_id;
+
+		uint32 NewComponentId;
+		if (SchemaBundleDefinitions::GetCorrespondingComponentId(OldSchemaBundleDefinitions, NewSchemaBundleDefinitions, OldComponentId, NewComponentId) && Calibration.ComponentIds.Contains(NewComponentId))
+		{
+			for (const FString& FieldName : GetFieldTypeMismatches(OldComponentId, NewComponentId))
+			{
+				RecordSkippedComponentFieldUpdate(Entity->entity_id, NewComponentId, FieldName, SnapshotMigrationSkipReason::FieldTypeMismatch);
+			}
+		}
+	}
+
+	MigrationData.RecordProjectedOutput(Calibration.Seconds, Calibration.NumBytes);
+	Progress.BytesWritten += Calibration.NumBytes;
+
 	MigrationData.RecordMigratedEntity();
 	return true;
 }
 
+const TArray<FString>& USnapshotMigratorCommandlet::GetFieldTypeMismatches(const Worker_ComponentId OldComponentId, const Worker_ComponentId NewComponentId)
+{
+	if (const TArray<FString>* CachedMismatches = FieldTypeMismatchesByOldComponentId.Find(OldComponentId))
+	{
+		return *CachedMismatches;
+	}
+
+	TArray<FString>& Mismatches = FieldTypeMismatchesByOldComponentId.Add(OldComponentId);
+
+	// Matches the checks made by CreateComponentMigration.
+	const SchemaBundleComponentDefinition& OldComponentDefinition = OldSchemaBundleDefinitions.FindComponentChecked(OldComponentId);
+	for (const SchemaBundleFieldDefinition& FieldDefinition : NewSchemaBundleDefinitions.FindComponentChecked(NewComponentId).GetFields())
+	{
+		const SchemaBundleFieldDefinition* OldFieldDefinition = OldComponentDefinition.FindField(FieldDefinition.GetName());
+		if (OldFieldDefinition != nullptr && !OldFieldDefinition->IsSameTypeAs(FieldDefinition))
+		{
+			Mismatches.Add(FieldDefinition.GetName());
+		}
+	}
+
+	if (const TArray<FString>* ChainMismatches = ChainFieldTypeMismatchesByComponentName.Find(OldComponentDefinition.GetName()))
+	{
+		Mismatches.Append(*ChainMismatches);
+	}
+
+	return Mismatches;
+}
+
+void USnapshotMigratorCommandlet::ReportProgress(const bool bFinished)
+{
+	LastProgressCycles = FPlatformTime::Cycles64();
+
+	Progress.bFinished = bFinished;
+	Progress.NumMigratedEntities = MigrationData.GetNumMigratedEntities();
+	Progress.NumSkippedEntities = MigrationData.GetNumSkippedEntities();
+	Progress.ElapsedTime = FPlatformTime::ToSeconds64(LastProgressCycles - ProgressStartCycles);
+
+	for (TUniquePtr<SnapshotMigrationReporterBase>& Reporter : Reporters)
+	{
+		Reporter->WriteProgress(Progress);
+	}
+}
+
+void USnapshotMigratorCommandlet::RecordSkippedEntity(const uint32 EntityId, const FString& EntityClass, const SnapshotMigrationSkipReason SkipReason)
+{
+	MigrationData.RecordSkippedEntity(EntityId, EntityClass, SkipReason);
+
+	// Failing to update a component is specific to the schema bundle it's migrated to, and fan-out targets record that themselves. Every other
+	// reason is decided before any target's components are built, so the entity is skipped for every target.
+	if (SkipReason != SnapshotMigrationSkipReason::UpdateComponentFailed)
+	{
+		for (FanOutTarget& Target : FanOutTargets)
+		{
+			Target.MigrationData.RecordSkippedEntity(EntityId, EntityClass, SkipReason);
+		}
+	}
+
+	for (TUniquePtr<SnapshotMigrationReporterBase>& Reporter : Reporters)
+	{
+		Reporter->OnSkippedEntity(MigrationData, EntityId, EntityClass, SkipReason);
+	}
+}
+
+void USnapshotMigratorCommandlet::RecordSkippedComponentFieldUpdate(const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotMigrationSkipReason SkipReason)
+{
+	MigrationData.RecordSkippedComponentFieldUpdate(EntityId, ComponentId, FieldName, SkipReason);
+
+	// The migration data may not be keeping the skips themselves, so the cache needs its own copy of the current entity's skips.
+	// Both are reset for each snapshot, so the cache can refer to the migration data's interned field names.
+	if (MigrationCache.IsValid())
+	{
+		EntitySkippedComponentFields.Add(SkippedComponentFieldInfo{ EntityId, ComponentId, MigrationData.InternString(FieldName), SkipReason });
+	}
+
+	for (TUniquePtr<SnapshotMigrationReporterBase>& Reporter : Reporters)
+	{
+		Reporter->OnSkippedComponentFieldUpdate(MigrationData, EntityId, ComponentId, FieldName, SkipReason);
+	}
+}
+
 bool USnapshotMigratorCommandlet::DoesEntityPassClassFilter(const FString& EntityActorClasspath)
 {
 	for (const FRegexPattern& Pattern : EntityActorClassFilters)
@@ -468,9 +2010,9 @@ bool USnapshotMigratorCommandlet::DoesEntityPassClassFilter(const FString& Entit
 	return false;
 }
 
-bool USnapshotMigratorCommandlet::UpdateComponent(const uint32 EntityId, const Worker_ComponentData& OldComponent, Worker_ComponentData& Component)
+bool USnapshotMigratorCommandlet::UpdateComponent(const Worker_ComponentData& OldComponent, Worker_ComponentData& Component, const SchemaBundleDefinitions& OldDefinitions, const SchemaBundleDefinitions& NewDefinitions, TFunctionRef<void(const FString&, const SnapshotMigrationSkipReason)> OnFieldSkipped)
 {
-	const Worker_ComponentUpdate Update = CreateComponentMigration(EntityId, OldComponent, Component.component_id);
+	const Worker_ComponentUpdate Update = CreateComponentMigration(OldComponent, Component.component_id, OldDefinitions, NewDefinitions, OnFieldSkipped);
 
 	// If the Ids match, there is an update to apply.
 	if (Update.component_id == Component.component_id)
@@ -502,7 +2044,7 @@ bool USnapshotMigratorCommandlet::UpdateComponent(const uint32 EntityId, const W
 	return true;
 }
 
-Worker_ComponentUpdate USnapshotMigratorCommandlet::CreateComponentMigration(const uint32 EntityId, const Worker_ComponentData& OldComponent, const Worker_ComponentId NewComponentId)
+Worker_ComponentUpdate USnapshotMigratorCommandlet::CreateComponentMigration(const Worker_ComponentData& OldComponent, const Worker_ComponentId NewComponentId, const SchemaBundleDefinitions& OldDefinitions, const SchemaBundleDefinitions& NewDefinitions, TFunctionRef<void(const FString&, const SnapshotMigrationSkipReason)> OnFieldSkipped)
 {
 	Worker_ComponentUpdate Update;
 	Update.component_id = NewComponentId;
@@ -513,20 +2055,21 @@ Worker_ComponentUpdate USnapshotMigratorCommandlet::CreateComponentMigration(con
 
 	bool bWroteUpdate = false;
 
-	SnapshotDataMigrator Migrator(OldSchemaBundleDefinitions, NewSchemaBundleDefinitions);
+	SnapshotDataMigrator Migrator(OldDefinitions, NewDefinitions);
+	Migrator.SetSurvivingEntities(SurvivingEntities.Get());
 
-	for (const SchemaBundleFieldDefinition& FieldDefinition : NewSchemaBundleDefinitions.FindComponentChecked(NewComponentId).GetFields())
+	for (const SchemaBundleFieldDefinition& FieldDefinition : NewDefinitions.FindComponentChecked(NewComponentId).GetFields())
 	{
 		// Only migrate fields which:
 		//	- Exist in both the new and old component definitions
 		//	- Have the same type
-		const SchemaBundleFieldDefinition* OldFieldDefinition = OldSchemaBundleDefinitions.FindComponentChecked(OldComponent.component_id).FindField(FieldDefinition.GetName());
+		const SchemaBundleFieldDefinition* OldFieldDefinition = OldDefinitions.FindComponentChecked(OldComponent.component_id).FindField(FieldDefinition.GetName());
 		if (OldFieldDefinition == nullptr || !OldFieldDefinition->IsSameTypeAs(FieldDefinition))
 		{
 			// If we aren't the same type, record this field as skipped
 			if (OldFieldDefinition != nullptr)
 			{
-				MigrationData.RecordSkippedComponentFieldUpdate(EntityId, NewComponentId, FieldDefinition.GetName(), FString{ TEXT("Type mismatch between Old and New field definitions.") });
+				OnFieldSkipped(FieldDefinition.GetName(), SnapshotMigrationSkipReason::FieldTypeMismatch);
 			}
 			continue;
 		}
@@ -535,6 +2078,7 @@ Worker_ComponentUpdate USnapshotMigratorCommandlet::CreateComponentMigration(con
 		Schema_FieldId NewFieldId = FieldDefinition.GetId();
 
 		bool bMigratedSomething = false;
+		const uint32 NumScrubbedReferences = Migrator.GetNumScrubbedReferences();
 
 		if (FieldDefinition.IsMap())
 		{
@@ -566,6 +2110,14 @@ Worker_ComponentUpdate USnapshotMigratorCommandlet::CreateComponentMigration(con
 			}
 		}
 
+		if (Migrator.GetNumScrubbedReferences() > NumScrubbedReferences)
+		{
+			OnFieldSkipped(FieldDefinition.GetName(), SnapshotMigrationSkipReason::DanglingReference);
+
+			// If every ref was removed, nothing was migrated; a list then has to be cleared, or it would keep the refs it was created with.
+			bMigratedSomething &= Schema_GetObjectCount(UpdateSchemaObject, NewFieldId) > 0;
+		}
+
 		if (!FieldDefinition.IsSingular() && !bMigratedSomething)
 		{
 			Schema_AddComponentUpdateClearedField(Update.schema_type, NewFieldId);
@@ -575,6 +2127,18 @@ Worker_ComponentUpdate USnapshotMigratorCommandlet::CreateComponentMigration(con
 		bWroteUpdate |= bMigratedSomething || !FieldDefinition.IsSingular();
 	}
 
+	// Fields pruned by the schema chain are only reported when migrating from the source snapshot, not between the schemas of fan-out targets.
+	if (&OldDefinitions == &OldSchemaBundleDefinitions)
+	{
+		if (const TArray<FString>* ChainMismatches = ChainFieldTypeMismatchesByComponentName.Find(OldDefinitions.FindComponentChecked(OldComponent.component_id).GetName()))
+		{
+			for (const FString& FieldName : *ChainMismatches)
+			{
+				OnFieldSkipped(FieldName, SnapshotMigrationSkipReason::FieldTypeMismatch);
+			}
+		}
+	}
+
 	if (!bWroteUpdate)
 	{
 		Schema_DestroyComponentUpdate(Update.schema_type);
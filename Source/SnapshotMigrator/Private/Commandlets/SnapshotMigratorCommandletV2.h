@@ -5,7 +5,16 @@
 #include "Internationalization/Regex.h"
 
 #include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotMigrationCache.h"
+#include "Util/SnapshotMigrationCheckpoint.h"
+#include "Util/SnapshotMigrationCompactor.h"
+#include "Util/SnapshotMigrationEntityIndex.h"
+#include "Util/SnapshotMigrationManifest.h"
 #include "Util/SnapshotMigrationReporter.h"
+#include "Util/SnapshotMigrationSampler.h"
+#include "Util/SnapshotMigrationSelector.h"
+#include "Util/SnapshotMigrationSpatialOrder.h"
+#include "Util/SnapshotMigrationTraceWriter.h"
 
 #include "EngineClasses/SpatialNetDriver.h"
 #include "EngineClasses/SpatialNetConnection.h"
@@ -41,9 +50,95 @@ public:
 private:
 	TArray<TUniquePtr<SnapshotMigrationReporterBase>> Reporters;
 	SnapshotMigrationData MigrationData;
+	// When set, the report lists every skipped entity and field as well as the aggregated skip counts.
+	bool bRetainSkipDetails = false;
 
 	TArray<FRegexPattern> EntityActorClassFilters;
 
+	// Zero if the migration cache is disabled.
+	int32 MigrationCacheMaxEntries = 0;
+	TUniquePtr<SnapshotMigrationCache> MigrationCache;
+	// Field updates skipped while migrating the current entity, so they can be replayed for later cache hits.
+	TArray<SkippedComponentFieldInfo> EntitySkippedComponentFields;
+
+	bool bRecordClassStats = false;
+
+	// Seconds between progress reports while a snapshot is being migrated; zero or less disables them.
+	float ProgressInterval = 30.f;
+	SnapshotMigrationProgress Progress;
+	uint64 ProgressStartCycles = 0;
+	uint64 LastProgressCycles = 0;
+
+	TUniquePtr<SnapshotMigrationTraceWriter> TraceWriter;
+	// Points at TraceWriter while migrating an entity that has been sampled for tracing, and is null otherwise.
+	SnapshotMigrationTraceWriter* EntityTraceWriter = nullptr;
+
+	// Only set for sampled migrations, which migrate a subset of each snapshot to a separate target.
+	TUniquePtr<SnapshotMigrationSampler> Sampler;
+
+	// Only set for partial migrations, which only migrate the entities selected by id, class or component to a separate target.
+	TUniquePtr<SnapshotMigrationSelector> Selector;
+
+	// When set, nothing is written and the output is projected rather than built; see MigrateEntity.
+	bool bDryRun = false;
+
+	// What it cost to migrate an entity of a class in full during a dry run, which is used to project the cost of the class' other entities.
+	struct DryRunClassCalibration
+	{
+		double Seconds;
+		uint64 NumBytes;
+		TSet<Worker_ComponentId> ComponentIds;
+	};
+	TMap<FString, DryRunClassCalibration> DryRunCalibrations;
+	// Names of the new component's fields whose type differs from the old component's, including those pruned by -SchemaChain, keyed by old component id.
+	TMap<Worker_ComponentId, TArray<FString>> FieldTypeMismatchesByOldComponentId;
+	// Names of the fields pruned from the old bundle's components by -SchemaChain because their type changed along it, keyed by component name.
+	TMap<FString, TArray<FString>> ChainFieldTypeMismatchesByComponentName;
+
+	// Seconds between checkpoints while a snapshot is being migrated; zero or less disables them.
+	float CheckpointInterval = 0.f;
+	static constexpr float DEFAULT_CHECKPOINT_INTERVAL = 300.f;
+	// When set, a snapshot with a checkpoint left by an interrupted migration of the same inputs carries on from the checkpoint.
+	bool bResumeFromCheckpoint = false;
+	uint64 LastCheckpointCycles = 0;
+
+	// Number of processes each snapshot is split between; one or less migrates snapshots in this process. See MigrateSnapshotInShards.
+	int32 NumShards = 0;
+	// Switches passed on to the process migrating each shard.
+	FString ShardParams;
+	FString OldSchemaBundlePath;
+
+	// A target schema bundle which snapshots are migrated to alongside the first one given, reusing the entities spawned for it; see MigrateEntityToFanOutTargets.
+	struct FanOutTarget
+	{
+		FString CompiledSchemaDir;
+		FString TargetSnapshotDir;
+		SchemaBundleDefinitions Definitions;
+		// Reset for each snapshot.
+		SnapshotMigrationData MigrationData;
+		Worker_SnapshotOutputStream* OutputStream = nullptr;
+	};
+	TArray<FanOutTarget> FanOutTargets;
+
+	// When set, each snapshot is read twice: first to index the entities which will be migrated, then to migrate them without any object refs to the rest.
+	bool bScrubDanglingReferences = false;
+	// Only set while such a snapshot is being migrated; see BuildSurvivingEntityIndex.
+	TUniquePtr<SnapshotMigrationEntityIndex> SurvivingEntities;
+
+	// Serialized size of the entities sorted in memory at once when ordering migrated snapshots spatially; zero leaves them in the source's order.
+	uint64 SpatialOrderMaxRunBytes = 0;
+
+	// Only set for compacted migrations, which strip redundant data from each entity before writing it; see CompactEntity.
+	TUniquePtr<SnapshotMigrationCompactor> Compactor;
+
+	// When set, each migrated snapshot is read back and checked against its target schema bundle; see VerifySnapshot.
+	bool bVerify = false;
+
+	// When set, snapshots whose inputs match the manifest of their previous migration are not migrated again.
+	bool bIncrementalMigration = false;
+	// Hashes of the inputs shared by every snapshot; only computed for incremental migrations and migrations with checkpoints.
+	SnapshotMigrationManifest SharedManifestInputs;
+
 	UPROPERTY()
 	USpatialNetDriver* NetDriver;
 	UPROPERTY()
@@ -66,19 +161,108 @@ private:
 	SchemaBundleDefinitions NewSchemaBundleDefinitions;
 	TArray<Snapshot> Snapshots;
 
-	UWorld* World;
+	// Only loaded once a snapshot needs migrating; see ConfigureNetDriver.
+	UWorld* World = nullptr;
 
-	bool LoadJsonSchemaBundleAtPath(const FString& SchemaBundlePath, TSharedPtr<FJsonObject>& OutJsonObject);
-
-	bool Setup();
+	bool Setup(const FString& Params);
+	bool IsSnapshotUpToDate(const Snapshot& Snapshot, SnapshotMigrationManifest& OutManifest);
 	bool ConfigureNetDriver();
 
 	bool MigrateSnapshot(const FString& Source, const FString& Target);
 
+	/**
+	* Splits a snapshot into contiguous shards, migrates each of them in a migrator process of its own, then concatenates the migrated shards in
+	* order and merges their migration data into MigrationData. MigrateEntity has to run on the game thread, so this is the only way to use more than
+	* one core on a single snapshot.
+	*	@param	Snapshot	Snapshot to migrate
+	*
+	*	@return				True if every shard was migrated and the migrated snapshot was written to the snapshot's target path
+	*/
+	bool MigrateSnapshotInShards(const Snapshot& Snapshot);
+	FString GetCheckpointInputsHash(const FString& Source) const;
+
+	/**
+	* Closes the current output segment, records it in a checkpoint along with the migration so far, and opens the next segment.
+	*	@param	Target					Target path of the migrated snapshot
+	*	@param	NumProcessedEntities	Number of entities read from the source snapshot so far
+	*	@param	OutputParameters		Parameters to open the next segment with
+	*	@param	OutputStream			Stream for the current segment, which is replaced with a stream for the next one
+	*	@param	Checkpoint				Checkpoint to update and save
+	*
+	*	@return							True if the next segment was opened; failing to save the checkpoint itself isn't fatal
+	*/
+	bool WriteCheckpoint(const FString& Target, const uint64 NumProcessedEntities, const Worker_SnapshotParameters& OutputParameters, Worker_SnapshotOutputStream*& OutputStream, SnapshotMigrationCheckpoint& Checkpoint);
+
+	/**
+	* Reads a snapshot ahead of migrating it, to index the entities which will be written to the migrated snapshot. Whether an entity survives is
+	* decided from its class alone, in the same way as MigrateEntity decides it, so entities which fail to spawn or update are still indexed.
+	*	@param	Source	Path of the snapshot to index
+	*
+	*	@return			The index, or null if the snapshot couldn't be read
+	*/
+	TUniquePtr<SnapshotMigrationEntityIndex> BuildSurvivingEntityIndex(const FString& Source);
+
+	/**
+	* Replaces a migrated snapshot with a copy whose entities are ordered by their position, and records how much closer together neighbouring entities are.
+	*	@param	Path				Path of the migrated snapshot
+	*	@param	OutMigrationData	Migration data of the snapshot
+	*
+	*	@return						True if the snapshot was replaced
+	*/
+	bool OrderSnapshotSpatially(const FString& Path, SnapshotMigrationData& OutMigrationData);
+
+	/**
+	* Reads a migrated snapshot back and checks it against the schema bundle it was migrated to, recording each failure found and passing it on to the reporters.
+	*	@param	Path				Path of the migrated snapshot
+	*	@param	Definitions			Schema bundle the snapshot was migrated to
+	*	@param	OutMigrationData	Migration data of the snapshot
+	*
+	*	@return						True if the snapshot could be read and nothing failed verification
+	*/
+	bool VerifySnapshot(const FString& Path, const SchemaBundleDefinitions& Definitions, SnapshotMigrationData& OutMigrationData);
+
+	// Records an entity which a partial migration doesn't select, and copies it to every target unchanged if unselected entities are copied.
+	void SkipUnselectedEntity(Worker_SnapshotOutputStream* OutStream, const Worker_Entity* Entity);
+
 	bool MigrateEntity(Worker_SnapshotOutputStream* OutStream, const Worker_Entity* Entity);
+	bool WriteMigratedEntity(Worker_SnapshotOutputStream* OutStream, const Worker_EntityId EntityId, TArray<Worker_ComponentData>& MigratedComponents);
+
+	/**
+	* Builds an entity for each fan-out target from the components created for the first target schema bundle, and writes it to the target's stream.
+	* Each component is carried over to the corresponding component of the target's schema, and the old entity's data is then migrated onto it.
+	*	@param	Entity				Entity read from the source snapshot
+	*	@param	EntityClass			Class path of the entity's actor
+	*	@param	EntityComponents	Components created for the first target schema bundle, before the old entity's data is migrated onto them
+	*/
+	void MigrateEntityToFanOutTargets(const Worker_Entity* Entity, const FString& EntityClass, const TArray<Worker_ComponentData>& EntityComponents);
+
+	/**
+	* Strips the data which the compactor's rules make redundant from an entity which is about to be written, and records its size before and after.
+	* Components may be removed from the array but are never destroyed, so the caller has to keep track of any it owns.
+	*	@param	Definitions			Schema bundle the entity is written with
+	*	@param	Components			Components of the entity, which the caller owns the data of
+	*	@param	OutMigrationData	Migration data of the snapshot the entity is written to
+	*/
+	void CompactEntity(const SchemaBundleDefinitions& Definitions, TArray<Worker_ComponentData>& Components, SnapshotMigrationData& OutMigrationData);
+	bool ProjectMigratedEntity(const Worker_Entity* Entity, const DryRunClassCalibration& Calibration);
+	const TArray<FString>& GetFieldTypeMismatches(const Worker_ComponentId OldComponentId, const Worker_ComponentId NewComponentId);
+	void ReportProgress(const bool bFinished);
+	void RecordSkippedEntity(const uint32 EntityId, const FString& EntityClass, const SnapshotMigrationSkipReason SkipReason);
+	void RecordSkippedComponentFieldUpdate(const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotMigrationSkipReason SkipReason);
 	bool DoesEntityPassClassFilter(const FString& EntityActorClasspath);
 
-	bool UpdateComponent(const uint32 EntityId, const Worker_ComponentData& OldComponent, Worker_ComponentData& Component);
+	/**
+	* Migrates the fields of a component onto a component of another schema bundle. The schema bundles are usually the old and new ones, but fan-out
+	* targets also use this to carry components over from the first target schema bundle.
+	*	@param	OldComponent			Component to migrate the fields of
+	*	@param	Component				Component to migrate the fields onto
+	*	@param	OldDefinitions			Schema bundle which OldComponent belongs to
+	*	@param	NewDefinitions			Schema bundle which Component belongs to
+	*	@param	OnFieldSkipped			Called with the name of each of Component's fields which couldn't be migrated, or was only migrated in part, and why
+	*
+	*	@return							True if the migrated fields were applied to Component
+	*/
+	bool UpdateComponent(const Worker_ComponentData& OldComponent, Worker_ComponentData& Component, const SchemaBundleDefinitions& OldDefinitions, const SchemaBundleDefinitions& NewDefinitions, TFunctionRef<void(const FString&, const SnapshotMigrationSkipReason)> OnFieldSkipped);
 
-	Worker_ComponentUpdate CreateComponentMigration(const uint32 EntityId, const Worker_ComponentData& OldComponent, const Worker_ComponentId NewComponentId);
+	Worker_ComponentUpdate CreateComponentMigration(const Worker_ComponentData& OldComponent, const Worker_ComponentId NewComponentId, const SchemaBundleDefinitions& OldDefinitions, const SchemaBundleDefinitions& NewDefinitions, TFunctionRef<void(const FString&, const SnapshotMigrationSkipReason)> OnFieldSkipped);
 };
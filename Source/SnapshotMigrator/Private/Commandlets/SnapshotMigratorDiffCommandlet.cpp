@@ -0,0 +1,201 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "SnapshotMigratorDiffCommandlet.h"
+#include "SnapshotMigratorModuleInternal.h"
+
+#include "Util/SnapshotHelperLibrary.h"
+#include "Util/SnapshotMigrationDiff.h"
+#include "Util/SnapshotMigrationSpatialOrder.h"
+
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+#include "SpatialConstants.h"
+#include "SpatialGDKServicesConstants.h"
+
+namespace
+{
+	// Rows of the field and class tables which are logged; -LogJSON has all of them.
+	const int32 MAX_LOGGED_ROWS = 50;
+}
+
+USnapshotMigratorDiffCommandlet::USnapshotMigratorDiffCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USnapshotMigratorDiffCommandlet::Main(const FString& Params)
+{
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Starting Snapshot Migrator Diff Commandlet"));
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const FString& DefaultSpatialRootDir = SpatialGDKServicesConstants::SpatialOSDirectory;
+	const FString& SchemaBundleFilename = FString{ TEXT("schema.sb.json") };
+
+	// Defaults match the migrator's, so that a migration can be diffed with the same arguments it was run with.
+	FString OldArtifactsDir = FPaths::Combine(DefaultSpatialRootDir, FString{ TEXT("tmp/artifacts") });
+	FString CompiledSchemaDir = FPaths::Combine(DefaultSpatialRootDir, FString{ TEXT("build/assembly/schema") });
+	TArray<FString> SchemaChainDirs;
+	FString SourceSnapshotPath;
+	FString MigratedSnapshotPath;
+	FString JsonFile;
+	uint64 MaxRunBytes = SnapshotMigrationSpatialOrder::DEFAULT_MAX_RUN_BYTES;
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	ParseCommandLine(*Params, Tokens, Switches);
+
+	for (const FString& CLSwitch : Switches)
+	{
+		FString SwitchName;
+		FString Value;
+		if (CLSwitch.StartsWith(FString{ TEXT("OldArtifactsDir") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &OldArtifactsDir);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("CompiledSchemaDir") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &CompiledSchemaDir);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("SchemaChain") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			Value.ParseIntoArray(SchemaChainDirs, TEXT(","));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Source") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &SourceSnapshotPath);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Migrated") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &MigratedSnapshotPath);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("LogJSON") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &JsonFile);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("SortRunSize") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value) && FCString::Atoi(*Value) > 0)
+		{
+			// Size of the runs sorted in memory in MB, when a snapshot isn't in id order, e.g. -SortRunSize=256
+			MaxRunBytes = FCString::Atoi(*Value) * 1024ull * 1024ull;
+		}
+	}
+
+	if (SourceSnapshotPath.IsEmpty() || MigratedSnapshotPath.IsEmpty())
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Both -Source={path/to/source.snapshot} and -Migrated={path/to/migrated.snapshot} need to be passed!"));
+		return 1;
+	}
+
+	const FString& OldSchemaBundlePath = FPaths::Combine(OldArtifactsDir, SchemaBundleFilename);
+	const FString& NewSchemaBundlePath = FPaths::Combine(CompiledSchemaDir, SchemaBundleFilename);
+
+	TSharedPtr<FJsonObject> OldSchemaBundleJsonObject;
+	TSharedPtr<FJsonObject> NewSchemaBundleJsonObject;
+
+	if (!SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(OldSchemaBundlePath, OldSchemaBundleJsonObject) || !SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(NewSchemaBundlePath, NewSchemaBundleJsonObject))
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to load both schema bundles -- ensure that there are bundles present at both '%s' and '%s'."), *OldSchemaBundlePath, *NewSchemaBundlePath);
+		return 1;
+	}
+
+	// Composed the same way as the migrator composes a chain, so that offsets are carried over the same way as the migration carried them over.
+	if (SchemaChainDirs.Num() > 0)
+	{
+		TArray<SchemaBundleDefinitions> SchemaChainDefinitions;
+		for (const FString& SchemaChainDir : SchemaChainDirs)
+		{
+			const FString& SchemaChainBundlePath = FPaths::Combine(SchemaChainDir, SchemaBundleFilename);
+
+			TSharedPtr<FJsonObject> SchemaChainBundleJsonObject;
+			if (!SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(SchemaChainBundlePath, SchemaChainBundleJsonObject))
+			{
+				UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to load schema bundle -- ensure that there is a bundle present at '%s'."), *SchemaChainBundlePath);
+				return 1;
+			}
+
+			SchemaChainDefinitions.Add(SchemaBundleDefinitions{ SchemaChainBundleJsonObject });
+		}
+
+		SnapshotHelperLibrary::ComposeSchemaBundleChain(OldSchemaBundleJsonObject, SchemaChainDefinitions);
+	}
+
+	const SchemaBundleDefinitions OldDefinitions{ OldSchemaBundleJsonObject };
+	const SchemaBundleDefinitions NewDefinitions{ NewSchemaBundleJsonObject };
+
+	SnapshotMigrationDiff Diff{ OldDefinitions, NewDefinitions };
+	if (!Diff.DiffSnapshots(SourceSnapshotPath, MigratedSnapshotPath, MaxRunBytes))
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to compare '%s' with '%s'!"), *SourceSnapshotPath, *MigratedSnapshotPath);
+		return 1;
+	}
+
+	const double ElapsedTime = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	const TArray<SnapshotFieldDiff> FieldDiffs = Diff.GetFieldDiffs(false);
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("%10s %10s %10s %10s %12s  %s"), TEXT("Changed"), TEXT("Dropped"), TEXT("Added"), TEXT("Unchanged"), TEXT("First Entity"), TEXT("Field"));
+	for (int32 i = 0; i < FMath::Min(FieldDiffs.Num(), MAX_LOGGED_ROWS); i++)
+	{
+		const SnapshotFieldDiff& FieldDiff = FieldDiffs[i];
+
+		Worker_EntityId FirstEntityId = SpatialConstants::INVALID_ENTITY_ID;
+		for (const SnapshotFieldDiffKind Kind : { SnapshotFieldDiffKind::Changed, SnapshotFieldDiffKind::Dropped, SnapshotFieldDiffKind::Added })
+		{
+			if (FieldDiff.GetCount(Kind) > 0 && (FirstEntityId == SpatialConstants::INVALID_ENTITY_ID || FieldDiff.FirstEntityIds[static_cast<int32>(Kind)] < FirstEntityId))
+			{
+				FirstEntityId = FieldDiff.FirstEntityIds[static_cast<int32>(Kind)];
+			}
+		}
+
+		const FString& FieldName = FieldDiff.FieldName.IsEmpty() ? FieldDiff.ComponentName
+			: FString::Printf(TEXT("%s.%s (%s)"), *FieldDiff.ComponentName, *FieldDiff.FieldName, FieldDiff.SourceType.IsEmpty() ? *FieldDiff.MigratedType : *FieldDiff.SourceType);
+		UE_LOG(LogSnapshotMigrator, Display, TEXT("%10llu %10llu %10llu %10llu %12lld  %s"), FieldDiff.GetCount(SnapshotFieldDiffKind::Changed), FieldDiff.GetCount(SnapshotFieldDiffKind::Dropped),
+			FieldDiff.GetCount(SnapshotFieldDiffKind::Added), FieldDiff.GetCount(SnapshotFieldDiffKind::Unchanged), FirstEntityId, *FieldName);
+	}
+	if (FieldDiffs.Num() > MAX_LOGGED_ROWS)
+	{
+		UE_LOG(LogSnapshotMigrator, Display, TEXT("... and %d more fields with differences."), FieldDiffs.Num() - MAX_LOGGED_ROWS);
+	}
+
+	const TArray<SnapshotClassDiff> ClassDiffs = Diff.GetClassDiffs();
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("%10s %10s %10s  %s"), TEXT("Source"), TEXT("Migrated"), TEXT("Changed"), TEXT("Class"));
+	for (int32 i = 0; i < FMath::Min(ClassDiffs.Num(), MAX_LOGGED_ROWS); i++)
+	{
+		const SnapshotClassDiff& ClassDiff = ClassDiffs[i];
+		UE_LOG(LogSnapshotMigrator, Display, TEXT("%10llu %10llu %10llu  %s"), ClassDiff.NumSourceEntities, ClassDiff.NumMigratedEntities, ClassDiff.NumChangedEntities,
+			ClassDiff.ClassPath.IsEmpty() ? TEXT("(no class)") : *ClassDiff.ClassPath);
+	}
+
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Compared '%s' with '%s' in %.1f s: %llu source entities, %llu migrated entities, %llu in both of which %llu changed, %d fields with differences."),
+		*SourceSnapshotPath, *MigratedSnapshotPath, ElapsedTime, Diff.GetNumSourceEntities(), Diff.GetNumMigratedEntities(), Diff.GetNumMatchedEntities(), Diff.GetNumChangedEntities(), FieldDiffs.Num());
+
+	if (!JsonFile.IsEmpty())
+	{
+		TSharedRef<FJsonObject> Json = Diff.ToJson();
+		Json->SetStringField(FString{ TEXT("SourceSnapshot") }, SourceSnapshotPath);
+		Json->SetStringField(FString{ TEXT("MigratedSnapshot") }, MigratedSnapshotPath);
+		Json->SetStringField(FString{ TEXT("OldSchemaBundle") }, OldSchemaBundlePath);
+		Json->SetStringField(FString{ TEXT("NewSchemaBundle") }, NewSchemaBundlePath);
+		Json->SetNumberField(FString{ TEXT("ElapsedTime") }, ElapsedTime);
+
+		FString OutputString;
+
+		using CharType = TCHAR;
+		using Policy = TPrettyJsonPrintPolicy<CharType>;
+
+		TSharedRef<TJsonWriter<CharType, Policy>> Writer = TJsonWriterFactory<CharType, Policy>::Create(&OutputString);
+		if (!FJsonSerializer::Serialize(Json, Writer) || !FFileHelper::SaveStringToFile(OutputString, *JsonFile, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+		{
+			UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to write snapshot diff to '%s'!"), *JsonFile);
+			return 1;
+		}
+	}
+
+	return 0;
+}
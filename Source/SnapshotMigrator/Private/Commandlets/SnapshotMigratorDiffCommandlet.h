@@ -0,0 +1,23 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "CoreMinimal.h"
+
+#include "SnapshotMigratorDiffCommandlet.generated.h"
+
+/**
+* Compares a source snapshot with its migration field by field, and reports how many entities each field was carried over unchanged, changed,
+* dropped or added on, along with the first entity for each, without needing the project's content.
+*/
+UCLASS()
+class USnapshotMigratorDiffCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+
+	USnapshotMigratorDiffCommandlet();
+};
@@ -0,0 +1,97 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "SnapshotMigratorKernelBenchmarkCommandlet.h"
+#include "SnapshotMigratorModuleInternal.h"
+
+#include "Util/SnapshotHelperLibrary.h"
+#include "Util/SnapshotMigrationAllocationCounter.h"
+#include "Util/SnapshotMigrationKernelBenchmark.h"
+
+#include "Dom/JsonValue.h"
+#include "Misc/Paths.h"
+
+USnapshotMigratorKernelBenchmarkCommandlet::USnapshotMigratorKernelBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USnapshotMigratorKernelBenchmarkCommandlet::Main(const FString& Params)
+{
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Starting Snapshot Migrator Kernel Benchmark Commandlet"));
+
+	TArray<int32> Sizes{ 1, 10, 100, 1000, 10000, 100000 };
+	int32 OuterDepth = 2;
+	float MinSecondsPerCase = 0.2f;
+	FString ResultsFile = FPaths::Combine(FPaths::ProjectSavedDir(), FString{ TEXT("SnapshotMigratorBenchmark") }, FString{ TEXT("KernelBenchmarkResults.json") });
+	FString Label{ TEXT("Kernels") };
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	ParseCommandLine(*Params, Tokens, Switches);
+
+	for (const FString& CLSwitch : Switches)
+	{
+		FString SwitchName;
+		FString Value;
+		if (CLSwitch.StartsWith(FString{ TEXT("Sizes") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			// Comma separated element counts, e.g. -Sizes=1,1000,100000
+			TArray<FString> SizeStrings;
+			Value.ParseIntoArray(SizeStrings, TEXT(","));
+
+			Sizes.Reset();
+			for (const FString& Size : SizeStrings)
+			{
+				Sizes.Add(FMath::Max(1, FCString::Atoi(*Size)));
+			}
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("OuterDepth") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			OuterDepth = FMath::Max(0, FCString::Atoi(*Value));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("MinTimePerCase") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			MinSecondsPerCase = FCString::Atof(*Value);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("ResultsFile") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &ResultsFile);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("Label") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Label);
+		}
+	}
+
+	TArray<SnapshotMigrationKernelBenchmark::Result> Results;
+	{
+		SnapshotMigrationKernelBenchmark Benchmark{ SnapshotMigrationAllocationCounter::Get(), MinSecondsPerCase, OuterDepth };
+		Results = Benchmark.Run(Sizes);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> ResultsJson;
+	for (const SnapshotMigrationKernelBenchmark::Result& Result : Results)
+	{
+		UE_LOG(LogSnapshotMigrator, Display, TEXT("%-50s %-9s %7d elements: %10.1f ns/element, %8.1f allocations/call (%d calls)"),
+			*Result.Kernel, *Result.Cardinality, Result.NumElements, Result.NanosecondsPerElement, Result.AllocationsPerCall, Result.NumCalls);
+
+		ResultsJson.Add(MakeShareable(new FJsonValueObject(Result.ToJson())));
+	}
+
+	TSharedRef<FJsonObject> RunJson = MakeShareable(new FJsonObject);
+	RunJson->SetStringField(FString{ TEXT("Label") }, Label);
+	RunJson->SetStringField(FString{ TEXT("Timestamp") }, FDateTime::UtcNow().ToIso8601());
+	RunJson->SetNumberField(FString{ TEXT("OuterDepth") }, OuterDepth);
+	RunJson->SetArrayField(FString{ TEXT("Results") }, ResultsJson);
+
+	if (!SnapshotHelperLibrary::AppendBenchmarkRunToResultsFile(ResultsFile, RunJson))
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to write kernel benchmark results to '%s'!"), *ResultsFile);
+		return 1;
+	}
+
+	return 0;
+}
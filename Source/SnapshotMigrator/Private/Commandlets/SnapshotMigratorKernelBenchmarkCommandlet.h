@@ -0,0 +1,23 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "CoreMinimal.h"
+
+#include "SnapshotMigratorKernelBenchmarkCommandlet.generated.h"
+
+/**
+* Measures SnapshotDataMigrator's field migration kernels in isolation, reporting nanoseconds per element and allocations per call. Results are
+* appended to a json file so that kernel changes can be checked for regressions.
+*/
+UCLASS()
+class USnapshotMigratorKernelBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+
+	USnapshotMigratorKernelBenchmarkCommandlet();
+};
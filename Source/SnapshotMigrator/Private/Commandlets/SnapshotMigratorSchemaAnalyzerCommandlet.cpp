@@ -0,0 +1,169 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "SnapshotMigratorSchemaAnalyzerCommandlet.h"
+#include "SnapshotMigratorModuleInternal.h"
+
+#include "Util/SnapshotHelperLibrary.h"
+#include "Util/SnapshotMigrationSchemaAnalysis.h"
+
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+#include "SpatialGDKServicesConstants.h"
+
+USnapshotMigratorSchemaAnalyzerCommandlet::USnapshotMigratorSchemaAnalyzerCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USnapshotMigratorSchemaAnalyzerCommandlet::Main(const FString& Params)
+{
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Starting Snapshot Migrator Schema Analyzer Commandlet"));
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const FString& DefaultSpatialRootDir = SpatialGDKServicesConstants::SpatialOSDirectory;
+	const FString& SchemaBundleFilename = FString{ TEXT("schema.sb.json") };
+
+	// Defaults match the migrator's, so that the analyzer can be run with the same arguments.
+	FString OldArtifactsDir = FPaths::Combine(DefaultSpatialRootDir, FString{ TEXT("tmp/artifacts") });
+	FString CompiledSchemaDir = FPaths::Combine(DefaultSpatialRootDir, FString{ TEXT("build/assembly/schema") });
+	TArray<FString> SchemaChainDirs;
+	FString JsonFile;
+	TArray<SchemaChangeKind> FailOnKinds;
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	ParseCommandLine(*Params, Tokens, Switches);
+
+	for (const FString& CLSwitch : Switches)
+	{
+		FString SwitchName;
+		FString Value;
+		if (CLSwitch.StartsWith(FString{ TEXT("OldArtifactsDir") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &OldArtifactsDir);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("CompiledSchemaDir") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &CompiledSchemaDir);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("SchemaChain") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			Value.ParseIntoArray(SchemaChainDirs, TEXT(","));
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("LogJSON") }))
+		{
+			CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &JsonFile);
+		}
+		else if (CLSwitch.StartsWith(FString{ TEXT("FailOn") }) && CLSwitch.Split(FString{ TEXT("=") }, &SwitchName, &Value))
+		{
+			// Comma separated kinds of change, e.g. -FailOn=ComponentDropped,FieldTypeMismatch
+			TArray<FString> KindNames;
+			Value.ParseIntoArray(KindNames, TEXT(","));
+
+			for (const FString& KindName : KindNames)
+			{
+				SchemaChangeKind Kind;
+				if (!GetSchemaChangeKindFromName(KindName, Kind))
+				{
+					UE_LOG(LogSnapshotMigrator, Error, TEXT("Unknown kind of schema change '%s' passed to FailOn!"), *KindName);
+					return 1;
+				}
+				FailOnKinds.Add(Kind);
+			}
+		}
+	}
+
+	const FString& OldSchemaBundlePath = FPaths::Combine(OldArtifactsDir, SchemaBundleFilename);
+	const FString& NewSchemaBundlePath = FPaths::Combine(CompiledSchemaDir, SchemaBundleFilename);
+
+	TSharedPtr<FJsonObject> OldSchemaBundleJsonObject;
+	TSharedPtr<FJsonObject> NewSchemaBundleJsonObject;
+
+	if (!SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(OldSchemaBundlePath, OldSchemaBundleJsonObject) || !SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(NewSchemaBundlePath, NewSchemaBundleJsonObject))
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to load both schema bundles -- ensure that there are bundles present at both '%s' and '%s'."), *OldSchemaBundlePath, *NewSchemaBundlePath);
+		return 1;
+	}
+
+	// Analyzed the same way as the migrator migrates a chain, so that the analysis matches what a migration along the chain would do.
+	if (SchemaChainDirs.Num() > 0)
+	{
+		TArray<SchemaBundleDefinitions> SchemaChainDefinitions;
+		for (const FString& SchemaChainDir : SchemaChainDirs)
+		{
+			const FString& SchemaChainBundlePath = FPaths::Combine(SchemaChainDir, SchemaBundleFilename);
+
+			TSharedPtr<FJsonObject> SchemaChainBundleJsonObject;
+			if (!SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(SchemaChainBundlePath, SchemaChainBundleJsonObject))
+			{
+				UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to load schema bundle -- ensure that there is a bundle present at '%s'."), *SchemaChainBundlePath);
+				return 1;
+			}
+
+			SchemaChainDefinitions.Add(SchemaBundleDefinitions{ SchemaChainBundleJsonObject });
+		}
+
+		SnapshotHelperLibrary::ComposeSchemaBundleChain(OldSchemaBundleJsonObject, SchemaChainDefinitions);
+	}
+
+	const SnapshotMigrationSchemaAnalysis Analysis = SnapshotMigrationSchemaAnalysis::Analyze(SchemaBundleDefinitions{ OldSchemaBundleJsonObject }, SchemaBundleDefinitions{ NewSchemaBundleJsonObject });
+	const double ElapsedTime = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	// Remapped and added components and fields don't lose any data, and there can be a great many of them, so only their counts are logged.
+	for (const SchemaChange& Change : Analysis.GetChanges())
+	{
+		if (Change.Kind == SchemaChangeKind::ComponentDropped)
+		{
+			UE_LOG(LogSnapshotMigrator, Display, TEXT("%-18s %s (%u)"), GetSchemaChangeKindName(Change.Kind), *Change.ComponentName, Change.OldComponentId);
+		}
+		else if (Change.Kind == SchemaChangeKind::FieldDropped || Change.Kind == SchemaChangeKind::FieldTypeMismatch || Change.Kind == SchemaChangeKind::FieldUnsupported)
+		{
+			UE_LOG(LogSnapshotMigrator, Display, TEXT("%-18s %s.%s (%s -> %s)"), GetSchemaChangeKindName(Change.Kind), *Change.ComponentName, *Change.FieldName, *Change.OldType,
+				Change.NewType.IsEmpty() ? TEXT("none") : *Change.NewType);
+		}
+	}
+
+	UE_LOG(LogSnapshotMigrator, Display, TEXT("Analyzed '%s' -> '%s' in %.1f ms:"), *OldSchemaBundlePath, *NewSchemaBundlePath, 1000.0 * ElapsedTime);
+	for (int32 i = 0; i < static_cast<int32>(SchemaChangeKind::Count); i++)
+	{
+		UE_LOG(LogSnapshotMigrator, Display, TEXT("%8d  %s"), Analysis.GetNumChanges(static_cast<SchemaChangeKind>(i)), GetSchemaChangeKindName(static_cast<SchemaChangeKind>(i)));
+	}
+
+	TArray<SchemaChangeKind> FailedKinds = FailOnKinds.FilterByPredicate([&Analysis](const SchemaChangeKind Kind) { return Analysis.GetNumChanges(Kind) > 0; });
+
+	if (!JsonFile.IsEmpty())
+	{
+		TSharedRef<FJsonObject> Json = Analysis.ToJson();
+		Json->SetStringField(FString{ TEXT("OldSchemaBundle") }, OldSchemaBundlePath);
+		Json->SetStringField(FString{ TEXT("NewSchemaBundle") }, NewSchemaBundlePath);
+		Json->SetNumberField(FString{ TEXT("ElapsedTime") }, ElapsedTime);
+		Json->SetBoolField(FString{ TEXT("Passed") }, FailedKinds.Num() == 0);
+
+		FString OutputString;
+
+		using CharType = TCHAR;
+		using Policy = TPrettyJsonPrintPolicy<CharType>;
+
+		TSharedRef<TJsonWriter<CharType, Policy>> Writer = TJsonWriterFactory<CharType, Policy>::Create(&OutputString);
+		if (!FJsonSerializer::Serialize(Json, Writer) || !FFileHelper::SaveStringToFile(OutputString, *JsonFile, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+		{
+			UE_LOG(LogSnapshotMigrator, Error, TEXT("Failed to write schema analysis to '%s'!"), *JsonFile);
+			return 1;
+		}
+	}
+
+	for (const SchemaChangeKind Kind : FailedKinds)
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Schema analysis failed: found %d %s changes."), Analysis.GetNumChanges(Kind), GetSchemaChangeKindName(Kind));
+	}
+
+	return FailedKinds.Num() > 0 ? 1 : 0;
+}
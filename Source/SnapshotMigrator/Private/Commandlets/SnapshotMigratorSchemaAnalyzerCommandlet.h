@@ -0,0 +1,23 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "CoreMinimal.h"
+
+#include "SnapshotMigratorSchemaAnalyzerCommandlet.generated.h"
+
+/**
+* Reports every component and field that migrating snapshots from the source bundle to the target bundle would drop, remap or skip, without
+* needing any snapshots or loading the project's content, so that schema changes can be checked quickly (e.g. in CI).
+*/
+UCLASS()
+class USnapshotMigratorSchemaAnalyzerCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+
+	USnapshotMigratorSchemaAnalyzerCommandlet();
+};
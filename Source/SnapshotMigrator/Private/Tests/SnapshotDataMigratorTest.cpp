@@ -0,0 +1,313 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/ScopeExit.h"
+
+#include "Tests/SnapshotMigratorTestLibrary.h"
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotHelperLibrary.h"
+#include "Util/SnapshotMigrationEntityIndex.h"
+
+#include "Schema/StandardLibrary.h"
+#include "SpatialConstants.h"
+#include "Utils/SchemaUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const Schema_FieldId OLD_FIELD_ID = 1;
+	const Schema_FieldId NEW_FIELD_ID = 3;
+
+	// Components keep their names between bundles but change ids; C is removed from the new bundle entirely.
+	const uint32 OLD_COMPONENT_A_ID = 100;
+	const uint32 OLD_COMPONENT_B_ID = 101;
+	const uint32 OLD_COMPONENT_C_ID = 102;
+	const uint32 NEW_COMPONENT_A_ID = 200;
+	const uint32 NEW_COMPONENT_B_ID = 201;
+
+	SchemaBundleDefinitions CreateOldDefinitions()
+	{
+		return SchemaBundleDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+			{ OLD_COMPONENT_A_ID, FString{ TEXT("unreal.generated.A") }, {} },
+			{ OLD_COMPONENT_B_ID, FString{ TEXT("unreal.generated.B") }, {} },
+			{ OLD_COMPONENT_C_ID, FString{ TEXT("unreal.generated.C") }, {} }
+		}) };
+	}
+
+	SchemaBundleDefinitions CreateNewDefinitions()
+	{
+		return SchemaBundleDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+			{ NEW_COMPONENT_A_ID, FString{ TEXT("unreal.generated.A") }, {} },
+			{ NEW_COMPONENT_B_ID, FString{ TEXT("unreal.generated.B") }, {} }
+		}) };
+	}
+
+	// Owns the old and new schema objects a field is migrated between.
+	struct MigrationObjects
+	{
+		MigrationObjects()
+			: OldData(Schema_CreateComponentData()), NewData(Schema_CreateComponentData())
+		{
+		}
+
+		~MigrationObjects()
+		{
+			Schema_DestroyComponentData(OldData);
+			Schema_DestroyComponentData(NewData);
+		}
+
+		Schema_Object* Old() const { return Schema_GetComponentDataFields(OldData); }
+		Schema_Object* New() const { return Schema_GetComponentDataFields(NewData); }
+
+		Schema_ComponentData* OldData;
+		Schema_ComponentData* NewData;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotDataMigratorPrimitiveFieldsTest, "SnapshotMigrator.DataMigrator.PrimitiveFieldsAreCarriedOver", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotDataMigratorPrimitiveFieldsTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions OldDefinitions = CreateOldDefinitions();
+	const SchemaBundleDefinitions NewDefinitions = CreateNewDefinitions();
+	SnapshotDataMigrator Migrator{ OldDefinitions, NewDefinitions };
+
+	{
+		MigrationObjects Objects;
+		Schema_AddInt32(Objects.Old(), OLD_FIELD_ID, -7);
+		Schema_AddInt32(Objects.Old(), OLD_FIELD_ID, 0);
+		Schema_AddInt32(Objects.Old(), OLD_FIELD_ID, MAX_int32);
+
+		TestTrue(TEXT("Int32 list migrated"), Migrator.MigratePrimitiveField(SchemaBundleFieldDefinition::SchemaPrimitiveType::Int32, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+		TestTrue(TEXT("Int32 list count"), Schema_GetInt32Count(Objects.New(), NEW_FIELD_ID) == 3);
+		TestEqual(TEXT("Int32 list element 0"), Schema_IndexInt32(Objects.New(), NEW_FIELD_ID, 0), -7);
+		TestEqual(TEXT("Int32 list element 1"), Schema_IndexInt32(Objects.New(), NEW_FIELD_ID, 1), 0);
+		TestEqual(TEXT("Int32 list element 2"), Schema_IndexInt32(Objects.New(), NEW_FIELD_ID, 2), MAX_int32);
+	}
+
+	{
+		MigrationObjects Objects;
+		Schema_AddUint32(Objects.Old(), OLD_FIELD_ID, MAX_uint32);
+
+		TestTrue(TEXT("Uint32 migrated"), Migrator.MigratePrimitiveField(SchemaBundleFieldDefinition::SchemaPrimitiveType::Uint32, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+		TestTrue(TEXT("Uint32 value"), Schema_GetUint32(Objects.New(), NEW_FIELD_ID) == MAX_uint32);
+	}
+
+	{
+		MigrationObjects Objects;
+		Schema_AddBool(Objects.Old(), OLD_FIELD_ID, 1);
+		Schema_AddBool(Objects.Old(), OLD_FIELD_ID, 0);
+
+		TestTrue(TEXT("Bool list migrated"), Migrator.MigratePrimitiveField(SchemaBundleFieldDefinition::SchemaPrimitiveType::Bool, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+		TestTrue(TEXT("Bool list count"), Schema_GetBoolCount(Objects.New(), NEW_FIELD_ID) == 2);
+		TestTrue(TEXT("Bool list element 0"), Schema_IndexBool(Objects.New(), NEW_FIELD_ID, 0) == 1);
+		TestTrue(TEXT("Bool list element 1"), Schema_IndexBool(Objects.New(), NEW_FIELD_ID, 1) == 0);
+	}
+
+	{
+		MigrationObjects Objects;
+		Schema_AddFloat(Objects.Old(), OLD_FIELD_ID, 1.5f);
+
+		TestTrue(TEXT("Float migrated"), Migrator.MigratePrimitiveField(SchemaBundleFieldDefinition::SchemaPrimitiveType::Float, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+		TestEqual(TEXT("Float value"), Schema_GetFloat(Objects.New(), NEW_FIELD_ID), 1.5f);
+	}
+
+	{
+		MigrationObjects Objects;
+		SpatialGDK::AddStringToSchema(Objects.Old(), OLD_FIELD_ID, FString{ TEXT("First") });
+		SpatialGDK::AddStringToSchema(Objects.Old(), OLD_FIELD_ID, FString{ TEXT("Second") });
+
+		TestTrue(TEXT("String list migrated"), Migrator.MigratePrimitiveField(SchemaBundleFieldDefinition::SchemaPrimitiveType::String, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+		TestTrue(TEXT("String list count"), Schema_GetBytesCount(Objects.New(), NEW_FIELD_ID) == 2);
+		TestEqual(TEXT("String list element 0"), SpatialGDK::IndexStringFromSchema(Objects.New(), NEW_FIELD_ID, 0), FString{ TEXT("First") });
+		TestEqual(TEXT("String list element 1"), SpatialGDK::IndexStringFromSchema(Objects.New(), NEW_FIELD_ID, 1), FString{ TEXT("Second") });
+	}
+
+	{
+		MigrationObjects Objects;
+		const uint8 Bytes[] = { 0, 1, 254, 255 };
+		SpatialGDK::AddBytesToSchema(Objects.Old(), OLD_FIELD_ID, Bytes, sizeof(Bytes));
+
+		TestTrue(TEXT("Bytes migrated"), Migrator.MigratePrimitiveField(SchemaBundleFieldDefinition::SchemaPrimitiveType::Bytes, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+		TestTrue(TEXT("Bytes value"), SpatialGDK::GetBytesFromSchema(Objects.New(), NEW_FIELD_ID) == TArray<uint8>(Bytes, sizeof(Bytes)));
+	}
+
+	{
+		// Nothing to migrate should be reported as such, so that list fields can be cleared on the new component.
+		MigrationObjects Objects;
+		TestFalse(TEXT("Empty field not migrated"), Migrator.MigratePrimitiveField(SchemaBundleFieldDefinition::SchemaPrimitiveType::Int32, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+		TestTrue(TEXT("Empty field count"), Schema_GetInt32Count(Objects.New(), NEW_FIELD_ID) == 0);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotDataMigratorUnrealObjectRefTest, "SnapshotMigrator.DataMigrator.UnrealObjectRefsAreRemapped", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotDataMigratorUnrealObjectRefTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions OldDefinitions = CreateOldDefinitions();
+	const SchemaBundleDefinitions NewDefinitions = CreateNewDefinitions();
+	SnapshotDataMigrator Migrator{ OldDefinitions, NewDefinitions };
+
+	const FString UnrealObjectRefType{ TEXT("unreal.UnrealObjectRef") };
+
+	MigrationObjects Objects;
+
+	// An actor ref, whose zero offset doesn't refer to a component and must be left alone.
+	SpatialGDK::AddObjectRefToSchema(Objects.Old(), OLD_FIELD_ID, FUnrealObjectRef{ 5, 0 });
+
+	// A subobject ref nested in another subobject, both of which have to be remapped.
+	FUnrealObjectRef NestedRef{ 6, OLD_COMPONENT_A_ID };
+	NestedRef.Outer = FUnrealObjectRef{ 6, OLD_COMPONENT_B_ID };
+	SpatialGDK::AddObjectRefToSchema(Objects.Old(), OLD_FIELD_ID, NestedRef);
+
+	// A ref to a component which no longer exists, which should be dropped.
+	SpatialGDK::AddObjectRefToSchema(Objects.Old(), OLD_FIELD_ID, FUnrealObjectRef{ 7, OLD_COMPONENT_C_ID });
+
+	TestTrue(TEXT("Object refs migrated"), Migrator.MigrateObjectField(UnrealObjectRefType, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+
+	if (!TestTrue(TEXT("Dangling object ref dropped"), Schema_GetObjectCount(Objects.New(), NEW_FIELD_ID) == 2))
+	{
+		return false;
+	}
+
+	const FUnrealObjectRef ActorRef = SpatialGDK::IndexObjectRefFromSchema(Objects.New(), NEW_FIELD_ID, 0);
+	TestEqual(TEXT("Actor ref entity"), ActorRef.Entity, static_cast<Worker_EntityId>(5));
+	TestTrue(TEXT("Actor ref offset"), ActorRef.Offset == 0);
+
+	const FUnrealObjectRef MigratedNestedRef = SpatialGDK::IndexObjectRefFromSchema(Objects.New(), NEW_FIELD_ID, 1);
+	TestEqual(TEXT("Nested ref entity"), MigratedNestedRef.Entity, static_cast<Worker_EntityId>(6));
+	TestTrue(TEXT("Nested ref offset remapped"), MigratedNestedRef.Offset == NEW_COMPONENT_A_ID);
+	if (TestTrue(TEXT("Nested ref outer kept"), MigratedNestedRef.Outer.IsSet()))
+	{
+		TestTrue(TEXT("Nested ref outer offset remapped"), MigratedNestedRef.Outer.GetValue().Offset == NEW_COMPONENT_B_ID);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotDataMigratorDanglingEntityRefTest, "SnapshotMigrator.DataMigrator.DanglingEntityRefsAreScrubbed", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotDataMigratorDanglingEntityRefTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions OldDefinitions = CreateOldDefinitions();
+	const SchemaBundleDefinitions NewDefinitions = CreateNewDefinitions();
+	SnapshotDataMigrator Migrator{ OldDefinitions, NewDefinitions };
+
+	// Entity 6 isn't migrated.
+	SnapshotMigrationEntityIndex SurvivingEntities;
+	SurvivingEntities.Add(7);
+	SurvivingEntities.Add(5);
+	SurvivingEntities.Build();
+
+	TestTrue(TEXT("Dense ids are indexed in a bitmap"), SurvivingEntities.IsBitmap());
+	TestTrue(TEXT("Index contains migrated entities"), SurvivingEntities.Contains(5) && SurvivingEntities.Contains(7));
+	TestFalse(TEXT("Index doesn't contain other entities"), SurvivingEntities.Contains(4) || SurvivingEntities.Contains(6) || SurvivingEntities.Contains(8));
+
+	Migrator.SetSurvivingEntities(&SurvivingEntities);
+
+	const FString UnrealObjectRefType{ TEXT("unreal.UnrealObjectRef") };
+
+	MigrationObjects Objects;
+
+	SpatialGDK::AddObjectRefToSchema(Objects.Old(), OLD_FIELD_ID, FUnrealObjectRef{ 6, 0 });
+	SpatialGDK::AddObjectRefToSchema(Objects.Old(), OLD_FIELD_ID, FUnrealObjectRef{ 5, OLD_COMPONENT_A_ID });
+
+	// A subobject ref is only as good as its outer's.
+	FUnrealObjectRef NestedRef{ 7, OLD_COMPONENT_A_ID };
+	NestedRef.Outer = FUnrealObjectRef{ 6, OLD_COMPONENT_B_ID };
+	SpatialGDK::AddObjectRefToSchema(Objects.Old(), OLD_FIELD_ID, NestedRef);
+
+	TestTrue(TEXT("Object refs migrated"), Migrator.MigrateObjectField(UnrealObjectRefType, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+	TestTrue(TEXT("Dangling refs counted"), Migrator.GetNumScrubbedReferences() == 2);
+
+	if (!TestTrue(TEXT("Dangling refs dropped"), Schema_GetObjectCount(Objects.New(), NEW_FIELD_ID) == 1))
+	{
+		return false;
+	}
+
+	const FUnrealObjectRef MigratedRef = SpatialGDK::IndexObjectRefFromSchema(Objects.New(), NEW_FIELD_ID, 0);
+	TestEqual(TEXT("Surviving ref entity"), MigratedRef.Entity, static_cast<Worker_EntityId>(5));
+	TestTrue(TEXT("Surviving ref offset remapped"), MigratedRef.Offset == NEW_COMPONENT_A_ID);
+
+	// Ids too far apart for a bitmap fall back to a sorted array.
+	SnapshotMigrationEntityIndex SparseEntities;
+	SparseEntities.Add(1ll << 40);
+	SparseEntities.Add(1);
+	SparseEntities.Build();
+
+	TestFalse(TEXT("Sparse ids aren't indexed in a bitmap"), SparseEntities.IsBitmap());
+	TestTrue(TEXT("Sparse index contains migrated entities"), SparseEntities.Contains(1) && SparseEntities.Contains(1ll << 40));
+	TestFalse(TEXT("Sparse index doesn't contain other entities"), SparseEntities.Contains(2));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotDataMigratorWriteACLTest, "SnapshotMigrator.DataMigrator.WriteACLsAreRemapped", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotDataMigratorWriteACLTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions OldDefinitions = CreateOldDefinitions();
+	const SchemaBundleDefinitions NewDefinitions = CreateNewDefinitions();
+	SnapshotDataMigrator Migrator{ OldDefinitions, NewDefinitions };
+
+	const WorkerRequirementSet RequirementSet{ WorkerAttributeSet{ FString{ TEXT("UnrealWorker") } } };
+
+	MigrationObjects Objects;
+	for (const uint32 ComponentId : { OLD_COMPONENT_A_ID, OLD_COMPONENT_B_ID })
+	{
+		Schema_Object* ACLPairObject = Schema_AddObject(Objects.Old(), OLD_FIELD_ID);
+		Schema_AddUint32(ACLPairObject, SCHEMA_MAP_KEY_FIELD_ID, ComponentId);
+		SpatialGDK::AddWorkerRequirementSetToSchema(ACLPairObject, SCHEMA_MAP_VALUE_FIELD_ID, RequirementSet);
+	}
+
+	TestTrue(TEXT("Write ACL migrated"), Migrator.MigrateObjectField(SchemaBundleFieldDefinition::WRITE_ACL_MAP, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New()));
+
+	if (!TestTrue(TEXT("Every entry migrated"), Schema_GetObjectCount(Objects.New(), NEW_FIELD_ID) == 2))
+	{
+		return false;
+	}
+
+	const uint32 ExpectedKeys[] = { NEW_COMPONENT_A_ID, NEW_COMPONENT_B_ID };
+	for (uint32 i = 0; i < 2; i++)
+	{
+		Schema_Object* ACLPairObject = Schema_IndexObject(Objects.New(), NEW_FIELD_ID, i);
+		TestTrue(*FString::Printf(TEXT("Entry %d key remapped"), i), Schema_GetUint32(ACLPairObject, SCHEMA_MAP_KEY_FIELD_ID) == ExpectedKeys[i]);
+
+		const WorkerRequirementSet MigratedRequirementSet = SpatialGDK::GetWorkerRequirementSetFromSchema(ACLPairObject, SCHEMA_MAP_VALUE_FIELD_ID);
+		TestTrue(*FString::Printf(TEXT("Entry %d requirement set kept"), i), MigratedRequirementSet == RequirementSet);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotDataMigratorWriteACLRemovedComponentTest, "SnapshotMigrator.DataMigrator.WriteACLEntriesForRemovedComponentsAreDropped", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotDataMigratorWriteACLRemovedComponentTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions OldDefinitions = CreateOldDefinitions();
+	const SchemaBundleDefinitions NewDefinitions = CreateNewDefinitions();
+	SnapshotDataMigrator Migrator{ OldDefinitions, NewDefinitions };
+
+	const WorkerRequirementSet RequirementSet{ WorkerAttributeSet{ FString{ TEXT("UnrealWorker") } } };
+
+	// The entry for C comes first, so that an entry written with a stale or uninitialized key would be noticed ahead of A's.
+	MigrationObjects Objects;
+	for (const uint32 ComponentId : { OLD_COMPONENT_C_ID, OLD_COMPONENT_A_ID })
+	{
+		Schema_Object* ACLPairObject = Schema_AddObject(Objects.Old(), OLD_FIELD_ID);
+		Schema_AddUint32(ACLPairObject, SCHEMA_MAP_KEY_FIELD_ID, ComponentId);
+		SpatialGDK::AddWorkerRequirementSetToSchema(ACLPairObject, SCHEMA_MAP_VALUE_FIELD_ID, RequirementSet);
+	}
+
+	Migrator.MigrateObjectField(SchemaBundleFieldDefinition::WRITE_ACL_MAP, OLD_FIELD_ID, NEW_FIELD_ID, Objects.Old(), Objects.New());
+
+	if (!TestTrue(TEXT("Entry for removed component dropped"), Schema_GetObjectCount(Objects.New(), NEW_FIELD_ID) == 1))
+	{
+		return false;
+	}
+
+	TestTrue(TEXT("Remaining entry is for the kept component"), Schema_GetUint32(Schema_IndexObject(Objects.New(), NEW_FIELD_ID, 0), SCHEMA_MAP_KEY_FIELD_ID) == NEW_COMPONENT_A_ID);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
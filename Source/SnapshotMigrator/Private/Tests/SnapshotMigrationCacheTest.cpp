@@ -0,0 +1,181 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "Tests/SnapshotMigratorTestLibrary.h"
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotMigrationCache.h"
+
+#include "Schema/UnrealObjectRef.h"
+#include "Utils/SchemaUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const Worker_ComponentId DOOR_COMPONENT_ID = 100;
+	const Schema_FieldId TARGET_FIELD_ID = 1;
+	const Schema_FieldId HINGE_FIELD_ID = 2;
+	const Schema_FieldId HINGE_DOOR_FIELD_ID = 1;
+	const Schema_FieldId HINGE_OWNERS_FIELD_ID = 2;
+	const Worker_EntityId OTHER_ENTITY_ID = 7;
+	const FString DOOR_CLASS{ TEXT("/Game/Doors/BP_Door.BP_Door_C") };
+
+	/**
+	* Creates an entity's door component, whose references to the door are all to RefEntityId: one at the top level, one within a nested type, and one
+	* in a list of entity ids alongside a reference to another entity.
+	*/
+	Worker_ComponentData CreateDoorData(const Worker_EntityId RefEntityId)
+	{
+		Worker_ComponentData Data{};
+		Data.component_id = DOOR_COMPONENT_ID;
+		Data.schema_type = Schema_CreateComponentData();
+
+		Schema_Object* Fields = Schema_GetComponentDataFields(Data.schema_type);
+		SpatialGDK::AddObjectRefToSchema(Fields, TARGET_FIELD_ID, FUnrealObjectRef{ RefEntityId, 0 });
+
+		Schema_Object* Hinge = Schema_AddObject(Fields, HINGE_FIELD_ID);
+		SpatialGDK::AddObjectRefToSchema(Hinge, HINGE_DOOR_FIELD_ID, FUnrealObjectRef{ RefEntityId, 0 });
+		Schema_AddEntityId(Hinge, HINGE_OWNERS_FIELD_ID, RefEntityId);
+		Schema_AddEntityId(Hinge, HINGE_OWNERS_FIELD_ID, OTHER_ENTITY_ID);
+
+		return Data;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationCacheTest, "SnapshotMigrator.Cache.PatchesOnlyReferencesToTheEntityItself", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationCacheTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions Definitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ DOOR_COMPONENT_ID, FString{ TEXT("unreal.generated.BP_Door") }, {
+			SnapshotMigratorTestLibrary::FieldDefinition{ TARGET_FIELD_ID, FString{ TEXT("Target") }, FString{ TEXT("unreal.UnrealObjectRef") }, false, false },
+			SnapshotMigratorTestLibrary::FieldDefinition{ HINGE_FIELD_ID, FString{ TEXT("Hinge") }, FString{ TEXT("unreal.generated.Hinge") }, false, false }
+		} }
+	}, {
+		{ FString{ TEXT("unreal.generated.Hinge") }, {
+			SnapshotMigratorTestLibrary::FieldDefinition{ HINGE_DOOR_FIELD_ID, FString{ TEXT("Door") }, FString{ TEXT("unreal.UnrealObjectRef") }, false, false },
+			SnapshotMigratorTestLibrary::FieldDefinition{ HINGE_OWNERS_FIELD_ID, FString{ TEXT("Owners") }, FString{ TEXT("EntityId") }, true, true }
+		} }
+	}) };
+
+	// The source and target schema are the same, so each entity's components stand in for its migrated components.
+	SnapshotMigrationCache Cache{ Definitions, Definitions, SnapshotMigrationCache::DEFAULT_MAX_ENTRIES };
+
+	const auto AddEntity = [&Cache](const Worker_EntityId EntityId, const Worker_EntityId RefEntityId) {
+		Worker_ComponentData Data = CreateDoorData(RefEntityId);
+		const Worker_Entity Entity{ EntityId, 1, &Data };
+		Cache.Add(Cache.MakeKey(DOOR_CLASS, &Entity), EntityId, { Data }, {}, 0, 0);
+		Schema_DestroyComponentData(Data.schema_type);
+	};
+
+	// Looks up an entity and, if its migration was cached, checks that every reference in it is to ExpectedRefEntityId.
+	const auto FindAndCheckEntity = [this, &Cache](const Worker_EntityId EntityId, const Worker_EntityId RefEntityId, const Worker_EntityId ExpectedRefEntityId) {
+		Worker_ComponentData Data = CreateDoorData(RefEntityId);
+		const Worker_Entity Entity{ EntityId, 1, &Data };
+		const SnapshotMigrationCache::Entry* CachedEntry = Cache.Find(Cache.MakeKey(DOOR_CLASS, &Entity));
+		Schema_DestroyComponentData(Data.schema_type);
+
+		if (CachedEntry == nullptr)
+		{
+			return false;
+		}
+
+		TArray<Worker_ComponentData> Components = Cache.Instantiate(*CachedEntry, EntityId);
+		if (TestTrue(*FString::Printf(TEXT("Entity %lld has one component"), EntityId), Components.Num() == 1))
+		{
+			Schema_Object* Fields = Schema_GetComponentDataFields(Components[0].schema_type);
+			Schema_Object* Hinge = Schema_GetObject(Fields, HINGE_FIELD_ID);
+			TestEqual(*FString::Printf(TEXT("Entity %lld target"), EntityId), SpatialGDK::GetObjectRefFromSchema(Fields, TARGET_FIELD_ID).Entity, ExpectedRefEntityId);
+			TestEqual(*FString::Printf(TEXT("Entity %lld nested door"), EntityId), SpatialGDK::GetObjectRefFromSchema(Hinge, HINGE_DOOR_FIELD_ID).Entity, ExpectedRefEntityId);
+			TestTrue(*FString::Printf(TEXT("Entity %lld owner count"), EntityId), Schema_GetEntityIdCount(Hinge, HINGE_OWNERS_FIELD_ID) == 2);
+			TestEqual(*FString::Printf(TEXT("Entity %lld owner 0"), EntityId), Schema_IndexEntityId(Hinge, HINGE_OWNERS_FIELD_ID, 0), ExpectedRefEntityId);
+			TestEqual(*FString::Printf(TEXT("Entity %lld owner 1"), EntityId), Schema_IndexEntityId(Hinge, HINGE_OWNERS_FIELD_ID, 1), OTHER_ENTITY_ID);
+		}
+
+		for (Worker_ComponentData& Component : Components)
+		{
+			Schema_DestroyComponentData(Component.schema_type);
+		}
+		return true;
+	};
+
+	// Entity 1 refers to itself.
+	AddEntity(1, 1);
+
+	// Entity 2 refers to entity 1, so it must not reuse entity 1's migration, even though its payload is byte-identical.
+	TestFalse(TEXT("Reference to another entity misses a self-referencing entry"), FindAndCheckEntity(2, 1, 1));
+	AddEntity(2, 1);
+
+	// Entity 3 refers to itself, so it reuses entity 1's migration with every reference patched, however deeply nested.
+	TestTrue(TEXT("Self-referencing entity hits a self-referencing entry"), FindAndCheckEntity(3, 3, 3));
+
+	// Entity 4 refers to entity 1 as entity 2 does, so it reuses entity 2's migration without patching anything.
+	TestTrue(TEXT("Reference to another entity hits an entry with the same reference"), FindAndCheckEntity(4, 1, 1));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationCacheEvictionTest, "SnapshotMigrator.Cache.EvictsLeastRecentlyUsedEntries", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationCacheEvictionTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions Definitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ DOOR_COMPONENT_ID, FString{ TEXT("unreal.generated.BP_Door") }, {
+			SnapshotMigratorTestLibrary::FieldDefinition{ TARGET_FIELD_ID, FString{ TEXT("Target") }, FString{ TEXT("unreal.UnrealObjectRef") }, false, false }
+		} }
+	}) };
+
+	SnapshotMigrationCache Cache{ Definitions, Definitions, 2 };
+
+	// Each entity targets a different other entity, so that no two of them have the same key.
+	const auto MakeKey = [&Cache](const FString& ClassPath, const Worker_EntityId EntityId) {
+		Worker_ComponentData Data{};
+		Data.component_id = DOOR_COMPONENT_ID;
+		Data.schema_type = Schema_CreateComponentData();
+		SpatialGDK::AddObjectRefToSchema(Schema_GetComponentDataFields(Data.schema_type), TARGET_FIELD_ID, FUnrealObjectRef{ EntityId + 100, 0 });
+
+		const Worker_Entity Entity{ EntityId, 1, &Data };
+		SnapshotMigrationCache::Key CacheKey = Cache.MakeKey(ClassPath, &Entity);
+		Schema_DestroyComponentData(Data.schema_type);
+		return CacheKey;
+	};
+
+	const auto Add = [&Cache, &MakeKey](const Worker_EntityId EntityId) {
+		Cache.Add(MakeKey(DOOR_CLASS, EntityId), EntityId, {}, {}, 0, 0);
+	};
+
+	const auto IsCached = [&Cache, &MakeKey](const Worker_EntityId EntityId) {
+		return Cache.Find(MakeKey(DOOR_CLASS, EntityId)) != nullptr;
+	};
+
+	Add(1);
+	Add(2);
+
+	// Looking up entity 1 makes entity 2 the least recently used, so it's the one which makes way for entity 3.
+	TestTrue(TEXT("Entity 1 cached"), IsCached(1));
+	Add(3);
+	TestFalse(TEXT("Entity 2 evicted"), IsCached(2));
+	TestTrue(TEXT("Entity 1 still cached"), IsCached(1));
+	TestTrue(TEXT("Entity 3 cached"), IsCached(3));
+
+	// A class which has hit keeps being looked up however often it misses afterwards.
+	for (int32 i = 0; i < SnapshotMigrationCache::MAX_LOOKUPS_WITHOUT_HIT; i++)
+	{
+		IsCached(1000 + i);
+	}
+	TestTrue(TEXT("Class with hits still looked up"), Cache.ShouldLookUp(DOOR_CLASS));
+
+	// A class which has only ever missed stops being looked up, without affecting any other class.
+	const FString UniqueClass{ TEXT("/Game/Doors/BP_UniqueDoor.BP_UniqueDoor_C") };
+	for (int32 i = 0; i < SnapshotMigrationCache::MAX_LOOKUPS_WITHOUT_HIT; i++)
+	{
+		TestTrue(TEXT("Class without hits looked up until it reaches the limit"), Cache.ShouldLookUp(UniqueClass));
+		Cache.Find(MakeKey(UniqueClass, 2000 + i));
+	}
+	TestFalse(TEXT("Class without hits no longer looked up"), Cache.ShouldLookUp(UniqueClass));
+	TestTrue(TEXT("Other class still looked up"), Cache.ShouldLookUp(DOOR_CLASS));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
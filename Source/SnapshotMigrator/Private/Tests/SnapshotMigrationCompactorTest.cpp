@@ -0,0 +1,70 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/ScopeExit.h"
+
+#include "Tests/SnapshotMigratorTestLibrary.h"
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotMigrationCompactor.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationCompactorTest, "SnapshotMigrator.Compactor.StripsOnlyWhatTheTargetSchemaCantRead", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationCompactorTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions Definitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ 100, FString{ TEXT("unreal.generated.A") }, { SnapshotMigratorTestLibrary::FieldDefinition{ 1, FString{ TEXT("Known") }, FString{ TEXT("Int32") }, true, false } } }
+	}) };
+
+	// A known component with an unknown field, an unknown component, and a component from improbable's reserved range which the bundle doesn't define.
+	TArray<Worker_ComponentData> Components;
+	for (const Worker_ComponentId ComponentId : { 100, 101, 53 })
+	{
+		Worker_ComponentData& Component = Components.AddDefaulted_GetRef();
+		Component.component_id = ComponentId;
+		Component.schema_type = Schema_CreateComponentData();
+		Schema_AddInt32(Schema_GetComponentDataFields(Component.schema_type), 1, 1);
+		Schema_AddInt32(Schema_GetComponentDataFields(Component.schema_type), 2, 2);
+	}
+
+	const TArray<Worker_ComponentData> CreatedComponents = Components;
+	ON_SCOPE_EXIT
+	{
+		for (const Worker_ComponentData& Component : CreatedComponents)
+		{
+			Schema_DestroyComponentData(Component.schema_type);
+		}
+	};
+
+	const SnapshotMigrationCompactor Compactor{ SnapshotMigrationCompactor::GetDefaultRules() };
+	const SnapshotCompactionResult Result = Compactor.CompactEntity(Definitions, Components);
+
+	TestTrue(TEXT("One component dropped"), Result.NumDroppedComponents == 1);
+	TestTrue(TEXT("One field cleared"), Result.NumClearedFields == 1);
+	if (!TestEqual(TEXT("Components left"), Components.Num(), 2))
+	{
+		return false;
+	}
+
+	Schema_Object* KnownFields = Schema_GetComponentDataFields(Components[0].schema_type);
+	TestTrue(TEXT("Known field kept"), Schema_GetInt32Count(KnownFields, 1) == 1);
+	TestTrue(TEXT("Unknown field cleared"), Schema_GetInt32Count(KnownFields, 2) == 0);
+	TestTrue(TEXT("Reserved component kept as it was"), Schema_GetUniqueFieldIdCount(Schema_GetComponentDataFields(Components[1].schema_type)) == 2);
+
+	// Default data is only cleared when asked for, and only while it's unchanged.
+	const TArray<uint8> CreatedData = SnapshotMigrationCompactor::SerializeComponentData(Components[0]);
+	TestTrue(TEXT("Default data kept by the default rules"), Compactor.ClearDefaultComponentData(Components[0], CreatedData) == 0);
+
+	const SnapshotMigrationCompactor DefaultDataCompactor{ { SnapshotCompactionRule::DefaultComponentData } };
+	Schema_AddInt32(KnownFields, 1, 3);
+	TestTrue(TEXT("Changed data kept"), DefaultDataCompactor.ClearDefaultComponentData(Components[0], CreatedData) == 0);
+	Schema_ClearField(KnownFields, 1);
+	Schema_AddInt32(KnownFields, 1, 1);
+	TestTrue(TEXT("Unchanged data cleared"), DefaultDataCompactor.ClearDefaultComponentData(Components[0], CreatedData) == 1);
+	TestTrue(TEXT("Nothing left on the default component"), Schema_GetUniqueFieldIdCount(KnownFields) == 0);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,145 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "Tests/SnapshotMigratorTestLibrary.h"
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotMigrationDiff.h"
+
+#include "Utils/SchemaUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const Worker_ComponentId SOURCE_COMPONENT_ID = 100;
+	const Worker_ComponentId MIGRATED_COMPONENT_ID = 200;
+	const Schema_FieldId COUNT_FIELD_ID = 1;
+	const Schema_FieldId LABEL_FIELD_ID = 2;
+	const Schema_FieldId OWNER_FIELD_ID = 3;
+	const Schema_FieldId HEALTH_FIELD_ID = 4;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationDiffTest, "SnapshotMigrator.Diff.ClassifiesEachFieldOfAMigratedSnapshot", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationDiffTest::RunTest(const FString& Parameters)
+{
+	// The component is remapped, Label is dropped and Health is added.
+	const SchemaBundleDefinitions SourceDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ SOURCE_COMPONENT_ID, FString{ TEXT("unreal.generated.A") }, {
+			SnapshotMigratorTestLibrary::FieldDefinition{ COUNT_FIELD_ID, FString{ TEXT("Count") }, FString{ TEXT("Int32") }, true, false },
+			SnapshotMigratorTestLibrary::FieldDefinition{ LABEL_FIELD_ID, FString{ TEXT("Label") }, FString{ TEXT("String") }, true, false },
+			SnapshotMigratorTestLibrary::FieldDefinition{ OWNER_FIELD_ID, FString{ TEXT("Owner") }, FString{ TEXT("unreal.UnrealObjectRef") }, false, false }
+		} }
+	}) };
+	const SchemaBundleDefinitions MigratedDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ MIGRATED_COMPONENT_ID, FString{ TEXT("unreal.generated.A") }, {
+			SnapshotMigratorTestLibrary::FieldDefinition{ COUNT_FIELD_ID, FString{ TEXT("Count") }, FString{ TEXT("Int32") }, true, false },
+			SnapshotMigratorTestLibrary::FieldDefinition{ OWNER_FIELD_ID, FString{ TEXT("Owner") }, FString{ TEXT("unreal.UnrealObjectRef") }, false, false },
+			SnapshotMigratorTestLibrary::FieldDefinition{ HEALTH_FIELD_ID, FString{ TEXT("Health") }, FString{ TEXT("Float") }, true, false }
+		} }
+	}) };
+
+	const auto CreateComponent = [](const Worker_ComponentId ComponentId, TFunctionRef<void(Schema_Object*)> AddFields) {
+		Worker_ComponentData Component{};
+		Component.component_id = ComponentId;
+		Component.schema_type = Schema_CreateComponentData();
+		AddFields(Schema_GetComponentDataFields(Component.schema_type));
+		return Component;
+	};
+
+	// Entity 1 keeps Count and Owner, whose offset is carried over to the remapped component, entity 2's Count is changed, and entity 3 is only
+	// in the migrated snapshot.
+	TArray<TArray<Worker_ComponentData>> SourceEntities;
+	SourceEntities.Add({ CreateComponent(SOURCE_COMPONENT_ID, [](Schema_Object* Fields) {
+		Schema_AddInt32(Fields, COUNT_FIELD_ID, 1);
+		SpatialGDK::AddStringToSchema(Fields, LABEL_FIELD_ID, FString{ TEXT("First") });
+		SpatialGDK::AddObjectRefToSchema(Fields, OWNER_FIELD_ID, FUnrealObjectRef{ 1, SOURCE_COMPONENT_ID });
+	}) });
+	SourceEntities.Add({ CreateComponent(SOURCE_COMPONENT_ID, [](Schema_Object* Fields) { Schema_AddInt32(Fields, COUNT_FIELD_ID, 2); }) });
+
+	TArray<TArray<Worker_ComponentData>> MigratedEntities;
+	MigratedEntities.Add({ CreateComponent(MIGRATED_COMPONENT_ID, [](Schema_Object* Fields) {
+		Schema_AddInt32(Fields, COUNT_FIELD_ID, 1);
+		SpatialGDK::AddObjectRefToSchema(Fields, OWNER_FIELD_ID, FUnrealObjectRef{ 1, MIGRATED_COMPONENT_ID });
+	}) });
+	MigratedEntities.Add({ CreateComponent(MIGRATED_COMPONENT_ID, [](Schema_Object* Fields) {
+		Schema_AddInt32(Fields, COUNT_FIELD_ID, 5);
+		Schema_AddFloat(Fields, HEALTH_FIELD_ID, 1.f);
+	}) });
+	MigratedEntities.Add({ CreateComponent(MIGRATED_COMPONENT_ID, [](Schema_Object* Fields) {}) });
+
+	const FString& SnapshotDir = FPaths::Combine(FPaths::AutomationTransientDir(), FString{ TEXT("SnapshotMigrator") });
+	const FString& SourcePath = FPaths::Combine(SnapshotDir, FString{ TEXT("DiffSource.snapshot") });
+	const FString& MigratedPath = FPaths::Combine(SnapshotDir, FString{ TEXT("DiffMigrated.snapshot") });
+	IFileManager::Get().MakeDirectory(*SnapshotDir, true);
+	if (!TestTrue(TEXT("Source snapshot written"), SnapshotMigratorTestLibrary::WriteSnapshot(SourcePath, SourceEntities)) ||
+		!TestTrue(TEXT("Migrated snapshot written"), SnapshotMigratorTestLibrary::WriteSnapshot(MigratedPath, MigratedEntities)))
+	{
+		return false;
+	}
+
+	SnapshotMigrationDiff Diff{ SourceDefinitions, MigratedDefinitions };
+	const bool bCompared = Diff.DiffSnapshots(SourcePath, MigratedPath, 1024 * 1024);
+	IFileManager::Get().Delete(*SourcePath, false, true);
+	IFileManager::Get().Delete(*MigratedPath, false, true);
+
+	if (!TestTrue(TEXT("Both snapshots compared"), bCompared))
+	{
+		return false;
+	}
+
+	TestTrue(TEXT("Every source entity counted"), Diff.GetNumSourceEntities() == 2);
+	TestTrue(TEXT("Every migrated entity counted"), Diff.GetNumMigratedEntities() == 3);
+	TestTrue(TEXT("Entities in both snapshots matched"), Diff.GetNumMatchedEntities() == 2);
+	TestTrue(TEXT("Both matched entities changed"), Diff.GetNumChangedEntities() == 2);
+
+	struct ExpectedFieldDiff
+	{
+		FString FieldName;
+		uint64 Counts[static_cast<int32>(SnapshotFieldDiffKind::Count)];
+		Worker_EntityId FirstChangedEntityId;
+	};
+
+	// Counts are Unchanged, Changed, Dropped and Added.
+	const TArray<ExpectedFieldDiff> ExpectedFieldDiffs{
+		{ FString{ TEXT("Count") }, { 1, 1, 0, 0 }, 2 },
+		{ FString{ TEXT("Label") }, { 0, 0, 1, 0 }, 1 },
+		{ FString{ TEXT("Owner") }, { 1, 0, 0, 0 }, 0 },
+		{ FString{ TEXT("Health") }, { 0, 0, 0, 1 }, 2 }
+	};
+
+	const TArray<SnapshotFieldDiff> FieldDiffs = Diff.GetFieldDiffs(true);
+	if (!TestEqual(TEXT("Field diffs"), FieldDiffs.Num(), ExpectedFieldDiffs.Num()))
+	{
+		return false;
+	}
+
+	for (const ExpectedFieldDiff& Expected : ExpectedFieldDiffs)
+	{
+		const SnapshotFieldDiff* FieldDiff = FieldDiffs.FindByPredicate([&Expected](const SnapshotFieldDiff& Field) { return Field.FieldName == Expected.FieldName; });
+		if (!TestNotNull(*FString::Printf(TEXT("%s is diffed"), *Expected.FieldName), FieldDiff))
+		{
+			continue;
+		}
+
+		TestTrue(*FString::Printf(TEXT("%s is matched across the remapped component"), *Expected.FieldName),
+			FieldDiff->ComponentName == TEXT("unreal.generated.A") && FieldDiff->SourceComponentId == SOURCE_COMPONENT_ID && FieldDiff->MigratedComponentId == MIGRATED_COMPONENT_ID);
+
+		for (int32 i = 0; i < static_cast<int32>(SnapshotFieldDiffKind::Count); i++)
+		{
+			const SnapshotFieldDiffKind Kind = static_cast<SnapshotFieldDiffKind>(i);
+			TestTrue(*FString::Printf(TEXT("%s is %s on %llu entities"), *Expected.FieldName, GetSnapshotFieldDiffKindName(Kind), Expected.Counts[i]), FieldDiff->GetCount(Kind) == Expected.Counts[i]);
+			if (Kind != SnapshotFieldDiffKind::Unchanged && Expected.Counts[i] > 0)
+			{
+				TestTrue(*FString::Printf(TEXT("%s is first %s on entity %lld"), *Expected.FieldName, GetSnapshotFieldDiffKindName(Kind), Expected.FirstChangedEntityId), FieldDiff->FirstEntityIds[i] == Expected.FirstChangedEntityId);
+			}
+		}
+	}
+
+	TestEqual(TEXT("Fields with differences"), Diff.GetFieldDiffs(false).Num(), 3);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,213 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "Tests/SnapshotMigratorTestLibrary.h"
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotHelperLibrary.h"
+#include "Util/SnapshotMigrationSchemaAnalysis.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	using FieldDefinition = SnapshotMigratorTestLibrary::FieldDefinition;
+
+	FieldDefinition Int32Field(const uint32 FieldId, const TCHAR* Name)
+	{
+		return FieldDefinition{ FieldId, FString{ Name }, FString{ TEXT("Int32") }, true, false };
+	}
+
+	const SchemaChange* FindChange(const SnapshotMigrationSchemaAnalysis& Analysis, const FString& ComponentName, const FString& FieldName)
+	{
+		return Analysis.GetChanges().FindByPredicate([&ComponentName, &FieldName](const SchemaChange& Change) {
+			return Change.ComponentName == ComponentName && Change.FieldName == FieldName;
+		});
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationSchemaAnalysisTest, "SnapshotMigrator.SchemaAnalysis.ClassifiesChanges", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationSchemaAnalysisTest::RunTest(const FString& Parameters)
+{
+	const FString ComponentA{ TEXT("unreal.generated.A") };
+
+	const SchemaBundleDefinitions OldDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ 100, ComponentA, { Int32Field(1, TEXT("Kept")), Int32Field(2, TEXT("Moved")), Int32Field(3, TEXT("Retyped")), Int32Field(4, TEXT("Removed")),
+			FieldDefinition{ 5, FString{ TEXT("Wide") }, FString{ TEXT("Int64") }, true, false } } },
+		{ 101, FString{ TEXT("unreal.generated.B") }, { Int32Field(1, TEXT("Kept")) } },
+		{ 102, FString{ TEXT("unreal.generated.C") }, {} }
+	}) };
+
+	const SchemaBundleDefinitions NewDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ 200, ComponentA, { Int32Field(1, TEXT("Kept")), Int32Field(7, TEXT("Moved")), FieldDefinition{ 3, FString{ TEXT("Retyped") }, FString{ TEXT("Float") }, true, false },
+			FieldDefinition{ 5, FString{ TEXT("Wide") }, FString{ TEXT("Int64") }, true, false }, FieldDefinition{ 6, FString{ TEXT("Added") }, FString{ TEXT("Bool") }, true, false } } },
+		{ 101, FString{ TEXT("unreal.generated.B") }, { Int32Field(1, TEXT("Kept")) } },
+		{ 300, FString{ TEXT("unreal.generated.D") }, {} }
+	}) };
+
+	const SnapshotMigrationSchemaAnalysis Analysis = SnapshotMigrationSchemaAnalysis::Analyze(OldDefinitions, NewDefinitions);
+
+	const TArray<TPair<FString, SchemaChangeKind>> ExpectedFieldChanges{
+		{ FString{ TEXT("Moved") }, SchemaChangeKind::FieldRemapped },
+		{ FString{ TEXT("Retyped") }, SchemaChangeKind::FieldTypeMismatch },
+		{ FString{ TEXT("Removed") }, SchemaChangeKind::FieldDropped },
+		{ FString{ TEXT("Wide") }, SchemaChangeKind::FieldUnsupported },
+		{ FString{ TEXT("Added") }, SchemaChangeKind::FieldAdded }
+	};
+
+	for (const TPair<FString, SchemaChangeKind>& Expected : ExpectedFieldChanges)
+	{
+		const SchemaChange* Change = FindChange(Analysis, ComponentA, Expected.Key);
+		if (TestNotNull(*FString::Printf(TEXT("Change to %s reported"), *Expected.Key), Change))
+		{
+			TestEqual(*FString::Printf(TEXT("Change to %s"), *Expected.Key), GetSchemaChangeKindName(Change->Kind), GetSchemaChangeKindName(Expected.Value));
+		}
+	}
+
+	const SchemaChange* RemappedComponent = FindChange(Analysis, ComponentA, FString{});
+	if (TestNotNull(TEXT("Component A remapped"), RemappedComponent))
+	{
+		TestTrue(TEXT("Component A remapped ids"), RemappedComponent->Kind == SchemaChangeKind::ComponentRemapped && RemappedComponent->OldComponentId == 100 && RemappedComponent->NewComponentId == 200);
+	}
+
+	TestNull(TEXT("Unchanged field not reported"), FindChange(Analysis, ComponentA, FString{ TEXT("Kept") }));
+	TestNull(TEXT("Unchanged component not reported"), FindChange(Analysis, FString{ TEXT("unreal.generated.B") }, FString{}));
+	TestEqual(TEXT("Components dropped"), Analysis.GetNumChanges(SchemaChangeKind::ComponentDropped), 1);
+	TestEqual(TEXT("Components added"), Analysis.GetNumChanges(SchemaChangeKind::ComponentAdded), 1);
+	TestEqual(TEXT("Total changes"), Analysis.GetChanges().Num(), 8);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationSchemaChainTest, "SnapshotMigrator.SchemaAnalysis.ChainDropsWhatAnIntermediateVersionDropped", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationSchemaChainTest::RunTest(const FString& Parameters)
+{
+	const FString ComponentA{ TEXT("unreal.generated.A") };
+	const FString ComponentB{ TEXT("unreal.generated.B") };
+
+	// A's Removed field and all of B are missing from the intermediate version, and come back with the same names and types in the newest one.
+	// Renumbered is given a different id in every version, but keeps its name and type throughout.
+	const TArray<SnapshotMigratorTestLibrary::ComponentDefinition> NewestComponents{
+		{ 300, ComponentA, { Int32Field(1, TEXT("Kept")), Int32Field(2, TEXT("Removed")), Int32Field(5, TEXT("Renumbered")) } },
+		{ 301, ComponentB, { Int32Field(1, TEXT("Kept")) } }
+	};
+
+	TSharedPtr<FJsonObject> OldSchemaBundleJson = SnapshotMigratorTestLibrary::CreateSchemaBundle(NewestComponents);
+
+	const TArray<SchemaBundleDefinitions> IntermediateDefinitions{ SchemaBundleDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ 200, ComponentA, { Int32Field(1, TEXT("Kept")), Int32Field(4, TEXT("Renumbered")) } }
+	}) } };
+
+	SnapshotHelperLibrary::ComposeSchemaBundleChain(OldSchemaBundleJson, IntermediateDefinitions);
+
+	const SnapshotMigrationSchemaAnalysis Analysis = SnapshotMigrationSchemaAnalysis::Analyze(SchemaBundleDefinitions{ OldSchemaBundleJson },
+		SchemaBundleDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle(NewestComponents) });
+
+	const SchemaChange* RemovedField = FindChange(Analysis, ComponentA, FString{ TEXT("Removed") });
+	TestTrue(TEXT("Field removed along the chain isn't migrated"), RemovedField != nullptr && RemovedField->Kind == SchemaChangeKind::FieldAdded);
+
+	const SchemaChange* RemovedComponent = FindChange(Analysis, ComponentB, FString{});
+	TestTrue(TEXT("Component removed along the chain isn't migrated"), RemovedComponent != nullptr && RemovedComponent->Kind == SchemaChangeKind::ComponentAdded);
+
+	TestNull(TEXT("Field renumbered along the chain is migrated"), FindChange(Analysis, ComponentA, FString{ TEXT("Renumbered") }));
+	TestNull(TEXT("Field kept along the chain is migrated"), FindChange(Analysis, ComponentA, FString{ TEXT("Kept") }));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationSchemaChainPrunedFieldsTest, "SnapshotMigrator.SchemaAnalysis.ChainRecordsWhereEachPrunedFieldWasDropped", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationSchemaChainPrunedFieldsTest::RunTest(const FString& Parameters)
+{
+	const FString ComponentA{ TEXT("unreal.generated.A") };
+	const FString ComponentB{ TEXT("unreal.generated.B") };
+	const FString ComponentC{ TEXT("unreal.generated.C") };
+	const FString HingeType{ TEXT("unreal.generated.Hinge") };
+	const FString BDataType{ TEXT("unreal.generated.BData") };
+
+	const FieldDefinition Int64Retyped{ 2, FString{ TEXT("Retyped") }, FString{ TEXT("Int64") }, true, false };
+	const FieldDefinition StringRetyped{ 2, FString{ TEXT("Retyped") }, FString{ TEXT("String") }, true, false };
+
+	// B's fields live on a data definition type at the start of the chain, and are inlined at its last step.
+	TSharedPtr<FJsonObject> OldSchemaBundleJson = SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ 100, ComponentA, { Int32Field(1, TEXT("Kept")), Int32Field(2, TEXT("Retyped")), Int32Field(3, TEXT("Removed")) } },
+		{ 101, ComponentB, {}, BDataType },
+		{ 102, ComponentC, { Int32Field(1, TEXT("Kept")) } }
+	}, {
+		{ HingeType, { Int32Field(1, TEXT("Kept")), Int32Field(2, TEXT("Retyped")), Int32Field(3, TEXT("Removed")) } },
+		{ BDataType, { Int32Field(1, TEXT("Kept")), Int32Field(2, TEXT("Retyped")) } }
+	});
+
+	const TArray<SchemaBundleDefinitions> IntermediateDefinitions{
+		SchemaBundleDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+			{ 200, ComponentA, { Int32Field(1, TEXT("Kept")), Int64Retyped, Int32Field(3, TEXT("Removed")) } },
+			{ 201, ComponentB, {}, BDataType },
+			{ 202, ComponentC, { Int32Field(1, TEXT("Kept")) } }
+		}, {
+			{ HingeType, { Int32Field(1, TEXT("Kept")), Int64Retyped } },
+			{ BDataType, { Int32Field(1, TEXT("Kept")), Int32Field(2, TEXT("Retyped")) } }
+		}) },
+		SchemaBundleDefinitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+			{ 300, ComponentA, { Int32Field(1, TEXT("Kept")), Int32Field(2, TEXT("Retyped")) } },
+			{ 301, ComponentB, { Int32Field(1, TEXT("Kept")), StringRetyped } }
+		}, {
+			{ HingeType, { Int32Field(1, TEXT("Kept")), Int32Field(2, TEXT("Retyped")) } }
+		}) }
+	};
+
+	TArray<SnapshotHelperLibrary::PrunedSchemaField> PrunedFields;
+	SnapshotHelperLibrary::ComposeSchemaBundleChain(OldSchemaBundleJson, IntermediateDefinitions, &PrunedFields);
+
+	const auto TestPrunedField = [this, &PrunedFields](const FString& OwnerName, const TCHAR* FieldName, const bool bIsComponentField, const int32 ChainStep, const bool bTypeChanged) {
+		const SnapshotHelperLibrary::PrunedSchemaField* PrunedField = PrunedFields.FindByPredicate([&OwnerName, FieldName](const SnapshotHelperLibrary::PrunedSchemaField& Field) {
+			return Field.OwnerName == OwnerName && Field.FieldName == FieldName;
+		});
+
+		const FString& What = FString::Printf(TEXT("%s.%s"), *OwnerName, FieldName);
+		if (TestNotNull(*FString::Printf(TEXT("%s is pruned"), *What), PrunedField))
+		{
+			TestTrue(*FString::Printf(TEXT("%s is a component field"), *What), PrunedField->bIsComponentField == bIsComponentField);
+			TestEqual(*FString::Printf(TEXT("%s chain step"), *What), PrunedField->ChainStep, ChainStep);
+			TestTrue(*FString::Printf(TEXT("%s type changed"), *What), PrunedField->bTypeChanged == bTypeChanged);
+		}
+	};
+
+	// A field whose type changes partway along the chain is pruned even though it has its original type again at the end.
+	TestPrunedField(ComponentA, TEXT("Retyped"), true, 0, true);
+	TestPrunedField(ComponentA, TEXT("Removed"), true, 1, false);
+	TestPrunedField(ComponentB, TEXT("Retyped"), true, 1, true);
+	TestPrunedField(HingeType, TEXT("Retyped"), false, 0, true);
+	TestPrunedField(HingeType, TEXT("Removed"), false, 0, false);
+	TestPrunedField(BDataType, TEXT("Kept"), false, 1, false);
+	TestPrunedField(BDataType, TEXT("Retyped"), false, 1, false);
+
+	// Fields of a component that is itself pruned aren't recorded, since the whole component is dropped.
+	TestFalse(TEXT("Pruned component's fields aren't recorded"), PrunedFields.ContainsByPredicate([&ComponentC](const SnapshotHelperLibrary::PrunedSchemaField& Field) { return Field.OwnerName == ComponentC; }));
+	TestTrue(TEXT("Surviving fields aren't recorded"), PrunedFields.Num() == 7);
+
+	const SchemaBundleDefinitions ComposedDefinitions{ OldSchemaBundleJson };
+	TestNull(TEXT("Component removed along the chain is pruned"), ComposedDefinitions.FindComponent(ComponentC));
+
+	const SchemaBundleComponentDefinition* ComposedA = ComposedDefinitions.FindComponent(ComponentA);
+	if (TestNotNull(TEXT("Component kept along the chain survives"), ComposedA))
+	{
+		TestTrue(TEXT("Component keeps only its surviving fields"), ComposedA->GetFields().Num() == 1 && ComposedA->FindField(FString{ TEXT("Kept") }) != nullptr);
+	}
+
+	const SchemaBundleComponentDefinition* ComposedB = ComposedDefinitions.FindComponent(ComponentB);
+	if (TestNotNull(TEXT("Component with a data definition survives"), ComposedB))
+	{
+		TestTrue(TEXT("Data definition is inlined"), ComposedB->GetDataDefinition().IsEmpty());
+		TestTrue(TEXT("Inlined data definition keeps only its surviving fields"), ComposedB->GetFields().Num() == 1 && ComposedB->FindField(FString{ TEXT("Kept") }) != nullptr);
+	}
+
+	const SchemaBundleTypeDefinition* ComposedHinge = ComposedDefinitions.FindType(HingeType);
+	if (TestNotNull(TEXT("Type survives"), ComposedHinge))
+	{
+		TestTrue(TEXT("Type keeps only its surviving fields"), ComposedHinge->GetFields().Num() == 1 && ComposedHinge->FindField(FString{ TEXT("Kept") }) != nullptr);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,116 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "Tests/SnapshotMigratorTestLibrary.h"
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotMigrationSelector.h"
+
+#include "Schema/UnrealMetadata.h"
+#include "SpatialConstants.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const Worker_ComponentId DOOR_COMPONENT_ID = 100;
+	const FString DOOR_CLASS{ TEXT("/Game/Doors/BP_Door.BP_Door_C") };
+	const FString WINDOW_CLASS{ TEXT("/Game/Windows/BP_Window.BP_Window_C") };
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationSelectorTest, "SnapshotMigrator.Selector.SelectsEntitiesMatchingEveryKindOfCriterion", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationSelectorTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions Definitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ DOOR_COMPONENT_ID, FString{ TEXT("unreal.generated.BP_Door") }, {} }
+	}) };
+
+	struct TestEntity
+	{
+		Worker_EntityId EntityId;
+		FString ClassPath;
+		bool bHasDoorComponent;
+	};
+
+	const TArray<TestEntity> TestEntities{
+		{ 1, DOOR_CLASS, true },
+		{ 2, DOOR_CLASS, false },
+		{ 3, WINDOW_CLASS, true },
+		{ 150, DOOR_CLASS, true },
+		// Entities without an actor have an empty class path.
+		{ 151, FString{}, true }
+	};
+
+	TArray<TArray<Worker_ComponentData>> EntityComponents;
+	for (const TestEntity& TestEntity : TestEntities)
+	{
+		TArray<Worker_ComponentData>& Components = EntityComponents.AddDefaulted_GetRef();
+		if (!TestEntity.ClassPath.IsEmpty())
+		{
+			Components.Add(SpatialGDK::UnrealMetadata({}, TestEntity.ClassPath, false).CreateUnrealMetadataData());
+		}
+		if (TestEntity.bHasDoorComponent)
+		{
+			Worker_ComponentData Component{};
+			Component.component_id = DOOR_COMPONENT_ID;
+			Component.schema_type = Schema_CreateComponentData();
+			Components.Add(Component);
+		}
+	}
+
+	const auto GetSelectedEntityIds = [&TestEntities, &EntityComponents](const SnapshotMigrationSelector& Selector) {
+		TArray<Worker_EntityId> EntityIds;
+		for (int32 i = 0; i < TestEntities.Num(); i++)
+		{
+			Worker_Entity Entity;
+			Entity.entity_id = TestEntities[i].EntityId;
+			Entity.components = EntityComponents[i].GetData();
+			Entity.component_count = EntityComponents[i].Num();
+			if (Selector.ShouldMigrateEntity(&Entity))
+			{
+				EntityIds.Add(Entity.entity_id);
+			}
+		}
+		return EntityIds;
+	};
+
+	SnapshotMigrationSelector ByRange;
+	TestTrue(TEXT("Ranges parsed"), ByRange.AddEntityIdRanges(FString{ TEXT("2,100-") }));
+	TestTrue(TEXT("Selected by id"), GetSelectedEntityIds(ByRange) == TArray<Worker_EntityId>{ 2, 150, 151 });
+
+	SnapshotMigrationSelector ByClass;
+	ByClass.AddClassPattern(FString{ TEXT("*/BP_Door*") });
+	TestTrue(TEXT("Selected by class"), GetSelectedEntityIds(ByClass) == TArray<Worker_EntityId>{ 1, 2, 150 });
+
+	SnapshotMigrationSelector ByComponent;
+	ByComponent.AddComponent(FString{ TEXT("unreal.generated.BP_Door") });
+	TestTrue(TEXT("Components resolved"), ByComponent.ResolveComponents(Definitions));
+	TestTrue(TEXT("Selected by component"), GetSelectedEntityIds(ByComponent) == TArray<Worker_EntityId>{ 1, 3, 150, 151 });
+
+	SnapshotMigrationSelector ByEverything;
+	ByEverything.AddEntityIdRanges(FString{ TEXT("-100") });
+	ByEverything.AddClassPattern(FString{ TEXT("*/BP_Door*") });
+	ByEverything.AddClassPattern(FString{ TEXT("*/BP_Window*") });
+	ByEverything.AddComponent(FString::FromInt(DOOR_COMPONENT_ID));
+	TestTrue(TEXT("Components resolved by id"), ByEverything.ResolveComponents(Definitions));
+	TestTrue(TEXT("Selected by every kind of criterion"), GetSelectedEntityIds(ByEverything) == TArray<Worker_EntityId>{ 1, 3 });
+
+	SnapshotMigrationSelector Invalid;
+	TestFalse(TEXT("Reversed range rejected"), Invalid.AddEntityIdRanges(FString{ TEXT("200-100") }));
+	TestFalse(TEXT("Malformed range rejected"), Invalid.AddEntityIdRanges(FString{ TEXT("1-x") }));
+	Invalid.AddComponent(FString{ TEXT("unreal.generated.Missing") });
+	TestFalse(TEXT("Unknown component rejected"), Invalid.ResolveComponents(Definitions));
+
+	for (TArray<Worker_ComponentData>& Components : EntityComponents)
+	{
+		for (Worker_ComponentData& Component : Components)
+		{
+			Schema_DestroyComponentData(Component.schema_type);
+		}
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,46 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "Util/SnapshotMigrationSpatialOrder.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationHilbertCurveTest, "SnapshotMigrator.SpatialOrder.HilbertCurveVisitsNeighbouringCells", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationHilbertCurveTest::RunTest(const FString& Parameters)
+{
+	// The curve fills the block of cells at the corner of the grid before leaving it, so the block's cells are the first along the curve.
+	const uint32 BlockSize = 8;
+
+	TArray<FIntPoint> CellsAlongCurve;
+	CellsAlongCurve.SetNum(BlockSize * BlockSize);
+	TArray<bool> bVisited;
+	bVisited.Init(false, BlockSize * BlockSize);
+
+	for (uint32 X = 0; X < BlockSize; X++)
+	{
+		for (uint32 Y = 0; Y < BlockSize; Y++)
+		{
+			const uint64 Index = SnapshotMigrationSpatialOrder::GetHilbertIndex(X, Y);
+			if (!TestTrue(*FString::Printf(TEXT("Cell (%u, %u) is within the block along the curve"), X, Y), Index < BlockSize * BlockSize) ||
+				!TestFalse(*FString::Printf(TEXT("Cell (%u, %u) has an index of its own"), X, Y), bVisited[Index]))
+			{
+				return false;
+			}
+
+			bVisited[Index] = true;
+			CellsAlongCurve[Index] = FIntPoint(X, Y);
+		}
+	}
+
+	for (int32 i = 1; i < CellsAlongCurve.Num(); i++)
+	{
+		const FIntPoint Step = CellsAlongCurve[i] - CellsAlongCurve[i - 1];
+		TestEqual(*FString::Printf(TEXT("Cells %d and %d along the curve are neighbours"), i - 1, i), FMath::Abs(Step.X) + FMath::Abs(Step.Y), 1);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
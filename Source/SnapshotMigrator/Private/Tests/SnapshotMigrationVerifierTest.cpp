@@ -0,0 +1,97 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "Tests/SnapshotMigratorTestLibrary.h"
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotMigrationVerifier.h"
+
+#include "Utils/SchemaUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const Worker_ComponentId TEST_COMPONENT_ID = 100;
+	const Schema_FieldId COUNT_FIELD_ID = 1;
+	const Schema_FieldId OWNER_FIELD_ID = 2;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigrationVerifierTest, "SnapshotMigrator.Verifier.FindsEachFailureInAMigratedSnapshot", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigrationVerifierTest::RunTest(const FString& Parameters)
+{
+	const SchemaBundleDefinitions Definitions{ SnapshotMigratorTestLibrary::CreateSchemaBundle({
+		{ TEST_COMPONENT_ID, FString{ TEXT("unreal.generated.A") }, {
+			SnapshotMigratorTestLibrary::FieldDefinition{ COUNT_FIELD_ID, FString{ TEXT("Count") }, FString{ TEXT("Int32") }, true, false },
+			SnapshotMigratorTestLibrary::FieldDefinition{ OWNER_FIELD_ID, FString{ TEXT("Owner") }, FString{ TEXT("unreal.UnrealObjectRef") }, false, false }
+		} }
+	}) };
+
+	const auto CreateComponent = [](const Worker_ComponentId ComponentId, TFunctionRef<void(Schema_Object*)> AddFields) {
+		Worker_ComponentData Component{};
+		Component.component_id = ComponentId;
+		Component.schema_type = Schema_CreateComponentData();
+		AddFields(Schema_GetComponentDataFields(Component.schema_type));
+		return Component;
+	};
+
+	// Entity 1 is well formed, and each of the rest has a single failure.
+	TArray<TArray<Worker_ComponentData>> Entities;
+	Entities.Add({ CreateComponent(TEST_COMPONENT_ID, [](Schema_Object* Fields) {
+		Schema_AddInt32(Fields, COUNT_FIELD_ID, 1);
+		SpatialGDK::AddObjectRefToSchema(Fields, OWNER_FIELD_ID, FUnrealObjectRef{ 2, 0 });
+	}) });
+	Entities.Add({ CreateComponent(101, [](Schema_Object* Fields) {}) });
+	Entities.Add({ CreateComponent(TEST_COMPONENT_ID, [](Schema_Object* Fields) { Schema_AddInt32(Fields, 3, 1); }) });
+	Entities.Add({ CreateComponent(TEST_COMPONENT_ID, [](Schema_Object* Fields) { Schema_AddFloat(Fields, COUNT_FIELD_ID, 1.f); }) });
+	Entities.Add({ CreateComponent(TEST_COMPONENT_ID, [](Schema_Object* Fields) {
+		Schema_AddInt32(Fields, COUNT_FIELD_ID, 1);
+		Schema_AddInt32(Fields, COUNT_FIELD_ID, 2);
+	}) });
+	Entities.Add({ CreateComponent(TEST_COMPONENT_ID, [](Schema_Object* Fields) { SpatialGDK::AddObjectRefToSchema(Fields, OWNER_FIELD_ID, FUnrealObjectRef{ 1, 102 }); }) });
+	Entities.Add({ CreateComponent(TEST_COMPONENT_ID, [](Schema_Object* Fields) { SpatialGDK::AddObjectRefToSchema(Fields, OWNER_FIELD_ID, FUnrealObjectRef{ 99, 0 }); }) });
+	// Components from improbable's reserved range aren't necessarily in the bundle.
+	Entities.Add({ CreateComponent(53, [](Schema_Object* Fields) {}) });
+
+	const FString& SnapshotDir = FPaths::Combine(FPaths::AutomationTransientDir(), FString{ TEXT("SnapshotMigrator") });
+	const FString& SnapshotPath = FPaths::Combine(SnapshotDir, FString{ TEXT("Verifier.snapshot") });
+	IFileManager::Get().MakeDirectory(*SnapshotDir, true);
+	if (!TestTrue(TEXT("Snapshot written"), SnapshotMigratorTestLibrary::WriteSnapshot(SnapshotPath, Entities)))
+	{
+		return false;
+	}
+
+	TArray<SnapshotVerificationIssue> Issues;
+	SnapshotMigrationVerifier::Result Result;
+	const bool bReadSnapshot = SnapshotMigrationVerifier{ Definitions }.VerifySnapshot(SnapshotPath, [&Issues](const SnapshotVerificationIssue& Issue) { Issues.Add(Issue); }, Result);
+	IFileManager::Get().Delete(*SnapshotPath, false, true);
+
+	TestTrue(TEXT("Whole snapshot read"), bReadSnapshot);
+	TestTrue(TEXT("Every entity verified"), Result.NumEntities == 8);
+
+	const TArray<SnapshotVerificationIssue> ExpectedIssues{
+		{ 2, 101, FString{}, SnapshotVerificationFailure::UnknownComponent },
+		{ 3, TEST_COMPONENT_ID, FString{ TEXT("#3") }, SnapshotVerificationFailure::UnknownField },
+		{ 4, TEST_COMPONENT_ID, FString{ TEXT("Count") }, SnapshotVerificationFailure::FieldTypeMismatch },
+		{ 5, TEST_COMPONENT_ID, FString{ TEXT("Count") }, SnapshotVerificationFailure::TooManyValues },
+		{ 6, TEST_COMPONENT_ID, FString{ TEXT("Owner") }, SnapshotVerificationFailure::InvalidObjectRefOffset },
+		{ 7, TEST_COMPONENT_ID, FString{ TEXT("Owner") }, SnapshotVerificationFailure::DanglingObjectRef }
+	};
+	if (!TestEqual(TEXT("Issues found"), Issues.Num(), ExpectedIssues.Num()))
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < ExpectedIssues.Num(); i++)
+	{
+		const SnapshotVerificationIssue& Issue = Issues[i];
+		const SnapshotVerificationIssue& Expected = ExpectedIssues[i];
+		TestTrue(*FString::Printf(TEXT("Issue %d is a %s on entity %lld"), i, GetSnapshotVerificationFailureName(Expected.Failure), Expected.EntityId),
+			Issue.EntityId == Expected.EntityId && Issue.ComponentId == Expected.ComponentId && Issue.FieldPath == Expected.FieldPath && Issue.Failure == Expected.Failure);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
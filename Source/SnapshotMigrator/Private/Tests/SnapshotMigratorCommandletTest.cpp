@@ -0,0 +1,452 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "CoreMinimal.h"
+#include "HAL/FileManager.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeExit.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+#include "Tests/SnapshotMigratorTestActor.h"
+#include "Tests/SnapshotMigratorTestLibrary.h"
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotHelperLibrary.h"
+#include "Util/SnapshotMigrationAllocationCounter.h"
+#include "Util/SnapshotMigrationCheckpoint.h"
+
+#include "Schema/StandardLibrary.h"
+#include "Schema/UnrealMetadata.h"
+#include "SpatialConstants.h"
+#include "SpatialGDKServicesConstants.h"
+#include "Utils/SchemaDatabase.h"
+#include "Utils/SchemaUtils.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const uint32 TEST_DATA_COMPONENT_ID = 1000;
+	const Schema_FieldId VALUES_FIELD_ID = 1;
+	const Schema_FieldId NAME_FIELD_ID = 2;
+
+	// Shouldn't match any project's classpath whitelist, so that actor entities go through the class filter and are skipped without needing
+	// a project specific class to spawn.
+	const FString NON_WHITELISTED_CLASS{ TEXT("/Script/SnapshotMigrator.SnapshotMigratorTestActorWhichIsNotWhitelisted") };
+
+	// Added to the test actor's data component id to give it a different id in the old schema bundle than in the new one.
+	const Worker_ComponentId OLD_COMPONENT_ID_OFFSET = 100000;
+	const int32 TEST_ACTOR_VALUE = 42;
+
+	bool CreateWorkingDir(const FString& WorkingDir)
+	{
+		IFileManager::Get().DeleteDirectory(*WorkingDir, false, true);
+		return IFileManager::Get().MakeDirectory(*SnapshotMigratorTestLibrary::GetArtifactsDir(WorkingDir), true) &&
+			IFileManager::Get().MakeDirectory(*SnapshotMigratorTestLibrary::GetSchemaDir(WorkingDir), true);
+	}
+
+	/**
+	* Writes a snapshot and both schema bundles to a working directory. Every entity has a Position; actor entities also have UnrealMetadata, and the
+	* rest have a test data component whose values are derived from their entity id.
+	*/
+	bool WriteTestInputs(const FString& WorkingDir, const int32 NumEntities, const float ActorEntityShare)
+	{
+		const TSharedPtr<FJsonObject> SchemaBundleJson = SnapshotMigratorTestLibrary::CreateSchemaBundle({
+			{ TEST_DATA_COMPONENT_ID, FString{ TEXT("unreal.generated.SnapshotMigratorTestData") }, {
+				{ VALUES_FIELD_ID, FString{ TEXT("values") }, FString{ TEXT("Int32") }, true, true },
+				{ NAME_FIELD_ID, FString{ TEXT("name") }, FString{ TEXT("String") }, true, false }
+			} }
+		});
+
+		if (!SnapshotMigratorTestLibrary::SaveSchemaBundle(SchemaBundleJson, FPaths::Combine(SnapshotMigratorTestLibrary::GetArtifactsDir(WorkingDir), FString{ TEXT("schema.sb.json") })) ||
+			!SnapshotMigratorTestLibrary::SaveSchemaBundle(SchemaBundleJson, FPaths::Combine(SnapshotMigratorTestLibrary::GetSchemaDir(WorkingDir), FString{ TEXT("schema.sb.json") })))
+		{
+			return false;
+		}
+
+		// Actor entities are spread evenly through the snapshot rather than bunched up at the start or end.
+		TArray<TArray<Worker_ComponentData>> Entities;
+		float ActorEntityDebt = 0.f;
+		for (int32 i = 0; i < NumEntities; i++)
+		{
+			const Worker_EntityId EntityId = i + 1;
+
+			TArray<Worker_ComponentData>& Components = Entities.AddDefaulted_GetRef();
+			Components.Add(SpatialGDK::Position(SpatialGDK::Coordinates{ static_cast<double>(i), 0.0, 0.0 }).CreatePositionData());
+
+			ActorEntityDebt += ActorEntityShare;
+			if (ActorEntityDebt >= 1.f)
+			{
+				ActorEntityDebt -= 1.f;
+				Components.Add(SpatialGDK::UnrealMetadata({}, NON_WHITELISTED_CLASS, false).CreateUnrealMetadataData());
+				continue;
+			}
+
+			Worker_ComponentData Data;
+			Data.component_id = TEST_DATA_COMPONENT_ID;
+			Data.schema_type = Schema_CreateComponentData();
+
+			Schema_Object* Fields = Schema_GetComponentDataFields(Data.schema_type);
+			Schema_AddInt32(Fields, VALUES_FIELD_ID, static_cast<int32>(EntityId));
+			Schema_AddInt32(Fields, VALUES_FIELD_ID, static_cast<int32>(EntityId) * 2);
+			Schema_AddInt32(Fields, VALUES_FIELD_ID, -static_cast<int32>(EntityId));
+			SpatialGDK::AddStringToSchema(Fields, NAME_FIELD_ID, FString::Printf(TEXT("Entity_%lld"), EntityId));
+
+			Components.Add(Data);
+		}
+
+		return SnapshotMigratorTestLibrary::WriteSnapshot(FPaths::Combine(SnapshotMigratorTestLibrary::GetArtifactsDir(WorkingDir), FString{ TEXT("Test.snapshot") }), Entities);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigratorMigratesSnapshotTest, "SnapshotMigrator.Commandlet.MigratesSnapshot", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigratorMigratesSnapshotTest::RunTest(const FString& Parameters)
+{
+	const FString& WorkingDir = FPaths::Combine(FPaths::AutomationTransientDir(), FString{ TEXT("SnapshotMigrator") }, FString{ TEXT("MigratesSnapshot") });
+
+	const int32 NumEntities = 30;
+	const int32 NumActorEntities = 10;
+	if (!TestTrue(TEXT("Created working directory"), CreateWorkingDir(WorkingDir)) ||
+		!TestTrue(TEXT("Wrote test inputs"), WriteTestInputs(WorkingDir, NumEntities, static_cast<float>(NumActorEntities) / NumEntities)))
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> StatusJson;
+	if (!TestTrue(TEXT("Migrator succeeded"), SnapshotMigratorTestLibrary::RunMigrator(WorkingDir, StatusJson)))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Migrated entities"), static_cast<int32>(StatusJson->GetNumberField(TEXT("NumMigratedEntities"))), NumEntities - NumActorEntities);
+	TestEqual(TEXT("Skipped entities"), static_cast<int32>(StatusJson->GetNumberField(TEXT("NumSkippedEntities"))), NumActorEntities);
+
+	int32 NumReadEntities = 0;
+	const bool bReadSnapshot = SnapshotMigratorTestLibrary::ReadSnapshot(FPaths::Combine(SnapshotMigratorTestLibrary::GetTargetSnapshotDir(WorkingDir), FString{ TEXT("Test.snapshot") }), [this, &NumReadEntities](const Worker_Entity& Entity) {
+		NumReadEntities++;
+
+		const Worker_ComponentData* Data = nullptr;
+		for (uint32 i = 0; i < Entity.component_count; i++)
+		{
+			if (Entity.components[i].component_id == TEST_DATA_COMPONENT_ID)
+			{
+				Data = &Entity.components[i];
+			}
+			TestFalse(*FString::Printf(TEXT("Entity %lld has no UnrealMetadata"), Entity.entity_id), Entity.components[i].component_id == SpatialConstants::UNREAL_METADATA_COMPONENT_ID);
+		}
+
+		if (!TestNotNull(*FString::Printf(TEXT("Entity %lld has test data"), Entity.entity_id), Data))
+		{
+			return;
+		}
+
+		Schema_Object* Fields = Schema_GetComponentDataFields(Data->schema_type);
+		const int32 EntityId = static_cast<int32>(Entity.entity_id);
+		TestTrue(*FString::Printf(TEXT("Entity %lld value count"), Entity.entity_id), Schema_GetInt32Count(Fields, VALUES_FIELD_ID) == 3);
+		TestEqual(*FString::Printf(TEXT("Entity %lld value 0"), Entity.entity_id), Schema_IndexInt32(Fields, VALUES_FIELD_ID, 0), EntityId);
+		TestEqual(*FString::Printf(TEXT("Entity %lld value 1"), Entity.entity_id), Schema_IndexInt32(Fields, VALUES_FIELD_ID, 1), EntityId * 2);
+		TestEqual(*FString::Printf(TEXT("Entity %lld value 2"), Entity.entity_id), Schema_IndexInt32(Fields, VALUES_FIELD_ID, 2), -EntityId);
+		TestEqual(*FString::Printf(TEXT("Entity %lld name"), Entity.entity_id), SpatialGDK::GetStringFromSchema(Fields, NAME_FIELD_ID), FString::Printf(TEXT("Entity_%lld"), Entity.entity_id));
+	});
+
+	TestTrue(TEXT("Read migrated snapshot"), bReadSnapshot);
+	TestEqual(TEXT("Entities in migrated snapshot"), NumReadEntities, NumEntities - NumActorEntities);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigratorRemapsActorEntityTest, "SnapshotMigrator.Commandlet.RemapsActorEntityComponentIds", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigratorRemapsActorEntityTest::RunTest(const FString& Parameters)
+{
+	const FString& ClassPath = ASnapshotMigratorTestActor::StaticClass()->GetPathName();
+
+	// The migrator builds actor entities through the GDK, so the test actor's data component id and the id of its TestValue field have to be the
+	// ones the project's schema generation gave them.
+	const USchemaDatabase* SchemaDatabase = Cast<USchemaDatabase>(FSoftObjectPath{ FPaths::SetExtension(SpatialConstants::SCHEMA_DATABASE_ASSET_PATH, TEXT(".SchemaDatabase")) }.TryLoad());
+	const FActorSchemaData* ActorSchemaData = SchemaDatabase != nullptr ? SchemaDatabase->ActorClassPathToSchema.Find(ClassPath) : nullptr;
+	if (!TestNotNull(*FString::Printf(TEXT("Schema database has %s; generate schema with the SnapshotMigrator plugin enabled"), *ClassPath), ActorSchemaData))
+	{
+		return false;
+	}
+
+	const FString& ProjectSchemaBundlePath = FPaths::Combine(SpatialGDKServicesConstants::SpatialOSDirectory, FString{ TEXT("build/assembly/schema/schema.sb.json") });
+	TSharedPtr<FJsonObject> ProjectSchemaBundleJson;
+	if (!TestTrue(TEXT("Loaded the project's compiled schema bundle"), SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(ProjectSchemaBundlePath, ProjectSchemaBundleJson)))
+	{
+		return false;
+	}
+
+	const Worker_ComponentId NewComponentId = ActorSchemaData->SchemaComponents[SCHEMA_Data];
+	const Worker_ComponentId OldComponentId = NewComponentId + OLD_COMPONENT_ID_OFFSET;
+
+	const SchemaBundleDefinitions ProjectDefinitions{ ProjectSchemaBundleJson };
+	const SchemaBundleComponentDefinition* DataComponent = ProjectDefinitions.FindComponent(NewComponentId);
+	const SchemaBundleFieldDefinition* TestValueField = nullptr;
+	if (DataComponent != nullptr)
+	{
+		TestValueField = DataComponent->GetFields().FindByPredicate([](const SchemaBundleFieldDefinition& Field) { return Field.GetName().Equals(TEXT("TestValue"), ESearchCase::IgnoreCase); });
+	}
+
+	if (!TestNotNull(TEXT("Compiled schema has the test actor's TestValue field; compile schema with the SnapshotMigrator plugin enabled"), TestValueField))
+	{
+		return false;
+	}
+
+	// Both bundles hold just the test actor's data component, under the same name but different ids. The entity's other components are left as
+	// the GDK creates them, since neither bundle defines them.
+	const Schema_FieldId TestValueFieldId = TestValueField->GetId();
+	const auto CreateSchemaBundle = [DataComponent, TestValueFieldId](const Worker_ComponentId ComponentId) {
+		return SnapshotMigratorTestLibrary::CreateSchemaBundle({
+			{ ComponentId, DataComponent->GetName(), {
+				{ TestValueFieldId, FString{ TEXT("testvalue") }, FString{ TEXT("Int32") }, true, false }
+			} }
+		});
+	};
+
+	const FString& WorkingDir = FPaths::Combine(FPaths::AutomationTransientDir(), FString{ TEXT("SnapshotMigrator") }, FString{ TEXT("RemapsActorEntity") });
+	if (!TestTrue(TEXT("Created working directory"), CreateWorkingDir(WorkingDir)) ||
+		!TestTrue(TEXT("Wrote old schema bundle"), SnapshotMigratorTestLibrary::SaveSchemaBundle(CreateSchemaBundle(OldComponentId), FPaths::Combine(SnapshotMigratorTestLibrary::GetArtifactsDir(WorkingDir), FString{ TEXT("schema.sb.json") }))) ||
+		!TestTrue(TEXT("Wrote new schema bundle"), SnapshotMigratorTestLibrary::SaveSchemaBundle(CreateSchemaBundle(NewComponentId), FPaths::Combine(SnapshotMigratorTestLibrary::GetSchemaDir(WorkingDir), FString{ TEXT("schema.sb.json") }))))
+	{
+		return false;
+	}
+
+	TArray<TArray<Worker_ComponentData>> Entities;
+	TArray<Worker_ComponentData>& Components = Entities.AddDefaulted_GetRef();
+	Components.Add(SpatialGDK::Position(SpatialGDK::Coordinates{ 0.0, 0.0, 0.0 }).CreatePositionData());
+	Components.Add(SpatialGDK::UnrealMetadata({}, ClassPath, false).CreateUnrealMetadataData());
+
+	Worker_ComponentData Data;
+	Data.component_id = OldComponentId;
+	Data.schema_type = Schema_CreateComponentData();
+	Schema_AddInt32(Schema_GetComponentDataFields(Data.schema_type), TestValueFieldId, TEST_ACTOR_VALUE);
+	Components.Add(Data);
+
+	if (!TestTrue(TEXT("Wrote test snapshot"), SnapshotMigratorTestLibrary::WriteSnapshot(FPaths::Combine(SnapshotMigratorTestLibrary::GetArtifactsDir(WorkingDir), FString{ TEXT("Test.snapshot") }), Entities)))
+	{
+		return false;
+	}
+
+	// The migrator reads its classpath whitelist from the global config, which stays loaded between runs, so the test actor is whitelisted there for
+	// the duration of the test.
+	FString WhitelistIniPath;
+	if (!TestTrue(TEXT("Loaded classpath whitelist"), FConfigCacheIni::LoadGlobalIniFile(WhitelistIniPath, TEXT("SnapshotClasspathWhitelistPatterns"))))
+	{
+		return false;
+	}
+
+	TArray<FString> WhitelistedClasspathPatterns;
+	GConfig->GetArray(TEXT("ClasspathPatterns"), TEXT("ClasspathPatterns"), WhitelistedClasspathPatterns, WhitelistIniPath);
+	ON_SCOPE_EXIT
+	{
+		GConfig->SetArray(TEXT("ClasspathPatterns"), TEXT("ClasspathPatterns"), WhitelistedClasspathPatterns, WhitelistIniPath);
+	};
+
+	TArray<FString> TestClasspathPatterns = WhitelistedClasspathPatterns;
+	TestClasspathPatterns.Add(FString::Printf(TEXT("^%s$"), *ClassPath.Replace(TEXT("."), TEXT("\\."))));
+	GConfig->SetArray(TEXT("ClasspathPatterns"), TEXT("ClasspathPatterns"), TestClasspathPatterns, WhitelistIniPath);
+
+	TSharedPtr<FJsonObject> StatusJson;
+	if (!TestTrue(TEXT("Migrator succeeded"), SnapshotMigratorTestLibrary::RunMigrator(WorkingDir, StatusJson)))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Migrated entities"), static_cast<int32>(StatusJson->GetNumberField(TEXT("NumMigratedEntities"))), 1);
+	TestEqual(TEXT("Skipped entities"), static_cast<int32>(StatusJson->GetNumberField(TEXT("NumSkippedEntities"))), 0);
+
+	int32 NumReadEntities = 0;
+	const bool bReadSnapshot = SnapshotMigratorTestLibrary::ReadSnapshot(FPaths::Combine(SnapshotMigratorTestLibrary::GetTargetSnapshotDir(WorkingDir), FString{ TEXT("Test.snapshot") }), [&](const Worker_Entity& Entity) {
+		NumReadEntities++;
+		TestEqual(TEXT("Entity id"), Entity.entity_id, static_cast<Worker_EntityId>(1));
+
+		const Worker_ComponentData* MigratedData = nullptr;
+		bool bHasUnrealMetadata = false;
+		for (uint32 i = 0; i < Entity.component_count; i++)
+		{
+			const Worker_ComponentId ComponentId = Entity.components[i].component_id;
+			if (ComponentId == NewComponentId)
+			{
+				MigratedData = &Entity.components[i];
+			}
+			bHasUnrealMetadata |= ComponentId == SpatialConstants::UNREAL_METADATA_COMPONENT_ID;
+			TestFalse(TEXT("Entity has no component under its old id"), ComponentId == OldComponentId);
+		}
+
+		TestTrue(TEXT("Entity has UnrealMetadata"), bHasUnrealMetadata);
+		if (TestNotNull(TEXT("Entity has the test actor's data component under its new id"), MigratedData))
+		{
+			Schema_Object* Fields = Schema_GetComponentDataFields(MigratedData->schema_type);
+			TestTrue(TEXT("TestValue count"), Schema_GetInt32Count(Fields, TestValueFieldId) == 1);
+			TestEqual(TEXT("TestValue"), Schema_GetInt32(Fields, TestValueFieldId), TEST_ACTOR_VALUE);
+		}
+	});
+
+	TestTrue(TEXT("Read migrated snapshot"), bReadSnapshot);
+	TestEqual(TEXT("Entities in migrated snapshot"), NumReadEntities, 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigratorResumesMigrationTest, "SnapshotMigrator.Commandlet.ResumesInterruptedMigration", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigratorResumesMigrationTest::RunTest(const FString& Parameters)
+{
+	const int32 NumEntities = 30;
+	const float ActorEntityShare = 1.f / 3.f;
+
+	// A checkpoint is written after every entity, since the interval is shorter than it takes to migrate one.
+	const FString& CheckpointParams = FString{ TEXT(" -Checkpoint=0.000000001") };
+
+	const auto MigrateAndReadEntityIds = [this](const FString& WorkingDir, const FString& ExtraParams, TSharedPtr<FJsonObject>& OutStatusJson, TArray<Worker_EntityId>& OutEntityIds) {
+		if (!TestTrue(TEXT("Migrator succeeded"), SnapshotMigratorTestLibrary::RunMigrator(WorkingDir, OutStatusJson, ExtraParams)))
+		{
+			return false;
+		}
+
+		const FString& TargetPath = FPaths::Combine(SnapshotMigratorTestLibrary::GetTargetSnapshotDir(WorkingDir), FString{ TEXT("Test.snapshot") });
+		return TestTrue(TEXT("Read migrated snapshot"), SnapshotMigratorTestLibrary::ReadSnapshot(TargetPath, [&OutEntityIds](const Worker_Entity& Entity) { OutEntityIds.Add(Entity.entity_id); }));
+	};
+
+	const FString& UninterruptedDir = FPaths::Combine(FPaths::AutomationTransientDir(), FString{ TEXT("SnapshotMigrator") }, FString{ TEXT("Uninterrupted") });
+	TSharedPtr<FJsonObject> UninterruptedStatusJson;
+	TArray<Worker_EntityId> UninterruptedEntityIds;
+	if (!TestTrue(TEXT("Created working directory"), CreateWorkingDir(UninterruptedDir)) ||
+		!TestTrue(TEXT("Wrote test inputs"), WriteTestInputs(UninterruptedDir, NumEntities, ActorEntityShare)) ||
+		!MigrateAndReadEntityIds(UninterruptedDir, CheckpointParams, UninterruptedStatusJson, UninterruptedEntityIds))
+	{
+		return false;
+	}
+
+	const FString& InterruptedDir = FPaths::Combine(FPaths::AutomationTransientDir(), FString{ TEXT("SnapshotMigrator") }, FString{ TEXT("Interrupted") });
+	if (!TestTrue(TEXT("Created working directory"), CreateWorkingDir(InterruptedDir)) ||
+		!TestTrue(TEXT("Wrote test inputs"), WriteTestInputs(InterruptedDir, NumEntities, ActorEntityShare)))
+	{
+		return false;
+	}
+
+	// A directory in the way of a later segment fails the migration partway through, once the checkpoint before it has been written.
+	const FString& TargetPath = FPaths::Combine(SnapshotMigratorTestLibrary::GetTargetSnapshotDir(InterruptedDir), FString{ TEXT("Test.snapshot") });
+	const FString& BlockedSegmentPath = SnapshotMigrationCheckpoint::GetSegmentPath(TargetPath, 10);
+	if (!TestTrue(TEXT("Blocked a segment"), IFileManager::Get().MakeDirectory(*BlockedSegmentPath, true)))
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> InterruptedStatusJson;
+	SnapshotMigratorTestLibrary::RunMigrator(InterruptedDir, InterruptedStatusJson, CheckpointParams);
+
+	SnapshotMigrationCheckpoint Checkpoint;
+	if (!TestTrue(TEXT("Interrupted migration left a checkpoint"), SnapshotMigrationCheckpoint::Load(SnapshotMigrationCheckpoint::GetCheckpointPath(TargetPath), Checkpoint)) ||
+		!TestTrue(TEXT("Checkpoint records the entities processed before it"), Checkpoint.NumProcessedEntities > 0 && Checkpoint.NumProcessedEntities < NumEntities))
+	{
+		return false;
+	}
+
+	IFileManager::Get().DeleteDirectory(*BlockedSegmentPath, false, true);
+
+	TSharedPtr<FJsonObject> ResumedStatusJson;
+	TArray<Worker_EntityId> ResumedEntityIds;
+	if (!MigrateAndReadEntityIds(InterruptedDir, CheckpointParams + TEXT(" -Resume"), ResumedStatusJson, ResumedEntityIds))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Migrated entities"), static_cast<int32>(ResumedStatusJson->GetNumberField(TEXT("NumMigratedEntities"))), static_cast<int32>(UninterruptedStatusJson->GetNumberField(TEXT("NumMigratedEntities"))));
+	TestEqual(TEXT("Skipped entities"), static_cast<int32>(ResumedStatusJson->GetNumberField(TEXT("NumSkippedEntities"))), static_cast<int32>(UninterruptedStatusJson->GetNumberField(TEXT("NumSkippedEntities"))));
+	TestTrue(TEXT("Resumed migration has the same entities as an uninterrupted one, each once and in order"), ResumedEntityIds == UninterruptedEntityIds);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSnapshotMigratorPerformanceTest, "SnapshotMigrator.Performance.MigrateSnapshot", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FSnapshotMigratorPerformanceTest::RunTest(const FString& Parameters)
+{
+	const TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("SnapshotMigrator"));
+	if (!TestTrue(TEXT("Found SnapshotMigrator plugin"), Plugin.IsValid()))
+	{
+		return false;
+	}
+
+	const FString& BaselinePath = FPaths::Combine(Plugin->GetBaseDir(), FString{ TEXT("Source/SnapshotMigrator/Private/Tests/SnapshotMigratorPerformanceBaseline.json") });
+
+	FString BaselineString;
+	TSharedPtr<FJsonObject> BaselineJson;
+	if (!TestTrue(TEXT("Loaded performance baseline"), FFileHelper::LoadFileToString(BaselineString, *BaselinePath) && FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineString), BaselineJson) && BaselineJson.IsValid()))
+	{
+		return false;
+	}
+
+	const int32 NumEntities = static_cast<int32>(BaselineJson->GetNumberField(TEXT("NumEntities")));
+	const float ActorEntityShare = static_cast<float>(BaselineJson->GetNumberField(TEXT("ActorEntityShare")));
+	const double Tolerance = BaselineJson->GetNumberField(TEXT("Tolerance"));
+
+	// The migrator's setup (loading a map, schema bundles and so on) allocates far more than migrating a few thousand entities does. Running it
+	// over snapshots of N and 2N entities and taking the difference leaves just the allocations made by the extra N entities.
+	int64 NumAllocations[2] = {};
+	TSharedPtr<FJsonObject> StatusJson;
+	for (int32 Run = 0; Run < 2; Run++)
+	{
+		const FString& WorkingDir = FPaths::Combine(FPaths::AutomationTransientDir(), FString{ TEXT("SnapshotMigrator") }, FString::Printf(TEXT("Performance%d"), Run));
+		if (!TestTrue(TEXT("Created working directory"), CreateWorkingDir(WorkingDir)) ||
+			!TestTrue(TEXT("Wrote test inputs"), WriteTestInputs(WorkingDir, NumEntities * (Run + 1), ActorEntityShare)))
+		{
+			return false;
+		}
+
+		// The migrator runs on this thread, so only this thread's allocations are counted; whatever the editor is doing in the background
+		// meanwhile doesn't get mixed in. Getting the counter installs it if no earlier test has.
+		SnapshotMigrationAllocationCounter::Get();
+		const int64 StartAllocations = SnapshotMigrationAllocationCounter::GetNumThreadAllocations();
+		const bool bMigrated = SnapshotMigratorTestLibrary::RunMigrator(WorkingDir, StatusJson);
+
+		if (!TestTrue(TEXT("Migrator succeeded"), bMigrated))
+		{
+			return false;
+		}
+
+		NumAllocations[Run] = SnapshotMigrationAllocationCounter::GetNumThreadAllocations() - StartAllocations;
+	}
+
+	const double ElapsedTime = StatusJson->GetNumberField(TEXT("ElapsedTime"));
+	const double EntitiesPerSecond = ElapsedTime > 0.0 ? StatusJson->GetNumberField(TEXT("NumProcessedEntities")) / ElapsedTime : 0.0;
+	const double AllocationsPerEntity = static_cast<double>(NumAllocations[1] - NumAllocations[0]) / NumEntities;
+
+	// Every run writes what it measured alongside the baseline's settings, so that recording a new baseline is a matter of copying this file over it.
+	const TSharedRef<FJsonObject> MeasuredJson = MakeShared<FJsonObject>();
+	MeasuredJson->Values = BaselineJson->Values;
+	MeasuredJson->SetNumberField(TEXT("EntitiesPerSecond"), EntitiesPerSecond);
+	MeasuredJson->SetNumberField(TEXT("AllocationsPerEntity"), AllocationsPerEntity);
+
+	FString MeasuredString;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&MeasuredString);
+	const FString& MeasuredPath = FPaths::Combine(FPaths::AutomationDir(), FString{ TEXT("SnapshotMigratorPerformanceMeasured.json") });
+	if (FJsonSerializer::Serialize(MeasuredJson, Writer) && FFileHelper::SaveStringToFile(MeasuredString, *MeasuredPath))
+	{
+		AddInfo(FString::Printf(TEXT("Wrote the measured values to %s."), *MeasuredPath));
+	}
+
+	double BaselineEntitiesPerSecond = 0.0;
+	double BaselineAllocationsPerEntity = 0.0;
+	if (!TestTrue(*FString::Printf(TEXT("Baseline records EntitiesPerSecond and AllocationsPerEntity; record them by running this test on the reference machine and copying %s over %s"), *MeasuredPath, *BaselinePath),
+		BaselineJson->TryGetNumberField(TEXT("EntitiesPerSecond"), BaselineEntitiesPerSecond) && BaselineJson->TryGetNumberField(TEXT("AllocationsPerEntity"), BaselineAllocationsPerEntity)))
+	{
+		AddInfo(FString::Printf(TEXT("Migrated %.1f entities/s with %.1f allocations/entity."), EntitiesPerSecond, AllocationsPerEntity));
+		return false;
+	}
+
+	AddInfo(FString::Printf(TEXT("Migrated %.1f entities/s (baseline %.1f) with %.1f allocations/entity (baseline %.1f)."),
+		EntitiesPerSecond, BaselineEntitiesPerSecond, AllocationsPerEntity, BaselineAllocationsPerEntity));
+
+	TestTrue(*FString::Printf(TEXT("Entities per second (%.1f) within %.0f%% of baseline (%.1f)"), EntitiesPerSecond, Tolerance * 100.0, BaselineEntitiesPerSecond),
+		EntitiesPerSecond >= BaselineEntitiesPerSecond * (1.0 - Tolerance));
+	TestTrue(*FString::Printf(TEXT("Allocations per entity (%.1f) within %.0f%% of baseline (%.1f)"), AllocationsPerEntity, Tolerance * 100.0, BaselineAllocationsPerEntity),
+		AllocationsPerEntity <= BaselineAllocationsPerEntity * (1.0 + Tolerance));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,18 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Tests/SnapshotMigratorTestActor.h"
+
+#include "Net/UnrealNetwork.h"
+
+ASnapshotMigratorTestActor::ASnapshotMigratorTestActor()
+	: TestValue(0)
+{
+	bReplicates = true;
+}
+
+void ASnapshotMigratorTestActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ASnapshotMigratorTestActor, TestValue);
+}
@@ -0,0 +1,26 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+#include "SnapshotMigratorTestActor.generated.h"
+
+/**
+* Minimal replicated actor for the automation tests to migrate actor entities of. It isn't built out of WITH_DEV_AUTOMATION_TESTS like the tests
+* are, so that the GDK generates schema for it along with the project's other classes.
+*/
+UCLASS(NotPlaceable, SpatialType)
+class ASnapshotMigratorTestActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ASnapshotMigratorTestActor();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	UPROPERTY(Replicated)
+	int32 TestValue;
+};
@@ -0,0 +1,185 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Tests/SnapshotMigratorTestLibrary.h"
+#include "SnapshotMigratorModuleInternal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Dom/JsonValue.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeExit.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+#include "Commandlets/SnapshotMigratorCommandletV2.h"
+#include "Util/SnapshotHelperLibrary.h"
+
+namespace
+{
+	TArray<TSharedPtr<FJsonValue>> CreateFieldsJson(const TArray<SnapshotMigratorTestLibrary::FieldDefinition>& Fields)
+	{
+		TArray<TSharedPtr<FJsonValue>> FieldsJson;
+		for (const SnapshotMigratorTestLibrary::FieldDefinition& Field : Fields)
+		{
+			TSharedPtr<FJsonObject> TypeJson = MakeShareable(new FJsonObject);
+			TypeJson->SetStringField(Field.bIsPrimitive ? TEXT("primitive") : TEXT("type"), Field.Type);
+
+			TSharedPtr<FJsonObject> CardinalityJson = MakeShareable(new FJsonObject);
+			CardinalityJson->SetObjectField(Field.bIsList ? TEXT("innerType") : TEXT("type"), TypeJson);
+
+			TSharedPtr<FJsonObject> FieldJson = MakeShareable(new FJsonObject);
+			FieldJson->SetNumberField(TEXT("fieldId"), Field.FieldId);
+			FieldJson->SetStringField(TEXT("name"), Field.Name);
+			FieldJson->SetObjectField(Field.bIsList ? TEXT("listType") : TEXT("singularType"), CardinalityJson);
+			FieldsJson.Add(MakeShareable(new FJsonValueObject(FieldJson)));
+		}
+		return FieldsJson;
+	}
+
+	FString GetShortName(const FString& QualifiedName)
+	{
+		FString Name;
+		QualifiedName.Split(TEXT("."), nullptr, &Name, ESearchCase::CaseSensitive, ESearchDir::FromEnd);
+		return Name;
+	}
+}
+
+TSharedPtr<FJsonObject> SnapshotMigratorTestLibrary::CreateSchemaBundle(const TArray<ComponentDefinition>& Components, const TArray<TypeDefinition>& Types)
+{
+	TArray<TSharedPtr<FJsonValue>> TypesJson;
+	for (const TypeDefinition& Type : Types)
+	{
+		TSharedPtr<FJsonObject> TypeJson = MakeShareable(new FJsonObject);
+		TypeJson->SetStringField(TEXT("qualifiedName"), Type.QualifiedName);
+		TypeJson->SetStringField(TEXT("name"), GetShortName(Type.QualifiedName));
+		TypeJson->SetArrayField(TEXT("fields"), CreateFieldsJson(Type.Fields));
+		TypesJson.Add(MakeShareable(new FJsonValueObject(TypeJson)));
+	}
+
+	TArray<TSharedPtr<FJsonValue>> ComponentsJson;
+	for (const ComponentDefinition& Component : Components)
+	{
+		TSharedPtr<FJsonObject> ComponentJson = MakeShareable(new FJsonObject);
+		ComponentJson->SetNumberField(TEXT("componentId"), Component.ComponentId);
+		ComponentJson->SetStringField(TEXT("qualifiedName"), Component.QualifiedName);
+		ComponentJson->SetStringField(TEXT("name"), GetShortName(Component.QualifiedName));
+		ComponentJson->SetStringField(TEXT("dataDefinition"), Component.DataDefinition);
+		ComponentJson->SetArrayField(TEXT("fields"), CreateFieldsJson(Component.Fields));
+		ComponentsJson.Add(MakeShareable(new FJsonValueObject(ComponentJson)));
+	}
+
+	TSharedPtr<FJsonObject> FileJson = MakeShareable(new FJsonObject);
+	FileJson->SetArrayField(TEXT("types"), TypesJson);
+	FileJson->SetArrayField(TEXT("components"), ComponentsJson);
+
+	TSharedPtr<FJsonObject> BundleJson = MakeShareable(new FJsonObject);
+	BundleJson->SetArrayField(TEXT("schemaFiles"), TArray<TSharedPtr<FJsonValue>>{ MakeShareable(new FJsonValueObject(FileJson)) });
+
+	return BundleJson;
+}
+
+bool SnapshotMigratorTestLibrary::SaveSchemaBundle(const TSharedPtr<FJsonObject>& SchemaBundleJson, const FString& Path)
+{
+	FString OutputString;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&OutputString);
+	return FJsonSerializer::Serialize(SchemaBundleJson.ToSharedRef(), Writer) && FFileHelper::SaveStringToFile(OutputString, *Path);
+}
+
+bool SnapshotMigratorTestLibrary::WriteSnapshot(const FString& Path, TArray<TArray<Worker_ComponentData>>& Entities)
+{
+	ON_SCOPE_EXIT
+	{
+		for (TArray<Worker_ComponentData>& Components : Entities)
+		{
+			for (Worker_ComponentData& Component : Components)
+			{
+				Schema_DestroyComponentData(Component.schema_type);
+			}
+		}
+		Entities.Reset();
+	};
+
+	const Worker_ComponentVtable DefaultVtable{};
+	Worker_SnapshotParameters Parameters{};
+	Parameters.default_component_vtable = &DefaultVtable;
+
+	Worker_SnapshotOutputStream* OutputStream = Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*Path), &Parameters);
+	ON_SCOPE_EXIT
+	{
+		Worker_SnapshotOutputStream_Destroy(OutputStream);
+	};
+
+	if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString{ TEXT("initialise test snapshot output stream") }))
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < Entities.Num(); i++)
+	{
+		Worker_Entity Entity;
+		Entity.entity_id = i + 1;
+		Entity.components = Entities[i].GetData();
+		Entity.component_count = Entities[i].Num();
+
+		Worker_SnapshotOutputStream_WriteEntity(OutputStream, &Entity);
+		if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString::Printf(TEXT("write test entity %d"), i + 1)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SnapshotMigratorTestLibrary::ReadSnapshot(const FString& Path, TFunctionRef<void(const Worker_Entity& Entity)> Visitor)
+{
+	const Worker_ComponentVtable DefaultVtable{};
+	Worker_SnapshotParameters Parameters{};
+	Parameters.default_component_vtable = &DefaultVtable;
+
+	Worker_SnapshotInputStream* InputStream = Worker_SnapshotInputStream_Create(TCHAR_TO_UTF8(*Path), &Parameters);
+	ON_SCOPE_EXIT
+	{
+		Worker_SnapshotInputStream_Destroy(InputStream);
+	};
+
+	if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString{ TEXT("initialise test snapshot input stream") }))
+	{
+		return false;
+	}
+
+	while (Worker_SnapshotInputStream_HasNext(InputStream))
+	{
+		const Worker_Entity* Entity = Worker_SnapshotInputStream_ReadEntity(InputStream);
+		if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString{ TEXT("read test entity") }))
+		{
+			return false;
+		}
+
+		Visitor(*Entity);
+	}
+
+	return true;
+}
+
+bool SnapshotMigratorTestLibrary::RunMigrator(const FString& WorkingDir, TSharedPtr<FJsonObject>& OutStatusJson, const FString& ExtraParams)
+{
+	const FString& StatusFile = FPaths::Combine(WorkingDir, FString{ TEXT("Status.json") });
+
+	// Progress reporting has to be enabled for the final status to be written, but the interval is long enough that it's the only report.
+	const FString& Params = FString::Printf(TEXT("-OldArtifactsDir=\"%s\" -CompiledSchemaDir=\"%s\" -TargetSnapshotDir=\"%s\" -StatusFile=\"%s\" -ProgressInterval=3600%s"),
+		*GetArtifactsDir(WorkingDir), *GetSchemaDir(WorkingDir), *GetTargetSnapshotDir(WorkingDir), *StatusFile, *ExtraParams);
+
+	USnapshotMigratorCommandlet* Migrator = NewObject<USnapshotMigratorCommandlet>();
+	if (Migrator->Main(Params) != 0)
+	{
+		return false;
+	}
+
+	FString StatusString;
+	return FFileHelper::LoadFileToString(StatusString, *StatusFile) && FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(StatusString), OutStatusJson) && OutStatusJson.IsValid();
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
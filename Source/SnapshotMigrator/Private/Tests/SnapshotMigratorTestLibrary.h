@@ -0,0 +1,85 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Misc/Paths.h"
+
+#include <WorkerSDK/improbable/c_schema.h>
+#include <WorkerSDK/improbable/c_worker.h>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+* Builds the schema bundles and snapshots the automation tests migrate, so that the tests don't depend on a project's compiled schema.
+*/
+class SnapshotMigratorTestLibrary
+{
+public:
+	struct FieldDefinition
+	{
+		uint32 FieldId;
+		FString Name;
+		// Either a primitive type name (e.g. "Int32") or a qualified type name (e.g. "unreal.UnrealObjectRef").
+		FString Type;
+		bool bIsPrimitive;
+		bool bIsList;
+	};
+
+	struct TypeDefinition
+	{
+		FString QualifiedName;
+		TArray<FieldDefinition> Fields;
+	};
+
+	struct ComponentDefinition
+	{
+		uint32 ComponentId;
+		FString QualifiedName;
+		TArray<FieldDefinition> Fields;
+		// Qualified name of a type holding the component's fields, in which case Fields should be empty.
+		FString DataDefinition;
+	};
+
+	/**
+	* Creates a schema bundle with a single schema file holding the given components and types. A component's fields are inlined unless it names a
+	* data definition type.
+	*/
+	static TSharedPtr<FJsonObject> CreateSchemaBundle(const TArray<ComponentDefinition>& Components, const TArray<TypeDefinition>& Types = {});
+
+	static bool SaveSchemaBundle(const TSharedPtr<FJsonObject>& SchemaBundleJson, const FString& Path);
+
+	/**
+	* Writes a snapshot of the given entities, destroying their component data afterwards.
+	*	@param	Path		Where to write the snapshot
+	*	@param	Entities	Components of each entity; entity ids are assigned in order starting from 1
+	*
+	*	@return				True if every entity was written
+	*/
+	static bool WriteSnapshot(const FString& Path, TArray<TArray<Worker_ComponentData>>& Entities);
+
+	/**
+	* Calls Visitor for every entity in a snapshot. The entity is only valid for the duration of the call.
+	*
+	*	@return		True if the whole snapshot could be read
+	*/
+	static bool ReadSnapshot(const FString& Path, TFunctionRef<void(const Worker_Entity& Entity)> Visitor);
+
+	/**
+	* Runs USnapshotMigratorCommandlet over WorkingDir/artifacts, with the target bundle in WorkingDir/schema, writing migrated snapshots to
+	* WorkingDir/snapshots.
+	*	@param	WorkingDir		Directory laid out as described above
+	*	@param	OutStatusJson	The migrator's final progress report for the last snapshot it migrated
+	*	@param	ExtraParams		Further switches to pass to the migrator, e.g. " -Checkpoint=60"
+	*
+	*	@return					True if the migrator succeeded
+	*/
+	static bool RunMigrator(const FString& WorkingDir, TSharedPtr<FJsonObject>& OutStatusJson, const FString& ExtraParams = FString{});
+
+	static FString GetArtifactsDir(const FString& WorkingDir) { return FPaths::Combine(WorkingDir, FString{ TEXT("artifacts") }); }
+	static FString GetSchemaDir(const FString& WorkingDir) { return FPaths::Combine(WorkingDir, FString{ TEXT("schema") }); }
+	static FString GetTargetSnapshotDir(const FString& WorkingDir) { return FPaths::Combine(WorkingDir, FString{ TEXT("snapshots") }); }
+};
+
+#endif // WITH_DEV_AUTOMATION_TESTS
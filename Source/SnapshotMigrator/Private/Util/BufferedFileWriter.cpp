@@ -0,0 +1,66 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/BufferedFileWriter.h"
+
+#include "HAL/FileManager.h"
+#include "SnapshotMigratorModuleInternal.h"
+
+BufferedFileWriter::BufferedFileWriter(const FString& InFilepath, const bool bAppend /* = false */, const int32 InBufferSize /* = DEFAULT_BUFFER_SIZE */)
+	: Filepath(InFilepath), BufferSize(InBufferSize)
+{
+	Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileWriter(*Filepath, bAppend ? EFileWrite::FILEWRITE_Append : EFileWrite::FILEWRITE_None));
+	if (!Archive.IsValid())
+	{
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to open %s for writing."), *Filepath);
+	}
+
+	Buffer.Reserve(BufferSize);
+}
+
+BufferedFileWriter::~BufferedFileWriter()
+{
+	Flush();
+	if (Archive.IsValid())
+	{
+		Archive->Close();
+	}
+}
+
+void BufferedFileWriter::Write(const FString& Text)
+{
+	const FTCHARToUTF8 Converted(*Text);
+	Write(Converted.Get(), Converted.Length());
+}
+
+void BufferedFileWriter::Write(const ANSICHAR* Text, const int32 Length)
+{
+	if (!Archive.IsValid())
+	{
+		return;
+	}
+
+	if (Buffer.Num() + Length > BufferSize)
+	{
+		Flush();
+	}
+
+	// Anything that wouldn't fit in an empty buffer is written straight through.
+	if (Length > BufferSize)
+	{
+		Archive->Serialize(const_cast<ANSICHAR*>(Text), Length);
+		return;
+	}
+
+	Buffer.Append(Text, Length);
+}
+
+void BufferedFileWriter::Flush()
+{
+	if (Archive.IsValid() && Buffer.Num() > 0)
+	{
+		Archive->Serialize(Buffer.GetData(), Buffer.Num());
+		Archive->Flush();
+	}
+
+	Buffer.Reset();
+}
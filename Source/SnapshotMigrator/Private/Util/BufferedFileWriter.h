@@ -0,0 +1,35 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/Archive.h"
+
+/**
+* Accumulates UTF-8 text in memory and only hands it to the file system once the buffer fills up, so that writers which emit many small records
+* (e.g. one per entity) don't pay for a file write each time.
+*/
+class BufferedFileWriter
+{
+public:
+	BufferedFileWriter(const FString& InFilepath, const bool bAppend = false, const int32 InBufferSize = DEFAULT_BUFFER_SIZE);
+	~BufferedFileWriter();
+
+	BufferedFileWriter(const BufferedFileWriter&) = delete;
+	BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+	bool IsValid() const { return Archive.IsValid(); }
+	const FString& GetFilepath() const { return Filepath; }
+
+	void Write(const FString& Text);
+	void Write(const ANSICHAR* Text, const int32 Length);
+	void Flush();
+
+	static const int32 DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+private:
+	FString Filepath;
+	TUniquePtr<FArchive> Archive;
+	TArray<ANSICHAR> Buffer;
+	const int32 BufferSize;
+};
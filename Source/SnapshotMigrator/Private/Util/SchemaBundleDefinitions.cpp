@@ -65,6 +65,11 @@ const SchemaBundleTypeDefinition& SchemaBundleDefinitions::FindTypeChecked(const
 	return SchemaTypes.FindChecked(Name);
 }
 
+const TArray<SchemaBundleComponentDefinition>& SchemaBundleDefinitions::GetComponents() const
+{
+	return SchemaComponents.GetAll();
+}
+
 const bool SchemaBundleDefinitions::GetCorrespondingComponentId(const SchemaBundleDefinitions& FromSchemaBundleDefinitions, const SchemaBundleDefinitions& ToSchemaBundleDefinitions, const uint32 FromComponentId, uint32& ToComponentId)
 {
 	if (const SchemaBundleComponentDefinition* FromComponentDefinition = FromSchemaBundleDefinitions.FindComponent(FromComponentId))
@@ -86,6 +86,29 @@ const bool SchemaBundleFieldDefinition::IsSameTypeAs(const SchemaBundleFieldDefi
 		(!IsMap() || Types[(int) TypeIndex::VALUE].IsSameTypeAs(Other.Types[(int) TypeIndex::VALUE]));
 }
 
+FString SchemaBundleFieldDefinition::GetTypeName() const
+{
+	const auto GetInnerTypeName = [this](const TypeIndex Index) {
+		const TypeInfo& Type = Types[(int) Index];
+		return Type.PrimitiveType > SchemaPrimitiveType::Invalid ? *SchemaPrimitiveTypes.FindKey(Type.PrimitiveType) : Type.ResolvedType;
+	};
+
+	if (IsMap())
+	{
+		return FString::Printf(TEXT("map<%s, %s>"), *GetInnerTypeName(TypeIndex::KEY), *GetInnerTypeName(TypeIndex::VALUE));
+	}
+	else if (IsList())
+	{
+		return FString::Printf(TEXT("list<%s>"), *GetInnerTypeName(TypeIndex::INNER));
+	}
+	else if (IsOptional())
+	{
+		return FString::Printf(TEXT("option<%s>"), *GetInnerTypeName(TypeIndex::INNER));
+	}
+
+	return GetInnerTypeName(TypeIndex::INNER);
+}
+
 const bool SchemaBundleFieldDefinition::IsSameCardinality(const SchemaBundleFieldDefinition& Other) const
 {
 	return IsSingular() == Other.IsSingular() &&
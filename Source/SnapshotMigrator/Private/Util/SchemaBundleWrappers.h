@@ -173,6 +173,9 @@ public:
 
 	const bool IsSameTypeAs(const SchemaBundleFieldDefinition& Other) const;
 
+	// Describes the field's type as it would be written in schema, e.g. "list<unreal.UnrealObjectRef>" or "map<Uint32, improbable.WorkerRequirementSet>".
+	FString GetTypeName() const;
+
 	static const FString WRITE_ACL_MAP;
 	static const FString COMPONENT_INTEREST_MAP;
 
@@ -186,8 +189,8 @@ private:
 	struct TypeInfo
 	{
 		SchemaPrimitiveType PrimitiveType = SchemaPrimitiveType::Invalid;
-		bool bIsEnum;
-		bool bIsType;
+		bool bIsEnum = false;
+		bool bIsType = false;
 
 		FString ResolvedType{};
 
@@ -310,8 +313,13 @@ public:
 
 	const SchemaBundleTypeDefinition& FindTypeChecked(const FString& Name) const;
 
+	const TArray<SchemaBundleComponentDefinition>& GetComponents() const;
+
 	static const bool GetCorrespondingComponentId(const SchemaBundleDefinitions& FromSchemaBundleDefinitions, const SchemaBundleDefinitions& ToSchemaBundleDefinitions, const uint32 FromComponentId, uint32& ToComponentId);
 
+	// Ids below this are reserved for improbable's standard library, which a schema bundle doesn't necessarily define.
+	static constexpr uint32 FIRST_NON_RESERVED_COMPONENT_ID = 100;
+
 private:
 	SchemaBundleSearchableContainer<SchemaBundleComponentDefinition> SchemaComponents;
 	// Types are only ever referenced by name, so a simple map suffices.
@@ -1,5 +1,13 @@
 #include "SnapshotHelperLibrary.h"
 
+#include "Dom/JsonValue.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeExit.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
 #include "Schema/Interest.h"
 #include "Schema/StandardLibrary.h"
 #include "Utils/SchemaUtils.h"
@@ -17,6 +25,276 @@ const worker::c::Worker_ComponentData* SnapshotHelperLibrary::GetComponentFromEn
 	return nullptr;
 }
 
+uint64 SnapshotHelperLibrary::GetSerializedComponentsSize(const Worker_ComponentData* Components, const uint32 ComponentCount)
+{
+	uint64 Size = 0;
+	for (uint32 i = 0; i < ComponentCount; i++)
+	{
+		Size += Schema_GetWriteBufferLength(Schema_GetComponentDataFields(Components[i].schema_type));
+	}
+
+	return Size;
+}
+
+uint32 SnapshotHelperLibrary::GetFieldValueCount(const Schema_Object* Object, const Schema_FieldId FieldId, const SchemaBundleFieldDefinition& Field, const SchemaBundleFieldDefinition::TypeIndex Index)
+{
+	using SchemaPrimitiveType = SchemaBundleFieldDefinition::SchemaPrimitiveType;
+
+	if (!Field.IsPrimitive(Index))
+	{
+		return Field.IsEnum(Index) ? Schema_GetEnumCount(Object, FieldId) : Schema_GetObjectCount(Object, FieldId);
+	}
+
+	switch (Field.GetPrimitiveType(Index))
+	{
+	case SchemaPrimitiveType::Int32:
+		return Schema_GetInt32Count(Object, FieldId);
+	case SchemaPrimitiveType::Int64:
+		return Schema_GetInt64Count(Object, FieldId);
+	case SchemaPrimitiveType::Uint32:
+		return Schema_GetUint32Count(Object, FieldId);
+	case SchemaPrimitiveType::Uint64:
+		return Schema_GetUint64Count(Object, FieldId);
+	case SchemaPrimitiveType::Sint32:
+		return Schema_GetSint32Count(Object, FieldId);
+	case SchemaPrimitiveType::Sint64:
+		return Schema_GetSint64Count(Object, FieldId);
+	case SchemaPrimitiveType::Fixed32:
+		return Schema_GetFixed32Count(Object, FieldId);
+	case SchemaPrimitiveType::Fixed64:
+		return Schema_GetFixed64Count(Object, FieldId);
+	case SchemaPrimitiveType::Sfixed32:
+		return Schema_GetSfixed32Count(Object, FieldId);
+	case SchemaPrimitiveType::Sfixed64:
+		return Schema_GetSfixed64Count(Object, FieldId);
+	case SchemaPrimitiveType::Bool:
+		return Schema_GetBoolCount(Object, FieldId);
+	case SchemaPrimitiveType::Float:
+		return Schema_GetFloatCount(Object, FieldId);
+	case SchemaPrimitiveType::Double:
+		return Schema_GetDoubleCount(Object, FieldId);
+	case SchemaPrimitiveType::String:
+	case SchemaPrimitiveType::Bytes:
+		return Schema_GetBytesCount(Object, FieldId);
+	case SchemaPrimitiveType::EntityId:
+		return Schema_GetEntityIdCount(Object, FieldId);
+	case SchemaPrimitiveType::Entity:
+		return Schema_GetObjectCount(Object, FieldId);
+	default:
+		checkNoEntry();
+		return 0;
+	}
+}
+
+bool SnapshotHelperLibrary::LoadJsonSchemaBundleAtPath(const FString& SchemaBundlePath, TSharedPtr<FJsonObject>& OutJsonObject)
+{
+	FString SchemaBundleJson{};
+	if (!FFileHelper::LoadFileToString(SchemaBundleJson, *SchemaBundlePath))
+	{
+		return false;
+	}
+
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(SchemaBundleJson);
+	return FJsonSerializer::Deserialize(Reader, OutJsonObject) && OutJsonObject.IsValid();
+}
+
+void SnapshotHelperLibrary::ComposeSchemaBundleChain(const TSharedPtr<FJsonObject>& SchemaBundleJson, const TArray<SchemaBundleDefinitions>& IntermediateDefinitions, TArray<PrunedSchemaField>* OutPrunedFields /* = nullptr */)
+{
+	// Fields correspond by name, so a field survives the chain as long as every bundle along it has a field of the same name and type in the same
+	// component or type, however its id changes.
+	const auto FilterSurvivingFields = [&IntermediateDefinitions, OutPrunedFields](const TArray<TSharedPtr<FJsonValue>>& FieldsJson, const FString& OwnerName, const bool bIsComponent, TFunctionRef<const SchemaBundleDefinitionWithFields*(const SchemaBundleDefinitions&)> FindOwner) {
+		return FieldsJson.FilterByPredicate([&IntermediateDefinitions, OutPrunedFields, &OwnerName, bIsComponent, &FindOwner](const TSharedPtr<FJsonValue>& FieldJson) {
+			const SchemaBundleFieldDefinition FieldDefinition{ FieldJson->AsObject() };
+			for (int32 i = 0; i < IntermediateDefinitions.Num(); i++)
+			{
+				const SchemaBundleDefinitionWithFields* Owner = FindOwner(IntermediateDefinitions[i]);
+				const SchemaBundleFieldDefinition* IntermediateFieldDefinition = Owner != nullptr ? Owner->FindField(FieldDefinition.GetName()) : nullptr;
+				if (IntermediateFieldDefinition == nullptr || !IntermediateFieldDefinition->IsSameTypeAs(FieldDefinition))
+				{
+					if (OutPrunedFields != nullptr)
+					{
+						OutPrunedFields->Add(PrunedSchemaField{ OwnerName, bIsComponent, FieldDefinition.GetName(), i, IntermediateFieldDefinition != nullptr });
+					}
+					return false;
+				}
+			}
+			return true;
+		});
+	};
+
+	TMap<FString, TSharedPtr<FJsonObject>> TypesByName;
+	for (const TSharedPtr<FJsonValue>& File : SchemaBundleJson->GetArrayField("schemaFiles"))
+	{
+		for (const TSharedPtr<FJsonValue>& Type : File->AsObject()->GetArrayField("types"))
+		{
+			TypesByName.Add(Type->AsObject()->GetStringField("qualifiedName"), Type->AsObject());
+		}
+	}
+
+	// Components are pruned first, since their fields may come from a type which is about to be pruned as a type in its own right.
+	for (const TSharedPtr<FJsonValue>& File : SchemaBundleJson->GetArrayField("schemaFiles"))
+	{
+		TArray<TSharedPtr<FJsonValue>> SurvivingComponents;
+		for (const TSharedPtr<FJsonValue>& Component : File->AsObject()->GetArrayField("components"))
+		{
+			TSharedPtr<FJsonObject> ComponentJson = Component->AsObject();
+			const FString ComponentName = ComponentJson->GetStringField("qualifiedName");
+
+			// A component missing from any bundle along the chain would have been dropped from every entity at that point.
+			if (IntermediateDefinitions.ContainsByPredicate([&ComponentName](const SchemaBundleDefinitions& Definitions) { return Definitions.FindComponent(ComponentName) == nullptr; }))
+			{
+				continue;
+			}
+
+			const FString DataDefinition = SchemaBundleComponentDefinition::ExtractDataDefinition(ComponentJson);
+			const TArray<TSharedPtr<FJsonValue>>& FieldsJson = DataDefinition.IsEmpty() ? ComponentJson->GetArrayField("fields") : TypesByName.FindChecked(DataDefinition)->GetArrayField("fields");
+
+			ComponentJson->SetArrayField("fields", FilterSurvivingFields(FieldsJson, ComponentName, true, [&ComponentName](const SchemaBundleDefinitions& Definitions) { return Definitions.FindComponent(ComponentName); }));
+			ComponentJson->SetStringField("dataDefinition", FString{});
+			SurvivingComponents.Add(Component);
+		}
+
+		File->AsObject()->SetArrayField("components", SurvivingComponents);
+	}
+
+	// Types are kept even if they're missing along the chain, but without any fields, since any field referring to them won't have survived either.
+	for (const TPair<FString, TSharedPtr<FJsonObject>>& Type : TypesByName)
+	{
+		const FString& TypeName = Type.Key;
+		Type.Value->SetArrayField("fields", FilterSurvivingFields(Type.Value->GetArrayField("fields"), TypeName, false, [&TypeName](const SchemaBundleDefinitions& Definitions) { return Definitions.FindType(TypeName); }));
+	}
+}
+
+bool SnapshotHelperLibrary::AppendBenchmarkRunToResultsFile(const FString& ResultsFilePath, const TSharedRef<FJsonObject>& RunJson)
+{
+	TSharedPtr<FJsonObject> ResultsJson;
+	FString ResultsString;
+	if (!FFileHelper::LoadFileToString(ResultsString, *ResultsFilePath) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(ResultsString), ResultsJson) || !ResultsJson.IsValid())
+	{
+		ResultsJson = MakeShareable(new FJsonObject);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> RunsJson;
+	const TArray<TSharedPtr<FJsonValue>>* ExistingRunsJson = nullptr;
+	if (ResultsJson->TryGetArrayField(TEXT("Runs"), ExistingRunsJson))
+	{
+		RunsJson = *ExistingRunsJson;
+	}
+
+	RunsJson.Add(MakeShareable(new FJsonValueObject(RunJson)));
+	ResultsJson->SetArrayField(FString{ TEXT("Runs") }, RunsJson);
+
+	FString OutputString;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&OutputString);
+	return FJsonSerializer::Serialize(ResultsJson.ToSharedRef(), Writer) && FFileHelper::SaveStringToFile(OutputString, *ResultsFilePath);
+}
+
+bool SnapshotHelperLibrary::ConcatenateSnapshots(const TArray<FString>& InputPaths, const FString& OutputPath)
+{
+	const Worker_ComponentVtable DefaultVtable{};
+	Worker_SnapshotParameters Parameters{};
+	Parameters.default_component_vtable = &DefaultVtable;
+
+	Worker_SnapshotOutputStream* OutputStream = Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*OutputPath), &Parameters);
+	ON_SCOPE_EXIT
+	{
+		Worker_SnapshotOutputStream_Destroy(OutputStream);
+	};
+
+	if (!IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString{ TEXT("initialise concatenated output stream") }))
+	{
+		return false;
+	}
+
+	for (const FString& InputPath : InputPaths)
+	{
+		Worker_SnapshotInputStream* InputStream = Worker_SnapshotInputStream_Create(TCHAR_TO_UTF8(*InputPath), &Parameters);
+		ON_SCOPE_EXIT
+		{
+			Worker_SnapshotInputStream_Destroy(InputStream);
+		};
+
+		if (!IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString::Printf(TEXT("open snapshot %s"), *InputPath)))
+		{
+			return false;
+		}
+
+		while (Worker_SnapshotInputStream_HasNext(InputStream))
+		{
+			const Worker_Entity* Entity = Worker_SnapshotInputStream_ReadEntity(InputStream);
+			if (!IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString::Printf(TEXT("read entity from snapshot %s"), *InputPath)))
+			{
+				return false;
+			}
+
+			Worker_SnapshotOutputStream_WriteEntity(OutputStream, Entity);
+			if (!IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString::Printf(TEXT("write entity with id %lld to concatenated snapshot"), Entity->entity_id)))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool SnapshotHelperLibrary::SplitSnapshot(const FString& SourcePath, const TArray<FString>& OutputPaths)
+{
+	const Worker_ComponentVtable DefaultVtable{};
+	Worker_SnapshotParameters Parameters{};
+	Parameters.default_component_vtable = &DefaultVtable;
+
+	Worker_SnapshotInputStream* InputStream = Worker_SnapshotInputStream_Create(TCHAR_TO_UTF8(*SourcePath), &Parameters);
+	ON_SCOPE_EXIT
+	{
+		Worker_SnapshotInputStream_Destroy(InputStream);
+	};
+
+	if (!IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString::Printf(TEXT("open snapshot %s"), *SourcePath)))
+	{
+		return false;
+	}
+
+	// The streams can't report their position, so the source is split using the serialized size of the entities read so far instead.
+	const double BytesPerOutput = FMath::Max<int64>(IFileManager::Get().FileSize(*SourcePath), 1) / static_cast<double>(OutputPaths.Num());
+	uint64 BytesRead = 0;
+
+	for (int32 OutputIndex = 0; OutputIndex < OutputPaths.Num(); OutputIndex++)
+	{
+		// Every output is written, even if it ends up empty, so that there's always one per path.
+		Worker_SnapshotOutputStream* OutputStream = Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*OutputPaths[OutputIndex]), &Parameters);
+		ON_SCOPE_EXIT
+		{
+			Worker_SnapshotOutputStream_Destroy(OutputStream);
+		};
+
+		if (!IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString::Printf(TEXT("open snapshot %s"), *OutputPaths[OutputIndex])))
+		{
+			return false;
+		}
+
+		const bool bIsLastOutput = OutputIndex == OutputPaths.Num() - 1;
+		while ((bIsLastOutput || BytesRead < BytesPerOutput * (OutputIndex + 1)) && Worker_SnapshotInputStream_HasNext(InputStream))
+		{
+			const Worker_Entity* Entity = Worker_SnapshotInputStream_ReadEntity(InputStream);
+			if (!IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString::Printf(TEXT("read entity from snapshot %s"), *SourcePath)))
+			{
+				return false;
+			}
+
+			BytesRead += GetSerializedComponentsSize(Entity->components, Entity->component_count);
+
+			Worker_SnapshotOutputStream_WriteEntity(OutputStream, Entity);
+			if (!IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString::Printf(TEXT("write entity with id %lld to snapshot %s"), Entity->entity_id, *OutputPaths[OutputIndex])))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 bool SnapshotDataMigrator::MigratePrimitiveField(const SchemaBundleFieldDefinition::SchemaPrimitiveType PrimitiveType, const Schema_FieldId OldId, const Schema_FieldId NewId, Schema_Object* OldSchemaObject, Schema_Object* NewSchemaObject)
 {
 	switch (PrimitiveType)
@@ -249,8 +527,49 @@ bool SnapshotDataMigrator::MigrateObjectField(const FString& ObjectType, const S
 	return false;
 }
 
+bool SnapshotDataMigrator::CanMigrateField(const SchemaBundleFieldDefinition& FieldDefinition) const
+{
+	using TypeIndex = SchemaBundleFieldDefinition::TypeIndex;
+	using SchemaPrimitiveType = SchemaBundleFieldDefinition::SchemaPrimitiveType;
+
+	if (FieldDefinition.IsMap())
+	{
+		return FieldDefinition.IsPrimitive(TypeIndex::KEY) && FieldDefinition.GetPrimitiveType(TypeIndex::KEY) == SchemaPrimitiveType::Uint32 && FieldDefinition.IsType(TypeIndex::VALUE) &&
+			(FieldDefinition.GetResolvedType(TypeIndex::VALUE).Equals(WORKER_REQUIREMENT_SET_TYPE) || FieldDefinition.GetResolvedType(TypeIndex::VALUE).Equals(FString{ TEXT("improbable.ComponentInterest") }));
+	}
+
+	if (FieldDefinition.IsPrimitive())
+	{
+		switch (FieldDefinition.GetPrimitiveType())
+		{
+		case SchemaPrimitiveType::Int32:
+		case SchemaPrimitiveType::Uint32:
+		case SchemaPrimitiveType::Bool:
+		case SchemaPrimitiveType::Float:
+		case SchemaPrimitiveType::String:
+		case SchemaPrimitiveType::Bytes:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Enums are passed to MigrateObjectField as well, but it has no kernel for any of them.
+	const FString& ObjectType = FieldDefinition.GetResolvedType();
+	return FieldDefinition.IsType() &&
+		(ObjectType == UNREAL_OBJECT_REF_TYPE || ObjectType == ROTATOR_TYPE || ObjectType == VECTOR_TYPE || ObjectType == COORDINATES_TYPE || ObjectType == WORKER_REQUIREMENT_SET_TYPE);
+}
+
 void SnapshotDataMigrator::PatchUnrealObjectRef(FUnrealObjectRef& UnrealObjectRef)
 {
+	// Cleared refs are dropped by MigrateObjectField's adder, the same as refs to components which no longer exist.
+	if (SurvivingEntities != nullptr && RefersToRemovedEntity(UnrealObjectRef))
+	{
+		UnrealObjectRef = FUnrealObjectRef::NULL_OBJECT_REF;
+		NumScrubbedReferences++;
+		return;
+	}
+
 	const Worker_ComponentId OldOffset = UnrealObjectRef.Offset;
 	if (OldOffset > SpatialConstants::INVALID_COMPONENT_ID)
 	{
@@ -271,12 +590,27 @@ void SnapshotDataMigrator::PatchUnrealObjectRef(FUnrealObjectRef& UnrealObjectRe
 	}
 }
 
+bool SnapshotDataMigrator::RefersToRemovedEntity(const FUnrealObjectRef& UnrealObjectRef) const
+{
+	// A subobject's ref can't be resolved without its outer's, so a ref dangles if any ref along its chain of outers does.
+	for (const FUnrealObjectRef* Ref = &UnrealObjectRef; Ref != nullptr; Ref = Ref->Outer ? &Ref->Outer.GetValue() : nullptr)
+	{
+		if (Ref->Entity != SpatialConstants::INVALID_ENTITY_ID && !SurvivingEntities->Contains(Ref->Entity))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void SnapshotDataMigrator::PatchWriteACLEntry(TPair<uint32, WorkerRequirementSet>& WriteACLEntry)
 {
 	Worker_ComponentId NewComponentId;
 	if (!SchemaBundleDefinitions::GetCorrespondingComponentId(OldDefinitions, NewDefinitions, WriteACLEntry.Key, NewComponentId))
 	{
-		WriteACLEntry.Key = NewComponentId;
+		// NewComponentId isn't set if there's no corresponding component; an invalid key makes sure the entry is dropped.
+		WriteACLEntry.Key = SpatialConstants::INVALID_COMPONENT_ID;
 		return;
 	}
 
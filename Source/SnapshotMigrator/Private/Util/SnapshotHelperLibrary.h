@@ -10,6 +10,7 @@
 #include "Schema/UnrealObjectRef.h"
 
 #include "SchemaBundleWrappers.h"
+#include "SnapshotMigrationEntityIndex.h"
 #include "SpatialCommonTypes.h"
 
 #include <functional>
@@ -17,6 +18,19 @@
 class SnapshotHelperLibrary
 {
 public:
+	// A field pruned from a schema bundle by ComposeSchemaBundleChain.
+	struct PrunedSchemaField
+	{
+		// Qualified name of the component or type the field belongs to.
+		FString OwnerName;
+		bool bIsComponentField;
+		FString FieldName;
+		// Index into the chain of the first bundle that the field didn't survive.
+		int32 ChainStep;
+		// True if that bundle has a field of the same name but a different type, rather than no such field.
+		bool bTypeChanged;
+	};
+
 	/**
 	* Checks to see if a given snapshot stream is still usable.
 	* Keeps us from having to repeat the contained boilerplate a) every time we want to check a Snapshot stream's status and b) for both input and output streams
@@ -40,10 +54,70 @@ public:
 	}
 
 	static const worker::c::Worker_ComponentData* GetComponentFromEntityById(const Worker_Entity* Entity, const Worker_ComponentId ComponentId);
+
+	/**
+	* Calculates how many bytes a set of components' data takes up once serialized, which is (close to) the space they take up in a snapshot.
+	*/
+	static uint64 GetSerializedComponentsSize(const Worker_ComponentData* Components, const uint32 ComponentCount);
+
+	/**
+	* Counts the values of a field, or of a map entry's key or value, using the schema accessor for the type the schema bundle gives the field. Values
+	* of any other type under the same field id aren't counted.
+	*	@param	Object		Object holding the field
+	*	@param	FieldId		Id of the field
+	*	@param	Field		Definition of the field
+	*	@param	Index		Which of the field's types to count; KEY and VALUE are only meaningful within a map entry
+	*
+	*	@return				Number of values
+	*/
+	static uint32 GetFieldValueCount(const Schema_Object* Object, const Schema_FieldId FieldId, const SchemaBundleFieldDefinition& Field, const SchemaBundleFieldDefinition::TypeIndex Index);
+
+	static bool LoadJsonSchemaBundleAtPath(const FString& SchemaBundlePath, TSharedPtr<FJsonObject>& OutJsonObject);
+
+	/**
+	* Prunes a schema bundle of the components and fields that wouldn't survive being migrated through each of a chain of schema bundles in turn, so
+	* that migrating directly from the pruned bundle to the end of the chain gives the same result as migrating through every bundle along it.
+	* Components' fields are written inline, since the data definition of a component may differ along the chain.
+	*	@param	SchemaBundleJson			Json of the bundle at the start of the chain, which is pruned in place
+	*	@param	IntermediateDefinitions		Bundles between the start and the end of the chain, in order
+	*	@param	OutPrunedFields				If given, the fields pruned from components which survive the chain and from types, and where along the chain
+	*										each was dropped
+	*/
+	static void ComposeSchemaBundleChain(const TSharedPtr<FJsonObject>& SchemaBundleJson, const TArray<SchemaBundleDefinitions>& IntermediateDefinitions, TArray<PrunedSchemaField>* OutPrunedFields = nullptr);
+
+	/**
+	* Copies the entities of several snapshots, in order, into a single snapshot.
+	*	@param	InputPaths		Snapshots to concatenate
+	*	@param	OutputPath		Path of the concatenated snapshot
+	*
+	*	@return					True if every snapshot was copied in full
+	*/
+	static bool ConcatenateSnapshots(const TArray<FString>& InputPaths, const FString& OutputPath);
+
+	/**
+	* Splits a snapshot into contiguous runs of entities of roughly equal size, such that concatenating the outputs in order gives back the source's entities.
+	*	@param	SourcePath		Snapshot to split
+	*	@param	OutputPaths		Path of each part; every path is written, even if there are fewer entities than parts
+	*
+	*	@return					True if the whole snapshot was split
+	*/
+	static bool SplitSnapshot(const FString& SourcePath, const TArray<FString>& OutputPaths);
+
+	/**
+	* Appends a benchmark run to the "Runs" array of a json results file, creating the file if it doesn't exist yet, so that runs can be compared over time.
+	*	@param	ResultsFilePath		Path to the results file
+	*	@param	RunJson				Results of the run
+	*
+	*	@return						True if the results file was written
+	*/
+	static bool AppendBenchmarkRunToResultsFile(const FString& ResultsFilePath, const TSharedRef<FJsonObject>& RunJson);
 };
 
 class SnapshotDataMigrator
 {
+	// Benchmarks the private kernels in isolation.
+	friend class SnapshotMigrationKernelBenchmark;
+
 public:
 	SnapshotDataMigrator(const SchemaBundleDefinitions& InOldDefinitions, const SchemaBundleDefinitions& InNewDefinitions)
 		: OldDefinitions(InOldDefinitions), NewDefinitions(InNewDefinitions)
@@ -53,10 +127,27 @@ public:
 
 	bool MigratePrimitiveField(const SchemaBundleFieldDefinition::SchemaPrimitiveType PrimitiveType, const Schema_FieldId OldId, const Schema_FieldId NewId, Schema_Object* OldSchemaObject, Schema_Object* NewSchemaObject);
 	bool MigrateObjectField(const FString& ObjectType, const Schema_FieldId OldId, const Schema_FieldId NewId, Schema_Object* OldSchemaObject, Schema_Object* NewSchemaObject);
+
+	/**
+	* Checks whether there's a kernel for a field's type, following the same choice of kernel as the migrator's CreateComponentMigration. Fields
+	* without one are never migrated, and are left at whatever value the new entity was created with.
+	*/
+	bool CanMigrateField(const SchemaBundleFieldDefinition& FieldDefinition) const;
+
+	/**
+	* Removes migrated object refs to any entity which isn't in the given index, rather than leaving them to dangle in the migrated snapshot.
+	*	@param	InSurvivingEntities		Entities which are written to the migrated snapshot, or null to keep every ref
+	*/
+	void SetSurvivingEntities(const SnapshotMigrationEntityIndex* InSurvivingEntities) { SurvivingEntities = InSurvivingEntities; }
+	// Number of object refs removed so far because the entity they refer to isn't migrated.
+	uint32 GetNumScrubbedReferences() const { return NumScrubbedReferences; }
 private:
 	const SchemaBundleDefinitions& OldDefinitions;
 	const SchemaBundleDefinitions& NewDefinitions;
 
+	const SnapshotMigrationEntityIndex* SurvivingEntities = nullptr;
+	uint32 NumScrubbedReferences = 0;
+
 	const FString COORDINATES_TYPE{ TEXT("improbable.Coordinates") };
 	const FString WORKER_REQUIREMENT_SET_TYPE{ TEXT("improbable.WorkerRequirementSet") };
 	const FString VECTOR_TYPE{ TEXT("unreal.Rotator") };
@@ -122,5 +213,6 @@ private:
 
 private:
 	void PatchUnrealObjectRef(FUnrealObjectRef& UnrealObjectRef);
+	bool RefersToRemovedEntity(const FUnrealObjectRef& UnrealObjectRef) const;
 	void PatchWriteACLEntry(TPair<uint32, WorkerRequirementSet>& WriteACLEntry);
 };
@@ -0,0 +1,130 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationAllocationCounter.h"
+
+namespace
+{
+	// Plain thread locals rather than a TLS slot, since they have to be usable from inside the allocator before and after any TLS is set up.
+	thread_local int64 ThreadNumAllocations = 0;
+	thread_local int64 ThreadNumBytesAllocated = 0;
+}
+
+SnapshotMigrationAllocationCounter::SnapshotMigrationAllocationCounter(FMalloc* InInnerMalloc)
+	: InnerMalloc(InInnerMalloc)
+{
+}
+
+SnapshotMigrationAllocationCounter& SnapshotMigrationAllocationCounter::Get()
+{
+	// Constructed in static storage and deliberately never destroyed, so that it outlives every thread which might still call into it.
+	static TTypeCompatibleBytes<SnapshotMigrationAllocationCounter> Storage;
+	static SnapshotMigrationAllocationCounter* const Counter = [] {
+		check(GMalloc != nullptr);
+		SnapshotMigrationAllocationCounter* NewCounter = new (Storage.GetTypedPtr()) SnapshotMigrationAllocationCounter(GMalloc);
+
+		// Threads which read GMalloc before the exchange carry on using the inner allocator, which can free anything the counter allocates.
+		FPlatformAtomics::InterlockedExchangePtr(reinterpret_cast<void**>(&GMalloc), NewCounter);
+		return NewCounter;
+	}();
+
+	return *Counter;
+}
+
+int64 SnapshotMigrationAllocationCounter::GetNumThreadAllocations()
+{
+	return ThreadNumAllocations;
+}
+
+int64 SnapshotMigrationAllocationCounter::GetNumThreadBytesAllocated()
+{
+	return ThreadNumBytesAllocated;
+}
+
+void* SnapshotMigrationAllocationCounter::Malloc(SIZE_T Count, uint32 Alignment)
+{
+	NumAllocations.Increment();
+	NumBytesAllocated.Add(Count);
+	ThreadNumAllocations++;
+	ThreadNumBytesAllocated += Count;
+	return InnerMalloc->Malloc(Count, Alignment);
+}
+
+void* SnapshotMigrationAllocationCounter::Realloc(void* Original, SIZE_T Count, uint32 Alignment)
+{
+	// Shrinking or freeing through Realloc doesn't need any new memory, so only growth is counted.
+	SIZE_T OriginalSize = 0;
+	if (Count > 0 && (Original == nullptr || !InnerMalloc->GetAllocationSize(Original, OriginalSize) || Count > OriginalSize))
+	{
+		NumAllocations.Increment();
+		NumBytesAllocated.Add(Count - OriginalSize);
+		ThreadNumAllocations++;
+		ThreadNumBytesAllocated += Count - OriginalSize;
+	}
+
+	return InnerMalloc->Realloc(Original, Count, Alignment);
+}
+
+void SnapshotMigrationAllocationCounter::Free(void* Original)
+{
+	InnerMalloc->Free(Original);
+}
+
+SIZE_T SnapshotMigrationAllocationCounter::QuantizeSize(SIZE_T Count, uint32 Alignment)
+{
+	return InnerMalloc->QuantizeSize(Count, Alignment);
+}
+
+bool SnapshotMigrationAllocationCounter::GetAllocationSize(void* Original, SIZE_T& SizeOut)
+{
+	return InnerMalloc->GetAllocationSize(Original, SizeOut);
+}
+
+void SnapshotMigrationAllocationCounter::Trim(bool bTrimThreadCaches)
+{
+	InnerMalloc->Trim(bTrimThreadCaches);
+}
+
+void SnapshotMigrationAllocationCounter::SetupTLSCachesOnCurrentThread()
+{
+	InnerMalloc->SetupTLSCachesOnCurrentThread();
+}
+
+void SnapshotMigrationAllocationCounter::ClearAndDisableTLSCachesOnCurrentThread()
+{
+	InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread();
+}
+
+void SnapshotMigrationAllocationCounter::InitializeStatsMetadata()
+{
+	InnerMalloc->InitializeStatsMetadata();
+}
+
+void SnapshotMigrationAllocationCounter::UpdateStats()
+{
+	InnerMalloc->UpdateStats();
+}
+
+void SnapshotMigrationAllocationCounter::GetAllocatorStats(FGenericMemoryStats& OutStats)
+{
+	InnerMalloc->GetAllocatorStats(OutStats);
+}
+
+void SnapshotMigrationAllocationCounter::DumpAllocatorStats(FOutputDevice& Ar)
+{
+	InnerMalloc->DumpAllocatorStats(Ar);
+}
+
+bool SnapshotMigrationAllocationCounter::IsInternallyThreadSafe() const
+{
+	return InnerMalloc->IsInternallyThreadSafe();
+}
+
+bool SnapshotMigrationAllocationCounter::ValidateHeap()
+{
+	return InnerMalloc->ValidateHeap();
+}
+
+const TCHAR* SnapshotMigrationAllocationCounter::GetDescriptiveName()
+{
+	return TEXT("SnapshotMigrationAllocationCounter");
+}
@@ -0,0 +1,55 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Templates/TypeCompatibleBytes.h"
+
+/**
+* Allocator which forwards everything to the allocator it replaces, counting allocations on the way. Callers measure a stretch of work by the
+* difference between the counts before and after it. The process wide counts include allocations made by any other thread, such as the editor's
+* background tasks; the thread counts only include the calling thread's own, so they're the ones to use for work which runs on a single thread.
+*
+* Once installed, the counter is never removed and never destroyed, since any thread may have just read GMalloc and be about to call into it.
+*/
+class SnapshotMigrationAllocationCounter : public FMalloc
+{
+public:
+	// Wraps GMalloc in the counter the first time it's called, and returns the same counter from then on.
+	static SnapshotMigrationAllocationCounter& Get();
+
+	int64 GetNumAllocations() const { return NumAllocations.GetValue(); }
+	int64 GetNumBytesAllocated() const { return NumBytesAllocated.GetValue(); }
+
+	// Allocations made through the counter by the calling thread only.
+	static int64 GetNumThreadAllocations();
+	static int64 GetNumThreadBytesAllocated();
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override;
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override;
+	virtual void Free(void* Original) override;
+
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override;
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override;
+	virtual void Trim(bool bTrimThreadCaches) override;
+	virtual void SetupTLSCachesOnCurrentThread() override;
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override;
+	virtual void InitializeStatsMetadata() override;
+	virtual void UpdateStats() override;
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override;
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override;
+	virtual bool IsInternallyThreadSafe() const override;
+	virtual bool ValidateHeap() override;
+	virtual const TCHAR* GetDescriptiveName() override;
+
+private:
+	explicit SnapshotMigrationAllocationCounter(FMalloc* InInnerMalloc);
+
+	// Memory allocated before the counter was installed is freed through it, so it forwards to the same allocator for the rest of the process.
+	FMalloc* const InnerMalloc;
+
+	FThreadSafeCounter64 NumAllocations;
+	FThreadSafeCounter64 NumBytesAllocated;
+};
@@ -0,0 +1,330 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationCache.h"
+
+#include "Hash/CityHash.h"
+
+#include "SpatialConstants.h"
+
+SnapshotMigrationCache::~SnapshotMigrationCache()
+{
+	Reset();
+}
+
+SnapshotMigrationCache::Key SnapshotMigrationCache::MakeKey(const FString& ClassPath, const Worker_Entity* Entity) const
+{
+	Key CacheKey;
+	CacheKey.ClassPath = ClassPath;
+
+	for (uint32 i = 0; i < Entity->component_count; i++)
+	{
+		const Worker_ComponentData& Component = Entity->components[i];
+
+		// Only components which refer to the entity itself are copied, to replace those references before serializing.
+		Schema_ComponentData* SelfReferencingData = nullptr;
+		const SchemaBundleComponentDefinition* ComponentDefinition = OldDefinitions.FindComponent(Component.component_id);
+		if (ComponentDefinition != nullptr && CanHoldEntityIds(*ComponentDefinition))
+		{
+			SelfReferencingData = Schema_CopyComponentData(Component.schema_type);
+			if (!ReplaceEntityId(Schema_GetComponentDataFields(SelfReferencingData), *ComponentDefinition, OldDefinitions, Entity->entity_id, SELF_ENTITY_ID, 0))
+			{
+				Schema_DestroyComponentData(SelfReferencingData);
+				SelfReferencingData = nullptr;
+			}
+		}
+
+		const Schema_Object* Fields = Schema_GetComponentDataFields(SelfReferencingData != nullptr ? SelfReferencingData : Component.schema_type);
+		const uint32 Length = Schema_GetWriteBufferLength(Fields);
+
+		// Prefix each component's data with its id and length so that differently split payloads can't produce the same key.
+		const int32 Offset = CacheKey.Payload.AddUninitialized(sizeof(Worker_ComponentId) + sizeof(uint32) + Length);
+		FMemory::Memcpy(&CacheKey.Payload[Offset], &Component.component_id, sizeof(Worker_ComponentId));
+		FMemory::Memcpy(&CacheKey.Payload[Offset + sizeof(Worker_ComponentId)], &Length, sizeof(uint32));
+		Schema_SerializeToBuffer(Fields, &CacheKey.Payload[Offset + sizeof(Worker_ComponentId) + sizeof(uint32)], Length);
+
+		if (SelfReferencingData != nullptr)
+		{
+			Schema_DestroyComponentData(SelfReferencingData);
+		}
+	}
+
+	CacheKey.Hash = CityHash64WithSeed(reinterpret_cast<const char*>(CacheKey.Payload.GetData()), CacheKey.Payload.Num(), GetTypeHash(ClassPath));
+
+	return CacheKey;
+}
+
+bool SnapshotMigrationCache::ShouldLookUp(const FString& ClassPath) const
+{
+	const ClassLookups* Lookups = LookupsByClass.Find(ClassPath);
+	return Lookups == nullptr || Lookups->NumHits > 0 || Lookups->NumLookups < MAX_LOOKUPS_WITHOUT_HIT;
+}
+
+const SnapshotMigrationCache::Entry* SnapshotMigrationCache::Find(const Key& CacheKey)
+{
+	ClassLookups& Lookups = LookupsByClass.FindOrAdd(CacheKey.ClassPath);
+	Lookups.NumLookups++;
+
+	if (const TArray<int32>* Bucket = SlotIndicesByHash.Find(CacheKey.Hash))
+	{
+		// Compare the full payload as well as the hash; a collision here would silently write the wrong data into the snapshot.
+		for (const int32 SlotIndex : *Bucket)
+		{
+			const Entry& CachedEntry = Slots[SlotIndex].CachedEntry;
+			if (CachedEntry.CacheKey.ClassPath == CacheKey.ClassPath && CachedEntry.CacheKey.Payload == CacheKey.Payload)
+			{
+				Lookups.NumHits++;
+				Unlink(SlotIndex);
+				LinkAsMostRecent(SlotIndex);
+				return &CachedEntry;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+void SnapshotMigrationCache::Add(Key&& CacheKey, const Worker_EntityId SourceEntityId, const TArray<Worker_ComponentData>& Components, const TArray<SkippedComponentFieldInfo>& SkippedComponentFields,
+	const uint64 CompactedBytes, const uint32 NumClearedFields)
+{
+	if (MaxEntries <= 0)
+	{
+		return;
+	}
+
+	int32 SlotIndex = LeastRecentlyUsed;
+	if (Slots.Num() < MaxEntries)
+	{
+		SlotIndex = Slots.AddDefaulted();
+	}
+	else
+	{
+		Evict(SlotIndex);
+	}
+
+	SlotIndicesByHash.FindOrAdd(CacheKey.Hash).Add(SlotIndex);
+
+	Entry& CachedEntry = Slots[SlotIndex].CachedEntry;
+	CachedEntry.CacheKey = MoveTemp(CacheKey);
+	CachedEntry.SkippedComponentFields = SkippedComponentFields;
+	CachedEntry.CompactedBytes = CompactedBytes;
+	CachedEntry.NumClearedFields = NumClearedFields;
+
+	CachedEntry.Components.Reserve(Components.Num());
+	for (const Worker_ComponentData& Component : Components)
+	{
+		Worker_ComponentData Copy = Component;
+		Copy.schema_type = Schema_CopyComponentData(Component.schema_type);
+		if (const SchemaBundleComponentDefinition* ComponentDefinition = NewDefinitions.FindComponent(Copy.component_id))
+		{
+			ReplaceEntityId(Schema_GetComponentDataFields(Copy.schema_type), *ComponentDefinition, NewDefinitions, SourceEntityId, SELF_ENTITY_ID, 0);
+		}
+		CachedEntry.Components.Add(Copy);
+	}
+
+	LinkAsMostRecent(SlotIndex);
+}
+
+TArray<Worker_ComponentData> SnapshotMigrationCache::Instantiate(const Entry& CachedEntry, const Worker_EntityId EntityId) const
+{
+	TArray<Worker_ComponentData> Components;
+	Components.Reserve(CachedEntry.Components.Num());
+
+	for (const Worker_ComponentData& CachedComponent : CachedEntry.Components)
+	{
+		Worker_ComponentData Component = CachedComponent;
+		Component.schema_type = Schema_CopyComponentData(CachedComponent.schema_type);
+
+		if (const SchemaBundleComponentDefinition* ComponentDefinition = NewDefinitions.FindComponent(Component.component_id))
+		{
+			ReplaceEntityId(Schema_GetComponentDataFields(Component.schema_type), *ComponentDefinition, NewDefinitions, SELF_ENTITY_ID, EntityId, 0);
+		}
+
+		Components.Add(Component);
+	}
+
+	return Components;
+}
+
+void SnapshotMigrationCache::Reset()
+{
+	for (Slot& CachedSlot : Slots)
+	{
+		for (Worker_ComponentData& Component : CachedSlot.CachedEntry.Components)
+		{
+			Schema_DestroyComponentData(Component.schema_type);
+		}
+	}
+
+	Slots.Empty();
+	SlotIndicesByHash.Empty();
+	MostRecentlyUsed = INDEX_NONE;
+	LeastRecentlyUsed = INDEX_NONE;
+	LookupsByClass.Empty();
+}
+
+void SnapshotMigrationCache::Unlink(const int32 SlotIndex)
+{
+	Slot& CachedSlot = Slots[SlotIndex];
+	if (CachedSlot.MoreRecent != INDEX_NONE)
+	{
+		Slots[CachedSlot.MoreRecent].LessRecent = CachedSlot.LessRecent;
+	}
+	else
+	{
+		MostRecentlyUsed = CachedSlot.LessRecent;
+	}
+
+	if (CachedSlot.LessRecent != INDEX_NONE)
+	{
+		Slots[CachedSlot.LessRecent].MoreRecent = CachedSlot.MoreRecent;
+	}
+	else
+	{
+		LeastRecentlyUsed = CachedSlot.MoreRecent;
+	}
+
+	CachedSlot.MoreRecent = INDEX_NONE;
+	CachedSlot.LessRecent = INDEX_NONE;
+}
+
+void SnapshotMigrationCache::LinkAsMostRecent(const int32 SlotIndex)
+{
+	Slot& CachedSlot = Slots[SlotIndex];
+	CachedSlot.LessRecent = MostRecentlyUsed;
+	if (MostRecentlyUsed != INDEX_NONE)
+	{
+		Slots[MostRecentlyUsed].MoreRecent = SlotIndex;
+	}
+	else
+	{
+		LeastRecentlyUsed = SlotIndex;
+	}
+
+	MostRecentlyUsed = SlotIndex;
+}
+
+void SnapshotMigrationCache::Evict(const int32 SlotIndex)
+{
+	Unlink(SlotIndex);
+
+	Entry& CachedEntry = Slots[SlotIndex].CachedEntry;
+	TArray<int32>& Bucket = SlotIndicesByHash.FindChecked(CachedEntry.CacheKey.Hash);
+	Bucket.RemoveSingleSwap(SlotIndex);
+	if (Bucket.Num() == 0)
+	{
+		SlotIndicesByHash.Remove(CachedEntry.CacheKey.Hash);
+	}
+
+	for (Worker_ComponentData& Component : CachedEntry.Components)
+	{
+		Schema_DestroyComponentData(Component.schema_type);
+	}
+	CachedEntry = Entry{};
+}
+
+bool SnapshotMigrationCache::ReplaceEntityId(Schema_Object* Object, const SchemaBundleDefinitionWithFields& Definition, const SchemaBundleDefinitions& Definitions, const Worker_EntityId FromEntityId, const Worker_EntityId ToEntityId, const int32 Depth) const
+{
+	bool bReplaced = false;
+
+	for (const SchemaBundleFieldDefinition& Field : Definition.GetFields())
+	{
+		if (!Field.IsMap())
+		{
+			bReplaced |= ReplaceEntityIdValues(Object, Field.GetId(), Field, SchemaBundleFieldDefinition::TypeIndex::INNER, Definitions, FromEntityId, ToEntityId, Depth);
+			continue;
+		}
+
+		const uint32 NumEntries = Schema_GetObjectCount(Object, Field.GetId());
+		for (uint32 i = 0; i < NumEntries; i++)
+		{
+			Schema_Object* Entry = Schema_IndexObject(Object, Field.GetId(), i);
+			bReplaced |= ReplaceEntityIdValues(Entry, SCHEMA_MAP_KEY_FIELD_ID, Field, SchemaBundleFieldDefinition::TypeIndex::KEY, Definitions, FromEntityId, ToEntityId, Depth);
+			bReplaced |= ReplaceEntityIdValues(Entry, SCHEMA_MAP_VALUE_FIELD_ID, Field, SchemaBundleFieldDefinition::TypeIndex::VALUE, Definitions, FromEntityId, ToEntityId, Depth);
+		}
+	}
+
+	return bReplaced;
+}
+
+bool SnapshotMigrationCache::ReplaceEntityIdValues(Schema_Object* Object, const Schema_FieldId FieldId, const SchemaBundleFieldDefinition& Field, const SchemaBundleFieldDefinition::TypeIndex Index, const SchemaBundleDefinitions& Definitions, const Worker_EntityId FromEntityId, const Worker_EntityId ToEntityId, const int32 Depth) const
+{
+	if (Field.GetPrimitiveType(Index) == SchemaBundleFieldDefinition::SchemaPrimitiveType::EntityId)
+	{
+		const uint32 Count = Schema_GetEntityIdCount(Object, FieldId);
+		if (Count == 0)
+		{
+			return false;
+		}
+
+		TArray<Worker_EntityId> EntityIds;
+		EntityIds.SetNumUninitialized(Count);
+		Schema_GetEntityIdList(Object, FieldId, EntityIds.GetData());
+		if (!EntityIds.Contains(FromEntityId))
+		{
+			return false;
+		}
+
+		// Values can't be replaced in place, so the whole field is written again.
+		for (Worker_EntityId& EntityId : EntityIds)
+		{
+			EntityId = EntityId == FromEntityId ? ToEntityId : EntityId;
+		}
+		Schema_ClearField(Object, FieldId);
+		Schema_AddEntityIdList(Object, FieldId, EntityIds.GetData(), Count);
+		return true;
+	}
+
+	if (!Field.IsType(Index) || Depth >= MAX_OBJECT_DEPTH)
+	{
+		return false;
+	}
+
+	const bool bIsObjectRef = Field.IsUnrealObjectRefType(Index);
+	const SchemaBundleTypeDefinition* Type = bIsObjectRef ? nullptr : Definitions.FindType(Field.GetResolvedType(Index));
+	if (!bIsObjectRef && Type == nullptr)
+	{
+		return false;
+	}
+
+	bool bReplaced = false;
+
+	const uint32 Count = Schema_GetObjectCount(Object, FieldId);
+	for (uint32 i = 0; i < Count; i++)
+	{
+		Schema_Object* Value = Schema_IndexObject(Object, FieldId, i);
+		bReplaced |= bIsObjectRef ? ReplaceObjectRefEntityId(Value, FromEntityId, ToEntityId, Depth + 1) : ReplaceEntityId(Value, *Type, Definitions, FromEntityId, ToEntityId, Depth + 1);
+	}
+
+	return bReplaced;
+}
+
+bool SnapshotMigrationCache::ReplaceObjectRefEntityId(Schema_Object* UnrealObjectRefObject, const Worker_EntityId FromEntityId, const Worker_EntityId ToEntityId, const int32 Depth) const
+{
+	bool bReplaced = false;
+
+	if (Schema_GetEntityIdCount(UnrealObjectRefObject, SpatialConstants::UNREAL_OBJECT_REF_ENTITY_ID) > 0 &&
+		Schema_GetEntityId(UnrealObjectRefObject, SpatialConstants::UNREAL_OBJECT_REF_ENTITY_ID) == FromEntityId)
+	{
+		Schema_ClearField(UnrealObjectRefObject, SpatialConstants::UNREAL_OBJECT_REF_ENTITY_ID);
+		Schema_AddEntityId(UnrealObjectRefObject, SpatialConstants::UNREAL_OBJECT_REF_ENTITY_ID, ToEntityId);
+		bReplaced = true;
+	}
+
+	if (Depth < MAX_OBJECT_DEPTH && Schema_GetObjectCount(UnrealObjectRefObject, SpatialConstants::UNREAL_OBJECT_REF_OUTER_ID) > 0)
+	{
+		bReplaced |= ReplaceObjectRefEntityId(Schema_GetObject(UnrealObjectRefObject, SpatialConstants::UNREAL_OBJECT_REF_OUTER_ID), FromEntityId, ToEntityId, Depth + 1);
+	}
+
+	return bReplaced;
+}
+
+bool SnapshotMigrationCache::CanHoldEntityIds(const SchemaBundleComponentDefinition& Definition)
+{
+	const auto CanHoldEntityId = [](const SchemaBundleFieldDefinition& Field, const SchemaBundleFieldDefinition::TypeIndex Index) {
+		return Field.IsType(Index) || Field.GetPrimitiveType(Index) == SchemaBundleFieldDefinition::SchemaPrimitiveType::EntityId;
+	};
+
+	return Definition.GetFields().ContainsByPredicate([&CanHoldEntityId](const SchemaBundleFieldDefinition& Field) {
+		return Field.IsMap() ? CanHoldEntityId(Field, SchemaBundleFieldDefinition::TypeIndex::KEY) || CanHoldEntityId(Field, SchemaBundleFieldDefinition::TypeIndex::VALUE) : CanHoldEntityId(Field, SchemaBundleFieldDefinition::TypeIndex::INNER);
+	});
+}
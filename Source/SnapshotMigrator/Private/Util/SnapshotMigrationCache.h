@@ -0,0 +1,137 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <WorkerSDK/improbable/c_schema.h>
+#include <WorkerSDK/improbable/c_worker.h>
+
+#include "SchemaBundleWrappers.h"
+#include "SnapshotMigrationReporter.h"
+
+/**
+* Caches the result of migrating an entity, keyed by the entity's class path and the serialized contents of its components.
+* Entities which are byte-identical apart from their entity id can then reuse a previous migration instead of spawning and replicating an actor again.
+* References an entity makes to itself are replaced with SELF_ENTITY_ID in both the key and the cached components, so that they can be told apart
+* from references to other entities, and patched to the entity's own id when the migration is reused.
+*
+* Once the cache is full, the least recently used entry makes way for each new one. Classes whose entities are never duplicates stop being looked
+* up after MAX_LOOKUPS_WITHOUT_HIT misses, so that they don't pay for building keys which never hit.
+*/
+class SnapshotMigrationCache
+{
+public:
+	struct Key
+	{
+		FString ClassPath;
+		uint64 Hash = 0;
+		TArray<uint8> Payload;
+	};
+
+	struct Entry
+	{
+		Key CacheKey;
+		TArray<Worker_ComponentData> Components;
+		TArray<SkippedComponentFieldInfo> SkippedComponentFields;
+		// What clearing default component data saved on the cached entity, which the cached components already have cleared.
+		uint64 CompactedBytes = 0;
+		uint32 NumClearedFields = 0;
+	};
+
+	SnapshotMigrationCache(const SchemaBundleDefinitions& InOldDefinitions, const SchemaBundleDefinitions& InNewDefinitions, const int32 InMaxEntries)
+		: OldDefinitions(InOldDefinitions), NewDefinitions(InNewDefinitions), MaxEntries(InMaxEntries)
+	{
+	}
+
+	~SnapshotMigrationCache();
+
+	SnapshotMigrationCache(const SnapshotMigrationCache&) = delete;
+	SnapshotMigrationCache& operator=(const SnapshotMigrationCache&) = delete;
+
+	/**
+	* Builds the cache key for an entity from its class path and the serialized data of each of its components, with its references to itself
+	* replaced by SELF_ENTITY_ID.
+	*	@param	ClassPath	Classpath of the actor the entity represents
+	*	@param	Entity		Entity as read from the source snapshot
+	*
+	*	@return				Key that can be passed to Find and Add
+	*/
+	Key MakeKey(const FString& ClassPath, const Worker_Entity* Entity) const;
+
+	// Whether entities of a class are still worth building keys for and looking up, i.e. the class has hit before or hasn't missed too often yet.
+	bool ShouldLookUp(const FString& ClassPath) const;
+
+	// Finds the entry for a key, marking it as the most recently used. Every call counts towards its class' lookups for ShouldLookUp.
+	const Entry* Find(const Key& CacheKey);
+
+	/**
+	* Stores a copy of an entity's migrated components, with its references to itself replaced by SELF_ENTITY_ID. If the cache already holds
+	* MaxEntries entries, the least recently used one is evicted to make room.
+	*	@param	CompactedBytes		Bytes saved by clearing default data from the migrated components, to be recorded again for each reuse
+	*	@param	NumClearedFields	Fields cleared from the migrated components as default data
+	*/
+	void Add(Key&& CacheKey, const Worker_EntityId SourceEntityId, const TArray<Worker_ComponentData>& Components, const TArray<SkippedComponentFieldInfo>& SkippedComponentFields,
+		const uint64 CompactedBytes, const uint32 NumClearedFields);
+
+	/**
+	* Copies a cached migration for a different entity. Entity ids that were references to the cached entity itself, whether in UnrealObjectRefs,
+	* EntityId fields or nested within other types, are patched to refer to the new entity instead.
+	*/
+	TArray<Worker_ComponentData> Instantiate(const Entry& CachedEntry, const Worker_EntityId EntityId) const;
+
+	void Reset();
+
+	static const int32 DEFAULT_MAX_ENTRIES = 16384;
+
+	// Lookups a class can miss on before it stops being looked up, unless one of them hit.
+	static const int32 MAX_LOOKUPS_WITHOUT_HIT = 256;
+
+	// Stands in for an entity's own id; no real entity can have it, as entity ids are positive.
+	static constexpr Worker_EntityId SELF_ENTITY_ID = MIN_int64;
+
+private:
+	struct Slot
+	{
+		Entry CachedEntry;
+		// Neighbouring slots in the recency list, which runs from the most recently used entry to the least.
+		int32 MoreRecent = INDEX_NONE;
+		int32 LessRecent = INDEX_NONE;
+	};
+
+	struct ClassLookups
+	{
+		int32 NumLookups = 0;
+		int32 NumHits = 0;
+	};
+
+	void Unlink(const int32 SlotIndex);
+	void LinkAsMostRecent(const int32 SlotIndex);
+	void Evict(const int32 SlotIndex);
+
+	/**
+	* Replaces one entity id with another throughout an object, recursing into nested types, lists and maps.
+	*
+	*	@return		True if any entity id was replaced
+	*/
+	bool ReplaceEntityId(Schema_Object* Object, const SchemaBundleDefinitionWithFields& Definition, const SchemaBundleDefinitions& Definitions, const Worker_EntityId FromEntityId, const Worker_EntityId ToEntityId, const int32 Depth) const;
+	bool ReplaceEntityIdValues(Schema_Object* Object, const Schema_FieldId FieldId, const SchemaBundleFieldDefinition& Field, const SchemaBundleFieldDefinition::TypeIndex Index, const SchemaBundleDefinitions& Definitions, const Worker_EntityId FromEntityId, const Worker_EntityId ToEntityId, const int32 Depth) const;
+	bool ReplaceObjectRefEntityId(Schema_Object* UnrealObjectRefObject, const Worker_EntityId FromEntityId, const Worker_EntityId ToEntityId, const int32 Depth) const;
+
+	// Whether any of a component's fields could hold an entity id, so that components which can't are keyed without being copied first.
+	static bool CanHoldEntityIds(const SchemaBundleComponentDefinition& Definition);
+
+	static constexpr int32 MAX_OBJECT_DEPTH = 32;
+
+	const SchemaBundleDefinitions& OldDefinitions;
+	const SchemaBundleDefinitions& NewDefinitions;
+	const int32 MaxEntries;
+
+	// Entries live in slots which are reused once full, so their indices stay valid for the recency list and the hash buckets.
+	TArray<Slot> Slots;
+	TMap<uint64, TArray<int32>> SlotIndicesByHash;
+	int32 MostRecentlyUsed = INDEX_NONE;
+	int32 LeastRecentlyUsed = INDEX_NONE;
+
+	TMap<FString, ClassLookups> LookupsByClass;
+};
@@ -0,0 +1,113 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationCheckpoint.h"
+
+#include "Dom/JsonValue.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+bool SnapshotMigrationCheckpoint::Save(const FString& CheckpointPath) const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetNumberField(FString{ TEXT("Version") }, VERSION);
+	Json->SetStringField(FString{ TEXT("InputsHash") }, InputsHash);
+	// Json numbers are doubles, which can't hold every uint64.
+	Json->SetStringField(FString{ TEXT("NumProcessedEntities") }, LexToString(NumProcessedEntities));
+
+	TArray<TSharedPtr<FJsonValue>> SegmentPathsJson;
+	for (const FString& SegmentPath : SegmentPaths)
+	{
+		SegmentPathsJson.Add(MakeShareable(new FJsonValueString(SegmentPath)));
+	}
+	Json->SetArrayField(FString{ TEXT("SegmentPaths") }, SegmentPathsJson);
+
+	Json->SetObjectField(FString{ TEXT("MigrationData") }, MigrationData.ToJson());
+
+	FString OutputString;
+
+	using CharType = TCHAR;
+	using Policy = TCondensedJsonPrintPolicy<CharType>;
+
+	TSharedRef<TJsonWriter<CharType, Policy>> Writer = TJsonWriterFactory<CharType, Policy>::Create(&OutputString);
+	if (!FJsonSerializer::Serialize(Json, Writer))
+	{
+		return false;
+	}
+
+	// Write the new checkpoint alongside the old one and then replace it, so that being killed part way through a save leaves the old checkpoint intact.
+	const FString& TmpCheckpointPath = FString::Printf(TEXT("%s.tmp"), *CheckpointPath);
+	return FFileHelper::SaveStringToFile(OutputString, *TmpCheckpointPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM) &&
+		   IFileManager::Get().Move(*CheckpointPath, *TmpCheckpointPath, true, true);
+}
+
+bool SnapshotMigrationCheckpoint::Load(const FString& CheckpointPath, SnapshotMigrationCheckpoint& OutCheckpoint)
+{
+	FString CheckpointJson;
+	if (!FFileHelper::LoadFileToString(CheckpointJson, *CheckpointPath))
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Json;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(CheckpointJson);
+	if (!FJsonSerializer::Deserialize(Reader, Json) || !Json.IsValid())
+	{
+		return false;
+	}
+
+	int32 Version = 0;
+	if (!Json->TryGetNumberField(FString{ TEXT("Version") }, Version) || Version != VERSION)
+	{
+		return false;
+	}
+
+	FString NumProcessedEntities;
+	const TArray<TSharedPtr<FJsonValue>>* SegmentPathsJson = nullptr;
+	const TSharedPtr<FJsonObject>* MigrationDataJson = nullptr;
+
+	if (!Json->TryGetStringField(FString{ TEXT("InputsHash") }, OutCheckpoint.InputsHash) ||
+		!Json->TryGetStringField(FString{ TEXT("NumProcessedEntities") }, NumProcessedEntities) ||
+		!Json->TryGetArrayField(FString{ TEXT("SegmentPaths") }, SegmentPathsJson) ||
+		!Json->TryGetObjectField(FString{ TEXT("MigrationData") }, MigrationDataJson) ||
+		!SnapshotMigrationData::FromJson(*MigrationDataJson, OutCheckpoint.MigrationData))
+	{
+		return false;
+	}
+
+	LexFromString(OutCheckpoint.NumProcessedEntities, *NumProcessedEntities);
+
+	OutCheckpoint.SegmentPaths.Reset();
+	for (const TSharedPtr<FJsonValue>& SegmentPathValue : *SegmentPathsJson)
+	{
+		OutCheckpoint.SegmentPaths.Add(SegmentPathValue->AsString());
+	}
+
+	return true;
+}
+
+void SnapshotMigrationCheckpoint::Delete(const FString& CheckpointPath)
+{
+	SnapshotMigrationCheckpoint Checkpoint;
+	if (Load(CheckpointPath, Checkpoint))
+	{
+		for (const FString& SegmentPath : Checkpoint.SegmentPaths)
+		{
+			IFileManager::Get().Delete(*SegmentPath, false, true);
+		}
+	}
+
+	IFileManager::Get().Delete(*CheckpointPath, false, true);
+}
+
+FString SnapshotMigrationCheckpoint::GetCheckpointPath(const FString& TargetSnapshotPath)
+{
+	return FString::Printf(TEXT("%s.checkpoint.json"), *TargetSnapshotPath);
+}
+
+FString SnapshotMigrationCheckpoint::GetSegmentPath(const FString& TargetSnapshotPath, const int32 SegmentIndex)
+{
+	return FString::Printf(TEXT("%s.part%d"), *TargetSnapshotPath, SegmentIndex);
+}
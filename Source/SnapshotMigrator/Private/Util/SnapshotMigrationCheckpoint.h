@@ -0,0 +1,35 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SnapshotMigrationReporter.h"
+
+/**
+* Written periodically while a snapshot is migrated with checkpoints enabled, so that an interrupted migration can be resumed rather than started
+* again. Snapshot output streams can't be reopened for appending, so the output is written as a series of segments, each of which is a complete
+* snapshot; a checkpoint is only written once the segments it lists have been closed. The segments are concatenated once the migration finishes.
+*/
+struct SnapshotMigrationCheckpoint
+{
+	// Hash of every input that affects the output, including the source snapshot's size and timestamp; a checkpoint is only resumed with the same inputs.
+	FString InputsHash;
+	// Number of entities read from the source snapshot whose output, if any, is in the segments.
+	uint64 NumProcessedEntities = 0;
+	TArray<FString> SegmentPaths;
+
+	SnapshotMigrationData MigrationData;
+
+	bool Save(const FString& CheckpointPath) const;
+	static bool Load(const FString& CheckpointPath, SnapshotMigrationCheckpoint& OutCheckpoint);
+
+	// Deletes a checkpoint along with its segments.
+	static void Delete(const FString& CheckpointPath);
+
+	static FString GetCheckpointPath(const FString& TargetSnapshotPath);
+	static FString GetSegmentPath(const FString& TargetSnapshotPath, const int32 SegmentIndex);
+
+	// Bump this whenever a change to the migrator alters the contents of the snapshots it writes, or the layout of checkpoints.
+	static const int32 VERSION = 1;
+};
@@ -0,0 +1,115 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationCompactor.h"
+
+const TCHAR* GetSnapshotCompactionRuleName(const SnapshotCompactionRule Rule)
+{
+	switch (Rule)
+	{
+	case SnapshotCompactionRule::UnknownComponents:
+		return TEXT("UnknownComponents");
+	case SnapshotCompactionRule::UnknownFields:
+		return TEXT("UnknownFields");
+	case SnapshotCompactionRule::DefaultComponentData:
+		return TEXT("DefaultComponentData");
+	default:
+		checkNoEntry();
+		return TEXT("Invalid");
+	}
+}
+
+bool GetSnapshotCompactionRuleFromName(const FString& Name, SnapshotCompactionRule& OutRule)
+{
+	for (int32 i = 0; i < static_cast<int32>(SnapshotCompactionRule::Count); i++)
+	{
+		if (Name.Equals(GetSnapshotCompactionRuleName(static_cast<SnapshotCompactionRule>(i)), ESearchCase::IgnoreCase))
+		{
+			OutRule = static_cast<SnapshotCompactionRule>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+SnapshotMigrationCompactor::SnapshotMigrationCompactor(const TArray<SnapshotCompactionRule>& Rules)
+{
+	for (const SnapshotCompactionRule Rule : Rules)
+	{
+		RuleMask |= 1u << static_cast<uint32>(Rule);
+	}
+}
+
+SnapshotCompactionResult SnapshotMigrationCompactor::CompactEntity(const SchemaBundleDefinitions& Definitions, TArray<Worker_ComponentData>& Components) const
+{
+	SnapshotCompactionResult Result;
+
+	for (int32 i = Components.Num() - 1; i >= 0; i--)
+	{
+		const SchemaBundleComponentDefinition* ComponentDefinition = Definitions.FindComponent(Components[i].component_id);
+		if (ComponentDefinition == nullptr)
+		{
+			if (HasRule(SnapshotCompactionRule::UnknownComponents) && Components[i].component_id >= SchemaBundleDefinitions::FIRST_NON_RESERVED_COMPONENT_ID)
+			{
+				Components.RemoveAt(i, 1, false);
+				Result.NumDroppedComponents++;
+			}
+			continue;
+		}
+
+		if (HasRule(SnapshotCompactionRule::UnknownFields))
+		{
+			Result.NumClearedFields += ClearFields(Schema_GetComponentDataFields(Components[i].schema_type), [ComponentDefinition](const Schema_FieldId FieldId) {
+				return ComponentDefinition->FindField(FieldId) == nullptr;
+			});
+		}
+	}
+
+	return Result;
+}
+
+uint32 SnapshotMigrationCompactor::ClearDefaultComponentData(Worker_ComponentData& Component, const TArray<uint8>& CreatedData) const
+{
+	if (!HasRule(SnapshotCompactionRule::DefaultComponentData) || SerializeComponentData(Component) != CreatedData)
+	{
+		return 0;
+	}
+
+	return ClearFields(Schema_GetComponentDataFields(Component.schema_type), [](const Schema_FieldId FieldId) { return true; });
+}
+
+TArray<uint8> SnapshotMigrationCompactor::SerializeComponentData(const Worker_ComponentData& Component)
+{
+	const Schema_Object* Fields = Schema_GetComponentDataFields(Component.schema_type);
+
+	TArray<uint8> Data;
+	Data.AddUninitialized(Schema_GetWriteBufferLength(Fields));
+	Schema_SerializeToBuffer(Fields, Data.GetData(), Data.Num());
+
+	return Data;
+}
+
+const TArray<SnapshotCompactionRule>& SnapshotMigrationCompactor::GetDefaultRules()
+{
+	static const TArray<SnapshotCompactionRule> DefaultRules{ SnapshotCompactionRule::UnknownComponents, SnapshotCompactionRule::UnknownFields };
+	return DefaultRules;
+}
+
+uint32 SnapshotMigrationCompactor::ClearFields(Schema_Object* Fields, TFunctionRef<bool(const Schema_FieldId)> ShouldClear)
+{
+	TArray<Schema_FieldId> FieldIds;
+	FieldIds.SetNumUninitialized(Schema_GetUniqueFieldIdCount(Fields));
+	Schema_GetUniqueFieldIds(Fields, FieldIds.GetData());
+
+	uint32 NumCleared = 0;
+	for (const Schema_FieldId FieldId : FieldIds)
+	{
+		if (ShouldClear(FieldId))
+		{
+			Schema_ClearField(Fields, FieldId);
+			NumCleared++;
+		}
+	}
+
+	return NumCleared;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <WorkerSDK/improbable/c_schema.h>
+#include <WorkerSDK/improbable/c_worker.h>
+
+#include "SchemaBundleWrappers.h"
+
+enum class SnapshotCompactionRule : uint8
+{
+	// Components which the target schema bundle doesn't define; nothing can read them once the snapshot is loaded.
+	UnknownComponents,
+	// Fields which the target schema bundle doesn't define for their component; nothing can read them either.
+	UnknownFields,
+	// The data of actor and subobject components which is the same as the data the actor's class was created with. The components themselves are
+	// kept, since the GDK treats a missing component differently, but their fields are cleared; the GDK only applies the fields it finds, so the
+	// actor keeps its class' values. Not on by default, since a snapshot compacted this way picks up any later changes to those class defaults.
+	DefaultComponentData,
+	Count
+};
+
+const TCHAR* GetSnapshotCompactionRuleName(const SnapshotCompactionRule Rule);
+bool GetSnapshotCompactionRuleFromName(const FString& Name, SnapshotCompactionRule& OutRule);
+
+struct SnapshotCompactionResult
+{
+	uint32 NumDroppedComponents = 0;
+	uint32 NumClearedFields = 0;
+};
+
+/**
+* Strips data from migrated entities which is redundant under a policy made up of SnapshotCompactionRules, just before they're written.
+*/
+class SnapshotMigrationCompactor
+{
+public:
+	explicit SnapshotMigrationCompactor(const TArray<SnapshotCompactionRule>& Rules);
+
+	bool HasRule(const SnapshotCompactionRule Rule) const { return (RuleMask & (1u << static_cast<uint32>(Rule))) != 0; }
+
+	/**
+	* Applies the UnknownComponents and UnknownFields rules to an entity. Fields are cleared in place, and dropped components are removed from the
+	* array without being destroyed, since they may belong to the snapshot they were read from. Components with reserved ids are never dropped.
+	*	@param	Definitions		Schema bundle the entity is written with
+	*	@param	Components		Components of the entity
+	*
+	*	@return					What was stripped from the entity
+	*/
+	SnapshotCompactionResult CompactEntity(const SchemaBundleDefinitions& Definitions, TArray<Worker_ComponentData>& Components) const;
+
+	/**
+	* Applies the DefaultComponentData rule to a component, by clearing its fields if its data is the same as it was created with.
+	*	@param	Component		Component to clear
+	*	@param	CreatedData		Component's data as it was created, from SerializeComponentData
+	*
+	*	@return					Number of fields cleared
+	*/
+	uint32 ClearDefaultComponentData(Worker_ComponentData& Component, const TArray<uint8>& CreatedData) const;
+
+	static TArray<uint8> SerializeComponentData(const Worker_ComponentData& Component);
+
+	static const TArray<SnapshotCompactionRule>& GetDefaultRules();
+
+private:
+	static uint32 ClearFields(Schema_Object* Fields, TFunctionRef<bool(const Schema_FieldId)> ShouldClear);
+
+	uint32 RuleMask = 0;
+};
@@ -0,0 +1,821 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationDiff.h"
+
+#include "Util/SnapshotHelperLibrary.h"
+#include "Util/SnapshotMigrationSpatialOrder.h"
+
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Dom/JsonValue.h"
+#include "HAL/FileManager.h"
+#include "Misc/ScopeExit.h"
+
+#include "Schema/UnrealMetadata.h"
+#include "SpatialConstants.h"
+#include "Utils/SchemaUtils.h"
+
+namespace
+{
+	void CopyEntityComponents(const Worker_Entity* Entity, TArray<Worker_ComponentData>& OutComponents)
+	{
+		OutComponents.Reserve(Entity->component_count);
+		for (uint32 i = 0; i < Entity->component_count; i++)
+		{
+			Worker_ComponentData Component = Entity->components[i];
+			Component.schema_type = Schema_CopyComponentData(Entity->components[i].schema_type);
+			OutComponents.Add(Component);
+		}
+	}
+
+	void DestroyEntityComponents(TArray<Worker_ComponentData>& Components)
+	{
+		for (Worker_ComponentData& Component : Components)
+		{
+			Schema_DestroyComponentData(Component.schema_type);
+		}
+		Components.Reset();
+	}
+
+	// Entities with the same id in either or both snapshots, copied out of the snapshots since each stream only keeps the entity it read last.
+	struct DiffBatch
+	{
+		TArray<Worker_EntityId> EntityIds;
+		TArray<bool> bInSource;
+		TArray<bool> bInMigrated;
+		TArray<TArray<Worker_ComponentData>> SourceComponents;
+		TArray<TArray<Worker_ComponentData>> MigratedComponents;
+		TArray<SnapshotMigrationDiff::EntityDiff> Diffs;
+
+		int32 Num() const { return EntityIds.Num(); }
+
+		void Add(const Worker_Entity* SourceEntity, const Worker_Entity* MigratedEntity)
+		{
+			EntityIds.Add(SourceEntity != nullptr ? SourceEntity->entity_id : MigratedEntity->entity_id);
+			bInSource.Add(SourceEntity != nullptr);
+			bInMigrated.Add(MigratedEntity != nullptr);
+
+			TArray<Worker_ComponentData>& EntitySourceComponents = SourceComponents.AddDefaulted_GetRef();
+			if (SourceEntity != nullptr)
+			{
+				CopyEntityComponents(SourceEntity, EntitySourceComponents);
+			}
+
+			TArray<Worker_ComponentData>& EntityMigratedComponents = MigratedComponents.AddDefaulted_GetRef();
+			if (MigratedEntity != nullptr)
+			{
+				CopyEntityComponents(MigratedEntity, EntityMigratedComponents);
+			}
+		}
+
+		void Reset()
+		{
+			for (int32 i = 0; i < Num(); i++)
+			{
+				DestroyEntityComponents(SourceComponents[i]);
+				DestroyEntityComponents(MigratedComponents[i]);
+			}
+
+			EntityIds.Reset();
+			bInSource.Reset();
+			bInMigrated.Reset();
+			SourceComponents.Reset();
+			MigratedComponents.Reset();
+			Diffs.Reset();
+		}
+	};
+
+	// The entity a snapshot stream has read last, which stays valid until the stream reads the next one.
+	struct DiffStream
+	{
+		Worker_SnapshotInputStream* Stream;
+		const FString& Path;
+		const Worker_Entity* Entity = nullptr;
+		Worker_EntityId LastEntityId = SpatialConstants::INVALID_ENTITY_ID;
+		bool bUnordered = false;
+
+		bool ReadNext()
+		{
+			Entity = nullptr;
+			if (!Worker_SnapshotInputStream_HasNext(Stream))
+			{
+				return true;
+			}
+
+			Entity = Worker_SnapshotInputStream_ReadEntity(Stream);
+			if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, Stream, FString::Printf(TEXT("read entity from snapshot %s"), *Path)))
+			{
+				return false;
+			}
+
+			// Entities can only be matched up by id if each snapshot's ids go up strictly.
+			if (Entity->entity_id <= LastEntityId)
+			{
+				bUnordered = true;
+				return false;
+			}
+
+			LastEntityId = Entity->entity_id;
+			return true;
+		}
+	};
+
+	const Worker_ComponentData* FindEntityComponent(const TArray<Worker_ComponentData>* Components, const Worker_ComponentId ComponentId)
+	{
+		return Components != nullptr ? Components->FindByPredicate([ComponentId](const Worker_ComponentData& Component) { return Component.component_id == ComponentId; }) : nullptr;
+	}
+
+	bool IsSerializedObjectEqual(const Schema_Object* SourceObject, const Schema_Object* MigratedObject)
+	{
+		const uint32 Length = Schema_GetWriteBufferLength(SourceObject);
+		if (Length != Schema_GetWriteBufferLength(MigratedObject))
+		{
+			return false;
+		}
+
+		TArray<uint8> SourceData;
+		TArray<uint8> MigratedData;
+		SourceData.SetNumUninitialized(Length);
+		MigratedData.SetNumUninitialized(Length);
+		Schema_SerializeToBuffer(SourceObject, SourceData.GetData(), Length);
+		Schema_SerializeToBuffer(MigratedObject, MigratedData.GetData(), Length);
+
+		return SourceData == MigratedData;
+	}
+
+	template <typename T>
+	bool AreValueListsEqual(uint32 (*GetCount)(const Schema_Object*, Schema_FieldId), void (*GetList)(const Schema_Object*, Schema_FieldId, T*),
+		const Schema_Object* SourceObject, const Schema_FieldId SourceFieldId, const Schema_Object* MigratedObject, const Schema_FieldId MigratedFieldId)
+	{
+		const uint32 Count = GetCount(SourceObject, SourceFieldId);
+		if (Count != GetCount(MigratedObject, MigratedFieldId))
+		{
+			return false;
+		}
+
+		TArray<T, TInlineAllocator<16>> SourceValues;
+		TArray<T, TInlineAllocator<16>> MigratedValues;
+		SourceValues.SetNumUninitialized(Count);
+		MigratedValues.SetNumUninitialized(Count);
+		GetList(SourceObject, SourceFieldId, SourceValues.GetData());
+		GetList(MigratedObject, MigratedFieldId, MigratedValues.GetData());
+
+		// Compared bitwise, so that floats which were carried over unchanged compare as unchanged even if they're NaN.
+		return FMemory::Memcmp(SourceValues.GetData(), MigratedValues.GetData(), Count * sizeof(T)) == 0;
+	}
+}
+
+const TCHAR* GetSnapshotFieldDiffKindName(const SnapshotFieldDiffKind Kind)
+{
+	switch (Kind)
+	{
+	case SnapshotFieldDiffKind::Unchanged:
+		return TEXT("Unchanged");
+	case SnapshotFieldDiffKind::Changed:
+		return TEXT("Changed");
+	case SnapshotFieldDiffKind::Dropped:
+		return TEXT("Dropped");
+	case SnapshotFieldDiffKind::Added:
+		return TEXT("Added");
+	default:
+		checkNoEntry();
+		return TEXT("Invalid");
+	}
+}
+
+TSharedRef<FJsonObject> SnapshotFieldDiff::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetStringField(FString{ TEXT("Component") }, ComponentName);
+	if (SourceComponentId != 0)
+	{
+		Json->SetNumberField(FString{ TEXT("SourceComponentId") }, SourceComponentId);
+	}
+	if (MigratedComponentId != 0)
+	{
+		Json->SetNumberField(FString{ TEXT("MigratedComponentId") }, MigratedComponentId);
+	}
+
+	if (!FieldName.IsEmpty())
+	{
+		Json->SetStringField(FString{ TEXT("Field") }, FieldName);
+		if (!SourceType.IsEmpty())
+		{
+			Json->SetStringField(FString{ TEXT("SourceType") }, SourceType);
+		}
+		if (!MigratedType.IsEmpty())
+		{
+			Json->SetStringField(FString{ TEXT("MigratedType") }, MigratedType);
+		}
+	}
+
+	for (int32 i = 0; i < static_cast<int32>(SnapshotFieldDiffKind::Count); i++)
+	{
+		Json->SetNumberField(GetSnapshotFieldDiffKindName(static_cast<SnapshotFieldDiffKind>(i)), Counts[i]);
+		if (Counts[i] > 0 && static_cast<SnapshotFieldDiffKind>(i) != SnapshotFieldDiffKind::Unchanged)
+		{
+			Json->SetNumberField(FString::Printf(TEXT("First%sEntityId"), GetSnapshotFieldDiffKindName(static_cast<SnapshotFieldDiffKind>(i))), FirstEntityIds[i]);
+		}
+	}
+
+	return Json;
+}
+
+TSharedRef<FJsonObject> SnapshotClassDiff::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetStringField(FString{ TEXT("Class") }, ClassPath);
+	Json->SetNumberField(FString{ TEXT("NumSourceEntities") }, NumSourceEntities);
+	Json->SetNumberField(FString{ TEXT("NumMigratedEntities") }, NumMigratedEntities);
+	Json->SetNumberField(FString{ TEXT("NumChangedEntities") }, NumChangedEntities);
+
+	TSharedRef<FJsonObject> FieldCountsJson = MakeShareable(new FJsonObject);
+	for (int32 i = 0; i < static_cast<int32>(SnapshotFieldDiffKind::Count); i++)
+	{
+		FieldCountsJson->SetNumberField(GetSnapshotFieldDiffKindName(static_cast<SnapshotFieldDiffKind>(i)), FieldCounts[i]);
+	}
+	Json->SetObjectField(FString{ TEXT("Fields") }, FieldCountsJson);
+
+	return Json;
+}
+
+bool SnapshotMigrationDiff::EntityDiff::HasDifferences() const
+{
+	return !bInSource || !bInMigrated || Fields.ContainsByPredicate([](const TPair<FieldKey, SnapshotFieldDiffKind>& Field) { return Field.Value != SnapshotFieldDiffKind::Unchanged; });
+}
+
+bool SnapshotMigrationDiff::DiffSnapshots(const FString& SourcePath, const FString& MigratedPath, const uint64 MaxRunBytes)
+{
+	FString OrderedSourcePath = SourcePath;
+	FString OrderedMigratedPath = MigratedPath;
+
+	TArray<FString> OrderedCopyPaths;
+	ON_SCOPE_EXIT
+	{
+		for (const FString& OrderedCopyPath : OrderedCopyPaths)
+		{
+			IFileManager::Get().Delete(*OrderedCopyPath, false, true);
+		}
+	};
+
+	// Each snapshot is ordered at most once, so one which still isn't in order afterwards has several entities with the same id.
+	const auto OrderByEntityId = [&OrderedCopyPaths, MaxRunBytes](FString& Path) {
+		if (OrderedCopyPaths.Contains(Path))
+		{
+			UE_LOG(LogSnapshotMigrator, Warning, TEXT("Snapshot %s has several entities with the same id, so it can't be compared!"), *Path);
+			return false;
+		}
+
+		const FString OrderedPath = FString::Printf(TEXT("%s.byid"), *Path);
+		OrderedCopyPaths.Add(OrderedPath);
+
+		int32 NumRuns = 0;
+		if (!SnapshotMigrationSpatialOrder::OrderSnapshotByEntityId(Path, OrderedPath, MaxRunBytes, NumRuns))
+		{
+			UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to order the entities of %s by id!"), *Path);
+			return false;
+		}
+
+		UE_LOG(LogSnapshotMigrator, Display, TEXT("Entities of %s aren't in id order; ordered a copy of it in %d run(s)."), *Path, NumRuns);
+		Path = OrderedPath;
+		return true;
+	};
+
+	while (true)
+	{
+		Reset();
+
+		bool bSourceUnordered = false;
+		bool bMigratedUnordered = false;
+		if (DiffOrderedSnapshots(OrderedSourcePath, OrderedMigratedPath, bSourceUnordered, bMigratedUnordered))
+		{
+			return true;
+		}
+
+		if ((!bSourceUnordered && !bMigratedUnordered) || (bSourceUnordered && !OrderByEntityId(OrderedSourcePath)) || (bMigratedUnordered && !OrderByEntityId(OrderedMigratedPath)))
+		{
+			return false;
+		}
+	}
+}
+
+bool SnapshotMigrationDiff::DiffOrderedSnapshots(const FString& SourcePath, const FString& MigratedPath, bool& bOutSourceUnordered, bool& bOutMigratedUnordered)
+{
+	const Worker_ComponentVtable DefaultVtable{};
+	Worker_SnapshotParameters Parameters{};
+	Parameters.default_component_vtable = &DefaultVtable;
+
+	DiffStream Source{ Worker_SnapshotInputStream_Create(TCHAR_TO_UTF8(*SourcePath), &Parameters), SourcePath };
+	DiffStream Migrated{ Worker_SnapshotInputStream_Create(TCHAR_TO_UTF8(*MigratedPath), &Parameters), MigratedPath };
+	ON_SCOPE_EXIT
+	{
+		Worker_SnapshotInputStream_Destroy(Source.Stream);
+		Worker_SnapshotInputStream_Destroy(Migrated.Stream);
+	};
+
+	if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, Source.Stream, FString::Printf(TEXT("open snapshot %s"), *SourcePath)) ||
+		!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, Migrated.Stream, FString::Printf(TEXT("open snapshot %s"), *MigratedPath)))
+	{
+		return false;
+	}
+
+	DiffBatch Batches[2];
+	ON_SCOPE_EXIT
+	{
+		Batches[0].Reset();
+		Batches[1].Reset();
+	};
+
+	TFuture<void> PendingDiff;
+	int32 PendingBatchIndex = INDEX_NONE;
+
+	const auto FinishPendingDiff = [this, &PendingDiff, &PendingBatchIndex, &Batches]() {
+		if (PendingBatchIndex == INDEX_NONE)
+		{
+			return;
+		}
+
+		PendingDiff.Wait();
+
+		DiffBatch& Batch = Batches[PendingBatchIndex];
+		for (int32 i = 0; i < Batch.Num(); i++)
+		{
+			AddEntityDiff(Batch.EntityIds[i], Batch.Diffs[i]);
+		}
+
+		Batch.Reset();
+		PendingBatchIndex = INDEX_NONE;
+	};
+
+	const auto StartDiff = [this, &PendingDiff, &PendingBatchIndex, &Batches](const int32 BatchIndex) {
+		DiffBatch& Batch = Batches[BatchIndex];
+		Batch.Diffs.SetNum(Batch.Num());
+
+		PendingBatchIndex = BatchIndex;
+		PendingDiff = Async(EAsyncExecution::ThreadPool, [this, &Batch]() {
+			ParallelFor(Batch.Num(), [this, &Batch](const int32 i) {
+				DiffEntity(Batch.bInSource[i] ? &Batch.SourceComponents[i] : nullptr, Batch.bInMigrated[i] ? &Batch.MigratedComponents[i] : nullptr, Batch.Diffs[i]);
+			});
+		});
+	};
+
+	// The batch which was read before this one is compared while this one is read, so reading the snapshots is never waiting on the comparisons.
+	bool bReadBothSnapshots = Source.ReadNext() && Migrated.ReadNext();
+	int32 ReadBatchIndex = 0;
+
+	while (bReadBothSnapshots && (Source.Entity != nullptr || Migrated.Entity != nullptr))
+	{
+		const Worker_Entity* SourceEntity = Source.Entity;
+		const Worker_Entity* MigratedEntity = Migrated.Entity;
+		if (SourceEntity != nullptr && MigratedEntity != nullptr && SourceEntity->entity_id != MigratedEntity->entity_id)
+		{
+			(SourceEntity->entity_id < MigratedEntity->entity_id ? MigratedEntity : SourceEntity) = nullptr;
+		}
+
+		Batches[ReadBatchIndex].Add(SourceEntity, MigratedEntity);
+		bReadBothSnapshots = (SourceEntity == nullptr || Source.ReadNext()) && (MigratedEntity == nullptr || Migrated.ReadNext());
+
+		if (Batches[ReadBatchIndex].Num() == BATCH_SIZE)
+		{
+			FinishPendingDiff();
+			StartDiff(ReadBatchIndex);
+			ReadBatchIndex = 1 - ReadBatchIndex;
+		}
+	}
+
+	FinishPendingDiff();
+	if (bReadBothSnapshots && Batches[ReadBatchIndex].Num() > 0)
+	{
+		StartDiff(ReadBatchIndex);
+		FinishPendingDiff();
+	}
+
+	bOutSourceUnordered = Source.bUnordered;
+	bOutMigratedUnordered = Migrated.bUnordered;
+
+	return bReadBothSnapshots;
+}
+
+void SnapshotMigrationDiff::Reset()
+{
+	NumSourceEntities = 0;
+	NumMigratedEntities = 0;
+	NumMatchedEntities = 0;
+	NumChangedEntities = 0;
+	FieldDiffs.Reset();
+	ClassDiffs.Reset();
+}
+
+void SnapshotMigrationDiff::DiffEntity(const TArray<Worker_ComponentData>* SourceComponents, const TArray<Worker_ComponentData>* MigratedComponents, EntityDiff& OutDiff) const
+{
+	OutDiff.bInSource = SourceComponents != nullptr;
+	OutDiff.bInMigrated = MigratedComponents != nullptr;
+
+	const Worker_ComponentData* UnrealMetadataComponent = FindEntityComponent(SourceComponents, SpatialConstants::UNREAL_METADATA_COMPONENT_ID);
+	if (UnrealMetadataComponent == nullptr)
+	{
+		UnrealMetadataComponent = FindEntityComponent(MigratedComponents, SpatialConstants::UNREAL_METADATA_COMPONENT_ID);
+	}
+	if (UnrealMetadataComponent != nullptr)
+	{
+		OutDiff.ClassPath = SpatialGDK::UnrealMetadata{ *UnrealMetadataComponent }.ClassPath;
+	}
+
+	// Entities which are only in one of the snapshots were filtered out or added as a whole, so they're only counted for their class.
+	if (SourceComponents == nullptr || MigratedComponents == nullptr)
+	{
+		return;
+	}
+
+	for (const Worker_ComponentData& SourceComponent : *SourceComponents)
+	{
+		const SchemaBundleComponentDefinition* SourceDefinition = SourceDefinitions.FindComponent(SourceComponent.component_id);
+		if (SourceDefinition == nullptr)
+		{
+			// Components which the source bundle doesn't define can't be matched by name, so they're matched by id and compared as a whole.
+			const Worker_ComponentData* MigratedComponent = FindEntityComponent(MigratedComponents, SourceComponent.component_id);
+			const SnapshotFieldDiffKind Kind = MigratedComponent == nullptr ? SnapshotFieldDiffKind::Dropped
+				: IsSerializedObjectEqual(Schema_GetComponentDataFields(SourceComponent.schema_type), Schema_GetComponentDataFields(MigratedComponent->schema_type)) ? SnapshotFieldDiffKind::Unchanged
+				: SnapshotFieldDiffKind::Changed;
+			OutDiff.Fields.Emplace(FieldKey{ SourceComponent.component_id, SourceComponent.component_id, nullptr, nullptr }, Kind);
+			continue;
+		}
+
+		const SchemaBundleComponentDefinition* MigratedDefinition = MigratedDefinitions.FindComponent(SourceDefinition->GetName());
+		const Worker_ComponentData* MigratedComponent = MigratedDefinition != nullptr ? FindEntityComponent(MigratedComponents, MigratedDefinition->GetId()) : nullptr;
+		DiffComponent(SourceComponent, *SourceDefinition, MigratedComponent, MigratedDefinition, OutDiff);
+	}
+
+	// Components of the migrated entity which were compared with a source component above are skipped.
+	for (const Worker_ComponentData& MigratedComponent : *MigratedComponents)
+	{
+		const SchemaBundleComponentDefinition* MigratedDefinition = MigratedDefinitions.FindComponent(MigratedComponent.component_id);
+		const SchemaBundleComponentDefinition* SourceDefinition = MigratedDefinition != nullptr ? SourceDefinitions.FindComponent(MigratedDefinition->GetName()) : nullptr;
+		const bool bMatchedById = SourceDefinitions.FindComponent(MigratedComponent.component_id) == nullptr && FindEntityComponent(SourceComponents, MigratedComponent.component_id) != nullptr;
+		const bool bMatchedByName = SourceDefinition != nullptr && FindEntityComponent(SourceComponents, SourceDefinition->GetId()) != nullptr;
+		if (bMatchedById || bMatchedByName)
+		{
+			continue;
+		}
+
+		if (MigratedDefinition == nullptr)
+		{
+			OutDiff.Fields.Emplace(FieldKey{ MigratedComponent.component_id, MigratedComponent.component_id, nullptr, nullptr }, SnapshotFieldDiffKind::Added);
+			continue;
+		}
+
+		Schema_Object* MigratedObject = Schema_GetComponentDataFields(MigratedComponent.schema_type);
+		for (const SchemaBundleFieldDefinition& MigratedField : MigratedDefinition->GetFields())
+		{
+			if (HasValues(MigratedObject, MigratedField))
+			{
+				const FieldKey Key{ SourceDefinition != nullptr ? SourceDefinition->GetId() : 0, MigratedDefinition->GetId(), FindCounterpartField(SourceDefinition, MigratedField), &MigratedField };
+				OutDiff.Fields.Emplace(Key, SnapshotFieldDiffKind::Added);
+			}
+		}
+	}
+}
+
+void SnapshotMigrationDiff::DiffComponent(const Worker_ComponentData& SourceComponent, const SchemaBundleComponentDefinition& SourceDefinition, const Worker_ComponentData* MigratedComponent, const SchemaBundleComponentDefinition* MigratedDefinition, EntityDiff& OutDiff) const
+{
+	Schema_Object* SourceObject = Schema_GetComponentDataFields(SourceComponent.schema_type);
+	Schema_Object* MigratedObject = MigratedComponent != nullptr ? Schema_GetComponentDataFields(MigratedComponent->schema_type) : nullptr;
+	const uint32 MigratedComponentId = MigratedDefinition != nullptr ? MigratedDefinition->GetId() : 0;
+
+	for (const SchemaBundleFieldDefinition& SourceField : SourceDefinition.GetFields())
+	{
+		const SchemaBundleFieldDefinition* MigratedField = FindCounterpartField(MigratedDefinition, SourceField);
+
+		const bool bSourceHasValues = HasValues(SourceObject, SourceField);
+		const bool bMigratedHasValues = MigratedObject != nullptr && MigratedField != nullptr && HasValues(MigratedObject, *MigratedField);
+		if (!bSourceHasValues && !bMigratedHasValues)
+		{
+			continue;
+		}
+
+		const SnapshotFieldDiffKind Kind = !bSourceHasValues ? SnapshotFieldDiffKind::Added
+			: !bMigratedHasValues ? SnapshotFieldDiffKind::Dropped
+			: AreFieldsEqual(SourceObject, SourceField, MigratedObject, *MigratedField, 0) ? SnapshotFieldDiffKind::Unchanged
+			: SnapshotFieldDiffKind::Changed;
+		OutDiff.Fields.Emplace(FieldKey{ SourceDefinition.GetId(), MigratedComponentId, &SourceField, MigratedField }, Kind);
+	}
+
+	if (MigratedObject == nullptr)
+	{
+		return;
+	}
+
+	for (const SchemaBundleFieldDefinition& MigratedField : MigratedDefinition->GetFields())
+	{
+		if (FindCounterpartField(&SourceDefinition, MigratedField) == nullptr && HasValues(MigratedObject, MigratedField))
+		{
+			OutDiff.Fields.Emplace(FieldKey{ SourceDefinition.GetId(), MigratedComponentId, nullptr, &MigratedField }, SnapshotFieldDiffKind::Added);
+		}
+	}
+}
+
+bool SnapshotMigrationDiff::AreFieldsEqual(Schema_Object* SourceObject, const SchemaBundleFieldDefinition& SourceField, Schema_Object* MigratedObject, const SchemaBundleFieldDefinition& MigratedField, const int32 Depth) const
+{
+	if (!SourceField.IsMap())
+	{
+		return AreValuesEqual(SourceObject, SourceField.GetId(), MigratedObject, MigratedField.GetId(), SourceField, SchemaBundleFieldDefinition::TypeIndex::INNER, Depth);
+	}
+
+	// Map entries are compared in order, since the migrator carries them over in order.
+	const uint32 NumEntries = Schema_GetObjectCount(SourceObject, SourceField.GetId());
+	if (NumEntries != Schema_GetObjectCount(MigratedObject, MigratedField.GetId()))
+	{
+		return false;
+	}
+
+	for (uint32 i = 0; i < NumEntries; i++)
+	{
+		Schema_Object* SourceEntry = Schema_IndexObject(SourceObject, SourceField.GetId(), i);
+		Schema_Object* MigratedEntry = Schema_IndexObject(MigratedObject, MigratedField.GetId(), i);
+		if (!AreValuesEqual(SourceEntry, SCHEMA_MAP_KEY_FIELD_ID, MigratedEntry, SCHEMA_MAP_KEY_FIELD_ID, SourceField, SchemaBundleFieldDefinition::TypeIndex::KEY, Depth) ||
+			!AreValuesEqual(SourceEntry, SCHEMA_MAP_VALUE_FIELD_ID, MigratedEntry, SCHEMA_MAP_VALUE_FIELD_ID, SourceField, SchemaBundleFieldDefinition::TypeIndex::VALUE, Depth))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SnapshotMigrationDiff::AreValuesEqual(Schema_Object* SourceObject, const Schema_FieldId SourceFieldId, Schema_Object* MigratedObject, const Schema_FieldId MigratedFieldId, const SchemaBundleFieldDefinition& Field, const SchemaBundleFieldDefinition::TypeIndex Index, const int32 Depth) const
+{
+	using SchemaPrimitiveType = SchemaBundleFieldDefinition::SchemaPrimitiveType;
+
+	if (Field.IsPrimitive(Index))
+	{
+		switch (Field.GetPrimitiveType(Index))
+		{
+		case SchemaPrimitiveType::Int32:
+			return AreValueListsEqual(Schema_GetInt32Count, Schema_GetInt32List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Int64:
+			return AreValueListsEqual(Schema_GetInt64Count, Schema_GetInt64List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Uint32:
+			return AreValueListsEqual(Schema_GetUint32Count, Schema_GetUint32List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Uint64:
+			return AreValueListsEqual(Schema_GetUint64Count, Schema_GetUint64List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Sint32:
+			return AreValueListsEqual(Schema_GetSint32Count, Schema_GetSint32List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Sint64:
+			return AreValueListsEqual(Schema_GetSint64Count, Schema_GetSint64List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Fixed32:
+			return AreValueListsEqual(Schema_GetFixed32Count, Schema_GetFixed32List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Fixed64:
+			return AreValueListsEqual(Schema_GetFixed64Count, Schema_GetFixed64List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Sfixed32:
+			return AreValueListsEqual(Schema_GetSfixed32Count, Schema_GetSfixed32List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Sfixed64:
+			return AreValueListsEqual(Schema_GetSfixed64Count, Schema_GetSfixed64List, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Bool:
+			return AreValueListsEqual(Schema_GetBoolCount, Schema_GetBoolList, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Float:
+			return AreValueListsEqual(Schema_GetFloatCount, Schema_GetFloatList, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::Double:
+			return AreValueListsEqual(Schema_GetDoubleCount, Schema_GetDoubleList, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::EntityId:
+			return AreValueListsEqual(Schema_GetEntityIdCount, Schema_GetEntityIdList, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+		case SchemaPrimitiveType::String:
+		case SchemaPrimitiveType::Bytes:
+		{
+			const uint32 Count = Schema_GetBytesCount(SourceObject, SourceFieldId);
+			if (Count != Schema_GetBytesCount(MigratedObject, MigratedFieldId))
+			{
+				return false;
+			}
+
+			for (uint32 i = 0; i < Count; i++)
+			{
+				const uint32 Length = Schema_IndexBytesLength(SourceObject, SourceFieldId, i);
+				if (Length != Schema_IndexBytesLength(MigratedObject, MigratedFieldId, i) ||
+					FMemory::Memcmp(Schema_IndexBytes(SourceObject, SourceFieldId, i), Schema_IndexBytes(MigratedObject, MigratedFieldId, i), Length) != 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		case SchemaPrimitiveType::Entity:
+		default:
+			break;
+		}
+	}
+	else if (Field.IsEnum(Index))
+	{
+		return AreValueListsEqual(Schema_GetEnumCount, Schema_GetEnumList, SourceObject, SourceFieldId, MigratedObject, MigratedFieldId);
+	}
+
+	const uint32 Count = Schema_GetObjectCount(SourceObject, SourceFieldId);
+	if (Count != Schema_GetObjectCount(MigratedObject, MigratedFieldId))
+	{
+		return false;
+	}
+
+	const bool bIsObjectRef = Field.IsUnrealObjectRefType(Index);
+	const SchemaBundleTypeDefinition* SourceType = Field.IsType(Index) && Depth < MAX_OBJECT_DEPTH ? SourceDefinitions.FindType(Field.GetResolvedType(Index)) : nullptr;
+	const SchemaBundleTypeDefinition* MigratedType = SourceType != nullptr ? MigratedDefinitions.FindType(Field.GetResolvedType(Index)) : nullptr;
+
+	for (uint32 i = 0; i < Count; i++)
+	{
+		if (bIsObjectRef)
+		{
+			if (!AreObjectRefsEqual(SpatialGDK::IndexObjectRefFromSchema(SourceObject, SourceFieldId, i), SpatialGDK::IndexObjectRefFromSchema(MigratedObject, MigratedFieldId, i)))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		Schema_Object* SourceValue = Schema_IndexObject(SourceObject, SourceFieldId, i);
+		Schema_Object* MigratedValue = Schema_IndexObject(MigratedObject, MigratedFieldId, i);
+		const bool bIsEqual = SourceType != nullptr && MigratedType != nullptr ? AreObjectsEqual(SourceValue, *SourceType, MigratedValue, *MigratedType, Depth + 1) : IsSerializedObjectEqual(SourceValue, MigratedValue);
+		if (!bIsEqual)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SnapshotMigrationDiff::AreObjectsEqual(Schema_Object* SourceObject, const SchemaBundleDefinitionWithFields& SourceDefinition, Schema_Object* MigratedObject, const SchemaBundleDefinitionWithFields& MigratedDefinition, const int32 Depth) const
+{
+	// Fields which only one of the types has are part of the value too, so a nested field that was dropped or added changes its outer field.
+	for (const SchemaBundleFieldDefinition& SourceField : SourceDefinition.GetFields())
+	{
+		const SchemaBundleFieldDefinition* MigratedField = FindCounterpartField(&MigratedDefinition, SourceField);
+		const bool bSourceHasValues = HasValues(SourceObject, SourceField);
+		const bool bMigratedHasValues = MigratedField != nullptr && HasValues(MigratedObject, *MigratedField);
+		if (bSourceHasValues != bMigratedHasValues || (bSourceHasValues && !AreFieldsEqual(SourceObject, SourceField, MigratedObject, *MigratedField, Depth)))
+		{
+			return false;
+		}
+	}
+
+	for (const SchemaBundleFieldDefinition& MigratedField : MigratedDefinition.GetFields())
+	{
+		if (FindCounterpartField(&SourceDefinition, MigratedField) == nullptr && HasValues(MigratedObject, MigratedField))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SnapshotMigrationDiff::AreObjectRefsEqual(const FUnrealObjectRef& SourceRef, const FUnrealObjectRef& MigratedRef) const
+{
+	// Offsets are carried over to the migrated bundle the same way as the migrator carries them over, along the whole chain of outers.
+	FUnrealObjectRef CarriedOverRef = SourceRef;
+	for (FUnrealObjectRef* Ref = &CarriedOverRef; Ref != nullptr; Ref = Ref->Outer ? &Ref->Outer.GetValue() : nullptr)
+	{
+		if (Ref->Offset == SpatialConstants::INVALID_COMPONENT_ID)
+		{
+			continue;
+		}
+
+		Worker_ComponentId MigratedOffset;
+		if (!SchemaBundleDefinitions::GetCorrespondingComponentId(SourceDefinitions, MigratedDefinitions, Ref->Offset, MigratedOffset))
+		{
+			Ref->Entity = SpatialConstants::INVALID_ENTITY_ID;
+			Ref->Offset = SpatialConstants::INVALID_COMPONENT_ID;
+			break;
+		}
+		Ref->Offset = MigratedOffset;
+	}
+
+	return CarriedOverRef == MigratedRef;
+}
+
+bool SnapshotMigrationDiff::HasValues(Schema_Object* Object, const SchemaBundleFieldDefinition& Field)
+{
+	return Field.IsMap() ? Schema_GetObjectCount(Object, Field.GetId()) > 0 : SnapshotHelperLibrary::GetFieldValueCount(Object, Field.GetId(), Field, SchemaBundleFieldDefinition::TypeIndex::INNER) > 0;
+}
+
+const SchemaBundleFieldDefinition* SnapshotMigrationDiff::FindCounterpartField(const SchemaBundleDefinitionWithFields* Definition, const SchemaBundleFieldDefinition& Field)
+{
+	const SchemaBundleFieldDefinition* Counterpart = Definition != nullptr ? Definition->FindField(Field.GetName()) : nullptr;
+	return Counterpart != nullptr && Counterpart->IsSameTypeAs(Field) ? Counterpart : nullptr;
+}
+
+void SnapshotMigrationDiff::AddEntityDiff(const Worker_EntityId EntityId, const EntityDiff& Diff)
+{
+	NumSourceEntities += Diff.bInSource ? 1 : 0;
+	NumMigratedEntities += Diff.bInMigrated ? 1 : 0;
+
+	SnapshotClassDiff& ClassDiff = ClassDiffs.FindOrAdd(Diff.ClassPath);
+	ClassDiff.ClassPath = Diff.ClassPath;
+	ClassDiff.NumSourceEntities += Diff.bInSource ? 1 : 0;
+	ClassDiff.NumMigratedEntities += Diff.bInMigrated ? 1 : 0;
+
+	if (Diff.bInSource && Diff.bInMigrated)
+	{
+		NumMatchedEntities++;
+		if (Diff.HasDifferences())
+		{
+			NumChangedEntities++;
+			ClassDiff.NumChangedEntities++;
+		}
+	}
+
+	for (const TPair<FieldKey, SnapshotFieldDiffKind>& Field : Diff.Fields)
+	{
+		const int32 KindIndex = static_cast<int32>(Field.Value);
+		ClassDiff.FieldCounts[KindIndex]++;
+
+		SnapshotFieldDiff* FieldDiff = FieldDiffs.Find(Field.Key);
+		if (FieldDiff == nullptr)
+		{
+			const FieldKey& Key = Field.Key;
+			const SchemaBundleComponentDefinition* ComponentDefinition = SourceDefinitions.FindComponent(Key.SourceComponentId);
+			if (ComponentDefinition == nullptr)
+			{
+				ComponentDefinition = MigratedDefinitions.FindComponent(Key.MigratedComponentId);
+			}
+
+			FieldDiff = &FieldDiffs.Add(Key);
+			FieldDiff->ComponentName = ComponentDefinition != nullptr ? ComponentDefinition->GetName() : FString::Printf(TEXT("#%u"), Key.SourceComponentId);
+			FieldDiff->SourceComponentId = Key.SourceComponentId;
+			FieldDiff->MigratedComponentId = Key.MigratedComponentId;
+			FieldDiff->FieldName = Key.SourceField != nullptr ? Key.SourceField->GetName() : Key.MigratedField != nullptr ? Key.MigratedField->GetName() : FString{};
+			FieldDiff->SourceType = Key.SourceField != nullptr ? Key.SourceField->GetTypeName() : FString{};
+			FieldDiff->MigratedType = Key.MigratedField != nullptr ? Key.MigratedField->GetTypeName() : FString{};
+		}
+
+		if (FieldDiff->Counts[KindIndex]++ == 0)
+		{
+			FieldDiff->FirstEntityIds[KindIndex] = EntityId;
+		}
+	}
+}
+
+TArray<SnapshotFieldDiff> SnapshotMigrationDiff::GetFieldDiffs(const bool bIncludeUnchanged) const
+{
+	TArray<SnapshotFieldDiff> Diffs;
+	for (const TPair<FieldKey, SnapshotFieldDiff>& FieldDiff : FieldDiffs)
+	{
+		if (bIncludeUnchanged || FieldDiff.Value.GetNumDifferences() > 0)
+		{
+			Diffs.Add(FieldDiff.Value);
+		}
+	}
+
+	Diffs.Sort([](const SnapshotFieldDiff& LHS, const SnapshotFieldDiff& RHS) {
+		if (LHS.GetNumDifferences() != RHS.GetNumDifferences())
+		{
+			return LHS.GetNumDifferences() > RHS.GetNumDifferences();
+		}
+		return LHS.ComponentName != RHS.ComponentName ? LHS.ComponentName < RHS.ComponentName : LHS.FieldName < RHS.FieldName;
+	});
+
+	return Diffs;
+}
+
+TArray<SnapshotClassDiff> SnapshotMigrationDiff::GetClassDiffs() const
+{
+	TArray<SnapshotClassDiff> Diffs;
+	ClassDiffs.GenerateValueArray(Diffs);
+
+	const auto GetNumDifferences = [](const SnapshotClassDiff& Diff) {
+		// Entities only in one of the snapshots are differences of their own, as well as changed entities.
+		const uint64 NumMatched = FMath::Min(Diff.NumSourceEntities, Diff.NumMigratedEntities);
+		return Diff.NumChangedEntities + (Diff.NumSourceEntities - NumMatched) + (Diff.NumMigratedEntities - NumMatched);
+	};
+
+	Diffs.Sort([&GetNumDifferences](const SnapshotClassDiff& LHS, const SnapshotClassDiff& RHS) {
+		return GetNumDifferences(LHS) != GetNumDifferences(RHS) ? GetNumDifferences(LHS) > GetNumDifferences(RHS) : LHS.ClassPath < RHS.ClassPath;
+	});
+
+	return Diffs;
+}
+
+TSharedRef<FJsonObject> SnapshotMigrationDiff::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetNumberField(FString{ TEXT("NumSourceEntities") }, NumSourceEntities);
+	Json->SetNumberField(FString{ TEXT("NumMigratedEntities") }, NumMigratedEntities);
+	Json->SetNumberField(FString{ TEXT("NumMatchedEntities") }, NumMatchedEntities);
+	Json->SetNumberField(FString{ TEXT("NumChangedEntities") }, NumChangedEntities);
+
+	TArray<TSharedPtr<FJsonValue>> ClassesJson;
+	for (const SnapshotClassDiff& ClassDiff : GetClassDiffs())
+	{
+		ClassesJson.Add(MakeShareable(new FJsonValueObject(ClassDiff.ToJson())));
+	}
+	Json->SetArrayField(FString{ TEXT("Classes") }, ClassesJson);
+
+	TArray<TSharedPtr<FJsonValue>> FieldsJson;
+	for (const SnapshotFieldDiff& FieldDiff : GetFieldDiffs(true))
+	{
+		FieldsJson.Add(MakeShareable(new FJsonValueObject(FieldDiff.ToJson())));
+	}
+	Json->SetArrayField(FString{ TEXT("Fields") }, FieldsJson);
+
+	return Json;
+}
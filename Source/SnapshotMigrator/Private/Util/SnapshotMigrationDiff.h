@@ -0,0 +1,174 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+#include <WorkerSDK/improbable/c_schema.h>
+#include <WorkerSDK/improbable/c_worker.h>
+
+#include "Schema/UnrealObjectRef.h"
+
+#include "SchemaBundleWrappers.h"
+
+enum class SnapshotFieldDiffKind : uint8
+{
+	// The field holds the same values in the source entity and the migrated entity.
+	Unchanged,
+	// The field holds values in both entities, but not the same ones.
+	Changed,
+	// The field holds values in the source entity, but neither it nor a counterpart of the same type holds any in the migrated entity.
+	Dropped,
+	// The field holds values in the migrated entity, but neither it nor a counterpart of the same type holds any in the source entity.
+	Added,
+	Count
+};
+
+const TCHAR* GetSnapshotFieldDiffKindName(const SnapshotFieldDiffKind Kind);
+
+// How a field compared across every entity which has its component in either snapshot.
+struct SnapshotFieldDiff
+{
+	FString ComponentName;
+	uint32 SourceComponentId = 0;
+	uint32 MigratedComponentId = 0;
+	// Empty for components which neither bundle defines, such as improbable's standard library, which are compared as a whole.
+	FString FieldName;
+	FString SourceType;
+	FString MigratedType;
+	uint64 Counts[static_cast<int32>(SnapshotFieldDiffKind::Count)] = {};
+	// Id of the first entity the field compared each way on, for following up on a difference.
+	Worker_EntityId FirstEntityIds[static_cast<int32>(SnapshotFieldDiffKind::Count)] = {};
+
+	uint64 GetCount(const SnapshotFieldDiffKind Kind) const { return Counts[static_cast<int32>(Kind)]; }
+	uint64 GetNumDifferences() const { return GetCount(SnapshotFieldDiffKind::Changed) + GetCount(SnapshotFieldDiffKind::Dropped) + GetCount(SnapshotFieldDiffKind::Added); }
+
+	TSharedRef<FJsonObject> ToJson() const;
+};
+
+// How the entities of an actor class compared; entities without UnrealMetadata are summarised under an empty class path.
+struct SnapshotClassDiff
+{
+	FString ClassPath;
+	uint64 NumSourceEntities = 0;
+	uint64 NumMigratedEntities = 0;
+	// Entities in both snapshots with at least one field which didn't compare as unchanged.
+	uint64 NumChangedEntities = 0;
+	uint64 FieldCounts[static_cast<int32>(SnapshotFieldDiffKind::Count)] = {};
+
+	uint64 GetFieldCount(const SnapshotFieldDiffKind Kind) const { return FieldCounts[static_cast<int32>(Kind)]; }
+
+	TSharedRef<FJsonObject> ToJson() const;
+};
+
+/**
+* Compares a source snapshot with its migration field by field. Components and fields are matched across the two schema bundles the same way as the
+* migrator matches them: components by name, and fields by name and type. UnrealObjectRefs are compared with their offsets carried over to the
+* migrated bundle, and nested types field by field, so values which the migrator carries over unchanged compare as unchanged.
+* Both snapshots are streamed side by side in entity id order, and entities are compared in batches on the thread pool while the next batch is read,
+* so memory use depends on the batch size rather than the size of the snapshots.
+*/
+class SnapshotMigrationDiff
+{
+public:
+	SnapshotMigrationDiff(const SchemaBundleDefinitions& InSourceDefinitions, const SchemaBundleDefinitions& InMigratedDefinitions)
+		: SourceDefinitions(InSourceDefinitions), MigratedDefinitions(InMigratedDefinitions)
+	{
+	}
+
+	/**
+	* Compares two snapshots. A snapshot whose entities aren't in id order is first ordered into a temporary copy next to it, in runs of MaxRunBytes.
+	* Snapshots written by the migrator keep the order of their source, so this is only needed for snapshots which weren't in id order to begin with
+	* or which were ordered spatially.
+	*	@param	SourcePath		Snapshot that was migrated
+	*	@param	MigratedPath	Migrated snapshot
+	*	@param	MaxRunBytes		Serialized size of the entities sorted in memory at once, when a snapshot has to be ordered
+	*
+	*	@return					True if both snapshots were compared in full
+	*/
+	bool DiffSnapshots(const FString& SourcePath, const FString& MigratedPath, const uint64 MaxRunBytes);
+
+	// Identifies a row of the field diffs. Fields are null for components compared as a whole, and for fields without a counterpart in the other bundle.
+	struct FieldKey
+	{
+		uint32 SourceComponentId;
+		uint32 MigratedComponentId;
+		const SchemaBundleFieldDefinition* SourceField;
+		const SchemaBundleFieldDefinition* MigratedField;
+
+		bool operator==(const FieldKey& Other) const
+		{
+			return SourceComponentId == Other.SourceComponentId && MigratedComponentId == Other.MigratedComponentId && SourceField == Other.SourceField && MigratedField == Other.MigratedField;
+		}
+
+		friend uint32 GetTypeHash(const FieldKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.SourceComponentId), GetTypeHash(Key.MigratedComponentId)), HashCombine(GetTypeHash(Key.SourceField), GetTypeHash(Key.MigratedField)));
+		}
+	};
+
+	struct EntityDiff
+	{
+		FString ClassPath;
+		bool bInSource = false;
+		bool bInMigrated = false;
+		TArray<TPair<FieldKey, SnapshotFieldDiffKind>> Fields;
+
+		bool HasDifferences() const;
+	};
+
+	/**
+	* Compares one entity's components in the two snapshots. Safe to call from several threads at once.
+	*	@param	SourceComponents	Components of the entity in the source snapshot, or null if it isn't in the source
+	*	@param	MigratedComponents	Components of the entity in the migrated snapshot, or null if it isn't in the migrated snapshot
+	*	@param	OutDiff				How each of the entity's fields compared
+	*/
+	void DiffEntity(const TArray<Worker_ComponentData>* SourceComponents, const TArray<Worker_ComponentData>* MigratedComponents, EntityDiff& OutDiff) const;
+
+	// Adds an entity's diff to the totals. Entities have to be added in id order for the first entity ids to be the lowest.
+	void AddEntityDiff(const Worker_EntityId EntityId, const EntityDiff& Diff);
+
+	// Fields with the most differences come first; fields which compared the same on every entity are left out unless asked for.
+	TArray<SnapshotFieldDiff> GetFieldDiffs(const bool bIncludeUnchanged) const;
+	// Classes with the most changed and unmatched entities come first.
+	TArray<SnapshotClassDiff> GetClassDiffs() const;
+
+	uint64 GetNumSourceEntities() const { return NumSourceEntities; }
+	uint64 GetNumMigratedEntities() const { return NumMigratedEntities; }
+	uint64 GetNumMatchedEntities() const { return NumMatchedEntities; }
+	uint64 GetNumChangedEntities() const { return NumChangedEntities; }
+
+	TSharedRef<FJsonObject> ToJson() const;
+
+	// Number of entities read from each snapshot before they're handed to the thread pool. Two batches are held in memory at once.
+	static constexpr int32 BATCH_SIZE = 4096;
+
+	// Nested types deeper than this are compared by their serialized data rather than field by field.
+	static constexpr int32 MAX_OBJECT_DEPTH = 32;
+
+private:
+	// Streams both snapshots in id order. Returns false without comparing the rest if either snapshot turns out not to be in id order.
+	bool DiffOrderedSnapshots(const FString& SourcePath, const FString& MigratedPath, bool& bOutSourceUnordered, bool& bOutMigratedUnordered);
+	void Reset();
+
+	void DiffComponent(const Worker_ComponentData& SourceComponent, const SchemaBundleComponentDefinition& SourceDefinition, const Worker_ComponentData* MigratedComponent, const SchemaBundleComponentDefinition* MigratedDefinition, EntityDiff& OutDiff) const;
+
+	bool AreFieldsEqual(Schema_Object* SourceObject, const SchemaBundleFieldDefinition& SourceField, Schema_Object* MigratedObject, const SchemaBundleFieldDefinition& MigratedField, const int32 Depth) const;
+	bool AreValuesEqual(Schema_Object* SourceObject, const Schema_FieldId SourceFieldId, Schema_Object* MigratedObject, const Schema_FieldId MigratedFieldId, const SchemaBundleFieldDefinition& Field, const SchemaBundleFieldDefinition::TypeIndex Index, const int32 Depth) const;
+	bool AreObjectsEqual(Schema_Object* SourceObject, const SchemaBundleDefinitionWithFields& SourceDefinition, Schema_Object* MigratedObject, const SchemaBundleDefinitionWithFields& MigratedDefinition, const int32 Depth) const;
+	bool AreObjectRefsEqual(const FUnrealObjectRef& SourceRef, const FUnrealObjectRef& MigratedRef) const;
+
+	static bool HasValues(Schema_Object* Object, const SchemaBundleFieldDefinition& Field);
+	static const SchemaBundleFieldDefinition* FindCounterpartField(const SchemaBundleDefinitionWithFields* Definition, const SchemaBundleFieldDefinition& Field);
+
+	const SchemaBundleDefinitions& SourceDefinitions;
+	const SchemaBundleDefinitions& MigratedDefinitions;
+
+	uint64 NumSourceEntities = 0;
+	uint64 NumMigratedEntities = 0;
+	uint64 NumMatchedEntities = 0;
+	uint64 NumChangedEntities = 0;
+	TMap<FieldKey, SnapshotFieldDiff> FieldDiffs;
+	TMap<FString, SnapshotClassDiff> ClassDiffs;
+};
@@ -0,0 +1,53 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationEntityIndex.h"
+
+#include "Algo/BinarySearch.h"
+
+void SnapshotMigrationEntityIndex::Build()
+{
+	Bitmap.Empty();
+
+	if (EntityIds.Num() == 0)
+	{
+		NumEntityIds = 0;
+		return;
+	}
+
+	Worker_EntityId MaxEntityId = EntityIds[0];
+	MinEntityId = EntityIds[0];
+	for (const Worker_EntityId EntityId : EntityIds)
+	{
+		MinEntityId = FMath::Min(MinEntityId, EntityId);
+		MaxEntityId = FMath::Max(MaxEntityId, EntityId);
+	}
+
+	const int64 Range = MaxEntityId - MinEntityId + 1;
+	if (Range <= MAX_int32 && Range <= MAX_BITS_PER_ENTITY_ID * EntityIds.Num())
+	{
+		Bitmap.Init(false, static_cast<int32>(Range));
+		for (const Worker_EntityId EntityId : EntityIds)
+		{
+			Bitmap[static_cast<int32>(EntityId - MinEntityId)] = true;
+		}
+
+		// Snapshots never contain the same entity twice, so every id added is counted.
+		NumEntityIds = EntityIds.Num();
+		EntityIds.Empty();
+		return;
+	}
+
+	EntityIds.Sort();
+	NumEntityIds = EntityIds.Num();
+}
+
+bool SnapshotMigrationEntityIndex::Contains(const Worker_EntityId EntityId) const
+{
+	if (IsBitmap())
+	{
+		const int64 Offset = EntityId - MinEntityId;
+		return Offset >= 0 && Offset < Bitmap.Num() && Bitmap[static_cast<int32>(Offset)];
+	}
+
+	return Algo::BinarySearch(EntityIds, EntityId) != INDEX_NONE;
+}
@@ -0,0 +1,38 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/BitArray.h"
+
+#include <WorkerSDK/improbable/c_worker.h>
+
+/**
+* A set of entity ids, built once per snapshot and then looked up for every entity reference that's migrated.
+* The ids are held in a bitmap over the range between the smallest and the largest of them, so that a lookup is a range check and a bit test.
+* Snapshots allocate entity ids densely, which keeps the bitmap small; should they be too sparse for that, the ids are kept in a sorted array instead.
+*/
+class SnapshotMigrationEntityIndex
+{
+public:
+	void Add(const Worker_EntityId EntityId) { EntityIds.Add(EntityId); }
+
+	// Must be called once every id has been added, and before the first lookup.
+	void Build();
+
+	bool Contains(const Worker_EntityId EntityId) const;
+
+	int32 Num() const { return NumEntityIds; }
+	bool IsBitmap() const { return Bitmap.Num() > 0; }
+	SIZE_T GetAllocatedSize() const { return EntityIds.GetAllocatedSize() + Bitmap.GetAllocatedSize(); }
+
+	// A bitmap is used as long as it takes no more memory than the sorted array of ids would.
+	static constexpr int64 MAX_BITS_PER_ENTITY_ID = 8 * sizeof(Worker_EntityId);
+
+private:
+	// Only kept once built if the ids are too sparse for a bitmap.
+	TArray<Worker_EntityId> EntityIds;
+	TBitArray<> Bitmap;
+	Worker_EntityId MinEntityId = 0;
+	int32 NumEntityIds = 0;
+};
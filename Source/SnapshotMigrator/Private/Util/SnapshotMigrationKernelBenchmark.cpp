@@ -0,0 +1,303 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationKernelBenchmark.h"
+
+#include "Dom/JsonValue.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeExit.h"
+
+#include "Util/SnapshotMigrationAllocationCounter.h"
+
+#include "Schema/StandardLibrary.h"
+#include "Utils/SchemaUtils.h"
+
+namespace
+{
+	const Schema_FieldId OLD_FIELD_ID = 1;
+	const Schema_FieldId NEW_FIELD_ID = 2;
+
+	// Every kernel is called at least this many times, so that short runs still average over more than one call, and at most this many times, so
+	// that tiny inputs don't take forever to reach the minimum time.
+	const int32 MIN_CALLS = 3;
+	const int32 MAX_CALLS = 1000000;
+
+	const FString SINGULAR{ TEXT("Singular") };
+	const FString LIST{ TEXT("List") };
+	const FString MAP{ TEXT("Map") };
+}
+
+TSharedRef<FJsonObject> SnapshotMigrationKernelBenchmark::Result::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetStringField(FString{ TEXT("Kernel") }, Kernel);
+	Json->SetStringField(FString{ TEXT("Cardinality") }, Cardinality);
+	Json->SetNumberField(FString{ TEXT("NumElements") }, NumElements);
+	Json->SetNumberField(FString{ TEXT("NumCalls") }, NumCalls);
+	Json->SetNumberField(FString{ TEXT("NanosecondsPerElement") }, NanosecondsPerElement);
+	Json->SetNumberField(FString{ TEXT("AllocationsPerCall") }, AllocationsPerCall);
+	Json->SetStringField(FString{ TEXT("AllocationsCounted") }, FString{ TEXT("UnrealAllocatorOnly") });
+
+	return Json;
+}
+
+SnapshotMigrationKernelBenchmark::SnapshotMigrationKernelBenchmark(const SnapshotMigrationAllocationCounter& InAllocationCounter, const double InMinSecondsPerCase, const int32 InOuterDepth)
+	: AllocationCounter(InAllocationCounter)
+	, MinSecondsPerCase(InMinSecondsPerCase)
+	, OuterDepth(InOuterDepth)
+	, OldDefinitions(CreateDefinitions(FIRST_OLD_COMPONENT_ID))
+	, NewDefinitions(CreateDefinitions(FIRST_NEW_COMPONENT_ID))
+	, Migrator(OldDefinitions, NewDefinitions)
+{
+}
+
+TArray<SnapshotMigrationKernelBenchmark::Result> SnapshotMigrationKernelBenchmark::Run(const TArray<int32>& Sizes)
+{
+	const auto PopulateInt32 = [](Schema_Object* Object, const int32 NumElements) {
+		for (int32 i = 0; i < NumElements; i++)
+		{
+			Schema_AddInt32(Object, OLD_FIELD_ID, i);
+		}
+	};
+
+	const auto PopulateUint32 = [](Schema_Object* Object, const int32 NumElements) {
+		for (int32 i = 0; i < NumElements; i++)
+		{
+			Schema_AddUint32(Object, OLD_FIELD_ID, static_cast<uint32>(i));
+		}
+	};
+
+	const auto PopulateFloat = [](Schema_Object* Object, const int32 NumElements) {
+		for (int32 i = 0; i < NumElements; i++)
+		{
+			Schema_AddFloat(Object, OLD_FIELD_ID, i * 0.5f);
+		}
+	};
+
+	const auto PopulateString = [](Schema_Object* Object, const int32 NumElements) {
+		for (int32 i = 0; i < NumElements; i++)
+		{
+			SpatialGDK::AddStringToSchema(Object, OLD_FIELD_ID, FString::Printf(TEXT("Value_%d"), i));
+		}
+	};
+
+	const auto PopulateBytes = [](Schema_Object* Object, const int32 NumElements) {
+		uint8 Bytes[16] = {};
+		for (int32 i = 0; i < NumElements; i++)
+		{
+			Bytes[0] = static_cast<uint8>(i);
+			SpatialGDK::AddBytesToSchema(Object, OLD_FIELD_ID, Bytes, sizeof(Bytes));
+		}
+	};
+
+	const auto PopulateUnrealObjectRef = [this](Schema_Object* Object, const int32 NumElements) {
+		for (int32 i = 0; i < NumElements; i++)
+		{
+			SpatialGDK::AddObjectRefToSchema(Object, OLD_FIELD_ID, CreateUnrealObjectRef(i));
+		}
+	};
+
+	const auto PopulateCoordinates = [](Schema_Object* Object, const int32 NumElements) {
+		for (int32 i = 0; i < NumElements; i++)
+		{
+			SpatialGDK::AddCoordinateToSchema(Object, OLD_FIELD_ID, SpatialGDK::Coordinates{ static_cast<double>(i), 0.0, -static_cast<double>(i) });
+		}
+	};
+
+	const auto PopulateWriteACLMap = [](Schema_Object* Object, const int32 NumElements) {
+		const WorkerRequirementSet RequirementSet{ WorkerAttributeSet{ FString{ TEXT("UnrealWorker") } } };
+		for (int32 i = 0; i < NumElements; i++)
+		{
+			Schema_Object* ACLPairObject = Schema_AddObject(Object, OLD_FIELD_ID);
+			Schema_AddUint32(ACLPairObject, SCHEMA_MAP_KEY_FIELD_ID, GetOldComponentId(i));
+			SpatialGDK::AddWorkerRequirementSetToSchema(ACLPairObject, SCHEMA_MAP_VALUE_FIELD_ID, RequirementSet);
+		}
+	};
+
+	const auto MigratePrimitive = [this](const SchemaBundleFieldDefinition::SchemaPrimitiveType PrimitiveType) {
+		return [this, PrimitiveType](Schema_Object* OldObject, Schema_Object* NewObject) {
+			Migrator.MigratePrimitiveField(PrimitiveType, OLD_FIELD_ID, NEW_FIELD_ID, OldObject, NewObject);
+		};
+	};
+
+	const auto MigrateObject = [this](const FString& ObjectType) {
+		return [this, ObjectType](Schema_Object* OldObject, Schema_Object* NewObject) {
+			Migrator.MigrateObjectField(ObjectType, OLD_FIELD_ID, NEW_FIELD_ID, OldObject, NewObject);
+		};
+	};
+
+	// Calls the generic kernel directly, so the cost of dispatching on the field type can be told apart from the cost of the migration itself.
+	const auto MigrateInternal = [](Schema_Object* OldObject, Schema_Object* NewObject) {
+		const SnapshotDataMigrator::SchemaFunctions<uint32_t> Funcs
+		{
+			Schema_IndexUint32,
+			Schema_GetUint32Count,
+			Schema_AddUint32
+		};
+
+		SnapshotDataMigrator::Migrate_Internal(Funcs, OLD_FIELD_ID, NEW_FIELD_ID, OldObject, NewObject);
+	};
+
+	const FString UnrealObjectRefKernel = FString::Printf(TEXT("MigrateObjectField<UnrealObjectRef, %d outers>"), OuterDepth);
+
+	TArray<Result> Results;
+
+	Results.Add(RunSchemaKernel(TEXT("MigratePrimitiveField<Int32>"), SINGULAR, 1, PopulateInt32, MigratePrimitive(SchemaBundleFieldDefinition::SchemaPrimitiveType::Int32)));
+	Results.Add(RunSchemaKernel(TEXT("MigratePrimitiveField<String>"), SINGULAR, 1, PopulateString, MigratePrimitive(SchemaBundleFieldDefinition::SchemaPrimitiveType::String)));
+	Results.Add(RunSchemaKernel(UnrealObjectRefKernel, SINGULAR, 1, PopulateUnrealObjectRef, MigrateObject(Migrator.UNREAL_OBJECT_REF_TYPE)));
+	Results.Add(RunPatchUnrealObjectRef(1));
+
+	for (const int32 Size : Sizes)
+	{
+		Results.Add(RunSchemaKernel(TEXT("Migrate_Internal<Uint32>"), LIST, Size, PopulateUint32, MigrateInternal));
+		Results.Add(RunSchemaKernel(TEXT("MigratePrimitiveField<Int32>"), LIST, Size, PopulateInt32, MigratePrimitive(SchemaBundleFieldDefinition::SchemaPrimitiveType::Int32)));
+		Results.Add(RunSchemaKernel(TEXT("MigratePrimitiveField<Float>"), LIST, Size, PopulateFloat, MigratePrimitive(SchemaBundleFieldDefinition::SchemaPrimitiveType::Float)));
+		Results.Add(RunSchemaKernel(TEXT("MigratePrimitiveField<String>"), LIST, Size, PopulateString, MigratePrimitive(SchemaBundleFieldDefinition::SchemaPrimitiveType::String)));
+		Results.Add(RunSchemaKernel(TEXT("MigratePrimitiveField<Bytes>"), LIST, Size, PopulateBytes, MigratePrimitive(SchemaBundleFieldDefinition::SchemaPrimitiveType::Bytes)));
+		Results.Add(RunSchemaKernel(UnrealObjectRefKernel, LIST, Size, PopulateUnrealObjectRef, MigrateObject(Migrator.UNREAL_OBJECT_REF_TYPE)));
+		Results.Add(RunSchemaKernel(TEXT("MigrateObjectField<Coordinates>"), LIST, Size, PopulateCoordinates, MigrateObject(Migrator.COORDINATES_TYPE)));
+		Results.Add(RunSchemaKernel(TEXT("MigrateObjectField<WriteACLMap>"), MAP, Size, PopulateWriteACLMap, MigrateObject(SchemaBundleFieldDefinition::WRITE_ACL_MAP)));
+		Results.Add(RunPatchUnrealObjectRef(Size));
+	}
+
+	return Results;
+}
+
+SchemaBundleDefinitions SnapshotMigrationKernelBenchmark::CreateDefinitions(const uint32 FirstComponentId)
+{
+	// Components are matched between bundles by name, so giving them different ids in each bundle means every reference to one gets remapped.
+	TArray<TSharedPtr<FJsonValue>> ComponentsJson;
+	for (int32 i = 0; i < NUM_COMPONENTS; i++)
+	{
+		const FString Name = FString::Printf(TEXT("KernelBenchmarkComponent%d"), i);
+
+		TSharedPtr<FJsonObject> ComponentJson = MakeShareable(new FJsonObject);
+		ComponentJson->SetNumberField(TEXT("componentId"), FirstComponentId + i);
+		ComponentJson->SetStringField(TEXT("qualifiedName"), TEXT("unreal.generated.") + Name);
+		ComponentJson->SetStringField(TEXT("name"), Name);
+		ComponentJson->SetStringField(TEXT("dataDefinition"), FString{});
+		ComponentJson->SetArrayField(TEXT("fields"), TArray<TSharedPtr<FJsonValue>>{});
+		ComponentsJson.Add(MakeShareable(new FJsonValueObject(ComponentJson)));
+	}
+
+	TSharedPtr<FJsonObject> FileJson = MakeShareable(new FJsonObject);
+	FileJson->SetArrayField(TEXT("types"), TArray<TSharedPtr<FJsonValue>>{});
+	FileJson->SetArrayField(TEXT("components"), ComponentsJson);
+
+	TSharedPtr<FJsonObject> BundleJson = MakeShareable(new FJsonObject);
+	BundleJson->SetArrayField(TEXT("schemaFiles"), TArray<TSharedPtr<FJsonValue>>{ MakeShareable(new FJsonValueObject(FileJson)) });
+
+	return SchemaBundleDefinitions{ BundleJson };
+}
+
+SnapshotMigrationKernelBenchmark::Result SnapshotMigrationKernelBenchmark::RunSchemaKernel(const FString& Kernel, const FString& Cardinality, const int32 NumElements, const PopulateFunction& Populate, const KernelFunction& KernelToRun)
+{
+	Schema_ComponentData* OldData = Schema_CreateComponentData();
+	ON_SCOPE_EXIT
+	{
+		Schema_DestroyComponentData(OldData);
+	};
+
+	Schema_Object* OldObject = Schema_GetComponentDataFields(OldData);
+	Populate(OldObject, NumElements);
+
+	// Warm up, so that any lazily built indices into the old object aren't counted against the first call.
+	{
+		Schema_ComponentData* NewData = Schema_CreateComponentData();
+		KernelToRun(OldObject, Schema_GetComponentDataFields(NewData));
+		Schema_DestroyComponentData(NewData);
+	}
+
+	uint64 KernelCycles = 0;
+	int64 NumAllocations = 0;
+	int32 NumCalls = 0;
+
+	while (NumCalls < MIN_CALLS || (FPlatformTime::ToSeconds64(KernelCycles) < MinSecondsPerCase && NumCalls < MAX_CALLS))
+	{
+		// A fresh object for every call, since the kernels append to whatever is already in the new object.
+		Schema_ComponentData* NewData = Schema_CreateComponentData();
+		Schema_Object* NewObject = Schema_GetComponentDataFields(NewData);
+
+		const int64 StartAllocations = AllocationCounter.GetNumThreadAllocations();
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		KernelToRun(OldObject, NewObject);
+
+		KernelCycles += FPlatformTime::Cycles64() - StartCycles;
+		NumAllocations += AllocationCounter.GetNumThreadAllocations() - StartAllocations;
+
+		Schema_DestroyComponentData(NewData);
+		NumCalls++;
+	}
+
+	Result KernelResult;
+	KernelResult.Kernel = Kernel;
+	KernelResult.Cardinality = Cardinality;
+	KernelResult.NumElements = NumElements;
+	KernelResult.NumCalls = NumCalls;
+	KernelResult.NanosecondsPerElement = FPlatformTime::ToSeconds64(KernelCycles) * 1e9 / (static_cast<double>(NumCalls) * NumElements);
+	KernelResult.AllocationsPerCall = static_cast<double>(NumAllocations) / NumCalls;
+	return KernelResult;
+}
+
+SnapshotMigrationKernelBenchmark::Result SnapshotMigrationKernelBenchmark::RunPatchUnrealObjectRef(const int32 NumElements)
+{
+	TArray<FUnrealObjectRef> ObjectRefs;
+	ObjectRefs.Reserve(NumElements);
+	for (int32 i = 0; i < NumElements; i++)
+	{
+		ObjectRefs.Add(CreateUnrealObjectRef(i));
+	}
+
+	uint64 KernelCycles = 0;
+	int64 NumAllocations = 0;
+	int32 NumCalls = 0;
+
+	// Patching modifies the refs in place, so each call works on a fresh copy.
+	TArray<FUnrealObjectRef> PatchedObjectRefs;
+	while (NumCalls < MIN_CALLS || (FPlatformTime::ToSeconds64(KernelCycles) < MinSecondsPerCase && NumCalls < MAX_CALLS))
+	{
+		PatchedObjectRefs = ObjectRefs;
+
+		const int64 StartAllocations = AllocationCounter.GetNumThreadAllocations();
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (FUnrealObjectRef& ObjectRef : PatchedObjectRefs)
+		{
+			Migrator.PatchUnrealObjectRef(ObjectRef);
+		}
+
+		KernelCycles += FPlatformTime::Cycles64() - StartCycles;
+		NumAllocations += AllocationCounter.GetNumThreadAllocations() - StartAllocations;
+
+		NumCalls++;
+	}
+
+	Result KernelResult;
+	KernelResult.Kernel = FString::Printf(TEXT("PatchUnrealObjectRef<%d outers>"), OuterDepth);
+	KernelResult.Cardinality = NumElements == 1 ? SINGULAR : LIST;
+	KernelResult.NumElements = NumElements;
+	// Unlike the other kernels, each ref is patched by a call of its own.
+	KernelResult.NumCalls = NumCalls * NumElements;
+	KernelResult.NanosecondsPerElement = FPlatformTime::ToSeconds64(KernelCycles) * 1e9 / KernelResult.NumCalls;
+	KernelResult.AllocationsPerCall = static_cast<double>(NumAllocations) / KernelResult.NumCalls;
+	return KernelResult;
+}
+
+FUnrealObjectRef SnapshotMigrationKernelBenchmark::CreateUnrealObjectRef(const int32 Index) const
+{
+	const Worker_EntityId EntityId = Index + 1;
+
+	// Built from the outermost ref inwards, each pointing at a different component so that every level needs remapping.
+	TSchemaOption<FUnrealObjectRef> Outer;
+	for (int32 Depth = OuterDepth; Depth > 0; Depth--)
+	{
+		FUnrealObjectRef OuterRef{ EntityId, GetOldComponentId(Index + Depth) };
+		OuterRef.Outer = Outer;
+		Outer = OuterRef;
+	}
+
+	FUnrealObjectRef ObjectRef{ EntityId, GetOldComponentId(Index) };
+	ObjectRef.Outer = Outer;
+	return ObjectRef;
+}
@@ -0,0 +1,77 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+#include <WorkerSDK/improbable/c_schema.h>
+
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotHelperLibrary.h"
+
+class SnapshotMigrationAllocationCounter;
+
+/**
+* Times SnapshotDataMigrator's field migration kernels over in-memory schema objects, without the snapshot streams, net driver or actors the
+* full migration needs. Old and new schema bundles are built in memory, with component ids that differ between the two so that object refs and
+* write ACL entries are remapped as they would be in a real migration. Allocation counts only cover Unreal's allocator, not the Worker SDK's.
+*/
+class SnapshotMigrationKernelBenchmark
+{
+public:
+	struct Result
+	{
+		FString Kernel;
+		FString Cardinality;
+		int32 NumElements = 0;
+		int32 NumCalls = 0;
+		double NanosecondsPerElement = 0.0;
+		// Only allocations made through Unreal's allocator (TArray, FString, TFunction, ...) are counted. The Worker SDK allocates the schema objects
+		// that Schema_AddObject, Schema_AddBytes and the like write to with an allocator of its own, which can only be replaced before the SDK is
+		// first used, long before a commandlet runs; this is a lower bound on what each call allocates.
+		double AllocationsPerCall = 0.0;
+
+		TSharedRef<FJsonObject> ToJson() const;
+	};
+
+	/**
+	*	@param	InAllocationCounter		Counter to measure each call's allocations with; only the calling thread's are counted, since the kernels run on it
+	*	@param	InMinSecondsPerCase		Each kernel is called until it has spent at least this long running for a given input size
+	*	@param	InOuterDepth			Number of outers nested in each generated UnrealObjectRef
+	*/
+	SnapshotMigrationKernelBenchmark(const SnapshotMigrationAllocationCounter& InAllocationCounter, const double InMinSecondsPerCase, const int32 InOuterDepth);
+
+	/**
+	* Runs every kernel over lists and maps of each of the given sizes, and over singular fields.
+	*	@param	Sizes	Number of elements in each list or map input
+	*
+	*	@return			One result per kernel and input
+	*/
+	TArray<Result> Run(const TArray<int32>& Sizes);
+
+private:
+	using PopulateFunction = TFunction<void(Schema_Object* Object, const int32 NumElements)>;
+	using KernelFunction = TFunction<void(Schema_Object* OldObject, Schema_Object* NewObject)>;
+
+	static const int32 NUM_COMPONENTS = 16;
+	static const uint32 FIRST_OLD_COMPONENT_ID = 10000;
+	static const uint32 FIRST_NEW_COMPONENT_ID = 20000;
+
+	static SchemaBundleDefinitions CreateDefinitions(const uint32 FirstComponentId);
+	static uint32 GetOldComponentId(const int32 Index) { return FIRST_OLD_COMPONENT_ID + Index % NUM_COMPONENTS; }
+
+	Result RunSchemaKernel(const FString& Kernel, const FString& Cardinality, const int32 NumElements, const PopulateFunction& Populate, const KernelFunction& KernelToRun);
+	Result RunPatchUnrealObjectRef(const int32 NumElements);
+
+	FUnrealObjectRef CreateUnrealObjectRef(const int32 Index) const;
+
+	const SnapshotMigrationAllocationCounter& AllocationCounter;
+	const double MinSecondsPerCase;
+	const int32 OuterDepth;
+
+	// The migrator keeps references to the definitions, so they have to be declared first.
+	const SchemaBundleDefinitions OldDefinitions;
+	const SchemaBundleDefinitions NewDefinitions;
+	SnapshotDataMigrator Migrator;
+};
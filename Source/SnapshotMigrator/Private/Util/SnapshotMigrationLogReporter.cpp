@@ -10,8 +10,180 @@ void SnapshotMigrationLogReporter::WriteToReport(const SnapshotMigrationData& Mi
 	ReportLines.Add(FString::Printf(TEXT("%-25s: %6d "), TEXT("# Encountered"), MigrationData.GetNumEncounteredEntities()));
 	ReportLines.Add(FString::Printf(TEXT("%-25s: %6d (%5.2f%% of Encountered)"), TEXT("# Successfully Migrated"), MigrationData.GetNumMigratedEntities(), MigrationData.GetPercentMigratedEntities()));
 	ReportLines.Add(FString::Printf(TEXT("%-25s: %6d (%5.2f%% of Encountered)"), TEXT("# Skipped"), MigrationData.GetNumSkippedEntities(), MigrationData.GetPercentSkippedEntities()));
+	ReportLines.Add(FString::Printf(TEXT("%-25s: %6d "), TEXT("# Skipped Field Updates"), MigrationData.GetNumSkippedComponentFieldUpdates()));
+	if (MigrationData.GetNumMigrationCacheLookups() > 0)
+	{
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %6d (%5.2f%% of Lookups)"), TEXT("# Migration Cache Hits"), MigrationData.GetNumMigrationCacheHits(), MigrationData.GetPercentMigrationCacheHits()));
+	}
+	if (MigrationData.IsSampled())
+	{
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %6d (sampling %.2f%% of entities, plus the first of each class)"), TEXT("# Not Sampled"), MigrationData.GetNumUnsampledEntities(), 100.f * MigrationData.GetSampleFraction()));
+	}
+	if (MigrationData.IsPartial())
+	{
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %6d (%s)"), TEXT("# Not Selected"), MigrationData.GetNumUnselectedEntities(),
+			MigrationData.CopiesUnselectedEntities() ? TEXT("copied unchanged") : TEXT("dropped")));
+	}
+	if (MigrationData.IsDryRun())
+	{
+		ReportLines.Add(FString{});
+		ReportLines.Add(FString{ TEXT("Dry run: nothing was written, and entity counts are what a full migration is projected to produce.") });
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %.2f seconds"), TEXT("Projected Time"), MigrationData.GetProjectedElapsedTime()));
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %.2f MB"), TEXT("Projected Output Size"), MigrationData.GetProjectedOutputBytes() / (1024.0 * 1024.0)));
+	}
+	if (MigrationData.IsSpatiallyOrdered())
+	{
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %.2f -> %.2f (mean distance between neighbouring entities)"), TEXT("Spatial Order"), MigrationData.GetMeanNeighbourDistanceBefore(), MigrationData.GetMeanNeighbourDistanceAfter()));
+	}
+	if (MigrationData.IsCompacted())
+	{
+		const uint64 BytesBefore = MigrationData.GetCompactionBytesBefore();
+		const uint64 BytesAfter = MigrationData.GetCompactionBytesAfter();
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %.2f MB -> %.2f MB (%.2f%% smaller)"), TEXT("Compaction"),
+			BytesBefore / (1024.0 * 1024.0), BytesAfter / (1024.0 * 1024.0), BytesBefore > 0 ? (100.0 * (BytesBefore - BytesAfter)) / BytesBefore : 0.0));
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %lld components, %lld fields"), TEXT("# Compacted"), MigrationData.GetNumCompactedComponents(), MigrationData.GetNumCompactedFields()));
+	}
+	if (MigrationData.IsVerified())
+	{
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %llu entities in %.2f seconds"), TEXT("Verified"), MigrationData.GetNumVerifiedEntities(), MigrationData.GetVerificationTime()));
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %6lld"), TEXT("# Verification Failures"), MigrationData.GetNumVerificationFailures()));
+	}
+
+	ReportLines.Add(FString{});
+	ReportLines.Add(FString::Printf(TEXT("%-25s: %10s %8s %10s %10s %10s %10s %10s"), TEXT("Phase"), TEXT("Total (s)"), TEXT("% Time"), TEXT("Count"), TEXT("p50 (ms)"), TEXT("p90 (ms)"), TEXT("p99 (ms)"), TEXT("Max (ms)")));
+	for (int32 i = 0; i < static_cast<int32>(SnapshotMigrationPhase::Count); i++)
+	{
+		const SnapshotMigrationPhase Phase = static_cast<SnapshotMigrationPhase>(i);
+		const SnapshotMigrationLatencyHistogram& Latency = MigrationData.GetPhaseLatency(Phase);
+		const float PercentTime = MigrationData.GetElapsedTime() > 0.f ? (100.f * Latency.GetTotalSeconds()) / MigrationData.GetElapsedTime() : 0.f;
+
+		ReportLines.Add(FString::Printf(TEXT("%-25s: %10.2f %7.2f%% %10llu %10.3f %10.3f %10.3f %10.3f"),
+			GetSnapshotMigrationPhaseName(Phase),
+			Latency.GetTotalSeconds(),
+			PercentTime,
+			Latency.GetCount(),
+			1000.0 * Latency.GetPercentileSeconds(50.f),
+			1000.0 * Latency.GetPercentileSeconds(90.f),
+			1000.0 * Latency.GetPercentileSeconds(99.f),
+			1000.0 * Latency.GetMaxSeconds()));
+	}
+
+	const TArray<SkippedEntityCount> SkippedEntityCounts = MigrationData.GetSkippedEntityCounts();
+	if (SkippedEntityCounts.Num() > 0)
+	{
+		const int32 NumRowsToReport = FMath::Min(SkippedEntityCounts.Num(), MAX_SKIP_ROWS_TO_REPORT);
+
+		ReportLines.Add(FString{});
+		ReportLines.Add(FString::Printf(TEXT("%8s  %-25s %s"), TEXT("Skipped"), TEXT("Reason"), TEXT("Class")));
+		for (int32 i = 0; i < NumRowsToReport; i++)
+		{
+			const SkippedEntityCount& Count = SkippedEntityCounts[i];
+			ReportLines.Add(FString::Printf(TEXT("%8d  %-25s %s"), Count.Count, GetSnapshotMigrationSkipReasonName(Count.SkipReason), *MigrationData.GetInternedString(Count.ClassIndex)));
+		}
+
+		if (SkippedEntityCounts.Num() > NumRowsToReport)
+		{
+			ReportLines.Add(FString::Printf(TEXT("... %d less frequent class skips omitted"), SkippedEntityCounts.Num() - NumRowsToReport));
+		}
+	}
+
+	const TArray<SkippedComponentFieldCount> SkippedComponentFieldCounts = MigrationData.GetSkippedComponentFieldCounts();
+	if (SkippedComponentFieldCounts.Num() > 0)
+	{
+		const int32 NumRowsToReport = FMath::Min(SkippedComponentFieldCounts.Num(), MAX_SKIP_ROWS_TO_REPORT);
+
+		ReportLines.Add(FString{});
+		ReportLines.Add(FString::Printf(TEXT("%8s  %-25s %10s  %s"), TEXT("Skipped"), TEXT("Reason"), TEXT("Component"), TEXT("Field")));
+		for (int32 i = 0; i < NumRowsToReport; i++)
+		{
+			const SkippedComponentFieldCount& Count = SkippedComponentFieldCounts[i];
+			ReportLines.Add(FString::Printf(TEXT("%8d  %-25s %10u  %s"), Count.Count, GetSnapshotMigrationSkipReasonName(Count.SkipReason), Count.ComponentId, *MigrationData.GetInternedString(Count.FieldNameIndex)));
+		}
+
+		if (SkippedComponentFieldCounts.Num() > NumRowsToReport)
+		{
+			ReportLines.Add(FString::Printf(TEXT("... %d less frequent field skips omitted"), SkippedComponentFieldCounts.Num() - NumRowsToReport));
+		}
+	}
+
+	const TArray<VerificationFailureCount> VerificationFailureCounts = MigrationData.GetVerificationFailureCounts();
+	if (VerificationFailureCounts.Num() > 0)
+	{
+		const int32 NumRowsToReport = FMath::Min(VerificationFailureCounts.Num(), MAX_SKIP_ROWS_TO_REPORT);
+
+		ReportLines.Add(FString{});
+		ReportLines.Add(FString::Printf(TEXT("%8s  %-25s %10s %12s  %s"), TEXT("Failed"), TEXT("Failure"), TEXT("Component"), TEXT("First Entity"), TEXT("Field")));
+		for (int32 i = 0; i < NumRowsToReport; i++)
+		{
+			const VerificationFailureCount& Count = VerificationFailureCounts[i];
+			ReportLines.Add(FString::Printf(TEXT("%8d  %-25s %10u %12u  %s"), Count.Count, GetSnapshotVerificationFailureName(Count.Failure), Count.ComponentId, Count.FirstEntityId, *MigrationData.GetInternedString(Count.FieldNameIndex)));
+		}
+
+		if (VerificationFailureCounts.Num() > NumRowsToReport)
+		{
+			ReportLines.Add(FString::Printf(TEXT("... %d less frequent verification failures omitted"), VerificationFailureCounts.Num() - NumRowsToReport));
+		}
+	}
+
+	const TMap<FString, ClassMigrationStats>& ClassStats = MigrationData.GetClassStats();
+	if (ClassStats.Num() > 0)
+	{
+		const TArray<FString> Classes = MigrationData.GetClassesByTotalTime();
+		const int32 NumClassesToReport = FMath::Min(Classes.Num(), MAX_CLASSES_TO_REPORT);
+
+		ReportLines.Add(FString{});
+		ReportLines.Add(FString::Printf(TEXT("%10s %8s %8s %10s %10s %10s %12s  %s"), TEXT("Total (s)"), TEXT("Entities"), TEXT("Migrated"), TEXT("Mean (ms)"), TEXT("Max (ms)"), TEXT("Components"), TEXT("Bytes"), TEXT("Class")));
+		for (int32 i = 0; i < NumClassesToReport; i++)
+		{
+			const ClassMigrationStats& Stats = ClassStats.FindChecked(Classes[i]);
+			ReportLines.Add(FString::Printf(TEXT("%10.2f %8d %8d %10.3f %10.3f %10lld %12lld  %s"),
+				Stats.TotalTime,
+				Stats.NumEntities,
+				Stats.NumMigratedEntities,
+				1000.0 * Stats.TotalTime / Stats.NumEntities,
+				1000.0 * Stats.MaxTime,
+				Stats.NumComponents,
+				Stats.MigratedBytes,
+				*Classes[i]));
+		}
+
+		if (Classes.Num() > NumClassesToReport)
+		{
+			ReportLines.Add(FString::Printf(TEXT("... %d cheaper classes omitted"), Classes.Num() - NumClassesToReport));
+		}
+	}
+
 	ReportLines.Add(FString{ TEXT("-- End of Migration Report -- ") });
 	ReportLines.Add(FString{});
 
 	Write(FString::Join(ReportLines, TEXT("\n")));
 }
+
+void SnapshotMigrationLogReporter::WriteProgress(const SnapshotMigrationProgress& Progress)
+{
+	const double MegabytesRead = Progress.BytesRead / (1024.0 * 1024.0);
+	const double MegabytesWritten = Progress.BytesWritten / (1024.0 * 1024.0);
+	const double EstimatedTimeRemaining = Progress.GetEstimatedTimeRemaining();
+
+	FString Status{ TEXT("ETA unknown.") };
+	if (Progress.bFinished)
+	{
+		Status = FString{ TEXT("Finished.") };
+	}
+	else if (EstimatedTimeRemaining >= 0.0)
+	{
+		Status = FString::Printf(TEXT("ETA %s."), *FTimespan::FromSeconds(EstimatedTimeRemaining).ToString(TEXT("%h:%m:%s")));
+	}
+
+	Write(FString::Printf(TEXT("%s: %lld entities processed (%lld migrated, %lld skipped) in %.0f seconds, %.1f entities/s. Read ~%.1f MB (%.1f%%), wrote %.1f MB. %s"),
+		*Progress.SnapshotName,
+		Progress.NumProcessedEntities,
+		Progress.NumMigratedEntities,
+		Progress.NumSkippedEntities,
+		Progress.ElapsedTime,
+		Progress.GetEntitiesPerSecond(),
+		MegabytesRead,
+		Progress.GetPercentRead(),
+		MegabytesWritten,
+		*Status));
+}
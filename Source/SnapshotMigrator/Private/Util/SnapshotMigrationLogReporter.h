@@ -12,4 +12,11 @@ public:
 
 	virtual ~SnapshotMigrationLogReporter() override {}
 	virtual void WriteToReport(const SnapshotMigrationData& MigrationData) override;
+	virtual void WriteProgress(const SnapshotMigrationProgress& Progress) override;
+
+private:
+	// The json report contains every class; the log only shows the most expensive ones.
+	static const int32 MAX_CLASSES_TO_REPORT = 50;
+	// Likewise for the skip tables, which are ordered from most to least frequent.
+	static const int32 MAX_SKIP_ROWS_TO_REPORT = 50;
 };
@@ -0,0 +1,114 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationManifest.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/SecureHash.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+bool SnapshotMigrationManifest::HasSameInputsAs(const SnapshotMigrationManifest& Other) const
+{
+	return SourceSnapshotHash == Other.SourceSnapshotHash &&
+		   WhitelistHash == Other.WhitelistHash &&
+		   OldSchemaBundleHash == Other.OldSchemaBundleHash &&
+		   NewSchemaBundleHash == Other.NewSchemaBundleHash &&
+		   OptionsHash == Other.OptionsHash;
+}
+
+void SnapshotMigrationManifest::SetSourceSnapshotStat(const FString& Path)
+{
+	const FFileStatData StatData = IFileManager::Get().GetStatData(*Path);
+	SourceSnapshotSize = StatData.bIsValid ? StatData.FileSize : INDEX_NONE;
+	SourceSnapshotTimestamp = StatData.bIsValid ? StatData.ModificationTime : FDateTime::MinValue();
+}
+
+bool SnapshotMigrationManifest::IsSourceSnapshotUnchanged(const SnapshotMigrationManifest& Other) const
+{
+	return SourceSnapshotSize != INDEX_NONE && SourceSnapshotSize == Other.SourceSnapshotSize && SourceSnapshotTimestamp == Other.SourceSnapshotTimestamp;
+}
+
+bool SnapshotMigrationManifest::Save(const FString& ManifestPath) const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetNumberField(FString{ TEXT("Version") }, VERSION);
+	Json->SetStringField(FString{ TEXT("SourceSnapshotHash") }, SourceSnapshotHash);
+	// Written as strings, since JSON numbers can't hold every int64.
+	Json->SetStringField(FString{ TEXT("SourceSnapshotSize") }, LexToString(SourceSnapshotSize));
+	Json->SetStringField(FString{ TEXT("SourceSnapshotTimestamp") }, LexToString(SourceSnapshotTimestamp.GetTicks()));
+	Json->SetStringField(FString{ TEXT("WhitelistHash") }, WhitelistHash);
+	Json->SetStringField(FString{ TEXT("OldSchemaBundleHash") }, OldSchemaBundleHash);
+	Json->SetStringField(FString{ TEXT("NewSchemaBundleHash") }, NewSchemaBundleHash);
+	Json->SetStringField(FString{ TEXT("OptionsHash") }, OptionsHash);
+	Json->SetObjectField(FString{ TEXT("MigrationData") }, MigrationData.ToJson());
+
+	FString OutputString;
+
+	using CharType = TCHAR;
+	using Policy = TCondensedJsonPrintPolicy<CharType>;
+
+	TSharedRef<TJsonWriter<CharType, Policy>> Writer = TJsonWriterFactory<CharType, Policy>::Create(&OutputString);
+	if (!FJsonSerializer::Serialize(Json, Writer))
+	{
+		return false;
+	}
+
+	return FFileHelper::SaveStringToFile(OutputString, *ManifestPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+}
+
+bool SnapshotMigrationManifest::Load(const FString& ManifestPath, SnapshotMigrationManifest& OutManifest)
+{
+	FString ManifestJson;
+	if (!FFileHelper::LoadFileToString(ManifestJson, *ManifestPath))
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Json;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(ManifestJson);
+	if (!FJsonSerializer::Deserialize(Reader, Json) || !Json.IsValid())
+	{
+		return false;
+	}
+
+	// Manifests written by a different version of the migrator never match, since the same inputs may not produce the same output.
+	int32 Version = 0;
+	if (!Json->TryGetNumberField(FString{ TEXT("Version") }, Version) || Version != VERSION)
+	{
+		return false;
+	}
+
+	// Manifests without the source snapshot's size and timestamp are still valid; the source snapshot just has to be hashed to compare against them.
+	FString SourceSnapshotSize;
+	FString SourceSnapshotTimestamp;
+	if (Json->TryGetStringField(FString{ TEXT("SourceSnapshotSize") }, SourceSnapshotSize) && Json->TryGetStringField(FString{ TEXT("SourceSnapshotTimestamp") }, SourceSnapshotTimestamp))
+	{
+		int64 Ticks = 0;
+		LexFromString(OutManifest.SourceSnapshotSize, *SourceSnapshotSize);
+		LexFromString(Ticks, *SourceSnapshotTimestamp);
+		OutManifest.SourceSnapshotTimestamp = FDateTime{ Ticks };
+	}
+
+	const TSharedPtr<FJsonObject>* MigrationDataJson = nullptr;
+
+	return Json->TryGetStringField(FString{ TEXT("SourceSnapshotHash") }, OutManifest.SourceSnapshotHash) &&
+		   Json->TryGetStringField(FString{ TEXT("WhitelistHash") }, OutManifest.WhitelistHash) &&
+		   Json->TryGetStringField(FString{ TEXT("OldSchemaBundleHash") }, OutManifest.OldSchemaBundleHash) &&
+		   Json->TryGetStringField(FString{ TEXT("NewSchemaBundleHash") }, OutManifest.NewSchemaBundleHash) &&
+		   Json->TryGetStringField(FString{ TEXT("OptionsHash") }, OutManifest.OptionsHash) &&
+		   Json->TryGetObjectField(FString{ TEXT("MigrationData") }, MigrationDataJson) &&
+		   SnapshotMigrationData::FromJson(*MigrationDataJson, OutManifest.MigrationData);
+}
+
+FString SnapshotMigrationManifest::GetManifestPath(const FString& TargetSnapshotPath)
+{
+	return FString::Printf(TEXT("%s.manifest.json"), *TargetSnapshotPath);
+}
+
+FString SnapshotMigrationManifest::HashFile(const FString& Path)
+{
+	return LexToString(FMD5Hash::HashFile(*Path));
+}
@@ -0,0 +1,43 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SnapshotMigrationReporter.h"
+
+/**
+* Written next to each migrated snapshot. Records hashes of every input that can affect the output snapshot so that a later run can tell whether
+* the snapshot needs migrating again, along with the migration data of the run that produced it so that it can still be reported.
+* The source snapshot's size and timestamp are recorded too, so that a later run only has to hash the source snapshot again if either has changed.
+*/
+struct SnapshotMigrationManifest
+{
+	FString SourceSnapshotHash;
+	// Not inputs in their own right, so they're not compared by HasSameInputsAs; see IsSourceSnapshotUnchanged.
+	int64 SourceSnapshotSize = INDEX_NONE;
+	FDateTime SourceSnapshotTimestamp;
+	FString WhitelistHash;
+	FString OldSchemaBundleHash;
+	FString NewSchemaBundleHash;
+	FString OptionsHash;
+
+	SnapshotMigrationData MigrationData;
+
+	bool HasSameInputsAs(const SnapshotMigrationManifest& Other) const;
+
+	// Records the size and timestamp of the source snapshot at Path.
+	void SetSourceSnapshotStat(const FString& Path);
+
+	// Whether the source snapshot has the same size and timestamp as it did for Other, in which case its hash is taken to be the same as well.
+	bool IsSourceSnapshotUnchanged(const SnapshotMigrationManifest& Other) const;
+
+	bool Save(const FString& ManifestPath) const;
+	static bool Load(const FString& ManifestPath, SnapshotMigrationManifest& OutManifest);
+
+	static FString GetManifestPath(const FString& TargetSnapshotPath);
+	static FString HashFile(const FString& Path);
+
+	// Bump this whenever a change to the migrator alters the contents of the snapshots it writes.
+	static const int32 VERSION = 1;
+};
@@ -0,0 +1,104 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationNDJsonReporter.h"
+
+#include "Dom/JsonObject.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	using CharType = TCHAR;
+	using Policy = TCondensedJsonPrintPolicy<CharType>;
+	using RecordWriter = TJsonWriter<CharType, Policy>;
+}
+
+void SnapshotMigrationNDJsonReporter::WriteToReport(const SnapshotMigrationData& MigrationData)
+{
+	const TSharedRef<FJsonObject> Json = MigrationData.ToJson();
+
+	// Individual skips have already been written as they happened.
+	Json->RemoveField(FString{ TEXT("SkippedEntities") });
+	Json->RemoveField(FString{ TEXT("SkippedComponentFieldUpdates") });
+	Json->SetStringField(FString{ TEXT("Type") }, FString{ TEXT("Summary") });
+
+	Record.Reset();
+	TSharedRef<RecordWriter> JsonWriter = TJsonWriterFactory<CharType, Policy>::Create(&Record);
+	FJsonSerializer::Serialize(Json, JsonWriter);
+	Record.AppendChar(TEXT('\n'));
+
+	Writer.Write(Record);
+	Writer.Flush();
+}
+
+void SnapshotMigrationNDJsonReporter::WriteProgress(const SnapshotMigrationProgress& Progress)
+{
+	const TSharedRef<FJsonObject> Json = Progress.ToJson();
+	Json->SetStringField(FString{ TEXT("Type") }, FString{ TEXT("Progress") });
+
+	Record.Reset();
+	TSharedRef<RecordWriter> JsonWriter = TJsonWriterFactory<CharType, Policy>::Create(&Record);
+	FJsonSerializer::Serialize(Json, JsonWriter);
+	Record.AppendChar(TEXT('\n'));
+
+	// Flush so that progress can be followed while the migration is still running.
+	Writer.Write(Record);
+	Writer.Flush();
+}
+
+void SnapshotMigrationNDJsonReporter::OnSkippedEntity(const SnapshotMigrationData& MigrationData, const uint32 EntityId, const FString& EntityClass, const SnapshotMigrationSkipReason SkipReason)
+{
+	Record.Reset();
+	TSharedRef<RecordWriter> JsonWriter = TJsonWriterFactory<CharType, Policy>::Create(&Record);
+
+	JsonWriter->WriteObjectStart();
+	JsonWriter->WriteValue(FString{ TEXT("Type") }, FString{ TEXT("SkippedEntity") });
+	JsonWriter->WriteValue(FString{ TEXT("SnapshotName") }, MigrationData.GetSnapshotName());
+	JsonWriter->WriteValue(FString{ TEXT("EntityId") }, static_cast<int64>(EntityId));
+	JsonWriter->WriteValue(FString{ TEXT("Class") }, EntityClass);
+	JsonWriter->WriteValue(FString{ TEXT("SkipReason") }, FString{ GetSnapshotMigrationSkipReasonDescription(SkipReason) });
+	JsonWriter->WriteObjectEnd();
+	JsonWriter->Close();
+	Record.AppendChar(TEXT('\n'));
+
+	Writer.Write(Record);
+}
+
+void SnapshotMigrationNDJsonReporter::OnSkippedComponentFieldUpdate(const SnapshotMigrationData& MigrationData, const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotMigrationSkipReason SkipReason)
+{
+	Record.Reset();
+	TSharedRef<RecordWriter> JsonWriter = TJsonWriterFactory<CharType, Policy>::Create(&Record);
+
+	JsonWriter->WriteObjectStart();
+	JsonWriter->WriteValue(FString{ TEXT("Type") }, FString{ TEXT("SkippedComponentFieldUpdate") });
+	JsonWriter->WriteValue(FString{ TEXT("SnapshotName") }, MigrationData.GetSnapshotName());
+	JsonWriter->WriteValue(FString{ TEXT("EntityId") }, static_cast<int64>(EntityId));
+	JsonWriter->WriteValue(FString{ TEXT("ComponentId") }, static_cast<int64>(ComponentId));
+	JsonWriter->WriteValue(FString{ TEXT("FieldName") }, FieldName);
+	JsonWriter->WriteValue(FString{ TEXT("SkipReason") }, FString{ GetSnapshotMigrationSkipReasonDescription(SkipReason) });
+	JsonWriter->WriteObjectEnd();
+	JsonWriter->Close();
+	Record.AppendChar(TEXT('\n'));
+
+	Writer.Write(Record);
+}
+
+void SnapshotMigrationNDJsonReporter::OnVerificationFailure(const SnapshotMigrationData& MigrationData, const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotVerificationFailure Failure)
+{
+	Record.Reset();
+	TSharedRef<RecordWriter> JsonWriter = TJsonWriterFactory<CharType, Policy>::Create(&Record);
+
+	JsonWriter->WriteObjectStart();
+	JsonWriter->WriteValue(FString{ TEXT("Type") }, FString{ TEXT("VerificationFailure") });
+	JsonWriter->WriteValue(FString{ TEXT("SnapshotName") }, MigrationData.GetSnapshotName());
+	JsonWriter->WriteValue(FString{ TEXT("EntityId") }, static_cast<int64>(EntityId));
+	JsonWriter->WriteValue(FString{ TEXT("ComponentId") }, static_cast<int64>(ComponentId));
+	JsonWriter->WriteValue(FString{ TEXT("FieldName") }, FieldName);
+	JsonWriter->WriteValue(FString{ TEXT("Failure") }, FString{ GetSnapshotVerificationFailureDescription(Failure) });
+	JsonWriter->WriteObjectEnd();
+	JsonWriter->Close();
+	Record.AppendChar(TEXT('\n'));
+
+	Writer.Write(Record);
+}
@@ -0,0 +1,36 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "SnapshotMigrationReporter.h"
+
+#include "BufferedFileWriter.h"
+
+/**
+* Writes one json record per line: a record for each skipped entity or field as soon as it's skipped, and for each verification failure, then a summary record once a snapshot is finished.
+* Nothing is accumulated between records, so memory usage doesn't grow with the number of skips.
+*/
+class SnapshotMigrationNDJsonReporter : public SnapshotMigrationReporterBase
+{
+public:
+	SnapshotMigrationNDJsonReporter(const FString& NDJsonReportFilepath)
+		: Writer(NDJsonReportFilepath)
+	{
+	}
+
+	virtual ~SnapshotMigrationNDJsonReporter() override {}
+
+	bool IsValid() const { return Writer.IsValid(); }
+
+	virtual void WriteToReport(const SnapshotMigrationData& MigrationData) override;
+	virtual void WriteProgress(const SnapshotMigrationProgress& Progress) override;
+	virtual void OnSkippedEntity(const SnapshotMigrationData& MigrationData, const uint32 EntityId, const FString& EntityClass, const SnapshotMigrationSkipReason SkipReason) override;
+	virtual void OnSkippedComponentFieldUpdate(const SnapshotMigrationData& MigrationData, const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotMigrationSkipReason SkipReason) override;
+	virtual void OnVerificationFailure(const SnapshotMigrationData& MigrationData, const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotVerificationFailure Failure) override;
+
+private:
+	BufferedFileWriter Writer;
+
+	// Reused between records so that streaming a record doesn't need to allocate once the buffer has grown.
+	FString Record;
+};
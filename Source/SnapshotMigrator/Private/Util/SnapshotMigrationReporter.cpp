@@ -1,18 +1,853 @@
 
 #include "Util/SnapshotMigrationReporter.h"
 
+#include "Dom/JsonValue.h"
+
+const TCHAR* GetSnapshotMigrationSkipReasonName(const SnapshotMigrationSkipReason SkipReason)
+{
+	switch (SkipReason)
+	{
+	case SnapshotMigrationSkipReason::ClassNotWhitelisted:
+		return TEXT("ClassNotWhitelisted");
+	case SnapshotMigrationSkipReason::ClassNotFound:
+		return TEXT("ClassNotFound");
+	case SnapshotMigrationSkipReason::ClassNotPersistent:
+		return TEXT("ClassNotPersistent");
+	case SnapshotMigrationSkipReason::SpawnActorFailed:
+		return TEXT("SpawnActorFailed");
+	case SnapshotMigrationSkipReason::CreateBunchFailed:
+		return TEXT("CreateBunchFailed");
+	case SnapshotMigrationSkipReason::UpdateComponentFailed:
+		return TEXT("UpdateComponentFailed");
+	case SnapshotMigrationSkipReason::FieldTypeMismatch:
+		return TEXT("FieldTypeMismatch");
+	case SnapshotMigrationSkipReason::DanglingReference:
+		return TEXT("DanglingReference");
+	default:
+		checkNoEntry();
+		return TEXT("Invalid");
+	}
+}
+
+const TCHAR* GetSnapshotMigrationSkipReasonDescription(const SnapshotMigrationSkipReason SkipReason)
+{
+	switch (SkipReason)
+	{
+	case SnapshotMigrationSkipReason::ClassNotWhitelisted:
+		return TEXT("Class does not match any patterns provided in the whitelist.");
+	case SnapshotMigrationSkipReason::ClassNotFound:
+		return TEXT("Could not locate class. This is expected if the class in question has been deleted.");
+	case SnapshotMigrationSkipReason::ClassNotPersistent:
+		return TEXT("Class is marked 'Not Persistent'.");
+	case SnapshotMigrationSkipReason::SpawnActorFailed:
+		return TEXT("Failed to spawn actor.");
+	case SnapshotMigrationSkipReason::CreateBunchFailed:
+		return TEXT("Failed to create initial bunch for simulated replication.");
+	case SnapshotMigrationSkipReason::UpdateComponentFailed:
+		return TEXT("Encountered a problem while trying to update at least one component.");
+	case SnapshotMigrationSkipReason::FieldTypeMismatch:
+		return TEXT("Type mismatch between Old and New field definitions.");
+	case SnapshotMigrationSkipReason::DanglingReference:
+		return TEXT("Referred to an entity which isn't migrated, so the reference was removed.");
+	default:
+		checkNoEntry();
+		return TEXT("Invalid");
+	}
+}
+
+bool FindSnapshotMigrationSkipReason(const FString& Description, SnapshotMigrationSkipReason& OutSkipReason)
+{
+	for (int32 i = 0; i < static_cast<int32>(SnapshotMigrationSkipReason::Count); i++)
+	{
+		if (Description.Equals(GetSnapshotMigrationSkipReasonDescription(static_cast<SnapshotMigrationSkipReason>(i))))
+		{
+			OutSkipReason = static_cast<SnapshotMigrationSkipReason>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const TCHAR* GetSnapshotVerificationFailureName(const SnapshotVerificationFailure Failure)
+{
+	switch (Failure)
+	{
+	case SnapshotVerificationFailure::UnreadableSnapshot:
+		return TEXT("UnreadableSnapshot");
+	case SnapshotVerificationFailure::UnknownComponent:
+		return TEXT("UnknownComponent");
+	case SnapshotVerificationFailure::UnknownField:
+		return TEXT("UnknownField");
+	case SnapshotVerificationFailure::FieldTypeMismatch:
+		return TEXT("FieldTypeMismatch");
+	case SnapshotVerificationFailure::TooManyValues:
+		return TEXT("TooManyValues");
+	case SnapshotVerificationFailure::MissingField:
+		return TEXT("MissingField");
+	case SnapshotVerificationFailure::InvalidObjectRefOffset:
+		return TEXT("InvalidObjectRefOffset");
+	case SnapshotVerificationFailure::DanglingObjectRef:
+		return TEXT("DanglingObjectRef");
+	default:
+		checkNoEntry();
+		return TEXT("Invalid");
+	}
+}
+
+const TCHAR* GetSnapshotVerificationFailureDescription(const SnapshotVerificationFailure Failure)
+{
+	switch (Failure)
+	{
+	case SnapshotVerificationFailure::UnreadableSnapshot:
+		return TEXT("The migrated snapshot couldn't be read in full.");
+	case SnapshotVerificationFailure::UnknownComponent:
+		return TEXT("Component isn't defined by the target schema bundle.");
+	case SnapshotVerificationFailure::UnknownField:
+		return TEXT("Field isn't defined by the target schema bundle.");
+	case SnapshotVerificationFailure::FieldTypeMismatch:
+		return TEXT("Field holds no values of the type the target schema bundle gives it.");
+	case SnapshotVerificationFailure::TooManyValues:
+		return TEXT("Singular or optional field holds more than one value.");
+	case SnapshotVerificationFailure::MissingField:
+		return TEXT("Singular field of a nested type or map entry is missing.");
+	case SnapshotVerificationFailure::InvalidObjectRefOffset:
+		return TEXT("UnrealObjectRef's offset isn't a component of the target schema bundle, or it has an offset but no entity.");
+	case SnapshotVerificationFailure::DanglingObjectRef:
+		return TEXT("UnrealObjectRef refers to an entity which isn't in the snapshot.");
+	default:
+		checkNoEntry();
+		return TEXT("Invalid");
+	}
+}
+
+bool FindSnapshotVerificationFailure(const FString& Description, SnapshotVerificationFailure& OutFailure)
+{
+	for (int32 i = 0; i < static_cast<int32>(SnapshotVerificationFailure::Count); i++)
+	{
+		if (Description.Equals(GetSnapshotVerificationFailureDescription(static_cast<SnapshotVerificationFailure>(i))))
+		{
+			OutFailure = static_cast<SnapshotVerificationFailure>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+double SnapshotMigrationProgress::GetEstimatedTimeRemaining() const
+{
+	if (bFinished)
+	{
+		return 0.0;
+	}
+
+	if (BytesRead == 0 || SourceSnapshotSize <= 0)
+	{
+		return -1.0;
+	}
+
+	const double RemainingBytes = FMath::Max(0.0, static_cast<double>(SourceSnapshotSize) - BytesRead);
+	return ElapsedTime * RemainingBytes / BytesRead;
+}
+
+TSharedRef<FJsonObject> SnapshotMigrationProgress::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetStringField(FString{ TEXT("SnapshotName") }, SnapshotName);
+	Json->SetBoolField(FString{ TEXT("Finished") }, bFinished);
+	Json->SetNumberField(FString{ TEXT("NumProcessedEntities") }, NumProcessedEntities);
+	Json->SetNumberField(FString{ TEXT("NumMigratedEntities") }, NumMigratedEntities);
+	Json->SetNumberField(FString{ TEXT("NumSkippedEntities") }, NumSkippedEntities);
+	Json->SetNumberField(FString{ TEXT("BytesRead") }, BytesRead);
+	Json->SetNumberField(FString{ TEXT("BytesWritten") }, BytesWritten);
+	Json->SetNumberField(FString{ TEXT("SourceSnapshotSize") }, SourceSnapshotSize);
+	Json->SetNumberField(FString{ TEXT("PercentRead") }, GetPercentRead());
+	Json->SetNumberField(FString{ TEXT("ElapsedTime") }, ElapsedTime);
+	Json->SetNumberField(FString{ TEXT("EntitiesPerSecond") }, GetEntitiesPerSecond());
+	Json->SetNumberField(FString{ TEXT("EstimatedTimeRemaining") }, GetEstimatedTimeRemaining());
+	Json->SetStringField(FString{ TEXT("UpdatedAt") }, FDateTime::UtcNow().ToIso8601());
+
+	return Json;
+}
+
 void SnapshotMigrationData::RecordMigratedEntity()
 {
 	NumMigratedEntities++;
 }
 
-void SnapshotMigrationData::RecordSkippedEntity(const uint32 EntityId, const FString& EntityClass, const FString& SkipReason)
+void SnapshotMigrationData::RecordSkippedEntity(const uint32 EntityId, const FString& EntityClass, const SnapshotMigrationSkipReason SkipReason)
+{
+	const int32 ClassIndex = InternString(EntityClass);
+
+	NumSkippedEntities++;
+	SkippedEntityCounts.FindOrAdd(MakeSkippedEntityCountKey(ClassIndex, SkipReason))++;
+
+	if (bRetainSkipDetails)
+	{
+		SkippedEntities.Add(SkippedEntityInfo{ EntityId, ClassIndex, SkipReason });
+	}
+}
+
+void SnapshotMigrationData::RecordSkippedComponentFieldUpdate(const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotMigrationSkipReason SkipReason)
+{
+	const int32 FieldNameIndex = InternString(FieldName);
+
+	NumSkippedComponentFieldUpdates++;
+	SkippedComponentFieldCounts.FindOrAdd(MakeSkippedComponentFieldCountKey(ComponentId, FieldNameIndex, SkipReason))++;
+
+	if (bRetainSkipDetails)
+	{
+		SkippedComponentFieldUpdates.Add(SkippedComponentFieldInfo{ EntityId, ComponentId, FieldNameIndex, SkipReason });
+	}
+}
+
+void SnapshotMigrationData::RecordVerificationFailure(const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotVerificationFailure Failure)
+{
+	const int32 FieldNameIndex = InternString(FieldName);
+
+	NumVerificationFailures++;
+	VerificationFailureCount& Count = VerificationFailureCounts.FindOrAdd(MakeVerificationFailureCountKey(ComponentId, FieldNameIndex, Failure), VerificationFailureCount{ ComponentId, FieldNameIndex, Failure, 0, EntityId });
+	Count.Count++;
+}
+
+int32 SnapshotMigrationData::InternString(const FString& String)
+{
+	if (const int32* Index = InternedStringIndices.Find(String))
+	{
+		return *Index;
+	}
+
+	const int32 Index = InternedStrings.Add(String);
+	InternedStringIndices.Add(String, Index);
+	return Index;
+}
+
+void SnapshotMigrationData::RecordMigrationCacheLookup(const bool bHit)
+{
+	NumMigrationCacheLookups++;
+	if (bHit)
+	{
+		NumMigrationCacheHits++;
+	}
+}
+
+void SnapshotMigrationData::RecordClassMigration(const FString& EntityClass, const bool bMigrated, const double Seconds, const int32 NumComponents, const uint64 NumBytes)
+{
+	ClassMigrationStats& Stats = ClassStats.FindOrAdd(EntityClass);
+	Stats.NumEntities++;
+	Stats.NumMigratedEntities += bMigrated ? 1 : 0;
+	Stats.TotalTime += Seconds;
+	Stats.MaxTime = FMath::Max(Stats.MaxTime, Seconds);
+	Stats.NumComponents += NumComponents;
+	Stats.MigratedBytes += NumBytes;
+}
+
+void SnapshotMigrationData::Merge(const SnapshotMigrationData& Other)
+{
+	NumMigratedEntities += Other.NumMigratedEntities;
+	NumSkippedEntities += Other.NumSkippedEntities;
+	NumSkippedComponentFieldUpdates += Other.NumSkippedComponentFieldUpdates;
+	NumMigrationCacheLookups += Other.NumMigrationCacheLookups;
+	NumMigrationCacheHits += Other.NumMigrationCacheHits;
+	NumUnsampledEntities += Other.NumUnsampledEntities;
+	NumUnselectedEntities += Other.NumUnselectedEntities;
+	ProjectedAdditionalTime += Other.ProjectedAdditionalTime;
+	ProjectedOutputBytes += Other.ProjectedOutputBytes;
+	bCompacted |= Other.bCompacted;
+	CompactionBytesBefore += Other.CompactionBytesBefore;
+	CompactionBytesAfter += Other.CompactionBytesAfter;
+	NumCompactedComponents += Other.NumCompactedComponents;
+	NumCompactedFields += Other.NumCompactedFields;
+	bVerified |= Other.bVerified;
+	NumVerifiedEntities += Other.NumVerifiedEntities;
+	VerificationTime += Other.VerificationTime;
+	NumVerificationFailures += Other.NumVerificationFailures;
+
+	// The other data's interned strings have their own indices, so everything which refers to them has to be interned again.
+	for (const SkippedEntityCount& Count : Other.GetSkippedEntityCounts())
+	{
+		SkippedEntityCounts.FindOrAdd(MakeSkippedEntityCountKey(InternString(Other.GetInternedString(Count.ClassIndex)), Count.SkipReason)) += Count.Count;
+	}
+
+	for (const SkippedComponentFieldCount& Count : Other.GetSkippedComponentFieldCounts())
+	{
+		SkippedComponentFieldCounts.FindOrAdd(MakeSkippedComponentFieldCountKey(Count.ComponentId, InternString(Other.GetInternedString(Count.FieldNameIndex)), Count.SkipReason)) += Count.Count;
+	}
+
+	for (const VerificationFailureCount& Count : Other.GetVerificationFailureCounts())
+	{
+		const int32 FieldNameIndex = InternString(Other.GetInternedString(Count.FieldNameIndex));
+		VerificationFailureCount& MergedCount = VerificationFailureCounts.FindOrAdd(MakeVerificationFailureCountKey(Count.ComponentId, FieldNameIndex, Count.Failure), VerificationFailureCount{ Count.ComponentId, FieldNameIndex, Count.Failure, 0, Count.FirstEntityId });
+		MergedCount.Count += Count.Count;
+	}
+
+	if (bRetainSkipDetails)
+	{
+		for (const SkippedEntityInfo& SkipInfo : Other.SkippedEntities)
+		{
+			SkippedEntities.Add(SkippedEntityInfo{ SkipInfo.EntityId, InternString(Other.GetInternedString(SkipInfo.ClassIndex)), SkipInfo.SkipReason });
+		}
+
+		for (const SkippedComponentFieldInfo& SkipInfo : Other.SkippedComponentFieldUpdates)
+		{
+			SkippedComponentFieldUpdates.Add(SkippedComponentFieldInfo{ SkipInfo.EntityId, SkipInfo.ComponentId, InternString(Other.GetInternedString(SkipInfo.FieldNameIndex)), SkipInfo.SkipReason });
+		}
+	}
+
+	for (const TPair<FString, ClassMigrationStats>& OtherStats : Other.ClassStats)
+	{
+		ClassMigrationStats& Stats = ClassStats.FindOrAdd(OtherStats.Key);
+		Stats.NumEntities += OtherStats.Value.NumEntities;
+		Stats.NumMigratedEntities += OtherStats.Value.NumMigratedEntities;
+		Stats.TotalTime += OtherStats.Value.TotalTime;
+		Stats.MaxTime = FMath::Max(Stats.MaxTime, OtherStats.Value.MaxTime);
+		Stats.NumComponents += OtherStats.Value.NumComponents;
+		Stats.MigratedBytes += OtherStats.Value.MigratedBytes;
+	}
+
+	for (int32 i = 0; i < static_cast<int32>(SnapshotMigrationPhase::Count); i++)
+	{
+		PhaseLatencies[i].Merge(Other.PhaseLatencies[i]);
+	}
+}
+
+TArray<SkippedEntityCount> SnapshotMigrationData::GetSkippedEntityCounts() const
 {
-	SkippedEntities.Add(EntityId, SkippedEntityInfo{ EntityClass, SkipReason });
+	TArray<SkippedEntityCount> Counts;
+	Counts.Reserve(SkippedEntityCounts.Num());
+
+	for (const TPair<uint64, int32>& Count : SkippedEntityCounts)
+	{
+		Counts.Add(SkippedEntityCount{ static_cast<int32>(Count.Key >> 8), static_cast<SnapshotMigrationSkipReason>(Count.Key & 0xFF), Count.Value });
+	}
+
+	// Break ties on the key so that the order doesn't depend on the map's layout.
+	Counts.Sort([](const SkippedEntityCount& LHS, const SkippedEntityCount& RHS) {
+		return LHS.Count != RHS.Count ? LHS.Count > RHS.Count : MakeSkippedEntityCountKey(LHS.ClassIndex, LHS.SkipReason) < MakeSkippedEntityCountKey(RHS.ClassIndex, RHS.SkipReason);
+	});
+
+	return Counts;
 }
 
-void SnapshotMigrationData::RecordSkippedComponentFieldUpdate(const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const FString& SkipReason)
+TArray<SkippedComponentFieldCount> SnapshotMigrationData::GetSkippedComponentFieldCounts() const
 {
-	TArray<SkippedComponentFieldInfo>& SkippedComponentFieldUpdatesForEntity = SkippedComponentFieldUpdates.FindOrAdd(EntityId);
-	SkippedComponentFieldUpdatesForEntity.Add(SkippedComponentFieldInfo{ ComponentId, FieldName, SkipReason });
+	TArray<SkippedComponentFieldCount> Counts;
+	Counts.Reserve(SkippedComponentFieldCounts.Num());
+
+	for (const TPair<uint64, int32>& Count : SkippedComponentFieldCounts)
+	{
+		Counts.Add(SkippedComponentFieldCount{ static_cast<uint32>(Count.Key >> 32), static_cast<int32>((Count.Key >> 8) & 0xFFFFFF), static_cast<SnapshotMigrationSkipReason>(Count.Key & 0xFF), Count.Value });
+	}
+
+	Counts.Sort([](const SkippedComponentFieldCount& LHS, const SkippedComponentFieldCount& RHS) {
+		return LHS.Count != RHS.Count
+			? LHS.Count > RHS.Count
+			: MakeSkippedComponentFieldCountKey(LHS.ComponentId, LHS.FieldNameIndex, LHS.SkipReason) < MakeSkippedComponentFieldCountKey(RHS.ComponentId, RHS.FieldNameIndex, RHS.SkipReason);
+	});
+
+	return Counts;
+}
+
+uint64 SnapshotMigrationData::MakeSkippedEntityCountKey(const int32 ClassIndex, const SnapshotMigrationSkipReason SkipReason)
+{
+	return (static_cast<uint64>(ClassIndex) << 8) | static_cast<uint8>(SkipReason);
+}
+
+uint64 SnapshotMigrationData::MakeSkippedComponentFieldCountKey(const uint32 ComponentId, const int32 FieldNameIndex, const SnapshotMigrationSkipReason SkipReason)
+{
+	// 24 bits is far more than enough for the interned field names of a single snapshot.
+	check(FieldNameIndex < (1 << 24));
+	return (static_cast<uint64>(ComponentId) << 32) | (static_cast<uint64>(FieldNameIndex) << 8) | static_cast<uint8>(SkipReason);
+}
+
+uint64 SnapshotMigrationData::MakeVerificationFailureCountKey(const uint32 ComponentId, const int32 FieldNameIndex, const SnapshotVerificationFailure Failure)
+{
+	check(FieldNameIndex < (1 << 24));
+	return (static_cast<uint64>(ComponentId) << 32) | (static_cast<uint64>(FieldNameIndex) << 8) | static_cast<uint8>(Failure);
+}
+
+TArray<VerificationFailureCount> SnapshotMigrationData::GetVerificationFailureCounts() const
+{
+	TArray<VerificationFailureCount> Counts;
+	VerificationFailureCounts.GenerateValueArray(Counts);
+
+	Counts.Sort([](const VerificationFailureCount& LHS, const VerificationFailureCount& RHS) {
+		return LHS.Count != RHS.Count
+			? LHS.Count > RHS.Count
+			: MakeVerificationFailureCountKey(LHS.ComponentId, LHS.FieldNameIndex, LHS.Failure) < MakeVerificationFailureCountKey(RHS.ComponentId, RHS.FieldNameIndex, RHS.Failure);
+	});
+
+	return Counts;
+}
+
+TArray<FString> SnapshotMigrationData::GetClassesByTotalTime() const
+{
+	TArray<FString> Classes;
+	ClassStats.GenerateKeyArray(Classes);
+	Classes.Sort([this](const FString& LHS, const FString& RHS) {
+		return ClassStats.FindChecked(LHS).TotalTime > ClassStats.FindChecked(RHS).TotalTime;
+	});
+
+	return Classes;
+}
+
+TSharedRef<FJsonObject> SnapshotMigrationData::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetStringField(FString{ TEXT("SnapshotName") }, SnapshotName);
+	Json->SetNumberField(FString{ TEXT("ElapsedTime") }, ElapsedTime);
+	Json->SetNumberField(FString{ TEXT("NumEncounteredEntities") }, NumEncounteredEntities);
+	Json->SetNumberField(FString{ TEXT("NumMigratedEntities") }, NumMigratedEntities);
+	Json->SetNumberField(FString{ TEXT("PercentMigratedEntities") }, PercentMigratedEntities);
+	Json->SetNumberField(FString{ TEXT("NumSkippedEntities") }, NumSkippedEntities);
+	Json->SetNumberField(FString{ TEXT("PercentSkippedEntities") }, PercentSkippedEntities);
+	Json->SetNumberField(FString{ TEXT("NumSkippedComponentFieldUpdates") }, NumSkippedComponentFieldUpdates);
+	Json->SetNumberField(FString{ TEXT("NumMigrationCacheLookups") }, NumMigrationCacheLookups);
+	Json->SetNumberField(FString{ TEXT("NumMigrationCacheHits") }, NumMigrationCacheHits);
+	Json->SetNumberField(FString{ TEXT("PercentMigrationCacheHits") }, PercentMigrationCacheHits);
+
+	if (IsSampled())
+	{
+		Json->SetNumberField(FString{ TEXT("SampleFraction") }, SampleFraction);
+		Json->SetNumberField(FString{ TEXT("NumUnsampledEntities") }, NumUnsampledEntities);
+	}
+
+	if (bPartial)
+	{
+		Json->SetBoolField(FString{ TEXT("Partial") }, true);
+		Json->SetBoolField(FString{ TEXT("CopiesUnselectedEntities") }, bCopiesUnselectedEntities);
+		Json->SetNumberField(FString{ TEXT("NumUnselectedEntities") }, NumUnselectedEntities);
+	}
+
+	if (bDryRun)
+	{
+		Json->SetBoolField(FString{ TEXT("DryRun") }, true);
+		Json->SetNumberField(FString{ TEXT("ProjectedElapsedTime") }, ProjectedElapsedTime);
+		Json->SetNumberField(FString{ TEXT("ProjectedOutputBytes") }, ProjectedOutputBytes);
+	}
+
+	if (bSpatiallyOrdered)
+	{
+		Json->SetNumberField(FString{ TEXT("MeanNeighbourDistanceBefore") }, MeanNeighbourDistanceBefore);
+		Json->SetNumberField(FString{ TEXT("MeanNeighbourDistanceAfter") }, MeanNeighbourDistanceAfter);
+	}
+
+	if (bCompacted)
+	{
+		Json->SetBoolField(FString{ TEXT("Compacted") }, true);
+		Json->SetNumberField(FString{ TEXT("CompactionBytesBefore") }, CompactionBytesBefore);
+		Json->SetNumberField(FString{ TEXT("CompactionBytesAfter") }, CompactionBytesAfter);
+		Json->SetNumberField(FString{ TEXT("NumCompactedComponents") }, NumCompactedComponents);
+		Json->SetNumberField(FString{ TEXT("NumCompactedFields") }, NumCompactedFields);
+	}
+
+	if (bVerified)
+	{
+		Json->SetBoolField(FString{ TEXT("Verified") }, true);
+		Json->SetNumberField(FString{ TEXT("NumVerifiedEntities") }, NumVerifiedEntities);
+		Json->SetNumberField(FString{ TEXT("VerificationTime") }, VerificationTime);
+		Json->SetNumberField(FString{ TEXT("NumVerificationFailures") }, NumVerificationFailures);
+
+		TArray<TSharedPtr<FJsonValue>> VerificationFailureCountsJson;
+
+		for (const VerificationFailureCount& Count : GetVerificationFailureCounts())
+		{
+			TSharedPtr<FJsonObject> CountJson = MakeShareable(new FJsonObject);
+
+			CountJson->SetNumberField(FString{ TEXT("ComponentId") }, Count.ComponentId);
+			CountJson->SetStringField(FString{ TEXT("FieldName") }, GetInternedString(Count.FieldNameIndex));
+			CountJson->SetStringField(FString{ TEXT("Failure") }, GetSnapshotVerificationFailureDescription(Count.Failure));
+			CountJson->SetNumberField(FString{ TEXT("Count") }, Count.Count);
+			CountJson->SetNumberField(FString{ TEXT("FirstEntityId") }, Count.FirstEntityId);
+
+			VerificationFailureCountsJson.Add(MakeShareable<FJsonValueObject>(new FJsonValueObject(CountJson)));
+		}
+
+		Json->SetArrayField(FString{ TEXT("VerificationFailuresByField") }, VerificationFailureCountsJson);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> SkippedEntityCountsJson;
+
+	for (const SkippedEntityCount& Count : GetSkippedEntityCounts())
+	{
+		TSharedPtr<FJsonObject> CountJson = MakeShareable(new FJsonObject);
+
+		CountJson->SetStringField(FString{ TEXT("Class") }, GetInternedString(Count.ClassIndex));
+		CountJson->SetStringField(FString{ TEXT("SkipReason") }, GetSnapshotMigrationSkipReasonDescription(Count.SkipReason));
+		CountJson->SetNumberField(FString{ TEXT("Count") }, Count.Count);
+
+		SkippedEntityCountsJson.Add(MakeShareable<FJsonValueObject>(new FJsonValueObject(CountJson)));
+	}
+
+	Json->SetArrayField(FString{ TEXT("SkippedEntitiesByClass") }, SkippedEntityCountsJson);
+
+	TArray<TSharedPtr<FJsonValue>> SkippedComponentFieldCountsJson;
+
+	for (const SkippedComponentFieldCount& Count : GetSkippedComponentFieldCounts())
+	{
+		TSharedPtr<FJsonObject> CountJson = MakeShareable(new FJsonObject);
+
+		CountJson->SetNumberField(FString{ TEXT("ComponentId") }, Count.ComponentId);
+		CountJson->SetStringField(FString{ TEXT("FieldName") }, GetInternedString(Count.FieldNameIndex));
+		CountJson->SetStringField(FString{ TEXT("SkipReason") }, GetSnapshotMigrationSkipReasonDescription(Count.SkipReason));
+		CountJson->SetNumberField(FString{ TEXT("Count") }, Count.Count);
+
+		SkippedComponentFieldCountsJson.Add(MakeShareable<FJsonValueObject>(new FJsonValueObject(CountJson)));
+	}
+
+	Json->SetArrayField(FString{ TEXT("SkippedComponentFieldUpdatesByField") }, SkippedComponentFieldCountsJson);
+
+	// Per-entity skips are only written when they were retained, since listing every entity makes the report unreadably large on big snapshots.
+	if (bRetainSkipDetails)
+	{
+		WriteSkipDetailsToJson(Json);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> PhasesJson;
+
+	for (int32 i = 0; i < static_cast<int32>(SnapshotMigrationPhase::Count); i++)
+	{
+		const SnapshotMigrationLatencyHistogram& Latency = PhaseLatencies[i];
+
+		TSharedRef<FJsonObject> PhaseJson = Latency.ToJson();
+		PhaseJson->SetStringField(FString{ TEXT("Phase") }, GetSnapshotMigrationPhaseName(static_cast<SnapshotMigrationPhase>(i)));
+		PhaseJson->SetNumberField(FString{ TEXT("P50Time") }, Latency.GetPercentileSeconds(50.f));
+		PhaseJson->SetNumberField(FString{ TEXT("P90Time") }, Latency.GetPercentileSeconds(90.f));
+		PhaseJson->SetNumberField(FString{ TEXT("P99Time") }, Latency.GetPercentileSeconds(99.f));
+
+		PhasesJson.Add(MakeShareable<FJsonValueObject>(new FJsonValueObject(PhaseJson)));
+	}
+
+	Json->SetArrayField(FString{ TEXT("Phases") }, PhasesJson);
+
+	TArray<TSharedPtr<FJsonValue>> ClassStatsJson;
+
+	for (const FString& EntityClass : GetClassesByTotalTime())
+	{
+		const ClassMigrationStats& Stats = ClassStats.FindChecked(EntityClass);
+
+		TSharedPtr<FJsonObject> ClassJson = MakeShareable(new FJsonObject);
+
+		ClassJson->SetStringField(FString{ TEXT("Class") }, EntityClass);
+		ClassJson->SetNumberField(FString{ TEXT("NumEntities") }, Stats.NumEntities);
+		ClassJson->SetNumberField(FString{ TEXT("NumMigratedEntities") }, Stats.NumMigratedEntities);
+		ClassJson->SetNumberField(FString{ TEXT("TotalTime") }, Stats.TotalTime);
+		ClassJson->SetNumberField(FString{ TEXT("MaxTime") }, Stats.MaxTime);
+		ClassJson->SetNumberField(FString{ TEXT("NumComponents") }, Stats.NumComponents);
+		ClassJson->SetNumberField(FString{ TEXT("MigratedBytes") }, Stats.MigratedBytes);
+
+		ClassStatsJson.Add(MakeShareable<FJsonValueObject>(new FJsonValueObject(ClassJson)));
+	}
+
+	Json->SetArrayField(FString{ TEXT("ClassStats") }, ClassStatsJson);
+
+	return Json;
+}
+
+void SnapshotMigrationData::WriteSkipDetailsToJson(const TSharedRef<FJsonObject>& Json) const
+{
+	// Skips are recorded in snapshot order, which usually but not necessarily matches entity id order.
+	TArray<SkippedEntityInfo> SortedSkippedEntities = SkippedEntities;
+	SortedSkippedEntities.StableSort([](const SkippedEntityInfo& LHS, const SkippedEntityInfo& RHS) { return LHS.EntityId < RHS.EntityId; });
+
+	TArray<TSharedPtr<FJsonValue>> SkippedEntitiesJson;
+
+	for (const SkippedEntityInfo& SkipInfo : SortedSkippedEntities)
+	{
+		TSharedPtr<FJsonObject> SkippedEntityJson = MakeShareable(new FJsonObject);
+
+		SkippedEntityJson->SetNumberField(FString{ TEXT("EntityId") }, SkipInfo.EntityId);
+		SkippedEntityJson->SetStringField(FString{ TEXT("Class") }, GetInternedString(SkipInfo.ClassIndex));
+		SkippedEntityJson->SetStringField(FString{ TEXT("SkipReason") }, GetSnapshotMigrationSkipReasonDescription(SkipInfo.SkipReason));
+
+		SkippedEntitiesJson.Add(MakeShareable<FJsonValueObject>(new FJsonValueObject(SkippedEntityJson)));
+	}
+
+	Json->SetArrayField(FString{ TEXT("SkippedEntities") }, SkippedEntitiesJson);
+
+	TArray<SkippedComponentFieldInfo> SortedSkippedComponentFields = SkippedComponentFieldUpdates;
+	SortedSkippedComponentFields.StableSort([](const SkippedComponentFieldInfo& LHS, const SkippedComponentFieldInfo& RHS) { return LHS.EntityId < RHS.EntityId; });
+
+	TArray<TSharedPtr<FJsonValue>> SkippedComponentFieldsJson;
+
+	// Group each entity's skipped fields together.
+	for (int32 EntityStart = 0; EntityStart < SortedSkippedComponentFields.Num();)
+	{
+		const uint32 EntityId = SortedSkippedComponentFields[EntityStart].EntityId;
+
+		int32 EntityEnd = EntityStart;
+		while (EntityEnd < SortedSkippedComponentFields.Num() && SortedSkippedComponentFields[EntityEnd].EntityId == EntityId)
+		{
+			EntityEnd++;
+		}
+
+		TSharedPtr<FJsonObject> EntityWithSkippedComponentFieldsJson = MakeShareable(new FJsonObject);
+
+		EntityWithSkippedComponentFieldsJson->SetNumberField(FString{ TEXT("EntityId") }, EntityId);
+		EntityWithSkippedComponentFieldsJson->SetNumberField(FString{ TEXT("NumSkippedComponentFields") }, EntityEnd - EntityStart);
+
+		TArray<TSharedPtr<FJsonValue>> SkippedComponentFieldsForEntityJson;
+
+		for (int32 i = EntityStart; i < EntityEnd; i++)
+		{
+			const SkippedComponentFieldInfo& SkippedComponentField = SortedSkippedComponentFields[i];
+
+			TSharedPtr<FJsonObject> SkippedComponentFieldJson = MakeShareable(new FJsonObject);
+
+			SkippedComponentFieldJson->SetNumberField(FString{ TEXT("ComponentId") }, SkippedComponentField.ComponentId);
+			SkippedComponentFieldJson->SetStringField(FString{ TEXT("FieldName") }, GetInternedString(SkippedComponentField.FieldNameIndex));
+			SkippedComponentFieldJson->SetStringField(FString{ TEXT("SkipReason") }, GetSnapshotMigrationSkipReasonDescription(SkippedComponentField.SkipReason));
+
+			SkippedComponentFieldsForEntityJson.Add(MakeShareable<FJsonValueObject>(new FJsonValueObject(SkippedComponentFieldJson)));
+		}
+
+		EntityWithSkippedComponentFieldsJson->SetArrayField(FString{ TEXT("SkippedComponentFields") }, SkippedComponentFieldsForEntityJson);
+		SkippedComponentFieldsJson.Add(MakeShareable<FJsonValueObject>(new FJsonValueObject(EntityWithSkippedComponentFieldsJson)));
+
+		EntityStart = EntityEnd;
+	}
+
+	Json->SetArrayField(FString{ TEXT("SkippedComponentFieldUpdates") }, SkippedComponentFieldsJson);
+}
+
+bool SnapshotMigrationData::FromJson(const TSharedPtr<FJsonObject>& Json, SnapshotMigrationData& OutMigrationData)
+{
+	if (!Json.IsValid())
+	{
+		return false;
+	}
+
+	SnapshotMigrationData Data{ Json->GetStringField(FString{ TEXT("SnapshotName") }) };
+
+	double Elapsed = 0.0;
+	double PercentMigrated = 0.0;
+	double PercentSkipped = 0.0;
+	double PercentCacheHits = 0.0;
+
+	const TArray<TSharedPtr<FJsonValue>>* SkippedEntityCountsJson = nullptr;
+	const TArray<TSharedPtr<FJsonValue>>* SkippedComponentFieldCountsJson = nullptr;
+
+	if (!Json->TryGetNumberField(FString{ TEXT("ElapsedTime") }, Elapsed) ||
+		!Json->TryGetNumberField(FString{ TEXT("NumEncounteredEntities") }, Data.NumEncounteredEntities) ||
+		!Json->TryGetNumberField(FString{ TEXT("NumMigratedEntities") }, Data.NumMigratedEntities) ||
+		!Json->TryGetNumberField(FString{ TEXT("PercentMigratedEntities") }, PercentMigrated) ||
+		!Json->TryGetNumberField(FString{ TEXT("NumSkippedEntities") }, Data.NumSkippedEntities) ||
+		!Json->TryGetNumberField(FString{ TEXT("PercentSkippedEntities") }, PercentSkipped) ||
+		!Json->TryGetNumberField(FString{ TEXT("NumSkippedComponentFieldUpdates") }, Data.NumSkippedComponentFieldUpdates) ||
+		!Json->TryGetNumberField(FString{ TEXT("NumMigrationCacheLookups") }, Data.NumMigrationCacheLookups) ||
+		!Json->TryGetNumberField(FString{ TEXT("NumMigrationCacheHits") }, Data.NumMigrationCacheHits) ||
+		!Json->TryGetNumberField(FString{ TEXT("PercentMigrationCacheHits") }, PercentCacheHits) ||
+		!Json->TryGetArrayField(FString{ TEXT("SkippedEntitiesByClass") }, SkippedEntityCountsJson) ||
+		!Json->TryGetArrayField(FString{ TEXT("SkippedComponentFieldUpdatesByField") }, SkippedComponentFieldCountsJson))
+	{
+		return false;
+	}
+
+	Data.ElapsedTime = Elapsed;
+	Data.PercentMigratedEntities = PercentMigrated;
+	Data.PercentSkippedEntities = PercentSkipped;
+	Data.PercentMigrationCacheHits = PercentCacheHits;
+
+	// Only sampled migrations record their sample.
+	double SampleFraction = 1.0;
+	if (Json->TryGetNumberField(FString{ TEXT("SampleFraction") }, SampleFraction))
+	{
+		Data.SampleFraction = SampleFraction;
+		Json->TryGetNumberField(FString{ TEXT("NumUnsampledEntities") }, Data.NumUnsampledEntities);
+	}
+
+	// Only partial migrations record their selection.
+	if (Json->TryGetBoolField(FString{ TEXT("Partial") }, Data.bPartial) && Data.bPartial)
+	{
+		Json->TryGetBoolField(FString{ TEXT("CopiesUnselectedEntities") }, Data.bCopiesUnselectedEntities);
+		Json->TryGetNumberField(FString{ TEXT("NumUnselectedEntities") }, Data.NumUnselectedEntities);
+	}
+
+	// Only dry run reports have projections.
+	if (Json->TryGetBoolField(FString{ TEXT("DryRun") }, Data.bDryRun) && Data.bDryRun)
+	{
+		double ProjectedOutputBytes = 0.0;
+		Json->TryGetNumberField(FString{ TEXT("ProjectedElapsedTime") }, Data.ProjectedElapsedTime);
+		Json->TryGetNumberField(FString{ TEXT("ProjectedOutputBytes") }, ProjectedOutputBytes);
+		Data.ProjectedOutputBytes = static_cast<uint64>(ProjectedOutputBytes);
+	}
+
+	// Only spatially ordered migrations measure their locality.
+	if (Json->TryGetNumberField(FString{ TEXT("MeanNeighbourDistanceBefore") }, Data.MeanNeighbourDistanceBefore) &&
+		Json->TryGetNumberField(FString{ TEXT("MeanNeighbourDistanceAfter") }, Data.MeanNeighbourDistanceAfter))
+	{
+		Data.bSpatiallyOrdered = true;
+	}
+
+	// Only compacted migrations record what was stripped.
+	if (Json->TryGetBoolField(FString{ TEXT("Compacted") }, Data.bCompacted) && Data.bCompacted)
+	{
+		double CompactionBytesBefore = 0.0;
+		double CompactionBytesAfter = 0.0;
+		double NumCompactedComponents = 0.0;
+		double NumCompactedFields = 0.0;
+		Json->TryGetNumberField(FString{ TEXT("CompactionBytesBefore") }, CompactionBytesBefore);
+		Json->TryGetNumberField(FString{ TEXT("CompactionBytesAfter") }, CompactionBytesAfter);
+		Json->TryGetNumberField(FString{ TEXT("NumCompactedComponents") }, NumCompactedComponents);
+		Json->TryGetNumberField(FString{ TEXT("NumCompactedFields") }, NumCompactedFields);
+		Data.CompactionBytesBefore = static_cast<uint64>(CompactionBytesBefore);
+		Data.CompactionBytesAfter = static_cast<uint64>(CompactionBytesAfter);
+		Data.NumCompactedComponents = static_cast<int64>(NumCompactedComponents);
+		Data.NumCompactedFields = static_cast<int64>(NumCompactedFields);
+	}
+
+	// Only verified migrations have verification results.
+	if (Json->TryGetBoolField(FString{ TEXT("Verified") }, Data.bVerified) && Data.bVerified)
+	{
+		double NumVerifiedEntities = 0.0;
+		double NumVerificationFailures = 0.0;
+		Json->TryGetNumberField(FString{ TEXT("NumVerifiedEntities") }, NumVerifiedEntities);
+		Json->TryGetNumberField(FString{ TEXT("VerificationTime") }, Data.VerificationTime);
+		Json->TryGetNumberField(FString{ TEXT("NumVerificationFailures") }, NumVerificationFailures);
+		Data.NumVerifiedEntities = static_cast<uint64>(NumVerifiedEntities);
+		Data.NumVerificationFailures = static_cast<int64>(NumVerificationFailures);
+
+		const TArray<TSharedPtr<FJsonValue>>* VerificationFailureCountsJson = nullptr;
+		if (Json->TryGetArrayField(FString{ TEXT("VerificationFailuresByField") }, VerificationFailureCountsJson))
+		{
+			for (const TSharedPtr<FJsonValue>& CountValue : *VerificationFailureCountsJson)
+			{
+				const TSharedPtr<FJsonObject> CountJson = CountValue->AsObject();
+
+				VerificationFailureCount Count;
+				if (!FindSnapshotVerificationFailure(CountJson->GetStringField(FString{ TEXT("Failure") }), Count.Failure))
+				{
+					return false;
+				}
+
+				Count.ComponentId = static_cast<uint32>(CountJson->GetIntegerField(FString{ TEXT("ComponentId") }));
+				Count.FieldNameIndex = Data.InternString(CountJson->GetStringField(FString{ TEXT("FieldName") }));
+				Count.Count = CountJson->GetIntegerField(FString{ TEXT("Count") });
+				Count.FirstEntityId = static_cast<uint32>(CountJson->GetIntegerField(FString{ TEXT("FirstEntityId") }));
+				Data.VerificationFailureCounts.Add(MakeVerificationFailureCountKey(Count.ComponentId, Count.FieldNameIndex, Count.Failure), Count);
+			}
+		}
+	}
+
+	for (const TSharedPtr<FJsonValue>& CountValue : *SkippedEntityCountsJson)
+	{
+		const TSharedPtr<FJsonObject> CountJson = CountValue->AsObject();
+
+		SnapshotMigrationSkipReason SkipReason;
+		if (!FindSnapshotMigrationSkipReason(CountJson->GetStringField(FString{ TEXT("SkipReason") }), SkipReason))
+		{
+			return false;
+		}
+
+		const int32 ClassIndex = Data.InternString(CountJson->GetStringField(FString{ TEXT("Class") }));
+		Data.SkippedEntityCounts.Add(MakeSkippedEntityCountKey(ClassIndex, SkipReason), CountJson->GetIntegerField(FString{ TEXT("Count") }));
+	}
+
+	for (const TSharedPtr<FJsonValue>& CountValue : *SkippedComponentFieldCountsJson)
+	{
+		const TSharedPtr<FJsonObject> CountJson = CountValue->AsObject();
+
+		SnapshotMigrationSkipReason SkipReason;
+		if (!FindSnapshotMigrationSkipReason(CountJson->GetStringField(FString{ TEXT("SkipReason") }), SkipReason))
+		{
+			return false;
+		}
+
+		const uint32 ComponentId = static_cast<uint32>(CountJson->GetIntegerField(FString{ TEXT("ComponentId") }));
+		const int32 FieldNameIndex = Data.InternString(CountJson->GetStringField(FString{ TEXT("FieldName") }));
+		Data.SkippedComponentFieldCounts.Add(MakeSkippedComponentFieldCountKey(ComponentId, FieldNameIndex, SkipReason), CountJson->GetIntegerField(FString{ TEXT("Count") }));
+	}
+
+	// Per-entity skips are only present if they were retained when the report was written.
+	const TArray<TSharedPtr<FJsonValue>>* SkippedEntitiesJson = nullptr;
+	const TArray<TSharedPtr<FJsonValue>>* SkippedComponentFieldsJson = nullptr;
+	Data.bRetainSkipDetails = Json->TryGetArrayField(FString{ TEXT("SkippedEntities") }, SkippedEntitiesJson) && Json->TryGetArrayField(FString{ TEXT("SkippedComponentFieldUpdates") }, SkippedComponentFieldsJson);
+
+	if (Data.bRetainSkipDetails)
+	{
+		for (const TSharedPtr<FJsonValue>& SkippedEntityValue : *SkippedEntitiesJson)
+		{
+			const TSharedPtr<FJsonObject> SkippedEntityJson = SkippedEntityValue->AsObject();
+
+			SkippedEntityInfo SkipInfo;
+			SkipInfo.EntityId = SkippedEntityJson->GetIntegerField(FString{ TEXT("EntityId") });
+			SkipInfo.ClassIndex = Data.InternString(SkippedEntityJson->GetStringField(FString{ TEXT("Class") }));
+			if (!FindSnapshotMigrationSkipReason(SkippedEntityJson->GetStringField(FString{ TEXT("SkipReason") }), SkipInfo.SkipReason))
+			{
+				return false;
+			}
+
+			Data.SkippedEntities.Add(SkipInfo);
+		}
+
+		for (const TSharedPtr<FJsonValue>& EntityValue : *SkippedComponentFieldsJson)
+		{
+			const TSharedPtr<FJsonObject> EntityJson = EntityValue->AsObject();
+			const uint32 EntityId = EntityJson->GetIntegerField(FString{ TEXT("EntityId") });
+
+			for (const TSharedPtr<FJsonValue>& SkippedComponentFieldValue : EntityJson->GetArrayField(FString{ TEXT("SkippedComponentFields") }))
+			{
+				const TSharedPtr<FJsonObject> SkippedComponentFieldJson = SkippedComponentFieldValue->AsObject();
+
+				SkippedComponentFieldInfo SkippedComponentField;
+				SkippedComponentField.EntityId = EntityId;
+				SkippedComponentField.ComponentId = static_cast<uint32>(SkippedComponentFieldJson->GetIntegerField(FString{ TEXT("ComponentId") }));
+				SkippedComponentField.FieldNameIndex = Data.InternString(SkippedComponentFieldJson->GetStringField(FString{ TEXT("FieldName") }));
+				if (!FindSnapshotMigrationSkipReason(SkippedComponentFieldJson->GetStringField(FString{ TEXT("SkipReason") }), SkippedComponentField.SkipReason))
+				{
+					return false;
+				}
+
+				Data.SkippedComponentFieldUpdates.Add(SkippedComponentField);
+			}
+		}
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* PhasesJson = nullptr;
+	if (!Json->TryGetArrayField(FString{ TEXT("Phases") }, PhasesJson))
+	{
+		return false;
+	}
+
+	for (const TSharedPtr<FJsonValue>& PhaseValue : *PhasesJson)
+	{
+		const TSharedPtr<FJsonObject> PhaseJson = PhaseValue->AsObject();
+		const FString PhaseName = PhaseJson->GetStringField(FString{ TEXT("Phase") });
+
+		for (int32 i = 0; i < static_cast<int32>(SnapshotMigrationPhase::Count); i++)
+		{
+			if (PhaseName == GetSnapshotMigrationPhaseName(static_cast<SnapshotMigrationPhase>(i)) && !SnapshotMigrationLatencyHistogram::FromJson(PhaseJson, Data.PhaseLatencies[i]))
+			{
+				return false;
+			}
+		}
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* ClassStatsJson = nullptr;
+	if (!Json->TryGetArrayField(FString{ TEXT("ClassStats") }, ClassStatsJson))
+	{
+		return false;
+	}
+
+	for (const TSharedPtr<FJsonValue>& ClassValue : *ClassStatsJson)
+	{
+		const TSharedPtr<FJsonObject> ClassJson = ClassValue->AsObject();
+		ClassMigrationStats& Stats = Data.ClassStats.FindOrAdd(ClassJson->GetStringField(FString{ TEXT("Class") }));
+
+		if (!ClassJson->TryGetNumberField(FString{ TEXT("NumEntities") }, Stats.NumEntities) ||
+			!ClassJson->TryGetNumberField(FString{ TEXT("NumMigratedEntities") }, Stats.NumMigratedEntities) ||
+			!ClassJson->TryGetNumberField(FString{ TEXT("TotalTime") }, Stats.TotalTime) ||
+			!ClassJson->TryGetNumberField(FString{ TEXT("MaxTime") }, Stats.MaxTime) ||
+			!ClassJson->TryGetNumberField(FString{ TEXT("NumComponents") }, Stats.NumComponents) ||
+			!ClassJson->TryGetNumberField(FString{ TEXT("MigratedBytes") }, Stats.MigratedBytes))
+		{
+			return false;
+		}
+	}
+
+	OutMigrationData = MoveTemp(Data);
+	return true;
 }
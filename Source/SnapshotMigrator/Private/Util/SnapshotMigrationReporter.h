@@ -1,6 +1,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
 #include "Misc/FileHelper.h"
 #include "Policies/CondensedJsonPrintPolicy.h"
 #include "Serialization/JsonWriter.h"
@@ -8,20 +9,123 @@
 #include <functional>
 
 #include "SnapshotMigratorModuleInternal.h"
+#include "SnapshotMigrationTiming.h"
 
 #include "SpatialConstants.h"
 
+enum class SnapshotMigrationSkipReason : uint8
+{
+	ClassNotWhitelisted,
+	ClassNotFound,
+	ClassNotPersistent,
+	SpawnActorFailed,
+	CreateBunchFailed,
+	UpdateComponentFailed,
+	FieldTypeMismatch,
+	DanglingReference,
+	Count
+};
+
+// Short, stable identifier for a skip reason.
+const TCHAR* GetSnapshotMigrationSkipReasonName(const SnapshotMigrationSkipReason SkipReason);
+// Human readable explanation of a skip reason, as written to the reports.
+const TCHAR* GetSnapshotMigrationSkipReasonDescription(const SnapshotMigrationSkipReason SkipReason);
+bool FindSnapshotMigrationSkipReason(const FString& Description, SnapshotMigrationSkipReason& OutSkipReason);
+
+// Ways in which a migrated snapshot can fail to match its target schema bundle; see SnapshotMigrationVerifier.
+enum class SnapshotVerificationFailure : uint8
+{
+	UnreadableSnapshot,
+	UnknownComponent,
+	UnknownField,
+	FieldTypeMismatch,
+	TooManyValues,
+	MissingField,
+	InvalidObjectRefOffset,
+	DanglingObjectRef,
+	Count
+};
+
+const TCHAR* GetSnapshotVerificationFailureName(const SnapshotVerificationFailure Failure);
+const TCHAR* GetSnapshotVerificationFailureDescription(const SnapshotVerificationFailure Failure);
+bool FindSnapshotVerificationFailure(const FString& Description, SnapshotVerificationFailure& OutFailure);
+
+// Class paths and field names are stored as indices into the migration data's interned strings; see SnapshotMigrationData::InternString.
 struct SkippedEntityInfo
 {
-	FString Class;
-	FString SkipReason;
+	uint32 EntityId;
+	int32 ClassIndex;
+	SnapshotMigrationSkipReason SkipReason;
 };
 
 struct SkippedComponentFieldInfo
 {
+	uint32 EntityId;
 	uint32 ComponentId;
-	FString FieldName;
-	FString SkipReason;
+	int32 FieldNameIndex;
+	SnapshotMigrationSkipReason SkipReason;
+};
+
+// Number of entities of a class skipped for the same reason.
+struct SkippedEntityCount
+{
+	int32 ClassIndex;
+	SnapshotMigrationSkipReason SkipReason;
+	int32 Count;
+};
+
+// Number of updates to the same component field skipped for the same reason.
+struct SkippedComponentFieldCount
+{
+	uint32 ComponentId;
+	int32 FieldNameIndex;
+	SnapshotMigrationSkipReason SkipReason;
+	int32 Count;
+};
+
+// Number of times the same component field failed verification in the same way, and the first entity it failed on.
+struct VerificationFailureCount
+{
+	uint32 ComponentId;
+	int32 FieldNameIndex;
+	SnapshotVerificationFailure Failure;
+	int32 Count;
+	uint32 FirstEntityId;
+};
+
+struct ClassMigrationStats
+{
+	int NumEntities = 0;
+	int NumMigratedEntities = 0;
+	double TotalTime = 0.0;
+	double MaxTime = 0.0;
+	int64 NumComponents = 0;
+	int64 MigratedBytes = 0;
+};
+
+// Snapshot of how far a migration has got, reported periodically while a snapshot is being migrated.
+struct SnapshotMigrationProgress
+{
+	FString SnapshotName;
+	bool bFinished = false;
+
+	int64 NumProcessedEntities = 0;
+	int64 NumMigratedEntities = 0;
+	int64 NumSkippedEntities = 0;
+
+	// The snapshot streams don't expose their position, so bytes read is estimated from the serialized size of the entities read so far.
+	uint64 BytesRead = 0;
+	uint64 BytesWritten = 0;
+	int64 SourceSnapshotSize = 0;
+
+	double ElapsedTime = 0.0;
+
+	double GetEntitiesPerSecond() const { return ElapsedTime > 0.0 ? NumProcessedEntities / ElapsedTime : 0.0; }
+	float GetPercentRead() const { return SourceSnapshotSize > 0 ? FMath::Min(100.f, (100.f * BytesRead) / SourceSnapshotSize) : 0.f; }
+	// Estimated seconds until the source snapshot has been read in full, or a negative number if there isn't enough information yet.
+	double GetEstimatedTimeRemaining() const;
+
+	TSharedRef<FJsonObject> ToJson() const;
 };
 
 struct SnapshotMigrationData
@@ -36,44 +140,228 @@ struct SnapshotMigrationData
 	{}
 	
 	void RecordMigratedEntity();
-	void RecordSkippedEntity(const uint32 EntityId, const FString& EntityClass, const FString& SkipReason);
-	void RecordSkippedComponentFieldUpdate(const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const FString& SkipReason);
+	void RecordSkippedEntity(const uint32 EntityId, const FString& EntityClass, const SnapshotMigrationSkipReason SkipReason);
+	void RecordSkippedComponentFieldUpdate(const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotMigrationSkipReason SkipReason);
+	void RecordMigrationCacheLookup(const bool bHit);
+	void RecordClassMigration(const FString& EntityClass, const bool bMigrated, const double Seconds, const int32 NumComponents, const uint64 NumBytes);
+	void RecordPhaseTime(const SnapshotMigrationPhase Phase, const double Seconds)
+	{
+		PhaseLatencies[static_cast<int32>(Phase)].Add(Seconds);
+	}
+
+	// Sampled migrations only migrate a fraction of the snapshot's entities; the rest are counted but neither migrated nor skipped.
+	void SetSampleFraction(const float InSampleFraction) { SampleFraction = InSampleFraction; }
+	void RecordUnsampledEntity() { NumUnsampledEntities++; }
+
+	// Partial migrations only migrate the entities they select; the rest are counted, and either copied to the migrated snapshot unchanged or dropped.
+	void SetPartial(const bool bInCopiesUnselectedEntities)
+	{
+		bPartial = true;
+		bCopiesUnselectedEntities = bInCopiesUnselectedEntities;
+	}
+	void RecordUnselectedEntity() { NumUnselectedEntities++; }
+
+	// Dry runs don't build or write most of the entities they would migrate, so they record the projected cost of writing each one instead.
+	void SetDryRun(const bool bInDryRun) { bDryRun = bInDryRun; }
+	void RecordProjectedOutput(const double Seconds, const uint64 NumBytes)
+	{
+		ProjectedAdditionalTime += Seconds;
+		ProjectedOutputBytes += NumBytes;
+	}
+
+	// Spatially ordered migrations record the mean distance between neighbouring entities in the migrated snapshot, before and after ordering.
+	void SetSpatialOrderLocality(const double InMeanNeighbourDistanceBefore, const double InMeanNeighbourDistanceAfter)
+	{
+		bSpatiallyOrdered = true;
+		MeanNeighbourDistanceBefore = InMeanNeighbourDistanceBefore;
+		MeanNeighbourDistanceAfter = InMeanNeighbourDistanceAfter;
+	}
+
+	// Compacted migrations strip redundant data from entities before writing them, and record the entities' serialized size before and after.
+	void SetCompacted(const bool bInCompacted) { bCompacted = bInCompacted; }
+	void RecordCompaction(const uint64 BytesBefore, const uint64 BytesAfter, const uint32 NumDroppedComponents, const uint32 NumClearedFields)
+	{
+		CompactionBytesBefore += BytesBefore;
+		CompactionBytesAfter += BytesAfter;
+		NumCompactedComponents += NumDroppedComponents;
+		NumCompactedFields += NumClearedFields;
+	}
+
+	// Verified migrations read the migrated snapshot back and check every entity against the target schema bundle.
+	void SetVerified(const uint64 InNumVerifiedEntities, const double InVerificationTime)
+	{
+		bVerified = true;
+		NumVerifiedEntities = InNumVerifiedEntities;
+		VerificationTime = InVerificationTime;
+	}
+	void RecordVerificationFailure(const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotVerificationFailure Failure);
+
+	/**
+	* Adds the counts, skips, timings and class stats of another migration to this one, e.g. to combine the shards of a snapshot which was migrated by
+	* several processes. Shards should be merged in snapshot order, so that retained skip details stay in the order they were recorded.
+	*	@param	Other	Migration data to add to this one
+	*/
+	void Merge(const SnapshotMigrationData& Other);
+
+	// Converts to and from the json layout used by SnapshotMigrationJsonReporter, so that the data of a previous run can be reported again.
+	TSharedRef<FJsonObject> ToJson() const;
+	static bool FromJson(const TSharedPtr<FJsonObject>& Json, SnapshotMigrationData& OutMigrationData);
+
+	// Skips are always aggregated by class, field and reason, but only kept individually when asked for; on snapshots with millions of skips the records dominate memory usage.
+	void SetRetainSkipDetails(const bool bInRetainSkipDetails) { bRetainSkipDetails = bInRetainSkipDetails; }
+
+	// Carries on with migration data restored from a checkpoint; the time spent before the checkpoint counts towards the elapsed time.
+	void Resume()
+	{
+		ResumedElapsedTime = ElapsedTime;
+		Start = FDateTime::Now();
+	}
 
 	void FinalizeData()
 	{
-		ElapsedTime = (FDateTime::Now() - Start).GetTotalSeconds();
-		NumSkippedEntities = SkippedEntities.Num();
+		ElapsedTime = ResumedElapsedTime + (FDateTime::Now() - Start).GetTotalSeconds();
+		ProjectedElapsedTime = ElapsedTime + ProjectedAdditionalTime;
 		NumEncounteredEntities = NumMigratedEntities + NumSkippedEntities;
 
-		PercentMigratedEntities = (100.f * NumMigratedEntities) / NumEncounteredEntities;
-		PercentSkippedEntities = (100.f * NumSkippedEntities) / NumEncounteredEntities;
+		// Checkpoints can finalize the data before any entities have been encountered.
+		PercentMigratedEntities = NumEncounteredEntities > 0 ? (100.f * NumMigratedEntities) / NumEncounteredEntities : 0.f;
+		PercentSkippedEntities = NumEncounteredEntities > 0 ? (100.f * NumSkippedEntities) / NumEncounteredEntities : 0.f;
+		PercentMigrationCacheHits = NumMigrationCacheLookups > 0 ? (100.f * NumMigrationCacheHits) / NumMigrationCacheLookups : 0.f;
 	}
 
 	const FString& GetSnapshotName() const { return SnapshotName; }
 	float GetElapsedTime() const { return ElapsedTime; }
 
+	bool IsSampled() const { return SampleFraction < 1.f; }
+	float GetSampleFraction() const { return SampleFraction; }
+	int GetNumUnsampledEntities() const { return NumUnsampledEntities; }
+
+	bool IsPartial() const { return bPartial; }
+	bool CopiesUnselectedEntities() const { return bCopiesUnselectedEntities; }
+	int GetNumUnselectedEntities() const { return NumUnselectedEntities; }
+
+	bool IsDryRun() const { return bDryRun; }
+	// Only meaningful for dry runs; the time a full migration is projected to take, and the projected size of its output's entities.
+	double GetProjectedElapsedTime() const { return ProjectedElapsedTime; }
+	uint64 GetProjectedOutputBytes() const { return ProjectedOutputBytes; }
+
+	bool IsSpatiallyOrdered() const { return bSpatiallyOrdered; }
+	double GetMeanNeighbourDistanceBefore() const { return MeanNeighbourDistanceBefore; }
+	double GetMeanNeighbourDistanceAfter() const { return MeanNeighbourDistanceAfter; }
+
+	bool IsCompacted() const { return bCompacted; }
+	uint64 GetCompactionBytesBefore() const { return CompactionBytesBefore; }
+	uint64 GetCompactionBytesAfter() const { return CompactionBytesAfter; }
+	int64 GetNumCompactedComponents() const { return NumCompactedComponents; }
+	int64 GetNumCompactedFields() const { return NumCompactedFields; }
+
+	bool IsVerified() const { return bVerified; }
+	uint64 GetNumVerifiedEntities() const { return NumVerifiedEntities; }
+	double GetVerificationTime() const { return VerificationTime; }
+	int64 GetNumVerificationFailures() const { return NumVerificationFailures; }
+	// Aggregated verification failures, most frequent first.
+	TArray<VerificationFailureCount> GetVerificationFailureCounts() const;
+
 	int GetNumEncounteredEntities() const { return NumEncounteredEntities; }
 	int GetNumMigratedEntities() const { return NumMigratedEntities; }
 	float GetPercentMigratedEntities() const { return PercentMigratedEntities; }
 	int GetNumSkippedEntities() const { return NumSkippedEntities; }
 	float GetPercentSkippedEntities() const { return PercentSkippedEntities; }
+	int GetNumSkippedComponentFieldUpdates() const { return NumSkippedComponentFieldUpdates; }
+
+	int GetNumMigrationCacheLookups() const { return NumMigrationCacheLookups; }
+	int GetNumMigrationCacheHits() const { return NumMigrationCacheHits; }
+	float GetPercentMigrationCacheHits() const { return PercentMigrationCacheHits; }
+
+	const TMap<FString, ClassMigrationStats>& GetClassStats() const { return ClassStats; }
+	// Classes ordered by the total time spent migrating them, most expensive first.
+	TArray<FString> GetClassesByTotalTime() const;
+
+	const SnapshotMigrationLatencyHistogram& GetPhaseLatency(const SnapshotMigrationPhase Phase) const { return PhaseLatencies[static_cast<int32>(Phase)]; }
+
+	// Aggregated skips, most frequent first.
+	TArray<SkippedEntityCount> GetSkippedEntityCounts() const;
+	TArray<SkippedComponentFieldCount> GetSkippedComponentFieldCounts() const;
 
-	const TMap<uint32, SkippedEntityInfo>& GetSkippedEntities() const { return SkippedEntities; }
-	const TMap<uint32, TArray<SkippedComponentFieldInfo>>& GetSkippedComponentFields() const { return SkippedComponentFieldUpdates; }
+	// Skip records in the order they were recorded. Only filled in if skip details are being retained.
+	const TArray<SkippedEntityInfo>& GetSkippedEntities() const { return SkippedEntities; }
+	const TArray<SkippedComponentFieldInfo>& GetSkippedComponentFields() const { return SkippedComponentFieldUpdates; }
+
+	/**
+	* Stores a single copy of a string for the lifetime of the migration data. There are only a few hundred distinct class paths and field names
+	* in a snapshot, so recording a skip against one that has been seen before doesn't need to allocate.
+	*	@param	String	String to intern
+	*
+	*	@return			Index which can be passed to GetInternedString
+	*/
+	int32 InternString(const FString& String);
+	const FString& GetInternedString(const int32 Index) const { return InternedStrings[Index]; }
 
 private:
 	FString SnapshotName;
 	FDateTime Start;
-	float ElapsedTime;
+	float ElapsedTime = 0.f;
+	float ResumedElapsedTime = 0.f;
+
+	float SampleFraction = 1.f;
+	int NumUnsampledEntities = 0;
+
+	bool bPartial = false;
+	bool bCopiesUnselectedEntities = false;
+	int NumUnselectedEntities = 0;
+
+	bool bDryRun = false;
+	double ProjectedAdditionalTime = 0.0;
+	double ProjectedElapsedTime = 0.0;
+	uint64 ProjectedOutputBytes = 0;
+
+	bool bSpatiallyOrdered = false;
+	double MeanNeighbourDistanceBefore = 0.0;
+	double MeanNeighbourDistanceAfter = 0.0;
 
-	TMap<uint32, SkippedEntityInfo> SkippedEntities;
+	bool bCompacted = false;
+	uint64 CompactionBytesBefore = 0;
+	uint64 CompactionBytesAfter = 0;
+	int64 NumCompactedComponents = 0;
+	int64 NumCompactedFields = 0;
+
+	bool bVerified = false;
+	uint64 NumVerifiedEntities = 0;
+	double VerificationTime = 0.0;
+	int64 NumVerificationFailures = 0;
+	// Keyed in the same way as SkippedComponentFieldCounts.
+	static uint64 MakeVerificationFailureCountKey(const uint32 ComponentId, const int32 FieldNameIndex, const SnapshotVerificationFailure Failure);
+	TMap<uint64, VerificationFailureCount> VerificationFailureCounts;
+
+	bool bRetainSkipDetails = false;
+	TArray<SkippedEntityInfo> SkippedEntities;
+
+	void WriteSkipDetailsToJson(const TSharedRef<FJsonObject>& Json) const;
+
+	// Keyed by the interned class or field name index, component id and skip reason packed into a single integer, so counting a skip is a single lookup.
+	static uint64 MakeSkippedEntityCountKey(const int32 ClassIndex, const SnapshotMigrationSkipReason SkipReason);
+	static uint64 MakeSkippedComponentFieldCountKey(const uint32 ComponentId, const int32 FieldNameIndex, const SnapshotMigrationSkipReason SkipReason);
+	TMap<uint64, int32> SkippedEntityCounts;
+	TMap<uint64, int32> SkippedComponentFieldCounts;
+
+	TArray<FString> InternedStrings;
+	TMap<FString, int32> InternedStringIndices;
 
 	int NumEncounteredEntities = 0;
 	int NumMigratedEntities = 0;
 	float PercentMigratedEntities = 0.f;
 	int NumSkippedEntities = 0;
 	float PercentSkippedEntities = 0.f;
-	TMap<uint32, TArray<SkippedComponentFieldInfo>> SkippedComponentFieldUpdates;
+	int NumSkippedComponentFieldUpdates = 0;
+	TArray<SkippedComponentFieldInfo> SkippedComponentFieldUpdates;
+
+	int NumMigrationCacheLookups = 0;
+	int NumMigrationCacheHits = 0;
+	float PercentMigrationCacheHits = 0.f;
+
+	TMap<FString, ClassMigrationStats> ClassStats;
+
+	SnapshotMigrationLatencyHistogram PhaseLatencies[static_cast<int32>(SnapshotMigrationPhase::Count)];
 };
 
 class SnapshotMigrationReporterBase
@@ -92,6 +380,14 @@ public:
 	virtual ~SnapshotMigrationReporterBase() {}
 	virtual void WriteToReport(const SnapshotMigrationData& MigrationData) = 0;
 
+	// Called periodically while a snapshot is being migrated, and once more when it's finished.
+	virtual void WriteProgress(const SnapshotMigrationProgress& Progress) {}
+
+	// Called as each skip is recorded, for reporters which stream records out rather than waiting for the finished migration data.
+	virtual void OnSkippedEntity(const SnapshotMigrationData& MigrationData, const uint32 EntityId, const FString& EntityClass, const SnapshotMigrationSkipReason SkipReason) {}
+	virtual void OnSkippedComponentFieldUpdate(const SnapshotMigrationData& MigrationData, const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotMigrationSkipReason SkipReason) {}
+	virtual void OnVerificationFailure(const SnapshotMigrationData& MigrationData, const uint32 EntityId, const uint32 ComponentId, const FString& FieldName, const SnapshotVerificationFailure Failure) {}
+
 protected:
 	std::function<void(const FString&)> Write;
 };
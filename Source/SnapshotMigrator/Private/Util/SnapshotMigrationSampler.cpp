@@ -0,0 +1,31 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationSampler.h"
+
+#include "Util/SnapshotHelperLibrary.h"
+
+#include "Schema/UnrealMetadata.h"
+#include "SpatialConstants.h"
+
+bool SnapshotMigrationSampler::ShouldMigrateEntity(const Worker_Entity* Entity)
+{
+	// SplitMix64's finalizer, which spreads consecutive entity ids evenly over the unit interval.
+	uint64 Hash = static_cast<uint64>(Entity->entity_id) + Seed * 0x9E3779B97F4A7C15ull;
+	Hash = (Hash ^ (Hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+	Hash = (Hash ^ (Hash >> 27)) * 0x94D049BB133111EBull;
+	Hash ^= Hash >> 31;
+
+	const bool bPicked = (Hash >> 11) * (1.0 / static_cast<double>(1ull << 53)) < Fraction;
+
+	const Worker_ComponentData* UnrealMetadataComponentPtr = SnapshotHelperLibrary::GetComponentFromEntityById(Entity, SpatialConstants::UNREAL_METADATA_COMPONENT_ID);
+	const FString& ClassPath = UnrealMetadataComponentPtr != nullptr ? SpatialGDK::UnrealMetadata{ *UnrealMetadataComponentPtr }.ClassPath : FString{};
+
+	bool bClassAlreadyPicked = false;
+	PickedClassPaths.Add(ClassPath, &bClassAlreadyPicked);
+	return bPicked || !bClassAlreadyPicked;
+}
+
+FString SnapshotMigrationSampler::GetSampleSnapshotPath(const FString& TargetPath)
+{
+	return FPaths::Combine(FPaths::GetPath(TargetPath), FString::Printf(TEXT("%s.sample.%s"), *FPaths::GetBaseFilename(TargetPath), *FPaths::GetExtension(TargetPath)));
+}
@@ -0,0 +1,43 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <WorkerSDK/improbable/c_worker.h>
+
+/**
+* Picks a deterministic subset of a snapshot's entities to migrate, for a quick but representative run over a large snapshot.
+* Whether an entity is picked depends only on its entity id and the seed, so the same entities are picked on every run. The first entity of each
+* actor class is always picked, so that every class is represented; entities which don't represent actors are treated as a single class.
+*/
+class SnapshotMigrationSampler
+{
+public:
+	SnapshotMigrationSampler(const float InFraction, const uint64 InSeed)
+		: Fraction(InFraction), Seed(InSeed)
+	{
+	}
+
+	/**
+	* Decides whether an entity is part of the sample.
+	*	@param	Entity	Entity as read from the source snapshot
+	*
+	*	@return			True if the entity should be migrated
+	*/
+	bool ShouldMigrateEntity(const Worker_Entity* Entity);
+
+	// Forgets which classes have been picked, so that every class is represented in the next snapshot too.
+	void Reset() { PickedClassPaths.Reset(); }
+
+	float GetFraction() const { return Fraction; }
+
+	// Sampled migrations are written next to the target snapshot rather than over it, e.g. Default.snapshot is sampled to Default.sample.snapshot.
+	static FString GetSampleSnapshotPath(const FString& TargetPath);
+
+private:
+	const float Fraction;
+	const uint64 Seed;
+
+	TSet<FString> PickedClassPaths;
+};
@@ -0,0 +1,211 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationSchemaAnalysis.h"
+
+#include "Util/SnapshotHelperLibrary.h"
+
+#include "Dom/JsonValue.h"
+
+const TCHAR* GetSchemaChangeKindName(const SchemaChangeKind Kind)
+{
+	switch (Kind)
+	{
+	case SchemaChangeKind::ComponentDropped:
+		return TEXT("ComponentDropped");
+	case SchemaChangeKind::ComponentAdded:
+		return TEXT("ComponentAdded");
+	case SchemaChangeKind::ComponentRemapped:
+		return TEXT("ComponentRemapped");
+	case SchemaChangeKind::FieldDropped:
+		return TEXT("FieldDropped");
+	case SchemaChangeKind::FieldAdded:
+		return TEXT("FieldAdded");
+	case SchemaChangeKind::FieldRemapped:
+		return TEXT("FieldRemapped");
+	case SchemaChangeKind::FieldTypeMismatch:
+		return TEXT("FieldTypeMismatch");
+	case SchemaChangeKind::FieldUnsupported:
+		return TEXT("FieldUnsupported");
+	default:
+		checkNoEntry();
+		return TEXT("Invalid");
+	}
+}
+
+bool GetSchemaChangeKindFromName(const FString& Name, SchemaChangeKind& OutKind)
+{
+	for (int32 i = 0; i < static_cast<int32>(SchemaChangeKind::Count); i++)
+	{
+		if (Name.Equals(GetSchemaChangeKindName(static_cast<SchemaChangeKind>(i)), ESearchCase::IgnoreCase))
+		{
+			OutKind = static_cast<SchemaChangeKind>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+TSharedRef<FJsonObject> SchemaChange::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetStringField(FString{ TEXT("Kind") }, GetSchemaChangeKindName(Kind));
+	Json->SetStringField(FString{ TEXT("Component") }, ComponentName);
+
+	// Ids and types are only written for the bundles that the component or field exists in.
+	if (Kind != SchemaChangeKind::ComponentAdded)
+	{
+		Json->SetNumberField(FString{ TEXT("OldComponentId") }, OldComponentId);
+	}
+	if (Kind != SchemaChangeKind::ComponentDropped)
+	{
+		Json->SetNumberField(FString{ TEXT("NewComponentId") }, NewComponentId);
+	}
+
+	if (!FieldName.IsEmpty())
+	{
+		Json->SetStringField(FString{ TEXT("Field") }, FieldName);
+
+		if (Kind != SchemaChangeKind::FieldAdded)
+		{
+			Json->SetNumberField(FString{ TEXT("OldFieldId") }, OldFieldId);
+			Json->SetStringField(FString{ TEXT("OldType") }, OldType);
+		}
+		if (Kind != SchemaChangeKind::FieldDropped)
+		{
+			Json->SetNumberField(FString{ TEXT("NewFieldId") }, NewFieldId);
+			Json->SetStringField(FString{ TEXT("NewType") }, NewType);
+		}
+	}
+
+	return Json;
+}
+
+SnapshotMigrationSchemaAnalysis SnapshotMigrationSchemaAnalysis::Analyze(const SchemaBundleDefinitions& OldDefinitions, const SchemaBundleDefinitions& NewDefinitions)
+{
+	SnapshotMigrationSchemaAnalysis Analysis;
+	const SnapshotDataMigrator Migrator(OldDefinitions, NewDefinitions);
+
+	for (const SchemaBundleComponentDefinition& OldComponent : OldDefinitions.GetComponents())
+	{
+		SchemaChange ComponentChange;
+		ComponentChange.ComponentName = OldComponent.GetName();
+		ComponentChange.OldComponentId = OldComponent.GetId();
+
+		const SchemaBundleComponentDefinition* NewComponent = NewDefinitions.FindComponent(OldComponent.GetName());
+		if (NewComponent == nullptr)
+		{
+			ComponentChange.Kind = SchemaChangeKind::ComponentDropped;
+			Analysis.AddChange(MoveTemp(ComponentChange));
+			continue;
+		}
+
+		ComponentChange.NewComponentId = NewComponent->GetId();
+
+		// Matches the checks made by the migrator's CreateComponentMigration.
+		for (const SchemaBundleFieldDefinition& OldField : OldComponent.GetFields())
+		{
+			SchemaChange FieldChange = ComponentChange;
+			FieldChange.FieldName = OldField.GetName();
+			FieldChange.OldFieldId = OldField.GetId();
+			FieldChange.OldType = OldField.GetTypeName();
+
+			const SchemaBundleFieldDefinition* NewField = NewComponent->FindField(OldField.GetName());
+			if (NewField == nullptr)
+			{
+				FieldChange.Kind = SchemaChangeKind::FieldDropped;
+				Analysis.AddChange(MoveTemp(FieldChange));
+				continue;
+			}
+
+			FieldChange.NewFieldId = NewField->GetId();
+			FieldChange.NewType = NewField->GetTypeName();
+
+			if (!OldField.IsSameTypeAs(*NewField))
+			{
+				FieldChange.Kind = SchemaChangeKind::FieldTypeMismatch;
+			}
+			else if (!Migrator.CanMigrateField(*NewField))
+			{
+				FieldChange.Kind = SchemaChangeKind::FieldUnsupported;
+			}
+			else if (OldField.GetId() != NewField->GetId())
+			{
+				FieldChange.Kind = SchemaChangeKind::FieldRemapped;
+			}
+			else
+			{
+				continue;
+			}
+
+			Analysis.AddChange(MoveTemp(FieldChange));
+		}
+
+		for (const SchemaBundleFieldDefinition& NewField : NewComponent->GetFields())
+		{
+			if (OldComponent.FindField(NewField.GetName()) == nullptr)
+			{
+				SchemaChange FieldChange = ComponentChange;
+				FieldChange.Kind = SchemaChangeKind::FieldAdded;
+				FieldChange.FieldName = NewField.GetName();
+				FieldChange.NewFieldId = NewField.GetId();
+				FieldChange.NewType = NewField.GetTypeName();
+				Analysis.AddChange(MoveTemp(FieldChange));
+			}
+		}
+
+		if (OldComponent.GetId() != NewComponent->GetId())
+		{
+			ComponentChange.Kind = SchemaChangeKind::ComponentRemapped;
+			Analysis.AddChange(MoveTemp(ComponentChange));
+		}
+	}
+
+	for (const SchemaBundleComponentDefinition& NewComponent : NewDefinitions.GetComponents())
+	{
+		if (OldDefinitions.FindComponent(NewComponent.GetName()) == nullptr)
+		{
+			SchemaChange ComponentChange;
+			ComponentChange.Kind = SchemaChangeKind::ComponentAdded;
+			ComponentChange.ComponentName = NewComponent.GetName();
+			ComponentChange.NewComponentId = NewComponent.GetId();
+			Analysis.AddChange(MoveTemp(ComponentChange));
+		}
+	}
+
+	// A change to a whole component has no field name, so it's listed before the changes to its fields.
+	Analysis.Changes.StableSort([](const SchemaChange& Lhs, const SchemaChange& Rhs) {
+		const int32 ComponentOrder = Lhs.ComponentName.Compare(Rhs.ComponentName);
+		return ComponentOrder != 0 ? ComponentOrder < 0 : Lhs.FieldName.Compare(Rhs.FieldName) < 0;
+	});
+
+	return Analysis;
+}
+
+TSharedRef<FJsonObject> SnapshotMigrationSchemaAnalysis::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	TSharedRef<FJsonObject> CountsJson = MakeShareable(new FJsonObject);
+	for (int32 i = 0; i < static_cast<int32>(SchemaChangeKind::Count); i++)
+	{
+		CountsJson->SetNumberField(GetSchemaChangeKindName(static_cast<SchemaChangeKind>(i)), NumChangesByKind[i]);
+	}
+	Json->SetObjectField(FString{ TEXT("Counts") }, CountsJson);
+
+	TArray<TSharedPtr<FJsonValue>> ChangesJson;
+	for (const SchemaChange& Change : Changes)
+	{
+		ChangesJson.Add(MakeShareable(new FJsonValueObject(Change.ToJson())));
+	}
+	Json->SetArrayField(FString{ TEXT("Changes") }, ChangesJson);
+
+	return Json;
+}
+
+void SnapshotMigrationSchemaAnalysis::AddChange(SchemaChange&& Change)
+{
+	NumChangesByKind[static_cast<int32>(Change.Kind)]++;
+	Changes.Add(MoveTemp(Change));
+}
@@ -0,0 +1,70 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+#include "Util/SchemaBundleWrappers.h"
+
+enum class SchemaChangeKind : uint8
+{
+	// The old component has no counterpart in the new schema, so it's dropped from every entity.
+	ComponentDropped,
+	// The new component has no counterpart in the old schema, so it's only ever created with the values its actor is spawned with.
+	ComponentAdded,
+	// The component kept its name but was given a new id.
+	ComponentRemapped,
+	// The old field has no counterpart in the new component, so its data is dropped.
+	FieldDropped,
+	// The new field has no counterpart in the old component, so it keeps the value its actor is spawned with.
+	FieldAdded,
+	// The field kept its name and type but was given a new id.
+	FieldRemapped,
+	// The field kept its name but not its type, so it's skipped and keeps the value its actor is spawned with.
+	FieldTypeMismatch,
+	// The field kept its name and type, but the migrator has no kernel for its type, so its data is never migrated.
+	FieldUnsupported,
+	Count
+};
+
+const TCHAR* GetSchemaChangeKindName(const SchemaChangeKind Kind);
+bool GetSchemaChangeKindFromName(const FString& Name, SchemaChangeKind& OutKind);
+
+struct SchemaChange
+{
+	SchemaChangeKind Kind = SchemaChangeKind::ComponentDropped;
+	FString ComponentName;
+	uint32 OldComponentId = 0;
+	uint32 NewComponentId = 0;
+	// Empty for changes to whole components.
+	FString FieldName;
+	uint32 OldFieldId = 0;
+	uint32 NewFieldId = 0;
+	FString OldType;
+	FString NewType;
+
+	TSharedRef<FJsonObject> ToJson() const;
+};
+
+/**
+* Works out what migrating snapshots between two schema bundles will do to every component and field, from the bundles alone. Components and fields
+* are matched by name in the same way as the migrator matches them, so the analysis is exact for everything that doesn't depend on the data itself.
+*/
+class SnapshotMigrationSchemaAnalysis
+{
+public:
+	static SnapshotMigrationSchemaAnalysis Analyze(const SchemaBundleDefinitions& OldDefinitions, const SchemaBundleDefinitions& NewDefinitions);
+
+	// Changes are ordered by component name, then by field name.
+	const TArray<SchemaChange>& GetChanges() const { return Changes; }
+	int32 GetNumChanges(const SchemaChangeKind Kind) const { return NumChangesByKind[static_cast<int32>(Kind)]; }
+
+	TSharedRef<FJsonObject> ToJson() const;
+
+private:
+	void AddChange(SchemaChange&& Change);
+
+	TArray<SchemaChange> Changes;
+	int32 NumChangesByKind[static_cast<int32>(SchemaChangeKind::Count)] = {};
+};
@@ -0,0 +1,110 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationSelector.h"
+
+#include "Util/SchemaBundleWrappers.h"
+#include "Util/SnapshotHelperLibrary.h"
+
+#include "Schema/UnrealMetadata.h"
+#include "SpatialConstants.h"
+
+bool SnapshotMigrationSelector::AddEntityIdRanges(const FString& Ranges)
+{
+	TArray<FString> RangeStrings;
+	Ranges.ParseIntoArray(RangeStrings, TEXT(","));
+
+	for (const FString& RangeString : RangeStrings)
+	{
+		FString First = RangeString;
+		FString Last = RangeString;
+		const bool bIsRange = RangeString.Split(FString{ TEXT("-") }, &First, &Last);
+
+		First.TrimStartAndEndInline();
+		Last.TrimStartAndEndInline();
+		if ((!First.IsEmpty() && !First.IsNumeric()) || (!Last.IsEmpty() && !Last.IsNumeric()) || (!bIsRange && First.IsEmpty()))
+		{
+			return false;
+		}
+
+		const Worker_EntityId FirstId = First.IsEmpty() ? 0 : FCString::Atoi64(*First);
+		const Worker_EntityId LastId = Last.IsEmpty() ? MAX_int64 : FCString::Atoi64(*Last);
+		if (FirstId > LastId)
+		{
+			return false;
+		}
+
+		EntityIdRanges.Emplace(FirstId, LastId);
+	}
+
+	return true;
+}
+
+bool SnapshotMigrationSelector::ResolveComponents(const SchemaBundleDefinitions& Definitions)
+{
+	ComponentIds.Reset();
+	for (const FString& ComponentName : ComponentNames)
+	{
+		if (ComponentName.IsNumeric())
+		{
+			ComponentIds.AddUnique(FCString::Atoi(*ComponentName));
+			continue;
+		}
+
+		const SchemaBundleComponentDefinition* Definition = Definitions.FindComponent(ComponentName);
+		if (Definition == nullptr)
+		{
+			UE_LOG(LogSnapshotMigrator, Warning, TEXT("Component %s isn't in the source schema bundle!"), *ComponentName);
+			return false;
+		}
+		ComponentIds.AddUnique(Definition->GetId());
+	}
+
+	return true;
+}
+
+bool SnapshotMigrationSelector::ShouldMigrateEntity(const Worker_Entity* Entity) const
+{
+	const Worker_EntityId EntityId = Entity->entity_id;
+	if (EntityIdRanges.Num() > 0 && !EntityIdRanges.ContainsByPredicate([EntityId](const TPair<Worker_EntityId, Worker_EntityId>& Range) { return EntityId >= Range.Key && EntityId <= Range.Value; }))
+	{
+		return false;
+	}
+
+	if (ComponentIds.Num() > 0 && !ComponentIds.ContainsByPredicate([Entity](const Worker_ComponentId ComponentId) { return SnapshotHelperLibrary::GetComponentFromEntityById(Entity, ComponentId) != nullptr; }))
+	{
+		return false;
+	}
+
+	// Checked last, since it's the only criterion which has to read a component's data.
+	if (ClassPatterns.Num() > 0)
+	{
+		const Worker_ComponentData* UnrealMetadataComponentPtr = SnapshotHelperLibrary::GetComponentFromEntityById(Entity, SpatialConstants::UNREAL_METADATA_COMPONENT_ID);
+		const FString& ClassPath = UnrealMetadataComponentPtr != nullptr ? SpatialGDK::UnrealMetadata{ *UnrealMetadataComponentPtr }.ClassPath : FString{};
+		if (!ClassPatterns.ContainsByPredicate([&ClassPath](const FString& Pattern) { return ClassPath.MatchesWildcard(Pattern); }))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SnapshotMigrationSelector::GetUnselectedEntityActionFromName(const FString& Name, UnselectedEntityAction& OutAction)
+{
+	if (Name.Equals(FString{ TEXT("Drop") }))
+	{
+		OutAction = UnselectedEntityAction::Drop;
+		return true;
+	}
+	if (Name.Equals(FString{ TEXT("Copy") }))
+	{
+		OutAction = UnselectedEntityAction::Copy;
+		return true;
+	}
+	return false;
+}
+
+FString SnapshotMigrationSelector::GetPartialSnapshotPath(const FString& TargetPath)
+{
+	return FPaths::Combine(FPaths::GetPath(TargetPath), FString::Printf(TEXT("%s.partial.%s"), *FPaths::GetBaseFilename(TargetPath), *FPaths::GetExtension(TargetPath)));
+}
@@ -0,0 +1,73 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <WorkerSDK/improbable/c_worker.h>
+
+class SchemaBundleDefinitions;
+
+/**
+* Picks the entities a partial migration migrates, so that a single class or region of a large snapshot can be iterated on without migrating the rest.
+* Entities can be selected by id range, by actor class path pattern and by the components they have. An entity is selected if it matches every kind of
+* criterion given, and any one of the criteria of each kind. Whether an entity is selected only depends on the entity itself, so unlike sampling, the
+* selection is the same whichever entities come before it.
+*/
+class SnapshotMigrationSelector
+{
+public:
+	// What happens to the entities which aren't selected. Either way, they're never decoded or spawned.
+	enum class UnselectedEntityAction : uint8
+	{
+		Drop,
+		// Written to the migrated snapshot exactly as they were read, still in the source bundle's schema.
+		Copy
+	};
+
+	/**
+	* Adds entity id ranges to select.
+	*	@param	Ranges	Comma separated ids and inclusive ranges, either end of which may be left open, e.g. "5,100-200,1000-"
+	*
+	*	@return			False if any of the ranges couldn't be parsed
+	*/
+	bool AddEntityIdRanges(const FString& Ranges);
+
+	// Adds a class path to select entities of, which may contain * and ? wildcards, e.g. "*/BP_Door*". Entities without an actor have an empty class path.
+	void AddClassPattern(const FString& Pattern) { ClassPatterns.Add(Pattern); }
+
+	// Adds a component to select entities which have it, given either as a component id or as its qualified name in the source bundle.
+	void AddComponent(const FString& Component) { ComponentNames.Add(Component); }
+
+	/**
+	* Resolves the components given by name to their ids in the source bundle. Must be called before any entities are checked.
+	*	@param	Definitions	Schema bundle the source snapshot was written with
+	*
+	*	@return				False if any of the components isn't in the bundle
+	*/
+	bool ResolveComponents(const SchemaBundleDefinitions& Definitions);
+
+	/**
+	* Decides whether an entity is part of the selection.
+	*	@param	Entity	Entity as read from the source snapshot
+	*
+	*	@return			True if the entity should be migrated
+	*/
+	bool ShouldMigrateEntity(const Worker_Entity* Entity) const;
+
+	bool HasCriteria() const { return EntityIdRanges.Num() > 0 || ClassPatterns.Num() > 0 || ComponentNames.Num() > 0; }
+
+	void SetUnselectedEntityAction(const UnselectedEntityAction InAction) { Action = InAction; }
+	UnselectedEntityAction GetUnselectedEntityAction() const { return Action; }
+	static bool GetUnselectedEntityActionFromName(const FString& Name, UnselectedEntityAction& OutAction);
+
+	// Partial migrations are written next to the target snapshot rather than over it, e.g. Default.snapshot is migrated to Default.partial.snapshot.
+	static FString GetPartialSnapshotPath(const FString& TargetPath);
+
+private:
+	TArray<TPair<Worker_EntityId, Worker_EntityId>> EntityIdRanges;
+	TArray<FString> ClassPatterns;
+	TArray<FString> ComponentNames;
+	TArray<Worker_ComponentId> ComponentIds;
+	UnselectedEntityAction Action = UnselectedEntityAction::Drop;
+};
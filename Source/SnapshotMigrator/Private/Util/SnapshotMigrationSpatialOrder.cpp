@@ -0,0 +1,415 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationSpatialOrder.h"
+
+#include "Util/SnapshotHelperLibrary.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/ScopeExit.h"
+
+#include "Schema/StandardLibrary.h"
+#include "SpatialConstants.h"
+
+namespace
+{
+	// improbable.Position's only field.
+	const Schema_FieldId POSITION_COORDS_FIELD_ID = 1;
+
+	// Sorts entities without a position after every entity with one.
+	const uint64 NO_POSITION_KEY = MAX_uint64;
+
+	bool GetEntityCoords(const Worker_Entity* Entity, SpatialGDK::Coordinates& OutCoords)
+	{
+		const Worker_ComponentData* PositionComponent = SnapshotHelperLibrary::GetComponentFromEntityById(Entity, SpatialConstants::POSITION_COMPONENT_ID);
+		if (PositionComponent == nullptr)
+		{
+			return false;
+		}
+
+		Schema_Object* Fields = Schema_GetComponentDataFields(PositionComponent->schema_type);
+		if (Schema_GetObjectCount(Fields, POSITION_COORDS_FIELD_ID) == 0)
+		{
+			return false;
+		}
+
+		OutCoords = SpatialGDK::IndexCoordinateFromSchema(Fields, POSITION_COORDS_FIELD_ID, 0);
+		return true;
+	}
+
+	// Maps the positions within a snapshot's bounds onto the Hilbert curve's grid. Cells are square, so the curve isn't stretched along either axis.
+	struct SpatialBounds
+	{
+		double MinX = MAX_dbl;
+		double MinZ = MAX_dbl;
+		double MaxX = -MAX_dbl;
+		double MaxZ = -MAX_dbl;
+
+		void Add(const SpatialGDK::Coordinates& Coords)
+		{
+			MinX = FMath::Min(MinX, Coords.X);
+			MinZ = FMath::Min(MinZ, Coords.Z);
+			MaxX = FMath::Max(MaxX, Coords.X);
+			MaxZ = FMath::Max(MaxZ, Coords.Z);
+		}
+
+		uint64 GetKey(const Worker_Entity* Entity) const
+		{
+			SpatialGDK::Coordinates Coords;
+			if (!GetEntityCoords(Entity, Coords))
+			{
+				return NO_POSITION_KEY;
+			}
+
+			const double MaxCell = static_cast<double>((1u << SnapshotMigrationSpatialOrder::HILBERT_ORDER) - 1);
+			const double CellsPerUnit = MaxCell / FMath::Max(FMath::Max(MaxX - MinX, MaxZ - MinZ), SMALL_NUMBER);
+
+			const uint32 X = static_cast<uint32>(FMath::Clamp((Coords.X - MinX) * CellsPerUnit, 0.0, MaxCell));
+			const uint32 Z = static_cast<uint32>(FMath::Clamp((Coords.Z - MinZ) * CellsPerUnit, 0.0, MaxCell));
+
+			return SnapshotMigrationSpatialOrder::GetHilbertIndex(X, Z);
+		}
+	};
+
+	// Measures how scattered a snapshot's entities are, as the mean distance between each entity with a position and the previous one.
+	struct NeighbourDistance
+	{
+		bool bHasPrevious = false;
+		SpatialGDK::Coordinates Previous;
+		double TotalDistance = 0.0;
+		uint64 NumDistances = 0;
+
+		void Add(const Worker_Entity* Entity)
+		{
+			SpatialGDK::Coordinates Coords;
+			if (!GetEntityCoords(Entity, Coords))
+			{
+				return;
+			}
+
+			if (bHasPrevious)
+			{
+				TotalDistance += FMath::Sqrt(FMath::Square(Coords.X - Previous.X) + FMath::Square(Coords.Y - Previous.Y) + FMath::Square(Coords.Z - Previous.Z));
+				NumDistances++;
+			}
+
+			Previous = Coords;
+			bHasPrevious = true;
+		}
+
+		double GetMean() const { return NumDistances > 0 ? TotalDistance / NumDistances : 0.0; }
+	};
+
+	// An entity copied out of the source snapshot, since the stream only keeps the entity it read last.
+	struct RunEntity
+	{
+		uint64 Key;
+		Worker_EntityId EntityId;
+		TArray<Worker_ComponentData> Components;
+	};
+
+	void DestroyRun(TArray<RunEntity>& Entities)
+	{
+		for (RunEntity& Entity : Entities)
+		{
+			for (Worker_ComponentData& Component : Entity.Components)
+			{
+				Schema_DestroyComponentData(Component.schema_type);
+			}
+		}
+		Entities.Reset();
+	}
+
+	// Sorts a run and writes it to a snapshot of its own, then empties it.
+	bool WriteRun(const FString& Path, TArray<RunEntity>& Entities, const Worker_SnapshotParameters& Parameters, NeighbourDistance* Locality)
+	{
+		// Entities with the same key keep the order they were read in, so that ordering a snapshot twice gives the same result.
+		Entities.StableSort([](const RunEntity& Lhs, const RunEntity& Rhs) { return Lhs.Key < Rhs.Key; });
+
+		ON_SCOPE_EXIT
+		{
+			DestroyRun(Entities);
+		};
+
+		Worker_SnapshotOutputStream* OutputStream = Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*Path), &Parameters);
+		ON_SCOPE_EXIT
+		{
+			Worker_SnapshotOutputStream_Destroy(OutputStream);
+		};
+
+		if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString::Printf(TEXT("open snapshot %s"), *Path)))
+		{
+			return false;
+		}
+
+		for (const RunEntity& Entity : Entities)
+		{
+			Worker_Entity OutputEntity;
+			OutputEntity.entity_id = Entity.EntityId;
+			OutputEntity.component_count = Entity.Components.Num();
+			OutputEntity.components = Entity.Components.GetData();
+
+			if (Locality != nullptr)
+			{
+				Locality->Add(&OutputEntity);
+			}
+
+			Worker_SnapshotOutputStream_WriteEntity(OutputStream, &OutputEntity);
+			if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString::Printf(TEXT("write entity with id %lld to snapshot %s"), Entity.EntityId, *Path)))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool ForEachEntity(const FString& Path, const Worker_SnapshotParameters& Parameters, TFunctionRef<bool(const Worker_Entity*)> Visit)
+	{
+		Worker_SnapshotInputStream* InputStream = Worker_SnapshotInputStream_Create(TCHAR_TO_UTF8(*Path), &Parameters);
+		ON_SCOPE_EXIT
+		{
+			Worker_SnapshotInputStream_Destroy(InputStream);
+		};
+
+		if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString::Printf(TEXT("open snapshot %s"), *Path)))
+		{
+			return false;
+		}
+
+		while (Worker_SnapshotInputStream_HasNext(InputStream))
+		{
+			const Worker_Entity* Entity = Worker_SnapshotInputStream_ReadEntity(InputStream);
+			if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString::Printf(TEXT("read entity from snapshot %s"), *Path)) || !Visit(Entity))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	* Writes the entities of a snapshot to the output in order of their keys, by sorting runs which fit in memory and writing each to a snapshot of its
+	* own, then merging the runs. A snapshot which fits in a single run is written straight to the output.
+	*	@param	Locality	Measures the locality of the output as it's written, if set
+	*/
+	bool SortSnapshot(const FString& SourcePath, const FString& OutputPath, const uint64 MaxRunBytes, const Worker_SnapshotParameters& Parameters, TFunctionRef<uint64(const Worker_Entity*)> GetKey, NeighbourDistance* Locality, int32& OutNumRuns)
+	{
+		TArray<FString> RunPaths;
+		ON_SCOPE_EXIT
+		{
+			for (const FString& RunPath : RunPaths)
+			{
+				IFileManager::Get().Delete(*RunPath, false, true);
+			}
+		};
+
+		TArray<RunEntity> Run;
+		uint64 RunBytes = 0;
+
+		const auto WriteNextRun = [&RunPaths, &Run, &RunBytes, &Parameters, &OutputPath]() {
+			RunPaths.Add(FString::Printf(TEXT("%s.%d.run"), *OutputPath, RunPaths.Num()));
+			RunBytes = 0;
+			return WriteRun(RunPaths.Last(), Run, Parameters, nullptr);
+		};
+
+		const bool bSortedRuns = ForEachEntity(SourcePath, Parameters, [&GetKey, &Run, &RunBytes, MaxRunBytes, &WriteNextRun](const Worker_Entity* Entity) {
+			RunEntity& Copy = Run.AddDefaulted_GetRef();
+			Copy.Key = GetKey(Entity);
+			Copy.EntityId = Entity->entity_id;
+			Copy.Components.Reserve(Entity->component_count);
+			for (uint32 i = 0; i < Entity->component_count; i++)
+			{
+				Worker_ComponentData Component = Entity->components[i];
+				Component.schema_type = Schema_CopyComponentData(Entity->components[i].schema_type);
+				Copy.Components.Add(Component);
+			}
+
+			RunBytes += SnapshotHelperLibrary::GetSerializedComponentsSize(Entity->components, Entity->component_count);
+			return RunBytes < MaxRunBytes || WriteNextRun();
+		});
+
+		if (!bSortedRuns)
+		{
+			DestroyRun(Run);
+			return false;
+		}
+
+		if (RunPaths.Num() == 0)
+		{
+			OutNumRuns = 1;
+			return WriteRun(OutputPath, Run, Parameters, Locality);
+		}
+
+		if (Run.Num() > 0 && !WriteNextRun())
+		{
+			return false;
+		}
+
+		OutNumRuns = RunPaths.Num();
+
+		// Runs hold consecutive parts of the source, so entities with the same key are taken from the earlier run first.
+		TArray<Worker_SnapshotInputStream*> RunStreams;
+		ON_SCOPE_EXIT
+		{
+			for (Worker_SnapshotInputStream* RunStream : RunStreams)
+			{
+				Worker_SnapshotInputStream_Destroy(RunStream);
+			}
+		};
+
+		Worker_SnapshotOutputStream* OutputStream = Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*OutputPath), &Parameters);
+		ON_SCOPE_EXIT
+		{
+			Worker_SnapshotOutputStream_Destroy(OutputStream);
+		};
+
+		if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString::Printf(TEXT("open snapshot %s"), *OutputPath)))
+		{
+			return false;
+		}
+
+		struct MergeHead
+		{
+			uint64 Key;
+			int32 RunIndex;
+			const Worker_Entity* Entity;
+		};
+
+		const auto IsBefore = [](const MergeHead& Lhs, const MergeHead& Rhs) {
+			return Lhs.Key != Rhs.Key ? Lhs.Key < Rhs.Key : Lhs.RunIndex < Rhs.RunIndex;
+		};
+
+		TArray<MergeHead> Heads;
+		Heads.Reserve(RunPaths.Num());
+
+		// Each run's stream only keeps the entity it read last, so the next one is only read once that entity has been written.
+		const auto ReadNextHead = [&RunStreams, &RunPaths, &Heads, &GetKey, &IsBefore](const int32 RunIndex) {
+			Worker_SnapshotInputStream* RunStream = RunStreams[RunIndex];
+			if (!Worker_SnapshotInputStream_HasNext(RunStream))
+			{
+				return true;
+			}
+
+			const Worker_Entity* Entity = Worker_SnapshotInputStream_ReadEntity(RunStream);
+			if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, RunStream, FString::Printf(TEXT("read entity from snapshot %s"), *RunPaths[RunIndex])))
+			{
+				return false;
+			}
+
+			Heads.HeapPush(MergeHead{ GetKey(Entity), RunIndex, Entity }, IsBefore);
+			return true;
+		};
+
+		for (int32 RunIndex = 0; RunIndex < RunPaths.Num(); RunIndex++)
+		{
+			RunStreams.Add(Worker_SnapshotInputStream_Create(TCHAR_TO_UTF8(*RunPaths[RunIndex]), &Parameters));
+			if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, RunStreams[RunIndex], FString::Printf(TEXT("open snapshot %s"), *RunPaths[RunIndex])) ||
+				!ReadNextHead(RunIndex))
+			{
+				return false;
+			}
+		}
+
+		while (Heads.Num() > 0)
+		{
+			MergeHead Head;
+			Heads.HeapPop(Head, IsBefore, false);
+
+			if (Locality != nullptr)
+			{
+				Locality->Add(Head.Entity);
+			}
+
+			Worker_SnapshotOutputStream_WriteEntity(OutputStream, Head.Entity);
+			if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString::Printf(TEXT("write entity with id %lld to snapshot %s"), Head.Entity->entity_id, *OutputPath)) ||
+				!ReadNextHead(Head.RunIndex))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+bool SnapshotMigrationSpatialOrder::OrderSnapshot(const FString& SourcePath, const FString& OutputPath, const uint64 MaxRunBytes, Result& OutResult)
+{
+	OutResult = Result{};
+
+	const Worker_ComponentVtable DefaultVtable{};
+	Worker_SnapshotParameters Parameters{};
+	Parameters.default_component_vtable = &DefaultVtable;
+
+	// The first pass finds the bounds that keys are relative to, and measures the source's locality.
+	SpatialBounds Bounds;
+	NeighbourDistance LocalityBefore;
+	const bool bMeasured = ForEachEntity(SourcePath, Parameters, [&OutResult, &Bounds, &LocalityBefore](const Worker_Entity* Entity) {
+		OutResult.NumEntities++;
+
+		SpatialGDK::Coordinates Coords;
+		if (GetEntityCoords(Entity, Coords))
+		{
+			Bounds.Add(Coords);
+		}
+		else
+		{
+			OutResult.NumEntitiesWithoutPosition++;
+		}
+
+		LocalityBefore.Add(Entity);
+		return true;
+	});
+
+	if (!bMeasured)
+	{
+		return false;
+	}
+
+	OutResult.MeanNeighbourDistanceBefore = LocalityBefore.GetMean();
+
+	// The second pass sorts each run in memory and writes it out, and the third merges the runs.
+	NeighbourDistance LocalityAfter;
+	if (!SortSnapshot(SourcePath, OutputPath, MaxRunBytes, Parameters, [&Bounds](const Worker_Entity* Entity) { return Bounds.GetKey(Entity); }, &LocalityAfter, OutResult.NumRuns))
+	{
+		return false;
+	}
+
+	OutResult.MeanNeighbourDistanceAfter = LocalityAfter.GetMean();
+	return true;
+}
+
+bool SnapshotMigrationSpatialOrder::OrderSnapshotByEntityId(const FString& SourcePath, const FString& OutputPath, const uint64 MaxRunBytes, int32& OutNumRuns)
+{
+	const Worker_ComponentVtable DefaultVtable{};
+	Worker_SnapshotParameters Parameters{};
+	Parameters.default_component_vtable = &DefaultVtable;
+
+	return SortSnapshot(SourcePath, OutputPath, MaxRunBytes, Parameters, [](const Worker_Entity* Entity) { return static_cast<uint64>(Entity->entity_id); }, nullptr, OutNumRuns);
+}
+
+uint64 SnapshotMigrationSpatialOrder::GetHilbertIndex(uint32 X, uint32 Y)
+{
+	const uint32 GridSize = 1u << HILBERT_ORDER;
+
+	uint64 Index = 0;
+	for (uint32 CellSize = GridSize / 2; CellSize > 0; CellSize /= 2)
+	{
+		const uint32 RightHalf = (X & CellSize) > 0 ? 1 : 0;
+		const uint32 TopHalf = (Y & CellSize) > 0 ? 1 : 0;
+		Index += static_cast<uint64>(CellSize) * CellSize * ((3 * RightHalf) ^ TopHalf);
+
+		// Rotate the quadrant so that the curve within it starts and ends next to its neighbouring quadrants.
+		if (TopHalf == 0)
+		{
+			if (RightHalf == 1)
+			{
+				X = GridSize - 1 - X;
+				Y = GridSize - 1 - Y;
+			}
+			Swap(X, Y);
+		}
+	}
+
+	return Index;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <WorkerSDK/improbable/c_worker.h>
+
+/**
+* Rewrites a snapshot with its entities ordered along a Hilbert curve over the x and z coordinates of their improbable.Position, so that entities which
+* are near each other in the world are near each other in the file too. The snapshot is sorted in runs which fit in memory and the runs are then merged,
+* so that snapshots larger than memory can be ordered. Entities without a position are written last, in their original order.
+*/
+class SnapshotMigrationSpatialOrder
+{
+public:
+	struct Result
+	{
+		uint64 NumEntities = 0;
+		uint64 NumEntitiesWithoutPosition = 0;
+		int32 NumRuns = 0;
+		// Mean distance between consecutive entities which both have a position, before and after ordering, in world units.
+		double MeanNeighbourDistanceBefore = 0.0;
+		double MeanNeighbourDistanceAfter = 0.0;
+	};
+
+	/**
+	* Orders the entities of a snapshot spatially. The snapshot is read three times: to find the bounds of its positions, to write sorted runs next to
+	* the output, and to merge the runs into the output.
+	*	@param	SourcePath		Snapshot to order
+	*	@param	OutputPath		Path of the ordered snapshot, which mustn't be the same as the source's
+	*	@param	MaxRunBytes		Serialized size of the entities sorted in memory at once
+	*	@param	OutResult		Entity counts and how much closer together neighbouring entities are
+	*
+	*	@return					True if every entity was written to the ordered snapshot
+	*/
+	static bool OrderSnapshot(const FString& SourcePath, const FString& OutputPath, const uint64 MaxRunBytes, Result& OutResult);
+
+	/**
+	* Orders the entities of a snapshot by entity id, in the same runs as OrderSnapshot, for tools which stream snapshots side by side. Entities with the
+	* same id keep their original order.
+	*	@param	SourcePath		Snapshot to order
+	*	@param	OutputPath		Path of the ordered snapshot, which mustn't be the same as the source's
+	*	@param	MaxRunBytes		Serialized size of the entities sorted in memory at once
+	*	@param	OutNumRuns		Number of runs the snapshot was sorted in
+	*
+	*	@return					True if every entity was written to the ordered snapshot
+	*/
+	static bool OrderSnapshotByEntityId(const FString& SourcePath, const FString& OutputPath, const uint64 MaxRunBytes, int32& OutNumRuns);
+
+	/**
+	* Position of a cell along a Hilbert curve over a square grid of HILBERT_ORDER bits a side. Neighbouring cells along the curve are always neighbours
+	* in the grid, which keeps clusters of entities closer together in the file than ordering along a Morton curve would.
+	*/
+	static uint64 GetHilbertIndex(uint32 X, uint32 Y);
+
+	static constexpr uint32 HILBERT_ORDER = 24;
+	static constexpr uint64 DEFAULT_MAX_RUN_BYTES = 1024ull * 1024ull * 1024ull;
+};
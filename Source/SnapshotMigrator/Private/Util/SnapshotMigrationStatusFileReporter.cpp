@@ -0,0 +1,24 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationStatusFileReporter.h"
+
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+void SnapshotMigrationStatusFileReporter::WriteProgress(const SnapshotMigrationProgress& Progress)
+{
+	FString OutputString;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&OutputString);
+	FJsonSerializer::Serialize(Progress.ToJson(), Writer);
+
+	// Write next to the status file and move it into place, so that anything polling the file never sees it half written.
+	const FString& TmpStatusFilepath = FString::Printf(TEXT("%s.tmp"), *StatusFilepath);
+	if (!FFileHelper::SaveStringToFile(OutputString, *TmpStatusFilepath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM) ||
+		!IFileManager::Get().Move(*StatusFilepath, *TmpStatusFilepath, true, true))
+	{
+		UE_LOG(LogSnapshotMigrator, Warning, TEXT("Failed to update status file %s."), *StatusFilepath);
+	}
+}
@@ -0,0 +1,26 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "SnapshotMigrationReporter.h"
+
+/**
+* Keeps a json file up to date with the latest progress of the migration, so that it can be polled by monitoring tools while the migrator is running.
+*/
+class SnapshotMigrationStatusFileReporter : public SnapshotMigrationReporterBase
+{
+public:
+	SnapshotMigrationStatusFileReporter(const FString& InStatusFilepath)
+		: StatusFilepath(InStatusFilepath)
+	{
+	}
+
+	virtual ~SnapshotMigrationStatusFileReporter() override {}
+
+	// The status file only ever holds progress; the final report is left to the other reporters.
+	virtual void WriteToReport(const SnapshotMigrationData& MigrationData) override {}
+	virtual void WriteProgress(const SnapshotMigrationProgress& Progress) override;
+
+private:
+	FString StatusFilepath;
+};
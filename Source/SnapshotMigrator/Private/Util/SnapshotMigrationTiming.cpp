@@ -0,0 +1,182 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationTiming.h"
+
+#include "Dom/JsonValue.h"
+
+#include "Util/SnapshotMigrationReporter.h"
+#include "Util/SnapshotMigrationTraceWriter.h"
+
+const TCHAR* GetSnapshotMigrationPhaseName(const SnapshotMigrationPhase Phase)
+{
+	switch (Phase)
+	{
+	case SnapshotMigrationPhase::Read:
+		return TEXT("Read");
+	case SnapshotMigrationPhase::ClassFilter:
+		return TEXT("ClassFilter");
+	case SnapshotMigrationPhase::LoadClass:
+		return TEXT("LoadClass");
+	case SnapshotMigrationPhase::SpawnActor:
+		return TEXT("SpawnActor");
+	case SnapshotMigrationPhase::Replicate:
+		return TEXT("Replicate");
+	case SnapshotMigrationPhase::CreateEntityComponents:
+		return TEXT("CreateEntityComponents");
+	case SnapshotMigrationPhase::UpdateComponents:
+		return TEXT("UpdateComponents");
+	case SnapshotMigrationPhase::FanOut:
+		return TEXT("FanOut");
+	case SnapshotMigrationPhase::Compact:
+		return TEXT("Compact");
+	case SnapshotMigrationPhase::Write:
+		return TEXT("Write");
+	case SnapshotMigrationPhase::MigrateEntity:
+		return TEXT("MigrateEntity");
+	default:
+		checkNoEntry();
+		return TEXT("Invalid");
+	}
+}
+
+void SnapshotMigrationLatencyHistogram::Add(const double Seconds)
+{
+	Buckets[GetBucketIndex(static_cast<uint64>(Seconds * 1000000.0))]++;
+	Count++;
+	TotalSeconds += Seconds;
+	MaxSeconds = FMath::Max(MaxSeconds, Seconds);
+}
+
+void SnapshotMigrationLatencyHistogram::Merge(const SnapshotMigrationLatencyHistogram& Other)
+{
+	for (int32 i = 0; i < NUM_BUCKETS; i++)
+	{
+		Buckets[i] += Other.Buckets[i];
+	}
+
+	Count += Other.Count;
+	TotalSeconds += Other.TotalSeconds;
+	MaxSeconds = FMath::Max(MaxSeconds, Other.MaxSeconds);
+}
+
+double SnapshotMigrationLatencyHistogram::GetPercentileSeconds(const float Percentile) const
+{
+	if (Count == 0)
+	{
+		return 0.0;
+	}
+
+	const uint64 TargetCount = FMath::Max<uint64>(1, static_cast<uint64>(FMath::CeilToDouble(Count * FMath::Clamp(Percentile, 0.f, 100.f) / 100.0)));
+
+	uint64 CumulativeCount = 0;
+	for (int32 i = 0; i < NUM_BUCKETS; i++)
+	{
+		CumulativeCount += Buckets[i];
+		if (CumulativeCount >= TargetCount)
+		{
+			// The bucket's upper bound can overshoot the largest value we actually saw.
+			return FMath::Min(GetBucketUpperBound(i) / 1000000.0, MaxSeconds);
+		}
+	}
+
+	return MaxSeconds;
+}
+
+TSharedRef<FJsonObject> SnapshotMigrationLatencyHistogram::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetNumberField(FString{ TEXT("Count") }, Count);
+	Json->SetNumberField(FString{ TEXT("TotalTime") }, TotalSeconds);
+	Json->SetNumberField(FString{ TEXT("MaxTime") }, MaxSeconds);
+
+	// Only non-empty buckets are written, as [BucketIndex, Count] pairs.
+	TArray<TSharedPtr<FJsonValue>> BucketsJson;
+	for (int32 i = 0; i < NUM_BUCKETS; i++)
+	{
+		if (Buckets[i] > 0)
+		{
+			TArray<TSharedPtr<FJsonValue>> BucketJson;
+			BucketJson.Add(MakeShareable(new FJsonValueNumber(i)));
+			BucketJson.Add(MakeShareable(new FJsonValueNumber(Buckets[i])));
+			BucketsJson.Add(MakeShareable(new FJsonValueArray(BucketJson)));
+		}
+	}
+
+	Json->SetArrayField(FString{ TEXT("Buckets") }, BucketsJson);
+
+	return Json;
+}
+
+bool SnapshotMigrationLatencyHistogram::FromJson(const TSharedPtr<FJsonObject>& Json, SnapshotMigrationLatencyHistogram& OutHistogram)
+{
+	SnapshotMigrationLatencyHistogram Histogram;
+
+	int64 HistogramCount = 0;
+	const TArray<TSharedPtr<FJsonValue>>* BucketsJson = nullptr;
+	if (!Json.IsValid() ||
+		!Json->TryGetNumberField(FString{ TEXT("Count") }, HistogramCount) ||
+		!Json->TryGetNumberField(FString{ TEXT("TotalTime") }, Histogram.TotalSeconds) ||
+		!Json->TryGetNumberField(FString{ TEXT("MaxTime") }, Histogram.MaxSeconds) ||
+		!Json->TryGetArrayField(FString{ TEXT("Buckets") }, BucketsJson))
+	{
+		return false;
+	}
+
+	Histogram.Count = static_cast<uint64>(HistogramCount);
+
+	for (const TSharedPtr<FJsonValue>& BucketValue : *BucketsJson)
+	{
+		const TArray<TSharedPtr<FJsonValue>>& BucketJson = BucketValue->AsArray();
+		if (BucketJson.Num() != 2)
+		{
+			return false;
+		}
+
+		const int32 BucketIndex = static_cast<int32>(BucketJson[0]->AsNumber());
+		if (BucketIndex < 0 || BucketIndex >= NUM_BUCKETS)
+		{
+			return false;
+		}
+
+		Histogram.Buckets[BucketIndex] = static_cast<uint64>(BucketJson[1]->AsNumber());
+	}
+
+	OutHistogram = Histogram;
+	return true;
+}
+
+int32 SnapshotMigrationLatencyHistogram::GetBucketIndex(const uint64 Microseconds)
+{
+	if (Microseconds < SUB_BUCKETS)
+	{
+		return static_cast<int32>(Microseconds);
+	}
+
+	const int32 Exponent = FMath::FloorLog2_64(Microseconds);
+	const int32 SubBucket = static_cast<int32>(Microseconds >> (Exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+	return (Exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + SubBucket;
+}
+
+uint64 SnapshotMigrationLatencyHistogram::GetBucketUpperBound(const int32 BucketIndex)
+{
+	if (BucketIndex < SUB_BUCKETS)
+	{
+		return BucketIndex + 1;
+	}
+
+	const int32 Shift = BucketIndex / SUB_BUCKETS - 1;
+	const uint64 SubBucket = BucketIndex % SUB_BUCKETS;
+	return (SUB_BUCKETS + SubBucket + 1) << Shift;
+}
+
+SnapshotMigrationPhaseScope::~SnapshotMigrationPhaseScope()
+{
+	const uint64 EndCycles = FPlatformTime::Cycles64();
+	MigrationData.RecordPhaseTime(Phase, FPlatformTime::ToSeconds64(EndCycles - StartCycles));
+
+	if (TraceWriter != nullptr)
+	{
+		TraceWriter->WriteSpan(GetSnapshotMigrationPhaseName(Phase), TEXT("Entity"), StartCycles, EndCycles, TraceWriter->GetEntityArgs());
+	}
+}
@@ -0,0 +1,100 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformTime.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+struct SnapshotMigrationData;
+class SnapshotMigrationTraceWriter;
+
+enum class SnapshotMigrationPhase : uint8
+{
+	Read,
+	ClassFilter,
+	LoadClass,
+	SpawnActor,
+	Replicate,
+	CreateEntityComponents,
+	UpdateComponents,
+	// Building and writing the entity for every target schema bundle after the first.
+	FanOut,
+	// Stripping redundant data from the entity before it's written, for compacted migrations.
+	Compact,
+	Write,
+	// Covers the whole of MigrateEntity, including the phases above which happen inside it.
+	MigrateEntity,
+	Count
+};
+
+const TCHAR* GetSnapshotMigrationPhaseName(const SnapshotMigrationPhase Phase);
+
+/**
+* Log-linear histogram of latencies, in microseconds. Each power of two is split into SUB_BUCKETS buckets, so percentiles are accurate to within
+* 1 / SUB_BUCKETS of the recorded value while only needing a few hundred counters regardless of how many samples are recorded.
+*/
+class SnapshotMigrationLatencyHistogram
+{
+public:
+	void Add(const double Seconds);
+	void Merge(const SnapshotMigrationLatencyHistogram& Other);
+
+	uint64 GetCount() const { return Count; }
+	double GetTotalSeconds() const { return TotalSeconds; }
+	double GetMaxSeconds() const { return MaxSeconds; }
+
+	/**
+	* Approximates a percentile from the bucket counts.
+	*	@param	Percentile	Percentile in the range [0, 100]
+	*
+	*	@return				Upper bound, in seconds, of the bucket the percentile falls into. Zero if nothing has been recorded.
+	*/
+	double GetPercentileSeconds(const float Percentile) const;
+
+	TSharedRef<FJsonObject> ToJson() const;
+	static bool FromJson(const TSharedPtr<FJsonObject>& Json, SnapshotMigrationLatencyHistogram& OutHistogram);
+
+private:
+	static const int32 SUB_BUCKET_BITS = 2;
+	static const int32 SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const int32 NUM_BUCKETS = 64 * SUB_BUCKETS;
+
+	static int32 GetBucketIndex(const uint64 Microseconds);
+	static uint64 GetBucketUpperBound(const int32 BucketIndex);
+
+	uint64 Buckets[NUM_BUCKETS] = {};
+	uint64 Count = 0;
+	double TotalSeconds = 0.0;
+	double MaxSeconds = 0.0;
+};
+
+/**
+* Records the time spent in its scope against a migration phase, and writes it as a span if given a trace writer. Use SNAPSHOT_MIGRATION_PHASE_SCOPE
+* rather than constructing this directly, so that the phase also shows up as a named CPU scope in Unreal Insights.
+*/
+class SnapshotMigrationPhaseScope
+{
+public:
+	SnapshotMigrationPhaseScope(SnapshotMigrationData& InMigrationData, SnapshotMigrationTraceWriter* InTraceWriter, const SnapshotMigrationPhase InPhase)
+		: MigrationData(InMigrationData), TraceWriter(InTraceWriter), Phase(InPhase), StartCycles(FPlatformTime::Cycles64())
+	{
+	}
+
+	~SnapshotMigrationPhaseScope();
+
+	SnapshotMigrationPhaseScope(const SnapshotMigrationPhaseScope&) = delete;
+	SnapshotMigrationPhaseScope& operator=(const SnapshotMigrationPhaseScope&) = delete;
+
+private:
+	SnapshotMigrationData& MigrationData;
+	SnapshotMigrationTraceWriter* TraceWriter;
+	const SnapshotMigrationPhase Phase;
+	const uint64 StartCycles;
+};
+
+// TraceWriter may be null, in which case the phase is only recorded in the migration data and Unreal Insights.
+#define SNAPSHOT_MIGRATION_PHASE_SCOPE(MigrationData, TraceWriter, Phase) \
+	TRACE_CPUPROFILER_EVENT_SCOPE(SnapshotMigrator_##Phase); \
+	SnapshotMigrationPhaseScope PREPROCESSOR_JOIN(SnapshotMigrationPhaseScope_, __LINE__)(MigrationData, TraceWriter, SnapshotMigrationPhase::Phase)
@@ -0,0 +1,69 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationTraceWriter.h"
+
+#include "HAL/PlatformProcess.h"
+
+namespace
+{
+	// The migrator does all of its traced work on the game thread, so every event shares a single thread id.
+	const uint32 TRACE_THREAD_ID = 1;
+}
+
+SnapshotMigrationTraceWriter::SnapshotMigrationTraceWriter(const FString& Filepath, const int32 InEntitySampleInterval)
+	: Writer(MakeUnique<BufferedFileWriter>(Filepath)), EntitySampleInterval(InEntitySampleInterval), TraceStartCycles(FPlatformTime::Cycles64()), ProcessId(FPlatformProcess::GetCurrentProcessId())
+{
+	if (!Writer->IsValid())
+	{
+		Writer.Reset();
+		return;
+	}
+
+	Writer->Write(FString{ TEXT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n") });
+	WriteEvent(FString::Printf(TEXT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"GameThread\"}}"), ProcessId, TRACE_THREAD_ID));
+}
+
+SnapshotMigrationTraceWriter::~SnapshotMigrationTraceWriter()
+{
+	if (Writer.IsValid())
+	{
+		Writer->Write(FString{ TEXT("\n]}\n") });
+	}
+}
+
+void SnapshotMigrationTraceWriter::SetEntityArgs(const int64 EntityId, const FString& ClassPath /* = FString{} */)
+{
+	EntityArgs = ClassPath.IsEmpty()
+		? FString::Printf(TEXT("\"EntityId\":%lld"), EntityId)
+		: FString::Printf(TEXT("\"EntityId\":%lld,\"Class\":\"%s\""), EntityId, *EscapeJsonString(ClassPath));
+}
+
+void SnapshotMigrationTraceWriter::WriteSpan(const TCHAR* Name, const TCHAR* Category, const uint64 StartCycles, const uint64 EndCycles, const FString& Args /* = FString{} */)
+{
+	if (!Writer.IsValid())
+	{
+		return;
+	}
+
+	const double StartMicroseconds = FPlatformTime::ToMilliseconds64(StartCycles - TraceStartCycles) * 1000.0;
+	const double DurationMicroseconds = FPlatformTime::ToMilliseconds64(EndCycles - StartCycles) * 1000.0;
+
+	WriteEvent(FString::Printf(TEXT("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u,\"args\":{%s}}"),
+		Name, Category, StartMicroseconds, DurationMicroseconds, ProcessId, TRACE_THREAD_ID, *Args));
+}
+
+FString SnapshotMigrationTraceWriter::EscapeJsonString(const FString& String)
+{
+	return String.Replace(TEXT("\\"), TEXT("\\\\")).Replace(TEXT("\""), TEXT("\\\""));
+}
+
+void SnapshotMigrationTraceWriter::WriteEvent(const FString& Event)
+{
+	if (bWroteFirstEvent)
+	{
+		Writer->Write(",\n", 2);
+	}
+
+	Writer->Write(Event);
+	bWroteFirstEvent = true;
+}
@@ -0,0 +1,81 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+
+#include "BufferedFileWriter.h"
+
+/**
+* Streams spans of a migration run to a file in the Chrome trace event format, which can be loaded in chrome://tracing or Perfetto.
+* Per-entity spans are only written for every Nth entity, so that tracing a large snapshot doesn't produce an unusably large trace.
+*/
+class SnapshotMigrationTraceWriter
+{
+public:
+	SnapshotMigrationTraceWriter(const FString& Filepath, const int32 InEntitySampleInterval);
+	~SnapshotMigrationTraceWriter();
+
+	bool IsValid() const { return Writer.IsValid(); }
+
+	bool ShouldSampleEntity(const uint64 EntityIndex) const { return EntitySampleInterval > 0 && EntityIndex % EntitySampleInterval == 0; }
+
+	// Sets the arguments attached to every per-entity span until the next call; the class path is only known once the entity's metadata has been read.
+	void SetEntityArgs(const int64 EntityId, const FString& ClassPath = FString{});
+	const FString& GetEntityArgs() const { return EntityArgs; }
+
+	/**
+	* Writes a complete ("X") event.
+	*	@param	Name			Name of the span
+	*	@param	Category		Category of the span, used for filtering in the trace viewer
+	*	@param	StartCycles		FPlatformTime::Cycles64() at the start of the span
+	*	@param	EndCycles		FPlatformTime::Cycles64() at the end of the span
+	*	@param	Args			Contents of the event's args object, without surrounding braces. May be empty.
+	*/
+	void WriteSpan(const TCHAR* Name, const TCHAR* Category, const uint64 StartCycles, const uint64 EndCycles, const FString& Args = FString{});
+
+	static FString EscapeJsonString(const FString& String);
+
+	static const int32 DEFAULT_ENTITY_SAMPLE_INTERVAL = 100;
+
+private:
+	void WriteEvent(const FString& Event);
+
+	TUniquePtr<BufferedFileWriter> Writer;
+	const int32 EntitySampleInterval;
+	const uint64 TraceStartCycles;
+	const uint32 ProcessId;
+	bool bWroteFirstEvent = false;
+
+	FString EntityArgs;
+};
+
+/**
+* Writes a span covering its scope. Does nothing if given a null writer, so it can be used unconditionally.
+*/
+class SnapshotMigrationTraceSpan
+{
+public:
+	SnapshotMigrationTraceSpan(SnapshotMigrationTraceWriter* InWriter, const TCHAR* InName, const FString& InArgs = FString{})
+		: Writer(InWriter), Name(InName), Args(InArgs), StartCycles(FPlatformTime::Cycles64())
+	{
+	}
+
+	~SnapshotMigrationTraceSpan()
+	{
+		if (Writer != nullptr)
+		{
+			Writer->WriteSpan(Name, TEXT("Migrator"), StartCycles, FPlatformTime::Cycles64(), Args);
+		}
+	}
+
+	SnapshotMigrationTraceSpan(const SnapshotMigrationTraceSpan&) = delete;
+	SnapshotMigrationTraceSpan& operator=(const SnapshotMigrationTraceSpan&) = delete;
+
+private:
+	SnapshotMigrationTraceWriter* Writer;
+	const TCHAR* Name;
+	FString Args;
+	const uint64 StartCycles;
+};
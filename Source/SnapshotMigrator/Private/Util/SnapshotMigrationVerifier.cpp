@@ -0,0 +1,344 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SnapshotMigrationVerifier.h"
+
+#include "Util/SnapshotHelperLibrary.h"
+#include "Util/SnapshotMigrationEntityIndex.h"
+
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Misc/ScopeExit.h"
+
+#include "Schema/UnrealObjectRef.h"
+#include "SpatialConstants.h"
+#include "Utils/SchemaUtils.h"
+
+namespace
+{
+	// Entities copied out of the snapshot, since the stream only keeps the entity it read last, along with what was found when checking them.
+	struct VerificationBatch
+	{
+		TArray<Worker_EntityId> EntityIds;
+		TArray<TArray<Worker_ComponentData>> Components;
+		TArray<TArray<SnapshotVerificationIssue>> Issues;
+		TArray<TArray<SnapshotMigrationVerifier::ObjectRefTarget>> References;
+
+		int32 Num() const { return EntityIds.Num(); }
+
+		void Add(const Worker_Entity* Entity)
+		{
+			EntityIds.Add(Entity->entity_id);
+			TArray<Worker_ComponentData>& EntityComponents = Components.AddDefaulted_GetRef();
+			EntityComponents.Reserve(Entity->component_count);
+			for (uint32 i = 0; i < Entity->component_count; i++)
+			{
+				Worker_ComponentData Component = Entity->components[i];
+				Component.schema_type = Schema_CopyComponentData(Entity->components[i].schema_type);
+				EntityComponents.Add(Component);
+			}
+		}
+
+		void Reset()
+		{
+			for (TArray<Worker_ComponentData>& EntityComponents : Components)
+			{
+				for (Worker_ComponentData& Component : EntityComponents)
+				{
+					Schema_DestroyComponentData(Component.schema_type);
+				}
+			}
+
+			EntityIds.Reset();
+			Components.Reset();
+			Issues.Reset();
+			References.Reset();
+		}
+	};
+}
+
+FString SnapshotMigrationVerifier::FieldPathNode::ToString() const
+{
+	return Parent != nullptr ? FString::Printf(TEXT("%s.%s"), *Parent->ToString(), **Name) : *Name;
+}
+
+void SnapshotMigrationVerifier::EntityContext::AddIssue(const FieldPathNode* Path, const SnapshotVerificationFailure Failure) const
+{
+	Issues.Add(SnapshotVerificationIssue{ EntityId, ComponentId, Path != nullptr ? Path->ToString() : FString{}, Failure });
+}
+
+bool SnapshotMigrationVerifier::VerifySnapshot(const FString& Path, TFunctionRef<void(const SnapshotVerificationIssue&)> OnIssue, Result& OutResult) const
+{
+	OutResult = Result{};
+
+	const auto ReportIssue = [&OnIssue, &OutResult](const SnapshotVerificationIssue& Issue) {
+		OutResult.NumIssues++;
+		OnIssue(Issue);
+	};
+
+	const Worker_ComponentVtable DefaultVtable{};
+	Worker_SnapshotParameters Parameters{};
+	Parameters.default_component_vtable = &DefaultVtable;
+
+	Worker_SnapshotInputStream* InputStream = Worker_SnapshotInputStream_Create(TCHAR_TO_UTF8(*Path), &Parameters);
+	ON_SCOPE_EXIT
+	{
+		Worker_SnapshotInputStream_Destroy(InputStream);
+	};
+
+	// Entity ids are collected as they're read, so that the entities referred to can be looked up once the whole snapshot has been read.
+	SnapshotMigrationEntityIndex EntityIds;
+	TMap<Worker_EntityId, ObjectRefTarget> ReferencedEntities;
+
+	VerificationBatch Batches[2];
+	ON_SCOPE_EXIT
+	{
+		Batches[0].Reset();
+		Batches[1].Reset();
+	};
+
+	TFuture<void> PendingCheck;
+	int32 PendingBatchIndex = INDEX_NONE;
+
+	const auto FinishPendingCheck = [&PendingCheck, &PendingBatchIndex, &Batches, &ReferencedEntities, &ReportIssue]() {
+		if (PendingBatchIndex == INDEX_NONE)
+		{
+			return;
+		}
+
+		PendingCheck.Wait();
+
+		VerificationBatch& Batch = Batches[PendingBatchIndex];
+		for (int32 i = 0; i < Batch.Num(); i++)
+		{
+			for (const SnapshotVerificationIssue& Issue : Batch.Issues[i])
+			{
+				ReportIssue(Issue);
+			}
+
+			for (const ObjectRefTarget& Reference : Batch.References[i])
+			{
+				if (!ReferencedEntities.Contains(Reference.ReferencedEntityId))
+				{
+					ReferencedEntities.Add(Reference.ReferencedEntityId, Reference);
+				}
+			}
+		}
+
+		Batch.Reset();
+		PendingBatchIndex = INDEX_NONE;
+	};
+
+	const auto StartCheck = [this, &PendingCheck, &PendingBatchIndex, &Batches](const int32 BatchIndex) {
+		VerificationBatch& Batch = Batches[BatchIndex];
+		Batch.Issues.SetNum(Batch.Num());
+		Batch.References.SetNum(Batch.Num());
+
+		PendingBatchIndex = BatchIndex;
+		PendingCheck = Async(EAsyncExecution::ThreadPool, [this, &Batch]() {
+			ParallelFor(Batch.Num(), [this, &Batch](const int32 i) {
+				VerifyEntity(Batch.EntityIds[i], Batch.Components[i], Batch.Issues[i], Batch.References[i]);
+			});
+		});
+	};
+
+	bool bReadWholeSnapshot = SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString::Printf(TEXT("open snapshot %s"), *Path));
+	int32 ReadBatchIndex = 0;
+
+	while (bReadWholeSnapshot && Worker_SnapshotInputStream_HasNext(InputStream))
+	{
+		const Worker_Entity* Entity = Worker_SnapshotInputStream_ReadEntity(InputStream);
+		if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotInputStream_GetState, InputStream, FString::Printf(TEXT("read entity from snapshot %s"), *Path)))
+		{
+			bReadWholeSnapshot = false;
+			break;
+		}
+
+		OutResult.NumEntities++;
+		EntityIds.Add(Entity->entity_id);
+		Batches[ReadBatchIndex].Add(Entity);
+
+		// The batch which was read before this one is checked while this one is read, so reading the snapshot is never waiting on the checks.
+		if (Batches[ReadBatchIndex].Num() == BATCH_SIZE)
+		{
+			FinishPendingCheck();
+			StartCheck(ReadBatchIndex);
+			ReadBatchIndex = 1 - ReadBatchIndex;
+		}
+	}
+
+	FinishPendingCheck();
+	if (Batches[ReadBatchIndex].Num() > 0)
+	{
+		StartCheck(ReadBatchIndex);
+		FinishPendingCheck();
+	}
+
+	if (!bReadWholeSnapshot)
+	{
+		ReportIssue(SnapshotVerificationIssue{ SpatialConstants::INVALID_ENTITY_ID, SpatialConstants::INVALID_COMPONENT_ID, FString{}, SnapshotVerificationFailure::UnreadableSnapshot });
+		return false;
+	}
+
+	EntityIds.Build();
+
+	TArray<ObjectRefTarget> DanglingReferences;
+	for (const TPair<Worker_EntityId, ObjectRefTarget>& ReferencedEntity : ReferencedEntities)
+	{
+		if (!EntityIds.Contains(ReferencedEntity.Key))
+		{
+			DanglingReferences.Add(ReferencedEntity.Value);
+		}
+	}
+
+	DanglingReferences.Sort([](const ObjectRefTarget& LHS, const ObjectRefTarget& RHS) {
+		return LHS.EntityId != RHS.EntityId ? LHS.EntityId < RHS.EntityId : LHS.ReferencedEntityId < RHS.ReferencedEntityId;
+	});
+
+	// Each missing entity is reported once, against the component field which first referred to it.
+	for (const ObjectRefTarget& Reference : DanglingReferences)
+	{
+		ReportIssue(SnapshotVerificationIssue{ Reference.EntityId, Reference.ComponentId, Reference.Field != nullptr ? Reference.Field->GetName() : FString{}, SnapshotVerificationFailure::DanglingObjectRef });
+	}
+
+	return true;
+}
+
+void SnapshotMigrationVerifier::VerifyEntity(const Worker_EntityId EntityId, const TArray<Worker_ComponentData>& Components, TArray<SnapshotVerificationIssue>& OutIssues, TArray<ObjectRefTarget>& OutReferences) const
+{
+	for (const Worker_ComponentData& Component : Components)
+	{
+		EntityContext Context{ EntityId, Component.component_id, nullptr, OutIssues, OutReferences };
+
+		const SchemaBundleComponentDefinition* ComponentDefinition = Definitions.FindComponent(Component.component_id);
+		if (ComponentDefinition == nullptr)
+		{
+			if (Component.component_id >= SchemaBundleDefinitions::FIRST_NON_RESERVED_COMPONENT_ID)
+			{
+				Context.AddIssue(nullptr, SnapshotVerificationFailure::UnknownComponent);
+			}
+			continue;
+		}
+
+		// A component's own singular fields may be left out, in which case the GDK keeps the actor's values for them.
+		VerifyObject(Schema_GetComponentDataFields(Component.schema_type), *ComponentDefinition, nullptr, false, 0, Context);
+	}
+}
+
+void SnapshotMigrationVerifier::VerifyObject(Schema_Object* Object, const SchemaBundleDefinitionWithFields& Definition, const FieldPathNode* Path, const bool bSingularFieldsRequired, const int32 Depth, EntityContext& Context) const
+{
+	TArray<Schema_FieldId, TInlineAllocator<32>> FieldIds;
+	FieldIds.SetNumUninitialized(Schema_GetUniqueFieldIdCount(Object));
+	Schema_GetUniqueFieldIds(Object, FieldIds.GetData());
+
+	for (const Schema_FieldId FieldId : FieldIds)
+	{
+		if (Definition.FindField(FieldId) == nullptr)
+		{
+			const FString FieldName = FString::Printf(TEXT("#%u"), FieldId);
+			const FieldPathNode FieldPath{ Path, &FieldName };
+			Context.AddIssue(&FieldPath, SnapshotVerificationFailure::UnknownField);
+		}
+	}
+
+	for (const SchemaBundleFieldDefinition& Field : Definition.GetFields())
+	{
+		const FieldPathNode FieldPath{ Path, &Field.GetName() };
+		if (Depth == 0)
+		{
+			Context.ComponentField = &Field;
+		}
+
+		if (!FieldIds.Contains(Field.GetId()))
+		{
+			if (bSingularFieldsRequired && Field.IsSingular())
+			{
+				Context.AddIssue(&FieldPath, SnapshotVerificationFailure::MissingField);
+			}
+			continue;
+		}
+
+		if (Field.IsMap())
+		{
+			const uint32 NumEntries = Schema_GetObjectCount(Object, Field.GetId());
+			if (NumEntries == 0)
+			{
+				Context.AddIssue(&FieldPath, SnapshotVerificationFailure::FieldTypeMismatch);
+			}
+
+			for (uint32 i = 0; i < NumEntries; i++)
+			{
+				Schema_Object* Entry = Schema_IndexObject(Object, Field.GetId(), i);
+				const uint32 KeyCount = VerifyValues(Entry, SCHEMA_MAP_KEY_FIELD_ID, Field, SchemaBundleFieldDefinition::TypeIndex::KEY, FieldPath, Depth + 1, Context);
+				const uint32 ValueCount = VerifyValues(Entry, SCHEMA_MAP_VALUE_FIELD_ID, Field, SchemaBundleFieldDefinition::TypeIndex::VALUE, FieldPath, Depth + 1, Context);
+				for (const uint32 Count : { KeyCount, ValueCount })
+				{
+					if (Count != 1)
+					{
+						Context.AddIssue(&FieldPath, Count == 0 ? SnapshotVerificationFailure::MissingField : SnapshotVerificationFailure::TooManyValues);
+					}
+				}
+			}
+			continue;
+		}
+
+		const uint32 Count = VerifyValues(Object, Field.GetId(), Field, SchemaBundleFieldDefinition::TypeIndex::INNER, FieldPath, Depth, Context);
+		if (Count == 0)
+		{
+			Context.AddIssue(&FieldPath, SnapshotVerificationFailure::FieldTypeMismatch);
+		}
+		else if (Count > 1 && (Field.IsSingular() || Field.IsOptional()))
+		{
+			Context.AddIssue(&FieldPath, SnapshotVerificationFailure::TooManyValues);
+		}
+	}
+}
+
+uint32 SnapshotMigrationVerifier::VerifyValues(Schema_Object* Object, const Schema_FieldId FieldId, const SchemaBundleFieldDefinition& Field, const SchemaBundleFieldDefinition::TypeIndex Index, const FieldPathNode& Path, const int32 Depth, EntityContext& Context) const
+{
+	const uint32 Count = SnapshotHelperLibrary::GetFieldValueCount(Object, FieldId, Field, Index);
+
+	if (Field.IsPrimitive(Index) || Field.IsEnum(Index) || Depth >= MAX_OBJECT_DEPTH)
+	{
+		return Count;
+	}
+
+	const bool bIsObjectRef = Field.IsUnrealObjectRefType(Index);
+	const SchemaBundleTypeDefinition* Type = Definitions.FindType(Field.GetResolvedType(Index));
+
+	for (uint32 i = 0; i < Count; i++)
+	{
+		if (bIsObjectRef)
+		{
+			VerifyObjectRef(Object, FieldId, i, Path, Context);
+		}
+
+		if (Type != nullptr)
+		{
+			VerifyObject(Schema_IndexObject(Object, FieldId, i), *Type, &Path, true, Depth + 1, Context);
+		}
+	}
+
+	return Count;
+}
+
+void SnapshotMigrationVerifier::VerifyObjectRef(Schema_Object* Object, const Schema_FieldId FieldId, const uint32 Index, const FieldPathNode& Path, EntityContext& Context) const
+{
+	// The ref's outer is a field of the ref's type, so it's checked in turn when the ref's own fields are.
+	const FUnrealObjectRef ObjectRef = SpatialGDK::IndexObjectRefFromSchema(Object, FieldId, Index);
+
+	if (ObjectRef.Entity == SpatialConstants::INVALID_ENTITY_ID)
+	{
+		if (ObjectRef.Offset != SpatialConstants::INVALID_COMPONENT_ID)
+		{
+			Context.AddIssue(&Path, SnapshotVerificationFailure::InvalidObjectRefOffset);
+		}
+		return;
+	}
+
+	if (ObjectRef.Offset != SpatialConstants::INVALID_COMPONENT_ID && Definitions.FindComponent(ObjectRef.Offset) == nullptr)
+	{
+		Context.AddIssue(&Path, SnapshotVerificationFailure::InvalidObjectRefOffset);
+	}
+
+	Context.References.Add(ObjectRefTarget{ ObjectRef.Entity, Context.EntityId, Context.ComponentId, Context.ComponentField });
+}
@@ -0,0 +1,105 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <WorkerSDK/improbable/c_schema.h>
+#include <WorkerSDK/improbable/c_worker.h>
+
+#include "SchemaBundleWrappers.h"
+#include "SnapshotMigrationReporter.h"
+
+struct SnapshotVerificationIssue
+{
+	Worker_EntityId EntityId;
+	Worker_ComponentId ComponentId;
+	// Dotted path from the component to the field, e.g. "Owner.Outer"; empty for issues with the component as a whole.
+	FString FieldPath;
+	SnapshotVerificationFailure Failure;
+};
+
+/**
+* Reads a snapshot back and checks every entity in it against a schema bundle: that its components and fields are defined by the bundle, that fields
+* hold values of the type the bundle gives them and no more of them than their cardinality allows, that nested types and map entries hold their
+* singular fields, and that UnrealObjectRefs have offsets which are components of the bundle and refer to entities in the snapshot.
+* The snapshot stream can only be read on one thread, so entities are read in batches and each batch is checked on the thread pool while the next
+* one is read.
+*/
+class SnapshotMigrationVerifier
+{
+public:
+	struct Result
+	{
+		uint64 NumEntities = 0;
+		uint64 NumIssues = 0;
+	};
+
+	explicit SnapshotMigrationVerifier(const SchemaBundleDefinitions& InDefinitions)
+		: Definitions(InDefinitions)
+	{
+	}
+
+	/**
+	* Verifies a snapshot. Issues are passed to OnIssue on the calling thread, in the order the entities they were found on were read, except for
+	* references to entities which aren't in the snapshot, which can only be found once every entity has been read and are passed on last.
+	*	@param	Path		Snapshot to verify
+	*	@param	OnIssue		Called with each issue found
+	*	@param	OutResult	Number of entities read and issues found
+	*
+	*	@return				True if the whole snapshot could be read; a snapshot which can't be is also reported as an issue
+	*/
+	bool VerifySnapshot(const FString& Path, TFunctionRef<void(const SnapshotVerificationIssue&)> OnIssue, Result& OutResult) const;
+
+	// Number of entities read before they're handed to the thread pool. Two batches are held in memory at once.
+	static constexpr int32 BATCH_SIZE = 4096;
+
+	// Nested types deeper than this aren't checked, so that a malformed snapshot can't recurse without bound.
+	static constexpr int32 MAX_OBJECT_DEPTH = 32;
+
+	// An entity referred to by an UnrealObjectRef, and the first place it was referred to from.
+	struct ObjectRefTarget
+	{
+		Worker_EntityId ReferencedEntityId;
+		Worker_EntityId EntityId;
+		Worker_ComponentId ComponentId;
+		const SchemaBundleFieldDefinition* Field;
+	};
+
+	/**
+	* Checks a single entity. Safe to call from several threads at once.
+	*	@param	EntityId		Id of the entity
+	*	@param	Components		Components of the entity
+	*	@param	OutIssues		Issues found with the entity
+	*	@param	OutReferences	Entities referred to by the entity, to be checked once every entity in the snapshot is known
+	*/
+	void VerifyEntity(const Worker_EntityId EntityId, const TArray<Worker_ComponentData>& Components, TArray<SnapshotVerificationIssue>& OutIssues, TArray<ObjectRefTarget>& OutReferences) const;
+
+private:
+	// Fields are only named when an issue is found with them, so checking a field which is fine doesn't allocate.
+	struct FieldPathNode
+	{
+		const FieldPathNode* Parent;
+		const FString* Name;
+
+		FString ToString() const;
+	};
+
+	struct EntityContext
+	{
+		Worker_EntityId EntityId;
+		Worker_ComponentId ComponentId;
+		// The component's field which the object being checked is within.
+		const SchemaBundleFieldDefinition* ComponentField;
+		TArray<SnapshotVerificationIssue>& Issues;
+		TArray<ObjectRefTarget>& References;
+
+		void AddIssue(const FieldPathNode* Path, const SnapshotVerificationFailure Failure) const;
+	};
+
+	void VerifyObject(Schema_Object* Object, const SchemaBundleDefinitionWithFields& Definition, const FieldPathNode* Path, const bool bSingularFieldsRequired, const int32 Depth, EntityContext& Context) const;
+	uint32 VerifyValues(Schema_Object* Object, const Schema_FieldId FieldId, const SchemaBundleFieldDefinition& Field, const SchemaBundleFieldDefinition::TypeIndex Index, const FieldPathNode& Path, const int32 Depth, EntityContext& Context) const;
+	void VerifyObjectRef(Schema_Object* Object, const Schema_FieldId FieldId, const uint32 Index, const FieldPathNode& Path, EntityContext& Context) const;
+
+	const SchemaBundleDefinitions& Definitions;
+};
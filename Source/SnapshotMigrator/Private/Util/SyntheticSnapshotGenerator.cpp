@@ -0,0 +1,382 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#include "Util/SyntheticSnapshotGenerator.h"
+#include "SnapshotMigratorModuleInternal.h"
+
+#include "Dom/JsonValue.h"
+#include "Misc/ScopeExit.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+#include "Util/SnapshotHelperLibrary.h"
+
+#include "Schema/StandardLibrary.h"
+#include "Schema/UnrealMetadata.h"
+#include "Utils/SchemaUtils.h"
+
+namespace
+{
+	const FString GENERATED_COMPONENT_PREFIX{ TEXT("unreal.generated.") };
+	const FString RENAMED_FIELD_SUFFIX{ TEXT("_renamed") };
+
+	// Every entity is placed somewhere within a cube of this half-extent, in metres.
+	const double WORLD_HALF_EXTENT = 1000.0;
+
+	// Maps each primitive type to the type it is changed to when a field is retyped. Both ends are types that SnapshotDataMigrator supports.
+	const TMap<FString, FString> RETYPED_PRIMITIVES{
+		{ TEXT("Int32"), TEXT("Float") },
+		{ TEXT("Uint32"), TEXT("Int32") },
+		{ TEXT("Bool"), TEXT("Uint32") },
+		{ TEXT("Float"), TEXT("Int32") },
+		{ TEXT("String"), TEXT("Bytes") },
+		{ TEXT("Bytes"), TEXT("String") }
+	};
+
+	TSharedPtr<FJsonObject> GetPrimitiveTypeReference(const TSharedPtr<FJsonObject>& FieldJson)
+	{
+		const TSharedPtr<FJsonObject>* CardinalityJson = nullptr;
+		if (FieldJson->TryGetObjectField(TEXT("singularType"), CardinalityJson))
+		{
+			return (*CardinalityJson)->GetObjectField(TEXT("type"));
+		}
+		if (FieldJson->TryGetObjectField(TEXT("optionType"), CardinalityJson) || FieldJson->TryGetObjectField(TEXT("listType"), CardinalityJson))
+		{
+			return (*CardinalityJson)->GetObjectField(TEXT("innerType"));
+		}
+
+		return nullptr;
+	}
+}
+
+TSharedRef<FJsonObject> SyntheticSnapshotGenerator::Config::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject);
+
+	Json->SetNumberField(FString{ TEXT("NumEntities") }, NumEntities);
+	Json->SetNumberField(FString{ TEXT("MinComponentsPerEntity") }, MinComponentsPerEntity);
+	Json->SetNumberField(FString{ TEXT("MaxComponentsPerEntity") }, MaxComponentsPerEntity);
+	Json->SetNumberField(FString{ TEXT("ListSize") }, ListSize);
+	Json->SetNumberField(FString{ TEXT("RenamedFieldShare") }, RenamedFieldShare);
+	Json->SetNumberField(FString{ TEXT("RetypedFieldShare") }, RetypedFieldShare);
+	Json->SetNumberField(FString{ TEXT("Seed") }, Seed);
+
+	TArray<TSharedPtr<FJsonValue>> ClassMixJson;
+	for (const TPair<FString, float>& Class : ClassMix)
+	{
+		TSharedPtr<FJsonObject> ClassJson = MakeShareable(new FJsonObject);
+		ClassJson->SetStringField(FString{ TEXT("Class") }, Class.Key);
+		ClassJson->SetNumberField(FString{ TEXT("Weight") }, Class.Value);
+		ClassMixJson.Add(MakeShareable<FJsonValueObject>(new FJsonValueObject(ClassJson)));
+	}
+
+	Json->SetArrayField(FString{ TEXT("ClassMix") }, ClassMixJson);
+
+	return Json;
+}
+
+SyntheticSnapshotGenerator::SyntheticSnapshotGenerator(const Config& InConfig, const TSharedPtr<FJsonObject>& InBaseSchemaBundleJson)
+	: GeneratorConfig(InConfig), BaseSchemaBundleJson(InBaseSchemaBundleJson), Random(InConfig.Seed)
+{
+	for (const TPair<FString, float>& Class : GeneratorConfig.ClassMix)
+	{
+		TotalClassWeight += FMath::Max(0.f, Class.Value);
+	}
+}
+
+bool SyntheticSnapshotGenerator::GenerateSourceSchemaBundle(TSharedPtr<FJsonObject>& OutSourceSchemaBundleJson)
+{
+	// Round trip through a string to get a deep copy, so that the base bundle is left untouched.
+	FString BaseSchemaBundleString;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&BaseSchemaBundleString);
+	if (!FJsonSerializer::Serialize(BaseSchemaBundleJson.ToSharedRef(), Writer))
+	{
+		return false;
+	}
+
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(BaseSchemaBundleString);
+	if (!FJsonSerializer::Deserialize(Reader, OutSourceSchemaBundleJson) || !OutSourceSchemaBundleJson.IsValid())
+	{
+		return false;
+	}
+
+	// Fields either live on the component itself or on the type named by its data definition.
+	TSet<FString> MutableDefinitions;
+	{
+		const SchemaBundleDefinitions BaseDefinitions{ BaseSchemaBundleJson };
+		for (const TSharedPtr<FJsonValue>& File : BaseSchemaBundleJson->GetArrayField(TEXT("schemaFiles")))
+		{
+			for (const TSharedPtr<FJsonValue>& Component : File->AsObject()->GetArrayField(TEXT("components")))
+			{
+				const SchemaBundleComponentDefinition& ComponentDefinition = BaseDefinitions.FindComponentChecked(static_cast<uint32>(Component->AsObject()->GetIntegerField(TEXT("componentId"))));
+				if (IsGeneratedComponent(ComponentDefinition))
+				{
+					MutableDefinitions.Add(ComponentDefinition.GetDataDefinition().IsEmpty() ? ComponentDefinition.GetName() : ComponentDefinition.GetDataDefinition());
+				}
+			}
+		}
+	}
+
+	const auto MutateFields = [this](const TSharedPtr<FJsonObject>& DefinitionJson) {
+		for (const TSharedPtr<FJsonValue>& FieldValue : DefinitionJson->GetArrayField(TEXT("fields")))
+		{
+			const TSharedPtr<FJsonObject> FieldJson = FieldValue->AsObject();
+			const TSharedPtr<FJsonObject> TypeReference = GetPrimitiveTypeReference(FieldJson);
+			FString Primitive;
+			if (!TypeReference.IsValid() || !TypeReference->TryGetStringField(TEXT("primitive"), Primitive) || !RETYPED_PRIMITIVES.Contains(Primitive))
+			{
+				continue;
+			}
+
+			// A single roll decides between renaming, retyping and leaving the field alone, so the shares don't overlap.
+			const float Roll = Random.FRand();
+			if (Roll < GeneratorConfig.RenamedFieldShare)
+			{
+				FieldJson->SetStringField(TEXT("name"), FieldJson->GetStringField(TEXT("name")) + RENAMED_FIELD_SUFFIX);
+				GeneratedStats.NumRenamedFields++;
+			}
+			else if (Roll < GeneratorConfig.RenamedFieldShare + GeneratorConfig.RetypedFieldShare)
+			{
+				TypeReference->SetStringField(TEXT("primitive"), RETYPED_PRIMITIVES.FindChecked(Primitive));
+				GeneratedStats.NumRetypedFields++;
+			}
+		}
+	};
+
+	for (const TSharedPtr<FJsonValue>& File : OutSourceSchemaBundleJson->GetArrayField(TEXT("schemaFiles")))
+	{
+		const TSharedPtr<FJsonObject> FileJson = File->AsObject();
+
+		for (const TSharedPtr<FJsonValue>& Type : FileJson->GetArrayField(TEXT("types")))
+		{
+			if (MutableDefinitions.Contains(Type->AsObject()->GetStringField(TEXT("qualifiedName"))))
+			{
+				MutateFields(Type->AsObject());
+			}
+		}
+
+		for (const TSharedPtr<FJsonValue>& Component : FileJson->GetArrayField(TEXT("components")))
+		{
+			const TSharedPtr<FJsonObject> ComponentJson = Component->AsObject();
+			if (SchemaBundleComponentDefinition::ExtractDataDefinition(ComponentJson).IsEmpty() && MutableDefinitions.Contains(ComponentJson->GetStringField(TEXT("qualifiedName"))))
+			{
+				MutateFields(ComponentJson);
+			}
+		}
+	}
+
+	// The snapshot is written with the source bundle, so its component definitions are the ones used to fill in component data.
+	SourceDefinitions = SchemaBundleDefinitions{ OutSourceSchemaBundleJson };
+	GeneratedComponents.Reset();
+	for (const TSharedPtr<FJsonValue>& File : OutSourceSchemaBundleJson->GetArrayField(TEXT("schemaFiles")))
+	{
+		for (const TSharedPtr<FJsonValue>& Component : File->AsObject()->GetArrayField(TEXT("components")))
+		{
+			const SchemaBundleComponentDefinition& ComponentDefinition = SourceDefinitions.FindComponentChecked(static_cast<uint32>(Component->AsObject()->GetIntegerField(TEXT("componentId"))));
+			if (IsGeneratedComponent(ComponentDefinition))
+			{
+				GeneratedComponents.Add(&ComponentDefinition);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool SyntheticSnapshotGenerator::GenerateSnapshot(const FString& SnapshotPath)
+{
+	if (GeneratedComponents.Num() == 0)
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("No data components to generate -- the source schema bundle must be generated first, and the base schema bundle must contain components under '%s'."), *GENERATED_COMPONENT_PREFIX);
+		return false;
+	}
+
+	if (GeneratorConfig.ClassMix.Num() == 0 || TotalClassWeight <= 0.f)
+	{
+		UE_LOG(LogSnapshotMigrator, Error, TEXT("Cannot generate a snapshot without any classes to generate entities for."));
+		return false;
+	}
+
+	const Worker_ComponentVtable DefaultOutputVtable{};
+	Worker_SnapshotParameters OutputParameters{};
+	OutputParameters.default_component_vtable = &DefaultOutputVtable;
+
+	Worker_SnapshotOutputStream* OutputStream = Worker_SnapshotOutputStream_Create(TCHAR_TO_UTF8(*SnapshotPath), &OutputParameters);
+	ON_SCOPE_EXIT
+	{
+		Worker_SnapshotOutputStream_Destroy(OutputStream);
+	};
+
+	if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString{ TEXT("initialise synthetic snapshot output stream") }))
+	{
+		return false;
+	}
+
+	const int32 MaxDataComponents = FMath::Min(GeneratorConfig.MaxComponentsPerEntity, GeneratedComponents.Num());
+	const int32 MinDataComponents = FMath::Min(GeneratorConfig.MinComponentsPerEntity, MaxDataComponents);
+
+	TArray<Worker_ComponentData> Components;
+	TArray<int32> ComponentIndices;
+
+	for (int32 i = 0; i < GeneratorConfig.NumEntities; i++)
+	{
+		Components.Reset();
+
+		const SpatialGDK::Coordinates Coords{
+			Random.FRandRange(-WORLD_HALF_EXTENT, WORLD_HALF_EXTENT),
+			Random.FRandRange(-WORLD_HALF_EXTENT, WORLD_HALF_EXTENT),
+			Random.FRandRange(-WORLD_HALF_EXTENT, WORLD_HALF_EXTENT)
+		};
+		Components.Add(SpatialGDK::Position(Coords).CreatePositionData());
+		Components.Add(SpatialGDK::UnrealMetadata({}, PickClass(), false).CreateUnrealMetadataData());
+
+		// Partial Fisher-Yates shuffle, so that no component is picked twice for the same entity.
+		ComponentIndices.Reset();
+		for (int32 j = 0; j < GeneratedComponents.Num(); j++)
+		{
+			ComponentIndices.Add(j);
+		}
+
+		const int32 NumDataComponents = Random.RandRange(MinDataComponents, MaxDataComponents);
+		for (int32 j = 0; j < NumDataComponents; j++)
+		{
+			ComponentIndices.Swap(j, Random.RandRange(j, ComponentIndices.Num() - 1));
+			Components.Add(CreateComponentData(*GeneratedComponents[ComponentIndices[j]]));
+		}
+
+		Worker_Entity Entity;
+		Entity.entity_id = i + 1;
+		Entity.components = Components.GetData();
+		Entity.component_count = Components.Num();
+
+		Worker_SnapshotOutputStream_WriteEntity(OutputStream, &Entity);
+
+		for (Worker_ComponentData& Component : Components)
+		{
+			Schema_DestroyComponentData(Component.schema_type);
+		}
+
+		if (!SnapshotHelperLibrary::IsStreamStateValid(Worker_SnapshotOutputStream_GetState, OutputStream, FString::Printf(TEXT("write synthetic entity %d"), i + 1)))
+		{
+			return false;
+		}
+
+		GeneratedStats.NumEntities++;
+		GeneratedStats.NumComponents += Components.Num();
+	}
+
+	return true;
+}
+
+bool SyntheticSnapshotGenerator::IsGeneratedPrimitiveType(const SchemaBundleFieldDefinition::SchemaPrimitiveType PrimitiveType)
+{
+	switch (PrimitiveType)
+	{
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Int32:
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Uint32:
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Bool:
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Float:
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::String:
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Bytes:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool SyntheticSnapshotGenerator::IsGeneratedComponent(const SchemaBundleComponentDefinition& ComponentDefinition)
+{
+	if (!ComponentDefinition.GetName().StartsWith(GENERATED_COMPONENT_PREFIX))
+	{
+		return false;
+	}
+
+	return ComponentDefinition.GetFields().ContainsByPredicate([](const SchemaBundleFieldDefinition& FieldDefinition) {
+		return !FieldDefinition.IsMap() && FieldDefinition.IsPrimitive() && IsGeneratedPrimitiveType(FieldDefinition.GetPrimitiveType());
+	});
+}
+
+const FString& SyntheticSnapshotGenerator::PickClass()
+{
+	float Roll = Random.FRand() * TotalClassWeight;
+	for (const TPair<FString, float>& Class : GeneratorConfig.ClassMix)
+	{
+		Roll -= FMath::Max(0.f, Class.Value);
+		if (Roll < 0.f)
+		{
+			return Class.Key;
+		}
+	}
+
+	return GeneratorConfig.ClassMix.Last().Key;
+}
+
+Worker_ComponentData SyntheticSnapshotGenerator::CreateComponentData(const SchemaBundleComponentDefinition& ComponentDefinition)
+{
+	Worker_ComponentData Data;
+	Data.component_id = ComponentDefinition.GetId();
+	Data.schema_type = Schema_CreateComponentData();
+
+	Schema_Object* Fields = Schema_GetComponentDataFields(Data.schema_type);
+
+	for (const SchemaBundleFieldDefinition& FieldDefinition : ComponentDefinition.GetFields())
+	{
+		if (FieldDefinition.IsMap() || !FieldDefinition.IsPrimitive() || !IsGeneratedPrimitiveType(FieldDefinition.GetPrimitiveType()))
+		{
+			continue;
+		}
+
+		int32 NumValues = 1;
+		if (FieldDefinition.IsList())
+		{
+			NumValues = GeneratorConfig.ListSize;
+		}
+		else if (FieldDefinition.IsOptional())
+		{
+			NumValues = Random.RandRange(0, 1);
+		}
+
+		for (int32 i = 0; i < NumValues; i++)
+		{
+			AddRandomPrimitive(Fields, FieldDefinition.GetId(), FieldDefinition.GetPrimitiveType());
+		}
+	}
+
+	return Data;
+}
+
+void SyntheticSnapshotGenerator::AddRandomPrimitive(Schema_Object* Object, const Schema_FieldId FieldId, const SchemaBundleFieldDefinition::SchemaPrimitiveType PrimitiveType)
+{
+	switch (PrimitiveType)
+	{
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Int32:
+		Schema_AddInt32(Object, FieldId, Random.RandHelper(MAX_int32));
+		break;
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Uint32:
+		Schema_AddUint32(Object, FieldId, static_cast<uint32>(Random.GetUnsignedInt()));
+		break;
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Bool:
+		Schema_AddBool(Object, FieldId, Random.RandRange(0, 1));
+		break;
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Float:
+		Schema_AddFloat(Object, FieldId, Random.FRandRange(-WORLD_HALF_EXTENT, WORLD_HALF_EXTENT));
+		break;
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::String:
+		SpatialGDK::AddStringToSchema(Object, FieldId, FString::Printf(TEXT("Synthetic_%08x"), Random.GetUnsignedInt()));
+		break;
+	case SchemaBundleFieldDefinition::SchemaPrimitiveType::Bytes:
+	{
+		uint8 Bytes[16];
+		for (uint8& Byte : Bytes)
+		{
+			Byte = static_cast<uint8>(Random.RandHelper(256));
+		}
+		SpatialGDK::AddBytesToSchema(Object, FieldId, Bytes, sizeof(Bytes));
+		break;
+	}
+	default:
+		checkNoEntry();
+		break;
+	}
+}
@@ -0,0 +1,86 @@
+// Copyright (c) Improbable Worlds Ltd, All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Math/RandomStream.h"
+
+#include <WorkerSDK/improbable/c_schema.h>
+#include <WorkerSDK/improbable/c_worker.h>
+
+#include "Util/SchemaBundleWrappers.h"
+
+/**
+* Generates snapshots, and the schema bundle they were written with, from a base schema bundle: usually either the source or the target bundle
+* of a migration. This lets the migrator be benchmarked without needing a production snapshot.
+*/
+class SyntheticSnapshotGenerator
+{
+public:
+	struct Config
+	{
+		int32 NumEntities = 10000;
+		// Actor classpaths and their relative weights. Each class has to match the classpath whitelist to be migrated rather than skipped.
+		TArray<TPair<FString, float>> ClassMix;
+		int32 MinComponentsPerEntity = 2;
+		int32 MaxComponentsPerEntity = 8;
+		int32 ListSize = 4;
+		// Share of generated fields, in the range [0, 1], that are renamed or given a different type in the source schema bundle.
+		float RenamedFieldShare = 0.f;
+		float RetypedFieldShare = 0.f;
+		int32 Seed = 0;
+
+		TSharedRef<FJsonObject> ToJson() const;
+	};
+
+	struct Stats
+	{
+		int32 NumEntities = 0;
+		int64 NumComponents = 0;
+		int32 NumRenamedFields = 0;
+		int32 NumRetypedFields = 0;
+	};
+
+	SyntheticSnapshotGenerator(const Config& InConfig, const TSharedPtr<FJsonObject>& InBaseSchemaBundleJson);
+
+	/**
+	* Copies the base schema bundle, renaming and retyping a share of the fields of the data components that the generated entities can contain.
+	* Must be called before GenerateSnapshot.
+	*	@param	OutSourceSchemaBundleJson	The schema bundle the generated snapshots are written with
+	*
+	*	@return								True if the bundle could be generated
+	*/
+	bool GenerateSourceSchemaBundle(TSharedPtr<FJsonObject>& OutSourceSchemaBundleJson);
+
+	/**
+	* Writes a snapshot of Config.NumEntities entities. Each entity has an UnrealMetadata component of a class picked from the class mix, a Position
+	* component, and a random selection of data components from the source schema bundle whose fields are filled with random values.
+	*	@param	SnapshotPath	Where to write the snapshot
+	*
+	*	@return					True if the snapshot was written
+	*/
+	bool GenerateSnapshot(const FString& SnapshotPath);
+
+	const Stats& GetStats() const { return GeneratedStats; }
+
+private:
+	// Only the primitive types SnapshotDataMigrator knows how to migrate are generated.
+	static bool IsGeneratedPrimitiveType(const SchemaBundleFieldDefinition::SchemaPrimitiveType PrimitiveType);
+	static bool IsGeneratedComponent(const SchemaBundleComponentDefinition& ComponentDefinition);
+
+	const FString& PickClass();
+	Worker_ComponentData CreateComponentData(const SchemaBundleComponentDefinition& ComponentDefinition);
+	void AddRandomPrimitive(Schema_Object* Object, const Schema_FieldId FieldId, const SchemaBundleFieldDefinition::SchemaPrimitiveType PrimitiveType);
+
+	const Config GeneratorConfig;
+	const TSharedPtr<FJsonObject> BaseSchemaBundleJson;
+	FRandomStream Random;
+
+	// Empty until the source schema bundle has been generated. GeneratedComponents point into it.
+	SchemaBundleDefinitions SourceDefinitions;
+	TArray<const SchemaBundleComponentDefinition*> GeneratedComponents;
+	float TotalClassWeight = 0.f;
+
+	Stats GeneratedStats;
+};
@@ -17,6 +17,7 @@ public class SnapshotMigrator : ModuleRules
 				"CoreUObject",
 				"Engine",
 				"Json",
+				"Projects",
 				"UnrealEd",
 				"SpatialGDK", 
 				"SpatialGDKServices"